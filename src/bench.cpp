@@ -0,0 +1,1224 @@
+#include "bench.h"
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// number of operator new calls in the whole program, allocations per record of the suite
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* result = std::malloc(size == 0 ? 1 : size);
+    if (result == nullptr) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+double bench_mutex_queue(const size_t producers, const size_t total) {
+    std::queue<bench_entry> queue;
+    std::mutex mtx;
+    std::condition_variable cv;
+    const size_t per_thread = total / producers;
+    const size_t expected = per_thread * producers;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        size_t received = 0;
+        while (received < expected) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return !queue.empty(); });
+            while (!queue.empty()) {
+                bench_entry entry = std::move(queue.front());
+                queue.pop();
+                ++received;
+            }
+        }
+    });
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < producers; ++t) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < per_thread; ++i) {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    queue.push(bench_entry{"info", "benchmark message"});
+                }
+                cv.notify_one();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return expected / elapsed.count();
+}
+
+double bench_mpsc_ring(const size_t producers, const size_t total) {
+    mpsc_ring<bench_entry> queue(65536);
+    const size_t per_thread = total / producers;
+    const size_t expected = per_thread * producers;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        size_t received = 0;
+        bench_entry entry;
+        while (received < expected) {
+            while (queue.try_pop(entry)) {
+                ++received;
+            }
+            if (received < expected) {
+                queue.wait();
+            }
+        }
+    });
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < producers; ++t) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < per_thread; ++i) {
+                bench_entry entry{"info", "benchmark message"};
+                while (!queue.try_push(std::move(entry))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return expected / elapsed.count();
+}
+
+void run_queue_bench() {
+    const size_t total = 1000000;
+    std::cout << "queue: producers, mutex_queue msg/s, mpsc_ring msg/s" << std::endl;
+    for (const size_t producers : {1, 4, 16, 64}) {
+        const double mutex_rate = bench_mutex_queue(producers, total);
+        const double ring_rate = bench_mpsc_ring(producers, total);
+        std::cout << "queue: " << producers << ", " << static_cast<size_t>(mutex_rate) << ", "
+                  << static_cast<size_t>(ring_rate) << std::endl;
+    }
+}
+
+const time_string legacy_get_time() {
+    std::time_t now_time_t = std::time(nullptr);
+    const std::tm* now_tm = std::localtime(&now_time_t);
+    struct time_string time;
+    time.hour[0] = now_tm->tm_hour / 10 + '0';
+    time.hour[1] = now_tm->tm_hour % 10 + '0';
+    time.min[0] = now_tm->tm_min / 10 + '0';
+    time.min[1] = now_tm->tm_min % 10 + '0';
+    time.sec[0] = now_tm->tm_sec / 10 + '0';
+    time.sec[1] = now_tm->tm_sec % 10 + '0';
+    time.hour[2] = '\0';
+    time.min[2] = '\0';
+    time.sec[2] = '\0';
+    return time;
+}
+
+double bench_timestamp(const timestamp_format& format, const size_t count) {
+    timestamp_engine engine(format);
+    char out[timestamp_engine::max_size];
+    size_t check = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        check += engine.format_now(out);
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (check == 0) {
+        std::cout << "time: empty stamps" << std::endl;
+    }
+    return elapsed.count() / count;
+}
+
+void run_time_bench() {
+    const size_t count = 2000000;
+    size_t check = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        check += legacy_get_time().sec[1];
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (check == 0) {
+        std::cout << "time: empty stamps" << std::endl;
+    }
+    std::cout << "time: variant, ns/stamp" << std::endl;
+    std::cout << "time: legacy time_string, " << elapsed.count() / count << std::endl;
+
+    const struct {
+        const char* name;
+        timestamp_format format;
+    } variants[] = {
+        {"HH:MM:SS realtime", {time_layout, seconds_precision, realtime_clock}},
+        {"HH:MM:SS.us realtime", {time_layout, micros_precision, realtime_clock}},
+        {"HH:MM:SS.ns realtime", {time_layout, nanos_precision, realtime_clock}},
+        {"HH:MM:SS.ns monotonic", {time_layout, nanos_precision, monotonic_clock}},
+        {"ISO-8601.ns realtime", {iso8601_layout, nanos_precision, realtime_clock}},
+    };
+    for (const auto& variant : variants) {
+        std::cout << "time: " << variant.name << ", " << bench_timestamp(variant.format, count) << std::endl;
+    }
+}
+
+std::string make_bench_file(const std::string& name) {
+    const std::string result = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream create(result, std::ios::trunc);
+    create.close();
+    return result;
+}
+
+double bench_async_producer(const bool deferred, const size_t count) {
+    const std::string path = make_bench_file("bench_format.log");
+    logger log(path, info_log_type);
+    flush_policy policy;
+    policy.buffer_size = 64 * 1024;
+    log.set_flush_policy(policy);
+    log.run_logger();
+
+    std::chrono::duration<double, std::nano> elapsed{0};
+    {
+        // the queue holds every record, so the producer never waits for the writer
+        async_logger async_log(log, count);
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            if (deferred) {
+                async_log.log(info_log_type, "request {} from {} took {} ms", i, "client", 0.5 * i);
+            } else {
+                async_log.put_log("request " + std::to_string(i) + " from " + "client" + " took " +
+                                      std::to_string(0.5 * i) + " ms",
+                                  info_log_type);
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    log.stop_logger();
+    std::filesystem::remove(path);
+    return elapsed.count() / count;
+}
+
+/**
+ * @brief Level of a level name by comparing it with every name.
+ *
+ * The comparison chain log_type_from_name replaces, kept for the comparison.
+ *
+ * @param[in] level debug, info, warn, error or critical.
+ *
+ * @return log_type, _unknown_log_type for other names
+ */
+static log_type _compare_chain_level(const std::string& level) {
+    log_type result = _unknown_log_type;
+    if (level == "debug") {
+        result = debug_log_type;
+    }
+    if (level == "info") {
+        result = info_log_type;
+    }
+    if (level == "warn") {
+        result = warn_log_type;
+    }
+    if (level == "error") {
+        result = error_log_type;
+    }
+    if (level == "critical") {
+        result = critical_log_type;
+    }
+    return result;
+}
+
+double bench_level_parse(const bool table, const size_t count) {
+    const std::string names[] = {"debug", "info", "warn", "error", "critical", "$set_default", "request 42"};
+    const size_t size = sizeof(names) / sizeof(names[0]);
+    // the sum keeps the results from being optimized away
+    volatile int sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& name = names[i % size];
+        sum = sum + (table ? log_type_from_name(name, true) : _compare_chain_level(name));
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / count;
+}
+
+void run_format_bench() {
+    const size_t count = 100000;
+    std::cout << "format: variant, producer ns/record" << std::endl;
+    std::cout << "format: eager std::string + put_log, " << bench_async_producer(false, count) << std::endl;
+    std::cout << "format: deferred log(fmt, args...), " << bench_async_producer(true, count) << std::endl;
+    std::cout << "format: level name, compare chain ns, log_type_from_name ns" << std::endl;
+    std::cout << "format: level name, " << bench_level_parse(false, 100 * count) << ", "
+              << bench_level_parse(true, 100 * count) << std::endl;
+}
+
+double bench_write_corpus(const std::string& path, const record_format format, const size_t count) {
+    logger log(path, info_log_type);
+    flush_policy policy;
+    policy.buffer_size = 64 * 1024;
+    log.set_flush_policy(policy);
+    log.set_record_format(format);
+    log.run_logger();
+
+    const char* users[] = {"alice", "bob", "carol", "dave"};
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 2 == 0) {
+            log.put_log("health check passed for the storage backend", info_log_type);
+        } else {
+            log.log(warn_log_type, "request {} from user {} took {} ms", i, users[i % 4], 0.25 * (i % 1000));
+        }
+    }
+    log.stop_logger();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return count / elapsed.count();
+}
+
+void run_binary_bench() {
+    const size_t count = 500000;
+    const std::string text_path = make_bench_file("bench_text.log");
+    const std::string binary_path = make_bench_file("bench_binary.log");
+
+    const double text_rate = bench_write_corpus(text_path, text_format, count);
+    const double binary_rate = bench_write_corpus(binary_path, binary_format, count);
+
+    std::ifstream in(binary_path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    binary_decoder decoder;
+    timestamp_engine stamp;
+    binary_record record;
+    std::string text;
+    size_t decoded = 0;
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* end = pos + data.size();
+    const auto start = std::chrono::steady_clock::now();
+    while (decoder.next(pos, end, record) == binary_ok) {
+        binary_record_to_text(record, stamp, text);
+        text.clear();
+        ++decoded;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "binary: format, bytes, bytes/record, write records/s" << std::endl;
+    std::cout << "binary: text, " << std::filesystem::file_size(text_path) << ", "
+              << std::filesystem::file_size(text_path) / static_cast<double>(count) << ", "
+              << static_cast<size_t>(text_rate) << std::endl;
+    std::cout << "binary: binary, " << data.size() << ", " << data.size() / static_cast<double>(count) << ", "
+              << static_cast<size_t>(binary_rate) << std::endl;
+    std::cout << "binary: decode to text records/s, " << static_cast<size_t>(decoded / elapsed.count())
+              << std::endl;
+    std::filesystem::remove(text_path);
+    std::filesystem::remove(binary_path);
+}
+
+double bench_structured_corpus(const std::string& path, const record_format format, const size_t count) {
+    logger log(path, info_log_type);
+    flush_policy policy;
+    policy.buffer_size = 64 * 1024;
+    log.set_flush_policy(policy);
+    log.set_record_format(format);
+    log.run_logger();
+
+    const char* users[] = {"alice", "bob", "carol", "dave"};
+    log_fields fields;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        fields.clear();
+        fields.add("user", users[i % 4]).add("request", i).add("ms", 0.25 * (i % 1000));
+        fields.add("path", "/api/v1/items?name=\"storage backend\"");
+        log.put_log("request done", fields, info_log_type);
+    }
+    log.stop_logger();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return count / elapsed.count();
+}
+
+/**
+ * @brief Escape a JSON string byte by byte.
+ *
+ * The loop json_escape replaces, kept for the comparison.
+ *
+ * @param[out] out result.
+ * @param[in] text string.
+ */
+static void _scalar_json_escape(std::string& out, std::string_view text) {
+    for (const char value : text) {
+        if (value == '"' || value == '\\') {
+            out += '\\';
+            out += value;
+        } else if (static_cast<unsigned char>(value) <= 0x1F) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(value));
+            out += code;
+        } else {
+            out += value;
+        }
+    }
+}
+
+double bench_json_escape(const bool simd, const size_t length, const size_t count) {
+    std::string text(length, 'a');
+    for (size_t i = 63; i < length; i += 64) {
+        text[i] = '"';
+    }
+    std::string out;
+    out.reserve(2 * length);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        out.clear();
+        if (simd) {
+            json_escape(out, text);
+        } else {
+            _scalar_json_escape(out, text);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return length * count / elapsed.count() / 1e6;
+}
+
+void run_structured_bench() {
+    const size_t count = 500000;
+    const std::pair<const char*, record_format> layouts[] = {
+        {"text", text_format}, {"json", json_format}, {"logfmt", logfmt_format}};
+    std::cout << "structured: layout, bytes/record, write records/s" << std::endl;
+    for (const auto& layout : layouts) {
+        const std::string path = make_bench_file("bench_structured.log");
+        const double rate = bench_structured_corpus(path, layout.second, count);
+        std::cout << "structured: " << layout.first << ", "
+                  << std::filesystem::file_size(path) / static_cast<double>(count) << ", "
+                  << static_cast<size_t>(rate) << std::endl;
+        std::filesystem::remove(path);
+    }
+
+    std::cout << "structured: escape, string bytes, simd MB/s, byte loop MB/s" << std::endl;
+    for (const size_t length : {32, 256, 4096}) {
+        const size_t escapes = 200000000 / length;
+        std::cout << "structured: escape, " << length << ", "
+                  << static_cast<size_t>(bench_json_escape(true, length, escapes)) << ", "
+                  << static_cast<size_t>(bench_json_escape(false, length, escapes)) << std::endl;
+    }
+}
+
+io_bench_result bench_io_backend(const io_backend_type backend, const size_t producers, const size_t total) {
+    // a local filesystem, the temporary directory may be tmpfs
+    const std::string path = "bench_io.log";
+    std::ofstream create(path, std::ios::trunc);
+    create.close();
+    logger log(path, info_log_type);
+    log.set_io_backend(backend);
+    log.run_logger();
+
+    const size_t per_thread = total / producers;
+    std::vector<std::vector<double>> latencies(producers);
+    auto async_log = std::make_unique<async_logger>(log, 4096);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < producers; ++t) {
+        threads.emplace_back([&, t] {
+            latencies[t].reserve(per_thread);
+            for (size_t i = 0; i < per_thread; ++i) {
+                const auto before = std::chrono::steady_clock::now();
+                async_log->log(info_log_type, "request {} from worker {} handled", i, t);
+                const std::chrono::duration<double, std::nano> took =
+                    std::chrono::steady_clock::now() - before;
+                latencies[t].push_back(took.count());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // the destructor waits until the writer has written every record
+    async_log.reset();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    log.stop_logger();
+    std::filesystem::remove(path);
+
+    std::vector<double> all;
+    for (const auto& thread_latencies : latencies) {
+        all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+    const size_t p99 = all.size() * 99 / 100;
+    std::nth_element(all.begin(), all.begin() + p99, all.end());
+    return {per_thread * producers / elapsed.count(), all[p99]};
+}
+
+void run_io_bench() {
+    const size_t total = 400000;
+    const std::pair<io_backend_type, const char*> backends[] = {
+        {stream_backend, "stream"},
+        {pwritev_backend, "pwritev"},
+        {io_uring_backend, "io_uring"},
+        {mmap_ring_backend, "mmap_ring"}};
+    std::cout << "io: backend, producers, records/s, p99 enqueue ns" << std::endl;
+    for (const auto& backend : backends) {
+        for (const size_t producers : {1, 4}) {
+            const io_bench_result result = bench_io_backend(backend.first, producers, total);
+            std::cout << "io: " << backend.second << ", " << producers << ", "
+                      << static_cast<size_t>(result.records_per_second) << ", "
+                      << static_cast<size_t>(result.p99_enqueue_ns) << std::endl;
+        }
+    }
+}
+
+double bench_ingest(const size_t block_size, const size_t count) {
+    const std::string path = make_bench_file("bench_ingest.log");
+    logger log(path, info_log_type);
+    log.run_logger();
+    std::string text;
+    std::vector<bulk_entry> all;
+    for (size_t i = 0; i < count; ++i) {
+        const std::string message = "request " + std::to_string(i) + " handled by worker in 12 ms";
+        bulk_entry entry;
+        entry.offset = static_cast<uint32_t>(text.size());
+        entry.size = static_cast<uint32_t>(message.size());
+        entry.type = static_cast<log_type>(i % 5);
+        text += message;
+        all.push_back(entry);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+        async_logger async_log(log, block_size == 0 ? 1024 : 16);
+        if (block_size == 0) {
+            for (const bulk_entry& entry : all) {
+                async_log.put_log(std::string_view(text.data() + entry.offset, entry.size), entry.type);
+            }
+        }
+        for (size_t first = 0; block_size > 0 && first < all.size();) {
+            // the block is copied as it would be read from the input, the offsets are moved to its start
+            const uint32_t base = all[first].offset;
+            size_t last = first;
+            while (last < all.size() && all[last].offset - base < block_size) {
+                ++last;
+            }
+            const size_t end = last < all.size() ? all[last].offset : text.size();
+            std::vector<bulk_entry> entries(all.begin() + first, all.begin() + last);
+            for (bulk_entry& entry : entries) {
+                entry.offset -= base;
+            }
+            async_log.put_bulk(text.substr(base, end - base), std::move(entries));
+            first = last;
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::filesystem::remove(path);
+    return count / elapsed.count();
+}
+
+void run_ingest_bench() {
+    const size_t count = 1000000;
+    std::cout << "ingest: mode, records/s" << std::endl;
+    const std::pair<const char*, size_t> modes[] = {
+        {"put_log", 0}, {"put_bulk 64 KB", 64 * 1024}, {"put_bulk 1 MB", 1024 * 1024}};
+    for (const auto& mode : modes) {
+        std::cout << "ingest: " << mode.first << ", " << static_cast<size_t>(bench_ingest(mode.second, count))
+                  << std::endl;
+    }
+}
+
+double bench_flood(const rate_limit_policy* policy, const size_t count, uintmax_t& bytes) {
+    const std::string path = make_bench_file("bench_flood.log");
+    logger log(path, info_log_type);
+    log.run_logger();
+    if (policy != nullptr) {
+        log.set_rate_limit(*policy);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    {
+        async_logger async_log(log, 1024);
+        for (size_t i = 0; i < count; ++i) {
+            if (policy == nullptr) {
+                LOGGER_LOG(async_log, error_log_type, "error: upstream connection refused");
+            } else {
+                LOGGER_LIMITED(async_log, error_log_type, "error: upstream connection refused");
+            }
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    log.stop_logger();
+    bytes = std::filesystem::file_size(path);
+    std::filesystem::remove(path);
+    return count / elapsed.count();
+}
+
+void run_limit_bench() {
+    const size_t count = 1000000;
+    rate_limit_policy collapse;
+    collapse.collapse = true;
+    rate_limit_policy rate;
+    rate.rate = 1000;
+    rate.burst = 100;
+    rate_limit_policy sample;
+    sample.sample[error_log_type] = 0.01;
+    const std::pair<const char*, const rate_limit_policy*> modes[] = {
+        {"LOGGER_LOG", nullptr}, {"collapse", &collapse}, {"rate 1000/s", &rate}, {"sample 1%", &sample}};
+    std::cout << "limit: mode, records/s, file bytes" << std::endl;
+    for (const auto& mode : modes) {
+        uintmax_t bytes = 0;
+        const double records = bench_flood(mode.second, count, bytes);
+        std::cout << "limit: " << mode.first << ", " << static_cast<size_t>(records) << ", " << bytes
+                  << std::endl;
+    }
+}
+
+payload_bench_result bench_payload(const size_t producers, const size_t cap, const size_t count) {
+    const std::string path = make_bench_file("bench_payload.log");
+    logger log(path, info_log_type);
+    log.run_logger();
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < 64; ++i) {
+        messages.push_back("request " + std::to_string(i) + " handled " + std::string(i * 6 % 360, '.'));
+    }
+
+    payload_bench_result result;
+    const size_t per_thread = count / producers;
+    const size_t allocations_before = allocations.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    {
+        async_logger async_log(log, 4096, block_policy);
+        async_log.set_memory_cap(cap);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < producers; ++t) {
+            threads.emplace_back([&, t] {
+                for (size_t i = 0; i < per_thread; ++i) {
+                    async_log.put_log(messages[(i + t) % messages.size()], info_log_type);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        result.pool = async_log.get_payload_stats();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const size_t heap = allocations.load(std::memory_order_relaxed) - allocations_before;
+    std::filesystem::remove(path);
+    result.records_per_second = per_thread * producers / elapsed.count();
+    result.allocations_per_record = static_cast<double>(heap) / (per_thread * producers);
+    return result;
+}
+
+void run_pool_bench() {
+    const size_t count = 1000000;
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < 64; ++i) {
+        messages.push_back("request " + std::to_string(i) + " handled " + std::string(i * 6 % 360, '.'));
+    }
+    // a window of messages is alive at a time, as in the queue
+    const size_t window = 1024;
+    std::cout << "pool: copy, ns per message" << std::endl;
+    {
+        std::vector<std::string> copies(window);
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            copies[i % window] = std::string(messages[i % messages.size()]);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "pool: std::string, " << elapsed.count() / count << std::endl;
+    }
+    {
+        payload_pool pool;
+        std::vector<payload> copies(window);
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            copies[i % window].assign(pool, messages[i % messages.size()]);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "pool: payload, " << elapsed.count() / count << std::endl;
+    }
+
+    std::cout << "pool: producers, cap, records/s, allocations per record, cache hit %, reserved KB"
+              << std::endl;
+    for (const size_t producers : {1, 4}) {
+        for (const size_t cap : {size_t{0}, size_t{1024 * 1024}}) {
+            const payload_bench_result result = bench_payload(producers, cap, count);
+            std::cout << "pool: " << producers << ", " << (cap == 0 ? "none" : "1 MB") << ", "
+                      << static_cast<size_t>(result.records_per_second) << ", "
+                      << result.allocations_per_record << ", "
+                      << 100.0 * result.pool.cache_hits / result.pool.allocations << ", "
+                      << result.pool.reserved_bytes / 1024 << std::endl;
+        }
+    }
+}
+
+double bench_writers(const size_t files, const size_t workers, const size_t producers, const size_t count) {
+    std::vector<std::string> paths;
+    std::vector<std::unique_ptr<logger>> logs;
+    for (size_t i = 0; i < files; ++i) {
+        paths.push_back(make_bench_file("bench_writers_" + std::to_string(i) + ".log"));
+        logs.push_back(std::make_unique<logger>(paths.back(), info_log_type));
+        logs.back()->run_logger();
+    }
+    const size_t per_thread = count / producers;
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::unique_ptr<writer_pool> writers;
+        if (workers > 0) {
+            writers = std::make_unique<writer_pool>(workers);
+        }
+        std::vector<std::unique_ptr<async_logger>> async_logs;
+        for (const auto& log : logs) {
+            if (writers != nullptr) {
+                async_logs.push_back(std::make_unique<async_logger>(*log, *writers, 1024));
+            } else {
+                async_logs.push_back(std::make_unique<async_logger>(*log, 1024));
+            }
+        }
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < producers; ++t) {
+            threads.emplace_back([&, t] {
+                for (size_t i = 0; i < per_thread; ++i) {
+                    async_logs[(i + t) % files]->put_log("request handled by worker in 12 ms", info_log_type);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    logs.clear();
+    for (const std::string& path : paths) {
+        std::filesystem::remove(path);
+    }
+    return per_thread * producers / elapsed.count();
+}
+
+void run_writers_bench() {
+    const size_t files = 32;
+    const size_t count = 1000000;
+    std::cout << "writers: files, writer threads, producers, records/s" << std::endl;
+    for (const size_t producers : {1, 4}) {
+        for (const size_t workers : {0, 1, 2, 4}) {
+            std::cout << "writers: " << files << ", "
+                      << (workers == 0 ? std::to_string(files) + " own" : std::to_string(workers) + " pool")
+                      << ", " << producers << ", "
+                      << static_cast<size_t>(bench_writers(files, workers, producers, count)) << std::endl;
+        }
+    }
+}
+
+durable_bench_result bench_durable(const std::string& path, const size_t producers, const double seconds) {
+    std::filesystem::remove(path);
+    logger log(path, info_log_type);
+    log.run_logger();
+    std::atomic<uint64_t> saved{0};
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<double>(seconds));
+    if (producers == 0) {
+        while (std::chrono::steady_clock::now() < deadline) {
+            log.put_log("payment 42 committed by worker in 12 ms", info_log_type);
+            saved += log.sync() == LOG_SAVED_LOGGER;
+        }
+    } else {
+        async_logger async_log(log, 4096);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < producers; ++t) {
+            threads.emplace_back([&] {
+                while (std::chrono::steady_clock::now() < deadline) {
+                    const LoggerReturn status =
+                        async_log.put_durable("payment 42 committed by worker in 12 ms", info_log_type);
+                    saved += status == LOG_SAVED_LOGGER;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const uint64_t syncs = log.get_stats().sync_latency.count;
+    log.stop_logger();
+    std::filesystem::remove(path);
+    return {syncs / elapsed.count(), saved / elapsed.count()};
+}
+
+void run_durable_bench() {
+    // a local filesystem, the temporary directory may be tmpfs
+    const std::string path = "bench_durable.log";
+    std::cout << "durable: producers, syncs/s, durable records/s, records per sync" << std::endl;
+    for (const size_t producers : {0, 1, 2, 4, 8, 16, 32}) {
+        const durable_bench_result result = bench_durable(path, producers, 1);
+        std::cout << "durable: " << (producers == 0 ? "1 sync per record" : std::to_string(producers)) << ", "
+                  << static_cast<size_t>(result.syncs_per_second) << ", "
+                  << static_cast<size_t>(result.records_per_second) << ", "
+                  << result.records_per_second / std::max(result.syncs_per_second, 1.0) << std::endl;
+    }
+}
+
+void bench_scan_corpus(const std::string& path, const uint64_t bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::string block;
+    uint64_t written = 0;
+    for (size_t i = 0; written < bytes; ++i) {
+        const size_t second = (i / 1000) % 86400;
+        char time[16];
+        std::snprintf(time, sizeof(time), "%02zu:%02zu:%02zu", second / 3600, second / 60 % 60, second % 60);
+        block += '[';
+        block += _log_type_to_string(static_cast<log_type>(i % 5));
+        block += "] request ";
+        block += std::to_string(i);
+        block += i % 100 == 0 ? " failed: upstream timeout after 3 retries " : " handled by worker in 12 ms ";
+        block += time;
+        block += '\n';
+        if (block.size() >= 1024 * 1024) {
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            written += block.size();
+            block.clear();
+        }
+    }
+    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+}
+
+double bench_scan_log(const mapped_file& file, const scan_filter& filter, const size_t threads,
+                      uint64_t& matched) {
+    const auto start = std::chrono::steady_clock::now();
+    matched = scan_log(file.data(), file.size(), filter, threads, nullptr).matched;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return file.size() / elapsed.count() / 1e9;
+}
+
+double bench_grep(const std::string& arguments, const std::string& path, uint64_t& matched) {
+    const std::string command = "LC_ALL=C grep -c " + arguments + " '" + path + "'";
+    const auto start = std::chrono::steady_clock::now();
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) return 0;
+    unsigned long long count = 0;
+    const bool read = std::fscanf(pipe, "%llu", &count) == 1;
+    const bool finished = pclose(pipe) != -1;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    matched = count;
+    return read && finished ? std::filesystem::file_size(path) / elapsed.count() / 1e9 : 0;
+}
+
+void run_scan_bench(const double gigabytes) {
+    // a local filesystem, the temporary directory may be tmpfs
+    const std::string path = "bench_scan.log";
+    bench_scan_corpus(path, static_cast<uint64_t>(gigabytes * 1e9));
+    mapped_file file;
+    if (!file.open(path)) {
+        std::cout << "scan: cannot map " << path << std::endl;
+        std::filesystem::remove(path);
+        return;
+    }
+
+    struct scan_query {
+        const char* name;
+        scan_filter filter;
+        // the same selection for grep
+        std::string grep;
+    };
+    std::vector<scan_query> queries(3);
+    queries[0].name = "level";
+    queries[0].filter.levels = 1U << error_log_type;
+    queries[0].grep = "'^\\[ERROR\\] '";
+    queries[1].name = "substring";
+    queries[1].filter.substring = "timeout";
+    queries[1].grep = "-F timeout";
+    queries[2].name = "level+substring";
+    queries[2].filter.levels = 1U << error_log_type;
+    queries[2].filter.substring = "timeout";
+    queries[2].grep = "'^\\[ERROR\\] .*timeout'";
+
+    const size_t cores = std::max(1U, std::thread::hardware_concurrency());
+    uint64_t matched = 0;
+    bench_scan_log(file, queries[0].filter, cores, matched);
+    std::cout << "scan: " << file.size() / 1e9 << " GB, " << cores << " cores" << std::endl;
+    std::cout << "scan: query, scan_log 1 thread GB/s, scan_log " << cores << " threads GB/s, grep -c GB/s, "
+              << "same count" << std::endl;
+    for (const scan_query& query : queries) {
+        uint64_t single_count = 0;
+        uint64_t parallel_count = 0;
+        uint64_t grep_count = 0;
+        const double single = bench_scan_log(file, query.filter, 1, single_count);
+        const double parallel = bench_scan_log(file, query.filter, cores, parallel_count);
+        const double grep = bench_grep(query.grep, path, grep_count);
+        std::cout << "scan: " << query.name << ", " << single << ", " << parallel << ", " << grep << ", "
+                  << (single_count == grep_count && parallel_count == grep_count ? "yes" : "no") << std::endl;
+    }
+    file.close();
+    std::filesystem::remove(path);
+}
+
+double bench_index_query(const mapped_file& file, const std::vector<index_entry>& entries,
+                         const scan_filter& filter, const bool use_index, scan_stats& result) {
+    const auto start = std::chrono::steady_clock::now();
+    if (use_index) {
+        result = scan_log_ranges(file.data(), index_ranges(entries, file.size(), filter), filter, 1, nullptr);
+    } else {
+        result = scan_log(file.data(), file.size(), filter, 1, nullptr);
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void run_index_bench(const double gigabytes) {
+    const std::string path = "bench_index.log";
+    std::filesystem::remove(path);
+    std::filesystem::remove(index_path(path));
+    {
+        logger log(path, debug_log_type);
+        timestamp_format format;
+        format.precision = micros_precision;
+        log.set_timestamp_format(format);
+        log.set_index();
+        log.run_logger();
+        // about 60 bytes per record
+        const uint64_t count = static_cast<uint64_t>(gigabytes * 1e9 / 60);
+        for (uint64_t i = 0; i < count; ++i) {
+            const bool burst = i >= count / 2 && i < count / 2 + 1000;
+            log.put_log("request " + std::to_string(i) + " handled by worker",
+                        burst ? critical_log_type : static_cast<log_type>(i % 4));
+        }
+        log.stop_logger();
+    }
+    mapped_file file;
+    std::vector<index_entry> entries;
+    if (!file.open(path) || !load_log_index(path, file.size(), entries) || entries.size() < 10) {
+        std::cout << "index: cannot read " << path << " and its index" << std::endl;
+        std::filesystem::remove(path);
+        std::filesystem::remove(index_path(path));
+        return;
+    }
+
+    std::vector<std::pair<const char*, scan_filter>> queries(3);
+    // the last tenth of the log
+    const index_entry& tail = entries[entries.size() - entries.size() / 10];
+    timestamp_format format;
+    format.precision = micros_precision;
+    timestamp_engine engine(format);
+    char from[timestamp_engine::max_size];
+    queries[0] = {"time range", scan_filter{}};
+    queries[0].second.from = std::string(from, engine.format_time(tail.earliest, from));
+    queries[1] = {"critical", scan_filter{}};
+    queries[1].second.levels = 1U << critical_log_type;
+    queries[2] = {"error", scan_filter{}};
+    queries[2].second.levels = 1U << error_log_type;
+
+    scan_stats warm;
+    bench_index_query(file, entries, queries[2].second, false, warm);
+    std::cout << "index: " << file.size() / 1e6 << " MB, " << entries.size() << " blocks, "
+              << std::filesystem::file_size(index_path(path)) / 1e3 << " KB index" << std::endl;
+    std::cout << "index: query, full scan ms, indexed ms, indexed MB scanned, same lines" << std::endl;
+    for (const auto& query : queries) {
+        scan_stats full;
+        scan_stats indexed;
+        const double full_ms = bench_index_query(file, entries, query.second, false, full);
+        const double indexed_ms = bench_index_query(file, entries, query.second, true, indexed);
+        std::cout << "index: " << query.first << ", " << full_ms << ", " << indexed_ms << ", "
+                  << indexed.bytes / 1e6 << ", " << (full.matched == indexed.matched ? "yes" : "no")
+                  << std::endl;
+    }
+    file.close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(index_path(path));
+}
+
+latency_histogram::latency_histogram() : counts((64 - sub_bits + 1) << sub_bits, 0) {}
+
+size_t latency_histogram::_bucket(const uint64_t value) {
+    size_t result = value;
+    if (value >= (1u << sub_bits)) {
+        const int exponent = 63 - __builtin_clzll(value);
+        const int shift = exponent - sub_bits;
+        result = (static_cast<size_t>(shift + 1) << sub_bits) + ((value >> shift) & ((1u << sub_bits) - 1));
+    }
+    return result;
+}
+
+uint64_t latency_histogram::_upper(const size_t index) {
+    uint64_t result = index;
+    if (index >= (1u << sub_bits)) {
+        const int shift = static_cast<int>(index >> sub_bits) - 1;
+        const uint64_t sub = index & ((1u << sub_bits) - 1);
+        result = (((1u << sub_bits) + sub + 1) << shift) - 1;
+    }
+    return result;
+}
+
+void latency_histogram::merge(const latency_histogram& other) {
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    max_value = other.max_value > max_value ? other.max_value : max_value;
+}
+
+uint64_t latency_histogram::percentile(const double quantile) const {
+    const uint64_t rank = static_cast<uint64_t>(quantile * total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen > rank) {
+            return std::min(_upper(i), max_value);
+        }
+    }
+    return max_value;
+}
+
+suite_result bench_suite_case(const suite_case& params, const size_t total) {
+    // a local filesystem, the temporary directory may be tmpfs
+    const std::string path = "bench_suite.log";
+    std::ofstream create(path, std::ios::trunc);
+    create.close();
+    logger log(path, info_log_type);
+    flush_policy policy;
+    policy.buffer_size = 64 * 1024;
+    log.set_flush_policy(policy);
+    log.run_logger();
+
+    const std::string payload(params.message_size, 'x');
+    const size_t per_thread = total / params.threads;
+    std::vector<latency_histogram> latencies(params.threads);
+    auto async_log =
+        std::make_unique<async_logger>(log, 4096, block_policy, warn_log_type, nullptr, thread_staging);
+
+    const size_t allocations_before = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < params.threads; ++t) {
+        threads.emplace_back([&, t] {
+            const std::string_view message(payload);
+            for (size_t i = 0; i < per_thread; ++i) {
+                const log_type level = i % 100 < params.hit_percent ? warn_log_type : debug_log_type;
+                const auto before = std::chrono::steady_clock::now();
+                async_log->log(level, "request {} payload {}", i, message);
+                const auto took = std::chrono::steady_clock::now() - before;
+                latencies[t].record(std::chrono::duration_cast<std::chrono::nanoseconds>(took).count());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // the destructor waits until the writer has written every record
+    async_log.reset();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const size_t allocated = allocations.load() - allocations_before;
+    log.stop_logger();
+
+    for (size_t t = 1; t < latencies.size(); ++t) {
+        latencies[0].merge(latencies[t]);
+    }
+    const size_t calls = per_thread * params.threads;
+    const size_t written = (per_thread / 100 * params.hit_percent +
+                            std::min<size_t>(per_thread % 100, params.hit_percent)) *
+                           params.threads;
+    suite_result result;
+    result.calls_per_second = calls / elapsed.count();
+    result.p50_ns = latencies[0].percentile(0.5);
+    result.p99_ns = latencies[0].percentile(0.99);
+    result.p999_ns = latencies[0].percentile(0.999);
+    result.max_ns = latencies[0].max();
+    result.bytes = std::filesystem::file_size(path);
+    result.bytes_per_record = written > 0 ? static_cast<double>(result.bytes) / written : 0;
+    result.allocations_per_call = static_cast<double>(allocated) / calls;
+    std::filesystem::remove(path);
+    return result;
+}
+
+/**
+ * @brief Round a non-negative value to a step (without libm, bench links only liblogger).
+ *
+ * @param[in] value value.
+ * @param[in] step step, 1 - integer.
+ *
+ * @return rounded value
+ */
+static double _round_to(const double value, const double step) {
+    return static_cast<double>(static_cast<uint64_t>(value / step + 0.5)) * step;
+}
+
+bool bench_timing_metric(const std::string& metric) {
+    return metric == "calls_per_s" || metric == "p50_ns" || metric == "p99_ns" || metric == "p999_ns";
+}
+
+bool bench_alloc_over_budget(const double allocations_per_call) {
+    return allocations_per_call > suite_alloc_budget;
+}
+
+bool bench_regressed(const std::string& metric, const double baseline, const double current) {
+    bool result = false;
+    if (metric == "calls_per_s") {
+        result = current < baseline * 0.7;
+    } else if (metric == "p50_ns" || metric == "p99_ns") {
+        result = current > baseline * 2 + 200;
+    } else if (metric == "p999_ns") {
+        // the tail is mostly preemption of the producers by the writer, it changes a lot between runs
+        result = current > baseline * 4 + 1000;
+    } else if (metric == "allocs_per_call") {
+        result = current > baseline + 0.01;
+    } else if (metric == "bytes_per_record") {
+        result = current > baseline * 1.01;
+    }
+    return result;
+}
+
+size_t run_suite_bench(const std::string& output, const std::string& baseline, const bool timing) {
+    const size_t total = 200000;
+    size_t regressions = 0;
+    // "case metric" -> value
+    std::map<std::string, double> metrics;
+    std::ofstream out(output, std::ios::trunc);
+    // integers are written without an exponent
+    out.precision(15);
+    out << "# case metric value" << std::endl;
+    std::cout << "suite: threads, payload, hit %, calls/s, p50/p99/p999/max enqueue ns, bytes, "
+                 "bytes/record, allocations/call"
+              << std::endl;
+    for (const size_t threads : {1, 4}) {
+        for (const size_t message_size : {32, 256}) {
+            for (const unsigned hit_percent : {100u, 10u}) {
+                const suite_result result = bench_suite_case({threads, message_size, hit_percent}, total);
+                const std::string name = "suite.t" + std::to_string(threads) + ".s" +
+                                         std::to_string(message_size) + ".h" + std::to_string(hit_percent);
+                const std::pair<const char*, double> values[] = {
+                    {"calls_per_s", _round_to(result.calls_per_second, 1)},
+                    {"p50_ns", static_cast<double>(result.p50_ns)},
+                    {"p99_ns", static_cast<double>(result.p99_ns)},
+                    {"p999_ns", static_cast<double>(result.p999_ns)},
+                    {"max_ns", static_cast<double>(result.max_ns)},
+                    {"bytes", static_cast<double>(result.bytes)},
+                    {"bytes_per_record", _round_to(result.bytes_per_record, 0.01)},
+                    {"allocs_per_call", _round_to(result.allocations_per_call, 0.001)}};
+                for (const auto& value : values) {
+                    metrics[name + ' ' + value.first] = value.second;
+                    out << name << ' ' << value.first << ' ' << value.second << '\n';
+                }
+                std::cout << "suite: " << threads << ", " << message_size << ", " << hit_percent << ", "
+                          << static_cast<size_t>(result.calls_per_second) << ", " << result.p50_ns << "/"
+                          << result.p99_ns << "/" << result.p999_ns << "/" << result.max_ns << ", "
+                          << result.bytes << ", " << result.bytes_per_record << ", "
+                          << result.allocations_per_call << std::endl;
+                // the allocation budget does not depend on the machine, it is checked without a baseline
+                if (bench_alloc_over_budget(result.allocations_per_call)) {
+                    ++regressions;
+                    std::cout << "suite: REGRESSION " << name << " allocs_per_call "
+                              << result.allocations_per_call << " over the budget " << suite_alloc_budget
+                              << std::endl;
+                }
+            }
+        }
+    }
+    out.close();
+    std::cout << "suite: results are written to " << output << std::endl;
+
+    std::ifstream in(baseline);
+    if (!in.is_open()) {
+        std::cout << "suite: no baseline " << baseline << std::endl;
+        return regressions;
+    }
+    std::string line;
+    size_t compared = 0;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        std::string metric;
+        double expected = 0;
+        if (line.empty() || line[0] == '#' || !(fields >> name >> metric >> expected)) continue;
+        const auto current = metrics.find(name + ' ' + metric);
+        if (current == metrics.end() || (!timing && bench_timing_metric(metric))) continue;
+        ++compared;
+        if (bench_regressed(metric, expected, current->second)) {
+            ++regressions;
+            std::cout << "suite: REGRESSION " << name << ' ' << metric << ' ' << expected << " -> "
+                      << current->second << std::endl;
+        }
+    }
+    std::cout << "suite: " << compared << " metrics compared with " << baseline
+              << (timing ? "" : " (timing metrics skipped, --timing compares them)") << ", " << regressions
+              << " regressions" << std::endl;
+    return regressions;
+}
+
+/**
+ * @brief Benchmarks of the logger library.
+ *
+ * Without section names runs every section, otherwise only the sections named in the arguments
+ * (queue, time, format, binary, structured, io, ingest, limit, pool, writers, durable, scan, index, suite).
+ * --output=<file> sets the machine-readable output of the suite
+ * (bench_output.txt by default), --baseline=<file> the baseline it is compared with,
+ * --timing also compares the throughput and the latency with the baseline,
+ * --scan-gb=<size> the size of the log of the scan and index sections (1 GB by default).
+ *
+ * @param[in] argc count of console arguments.
+ * @param[in] argv names of the sections to run and options.
+ *
+ * @return 0, 1 if the suite has found a regression
+ */
+int main(const int argc, const char* argv[]) {
+    std::vector<std::string> sections;
+    std::string output = "bench_output.txt";
+    std::string baseline = "bench_baseline.txt";
+    bool timing = false;
+    double scan_gigabytes = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--output=", 0) == 0) {
+            output = arg.substr(sizeof("--output=") - 1);
+        } else if (arg.rfind("--baseline=", 0) == 0) {
+            baseline = arg.substr(sizeof("--baseline=") - 1);
+        } else if (arg == "--timing") {
+            timing = true;
+        } else if (arg.rfind("--scan-gb=", 0) == 0) {
+            scan_gigabytes = std::atof(arg.c_str() + sizeof("--scan-gb=") - 1);
+        } else {
+            sections.push_back(arg);
+        }
+    }
+    auto selected = [&](const char* name) {
+        return sections.empty() || std::find(sections.begin(), sections.end(), name) != sections.end();
+    };
+
+    if (selected("queue")) {
+        run_queue_bench();
+    }
+    if (selected("time")) {
+        run_time_bench();
+    }
+    if (selected("format")) {
+        run_format_bench();
+    }
+    if (selected("binary")) {
+        run_binary_bench();
+    }
+    if (selected("structured")) {
+        run_structured_bench();
+    }
+    if (selected("io")) {
+        run_io_bench();
+    }
+    if (selected("ingest")) {
+        run_ingest_bench();
+    }
+    if (selected("limit")) {
+        run_limit_bench();
+    }
+    if (selected("pool")) {
+        run_pool_bench();
+    }
+    if (selected("writers")) {
+        run_writers_bench();
+    }
+    if (selected("durable")) {
+        run_durable_bench();
+    }
+    if (selected("scan")) {
+        run_scan_bench(scan_gigabytes);
+    }
+    if (selected("index")) {
+        run_index_bench(scan_gigabytes);
+    }
+    size_t regressions = 0;
+    if (selected("suite")) {
+        regressions = run_suite_bench(output, baseline, timing);
+    }
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,612 @@
+#ifndef THREAD_H
+#define THREAD_H
+#include <thread>
+#endif
+
+#ifndef QUEUE_H
+#define QUEUE_H
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#endif
+
+#ifndef IO_H
+#define IO_H
+#include <iostream>
+#endif
+
+#ifndef BENCH_STD_H
+#define BENCH_STD_H
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <sstream>
+#include <vector>
+#endif
+
+#ifndef FILE_H
+#define FILE_H
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#endif
+
+#ifndef LOGGER_H
+#include "logger.h"
+#endif
+
+#ifndef RING_BUFFER_H
+#include "ring_buffer.h"
+#endif
+
+#ifndef LOG_SCAN_H
+#include "log_scan.h"
+#endif
+
+#ifndef BENCH_H
+#define BENCH_H
+
+// Structure of formatted time from strings (time path of the logger before timestamp_engine)
+struct time_string {
+    char hour[3];
+    char min[3];
+    char sec[3];
+};
+
+// Queue element of the queue benchmarks, the same payload as LogEntry of the mainframe
+struct bench_entry {
+    std::string type;
+    std::string message;
+};
+
+/**
+ * @brief Benchmark of the mutex/condition_variable std::queue.
+ *
+ * The same scheme as the original mainframe: every push takes the mutex
+ * and calls notify_one, the consumer takes elements under the mutex.
+ *
+ * @param[in] producers number of producer threads.
+ * @param[in] total total number of elements from all producers.
+ *
+ * @return elements per second
+ */
+double bench_mutex_queue(const size_t producers, const size_t total);
+
+/**
+ * @brief Benchmark of the mpsc_ring.
+ *
+ * Producers push with try_push (yield while the ring is full),
+ * the consumer takes elements with try_pop and sleeps in wait.
+ *
+ * @param[in] producers number of producer threads.
+ * @param[in] total total number of elements from all producers.
+ *
+ * @return elements per second
+ */
+double bench_mpsc_ring(const size_t producers, const size_t total);
+
+/**
+ * @brief Queue benchmark section.
+ *
+ * Compares std::queue with mutex and mpsc_ring at 1, 4, 16 and 64 producers.
+ */
+void run_queue_bench();
+
+/**
+ * @brief Getting the current time structure.
+ *
+ * The time path of the logger before timestamp_engine (std::time + std::localtime),
+ * kept as the reference of the timestamp benchmark
+ *
+ * @return struct time_string
+ */
+const time_string legacy_get_time();
+
+/**
+ * @brief Benchmark of one timestamp_engine setting.
+ *
+ * @param[in] format timestamp settings.
+ * @param[in] count number of stamps.
+ *
+ * @return nanoseconds per stamp
+ */
+double bench_timestamp(const timestamp_format& format, const size_t count);
+
+/**
+ * @brief Timestamp benchmark section.
+ *
+ * Nanoseconds per stamp of legacy_get_time and timestamp_engine settings.
+ */
+void run_time_bench();
+
+/**
+ * @brief Create an empty log file for a benchmark.
+ *
+ * @param[in] name file name in the temporary directory.
+ *
+ * @return path to the created file
+ */
+std::string make_bench_file(const std::string& name);
+
+/**
+ * @brief Producer-side cost of async_logger records.
+ *
+ * @param[in] deferred true - log() with encoded arguments,
+ * false - the message is built with std::to_string and put_log.
+ * @param[in] count number of records.
+ *
+ * @return nanoseconds per call on the producer thread
+ */
+double bench_async_producer(const bool deferred, const size_t count);
+
+/**
+ * @brief Cost of resolving a level name.
+ *
+ * The names cycle through the five levels, a command and a message.
+ *
+ * @param[in] table true - log_type_from_name, false - comparing with every name.
+ * @param[in] count number of names.
+ *
+ * @return nanoseconds per name
+ */
+double bench_level_parse(const bool table, const size_t count);
+
+/**
+ * @brief Formatting benchmark section.
+ *
+ * Compares producer latency of eager string building and deferred formatting,
+ * and the cost of resolving level names.
+ */
+void run_format_bench();
+
+/**
+ * @brief Write a generated corpus with one record format.
+ *
+ * Half of the records are plain messages, half are formatted records.
+ *
+ * @param[in] path log file.
+ * @param[in] format record_format.
+ * @param[in] count number of records.
+ *
+ * @return records per second
+ */
+double bench_write_corpus(const std::string& path, const record_format format, const size_t count);
+
+/**
+ * @brief Binary format benchmark section.
+ *
+ * Size and write throughput of the text and binary formats on a generated
+ * corpus, and decoding throughput of the binary file.
+ */
+void run_binary_bench();
+
+/**
+ * @brief Write records with four fields in one record layout.
+ *
+ * Every record is put_log with log_fields: a short string, an integer,
+ * a double and a string that needs escaping.
+ *
+ * @param[in] path log file.
+ * @param[in] format text_format, json_format or logfmt_format.
+ * @param[in] count number of records.
+ *
+ * @return records per second
+ */
+double bench_structured_corpus(const std::string& path, const record_format format, const size_t count);
+
+/**
+ * @brief Throughput of escaping a JSON string.
+ *
+ * @param[in] simd true - json_escape, false - a byte-by-byte escape loop for comparison.
+ * @param[in] length length of the string, one byte in 64 needs escaping.
+ * @param[in] count number of escapes.
+ *
+ * @return megabytes of input per second
+ */
+double bench_json_escape(const bool simd, const size_t length, const size_t count);
+
+/**
+ * @brief Structured records benchmark section.
+ *
+ * Records/s and bytes/record of records with fields in the text, JSON and
+ * logfmt layouts, and the escape throughput of the SIMD scan against a
+ * byte-by-byte loop.
+ */
+void run_structured_bench();
+
+// Result of one I/O backend run
+struct io_bench_result {
+    // records written per second, until the writer has drained the queue
+    double records_per_second;
+    // 99th percentile of the producer enqueue time, nanoseconds
+    double p99_enqueue_ns;
+};
+
+/**
+ * @brief Write records through async_logger with one I/O backend.
+ *
+ * Every record is written to the file (default flush_policy), the queue is small,
+ * so the enqueue latency shows how fast the writer keeps up.
+ *
+ * @param[in] backend io_backend_type.
+ * @param[in] producers number of producer threads.
+ * @param[in] total total number of records from all producers.
+ *
+ * @return throughput and enqueue latency
+ */
+io_bench_result bench_io_backend(const io_backend_type backend, const size_t producers, const size_t total);
+
+/**
+ * @brief I/O backend benchmark section.
+ *
+ * Records/s and p99 enqueue latency of the stream, pwritev, io_uring and
+ * mmap_ring backends at 1 and 4 producers, the file is in the current directory.
+ */
+void run_io_bench();
+
+/**
+ * @brief Write records through async_logger one by one or in blocks.
+ *
+ * The same messages of every level (the info mode filters out a fifth) are
+ * queued with put_log per record or with put_bulk per block of block_size bytes.
+ *
+ * @param[in] block_size bytes of messages in a put_bulk block, 0 - put_log per record.
+ * @param[in] count number of records.
+ *
+ * @return records per second until the writer has written all of them
+ */
+double bench_ingest(const size_t block_size, const size_t count);
+
+/**
+ * @brief Bulk ingest benchmark section.
+ *
+ * Records/s of put_log per record against put_bulk with 64 KB and 1 MB blocks.
+ */
+void run_ingest_bench();
+
+/**
+ * @brief Write a flood of identical error records through async_logger.
+ *
+ * @param[in] policy limits of the call site, nullptr - LOGGER_LOG without limits.
+ * @param[in] count number of records.
+ * @param[out] bytes size of the written log.
+ *
+ * @return records per second until the writer has written all of them
+ */
+double bench_flood(const rate_limit_policy* policy, const size_t count, uintmax_t& bytes);
+
+/**
+ * @brief Call site limits benchmark section.
+ *
+ * Records/s and log size of a flood of identical records without limits,
+ * with repeat collapsing, with a rate limit and with 1% sampling.
+ */
+void run_limit_bench();
+
+// Result of the payload benchmark
+struct payload_bench_result {
+    double records_per_second;
+    // operator new calls per record on all threads
+    double allocations_per_record;
+    // counters of the payload_pool of the async_logger
+    payload_stats pool;
+};
+
+/**
+ * @brief Write records of 40 ... 400 bytes through async_logger from several producers.
+ *
+ * @param[in] producers number of producer threads.
+ * @param[in] cap memory cap of the queued messages, 0 - no cap.
+ * @param[in] count number of records.
+ *
+ * @return records/s, heap allocations per record and the pool counters
+ */
+payload_bench_result bench_payload(const size_t producers, const size_t cap, const size_t count);
+
+/**
+ * @brief Record payload benchmark section.
+ *
+ * Copying and freeing a message with std::string against a payload_pool block,
+ * then records/s, heap allocations per record, cache hit rate and reserved
+ * memory of async_logger without a cap and with a 1 MB cap.
+ */
+void run_pool_bench();
+
+/**
+ * @brief Write records to many files through async_logger from several producers.
+ *
+ * Every producer writes to the files in turn.
+ *
+ * @param[in] files number of files, one logger and async_logger each.
+ * @param[in] workers threads of a writer_pool, 0 - a writer thread per async_logger.
+ * @param[in] producers number of producer threads.
+ * @param[in] count number of records of all files.
+ *
+ * @return records per second until the writers have written all of them
+ */
+double bench_writers(const size_t files, const size_t workers, const size_t producers, const size_t count);
+
+/**
+ * @brief Shared writer pool benchmark section.
+ *
+ * Records/s of 32 files with a writer thread per file against a writer_pool of 1, 2 and 4 workers.
+ */
+void run_writers_bench();
+
+// Result of one durable writes run
+struct durable_bench_result {
+    // fdatasync calls per second
+    double syncs_per_second;
+    // records reported durable per second
+    double records_per_second;
+};
+
+/**
+ * @brief Write durable records for a fixed time.
+ *
+ * With producers == 0 one thread calls logger::put_log and logger::sync for
+ * every record, otherwise every producer thread calls async_logger::put_durable.
+ *
+ * @param[in] path log file, on the filesystem being measured.
+ * @param[in] producers number of producer threads, 0 - sync per record without async_logger.
+ * @param[in] seconds duration of the run.
+ *
+ * @return syncs and durable records per second
+ */
+durable_bench_result bench_durable(const std::string& path, const size_t producers, const double seconds);
+
+/**
+ * @brief Durable writes benchmark section.
+ *
+ * fdatasync calls per second against durable records per second of a sync
+ * per record and of the group commit of async_logger with 1 ... 32 producer
+ * threads. The log is written in the current directory, the temporary
+ * directory may be tmpfs where a sync costs nothing.
+ */
+void run_durable_bench();
+
+/**
+ * @brief Write a text log for the scan benchmark.
+ *
+ * "[LEVEL] request <n> ... HH:MM:SS" lines of every level, one in 100 has
+ * "timeout" in the message.
+ *
+ * @param[in] path log file.
+ * @param[in] bytes size of the log, rounded up to a whole line.
+ */
+void bench_scan_corpus(const std::string& path, const uint64_t bytes);
+
+/**
+ * @brief Count the selected lines of a log with scan_log.
+ *
+ * @param[in] file mapped log.
+ * @param[in] filter conditions.
+ * @param[in] threads number of threads.
+ * @param[out] matched number of selected lines.
+ *
+ * @return gigabytes scanned per second
+ */
+double bench_scan_log(const mapped_file& file, const scan_filter& filter, const size_t threads,
+                      uint64_t& matched);
+
+/**
+ * @brief Count the lines with grep -c.
+ *
+ * @param[in] arguments grep options and pattern, quoted for the shell.
+ * @param[in] path log file.
+ * @param[out] matched number printed by grep.
+ *
+ * @return gigabytes scanned per second, 0 if grep cannot be run
+ */
+double bench_grep(const std::string& arguments, const std::string& path, uint64_t& matched);
+
+/**
+ * @brief Log scanning benchmark section.
+ *
+ * Generates a text log in the current directory and compares counting the
+ * lines of one level, with a substring and with both with scan_log on one
+ * thread and on every core against grep -c. The log is scanned once before
+ * the measurements, so a log that fits into memory is read from the page cache.
+ *
+ * @param[in] gigabytes size of the generated log.
+ */
+void run_scan_bench(const double gigabytes);
+
+/**
+ * @brief Run one query over a log with or without its index.
+ *
+ * @param[in] file mapped log.
+ * @param[in] entries valid entries of the index of the log.
+ * @param[in] filter conditions.
+ * @param[in] use_index scan only the index_ranges of the query, otherwise the whole log.
+ * @param[out] result selected lines and scanned bytes.
+ *
+ * @return milliseconds of the query, with index_ranges
+ */
+double bench_index_query(const mapped_file& file, const std::vector<index_entry>& entries,
+                         const scan_filter& filter, const bool use_index, scan_stats& result);
+
+/**
+ * @brief Sparse index benchmark section.
+ *
+ * Writes a text log with an index through the logger (a burst of critical
+ * records in the middle) and compares the time and the bytes scanned of a
+ * time range at the end, the critical level and a frequent level with the
+ * index against a scan of the whole log on one thread.
+ *
+ * @param[in] gigabytes size of the log.
+ */
+void run_index_bench(const double gigabytes);
+
+/**
+ * @brief Latency histogram with a bounded relative error.
+ *
+ * Values below 16 have their own buckets, every higher power of two is split
+ * into 16 linear sub-buckets, so a percentile is within 1/16 of the real value
+ * and recording is a few instructions without an allocation.
+ */
+class latency_histogram {
+    // number of linear sub-buckets of a power of two, log2
+    static constexpr int sub_bits = 4;
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+
+    /**
+     * @brief Bucket of a value.
+     *
+     * @param[in] value value.
+     *
+     * @return bucket index
+     */
+    static size_t _bucket(const uint64_t value);
+
+    /**
+     * @brief Largest value of a bucket.
+     *
+     * @param[in] index bucket index.
+     *
+     * @return upper bound of the bucket
+     */
+    static uint64_t _upper(const size_t index);
+
+   public:
+    latency_histogram();
+
+    /**
+     * @brief Add a value.
+     *
+     * @param[in] value value, nanoseconds.
+     */
+    void record(const uint64_t value) {
+        ++counts[_bucket(value)];
+        ++total;
+        max_value = value > max_value ? value : max_value;
+    }
+
+    /**
+     * @brief Add all values of another histogram.
+     *
+     * @param[in] other histogram.
+     */
+    void merge(const latency_histogram& other);
+
+    /**
+     * @brief Value at a percentile.
+     *
+     * @param[in] quantile from 0 to 1.
+     *
+     * @return upper bound of the bucket holding the percentile, 0 if the histogram is empty
+     */
+    uint64_t percentile(const double quantile) const;
+
+    /**
+     * @brief Largest recorded value.
+     *
+     * @return maximum
+     */
+    uint64_t max() const { return max_value; }
+};
+
+// Parameters of one suite case
+struct suite_case {
+    // number of producer threads
+    size_t threads;
+    // size of the payload argument of every record, bytes
+    size_t message_size;
+    // share of the records that pass the level filter, percent
+    unsigned hit_percent;
+};
+
+// Result of one suite case
+struct suite_result {
+    // log calls (written and filtered) per second, until the writer has drained the queue
+    double calls_per_second;
+    // enqueue latency of a log call, nanoseconds
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+    // bytes written to the file
+    uint64_t bytes;
+    // bytes written per record that passed the filter
+    double bytes_per_record;
+    // operator new calls per log call in all threads
+    double allocations_per_call;
+};
+
+/**
+ * @brief Run one suite case.
+ *
+ * The producers log "request {} payload {}" through async_logger (thread_staging,
+ * 64 KB logger buffer) with a warn level for hit_percent of the records and
+ * a debug level for the rest, the logger mode is info.
+ *
+ * @param[in] params case parameters.
+ * @param[in] total total number of log calls from all producers.
+ *
+ * @return measured values
+ */
+suite_result bench_suite_case(const suite_case& params, const size_t total);
+
+// Allocations per log call the suite allows in every case, whatever the baseline says
+constexpr double suite_alloc_budget = 0.05;
+
+/**
+ * @brief Check for a timing metric.
+ *
+ * Throughput and latency depend on the machine, they are compared with the
+ * baseline only on request (--timing).
+ *
+ * @param[in] metric metric name.
+ *
+ * @return true for calls_per_s, p50_ns, p99_ns and p999_ns
+ */
+bool bench_timing_metric(const std::string& metric);
+
+/**
+ * @brief Check the allocations of a suite case against suite_alloc_budget.
+ *
+ * @param[in] allocations_per_call measured operator new calls per log call.
+ *
+ * @return true if the case allocates more than the budget
+ */
+bool bench_alloc_over_budget(const double allocations_per_call);
+
+/**
+ * @brief Check a metric against its baseline.
+ *
+ * Throughput may drop by 30%, p50 and p99 may grow twice plus 200 ns, p999
+ * four times plus 1 us, allocations per call by 0.01 and bytes per record by 1%;
+ * the other metrics (max, bytes) are reported only.
+ *
+ * @param[in] metric metric name.
+ * @param[in] baseline baseline value.
+ * @param[in] current current value.
+ *
+ * @return true if the current value is a regression
+ */
+bool bench_regressed(const std::string& metric, const double baseline, const double current);
+
+/**
+ * @brief Suite benchmark section.
+ *
+ * Runs the cases of 1 and 4 threads, 32 and 256 byte payloads and 100% and 10%
+ * filter hit rate. Every metric is written to output as "case metric value" lines.
+ * A case over suite_alloc_budget is a regression on any machine. If the baseline
+ * file (the same format, a saved output) exists, the metrics are compared with it
+ * and the regressions are printed; the timing metrics only if timing is set,
+ * because a baseline saved on other hardware says nothing about them.
+ *
+ * @param[in] output path of the machine-readable output.
+ * @param[in] baseline path of the baseline, may not exist.
+ * @param[in] timing compare throughput and latency too.
+ *
+ * @return number of regressions
+ */
+size_t run_suite_bench(const std::string& output, const std::string& baseline, const bool timing);
+#endif
@@ -0,0 +1,172 @@
+#include "binary_format.h"
+
+#include "logger.h"
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+/**
+ * @brief Zigzag encoding of a signed value.
+ *
+ * @param[in] value signed value.
+ *
+ * @return unsigned value with small magnitudes kept small
+ */
+static uint64_t _zigzag(const int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+/**
+ * @brief Zigzag decoding.
+ *
+ * @param[in] value unsigned value.
+ *
+ * @return signed value
+ */
+static int64_t _unzigzag(const uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void binary_put_varint(std::string& out, uint64_t value) {
+    char bytes[10];
+    size_t size = 0;
+    while (value >= 0x80) {
+        bytes[size++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    bytes[size++] = static_cast<char>(value);
+    out.append(bytes, size);
+}
+
+bool binary_get_varint(const unsigned char*& pos, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    bool done = false;
+    for (int shift = 0; pos < end && shift < 64 && !done; shift += 7) {
+        value |= static_cast<uint64_t>(*pos & 0x7F) << shift;
+        done = (*pos & 0x80) == 0;
+        ++pos;
+    }
+    return done;
+}
+
+void binary_encoder::reset() {
+    session = false;
+    format_ids.clear();
+}
+
+void binary_encoder::begin_record(std::string& out, const int64_t epoch_ns, const uint8_t level, const char* fmt,
+                                  const size_t payload_size) {
+    if (!session) {
+        out += static_cast<char>(binary_session_tag);
+        out.append(binary_magic, sizeof(binary_magic));
+        out += static_cast<char>(binary_version);
+        binary_put_varint(out, static_cast<uint64_t>(epoch_ns));
+        last_time = epoch_ns;
+        session = true;
+    }
+
+    uint64_t format_id = 0;
+    if (fmt != nullptr) {
+        lookup.assign(fmt);
+        auto found = format_ids.find(lookup);
+        if (found == format_ids.end()) {
+            format_id = format_ids.size() + 1;
+            format_ids.emplace(lookup, format_id);
+            out += static_cast<char>(binary_format_tag);
+            binary_put_varint(out, format_id);
+            binary_put_varint(out, lookup.size());
+            out += lookup;
+        } else {
+            format_id = found->second;
+        }
+    }
+
+    out += static_cast<char>(binary_record_tag);
+    binary_put_varint(out, _zigzag(epoch_ns - last_time));
+    out += static_cast<char>(level);
+    binary_put_varint(out, format_id);
+    binary_put_varint(out, payload_size);
+    last_time = epoch_ns;
+}
+
+binary_status binary_decoder::next(const unsigned char*& pos, const unsigned char* end, binary_record& record) {
+    binary_status result = binary_end;
+    bool found = false;
+    while (!found && result != binary_corrupt && pos < end) {
+        const uint8_t tag = *pos++;
+        uint64_t value = 0;
+        if (tag == binary_session_tag) {
+            if (end - pos < static_cast<ptrdiff_t>(sizeof(binary_magic) + 1) ||
+                std::char_traits<char>::compare(reinterpret_cast<const char*>(pos), binary_magic,
+                                                sizeof(binary_magic)) != 0 ||
+                pos[sizeof(binary_magic)] != binary_version) {
+                result = binary_corrupt;
+            } else {
+                pos += sizeof(binary_magic) + 1;
+                if (!binary_get_varint(pos, end, value)) {
+                    result = binary_corrupt;
+                }
+                last_time = static_cast<int64_t>(value);
+                formats.clear();
+                session = true;
+            }
+        } else if (!session) {
+            result = binary_corrupt;
+        } else if (tag == binary_format_tag) {
+            uint64_t id = 0;
+            if (!binary_get_varint(pos, end, id) || !binary_get_varint(pos, end, value) ||
+                static_cast<uint64_t>(end - pos) < value) {
+                result = binary_corrupt;
+            } else {
+                formats[id].assign(reinterpret_cast<const char*>(pos), value);
+                pos += value;
+            }
+        } else if (tag == binary_record_tag) {
+            uint64_t format_id = 0;
+            if (!binary_get_varint(pos, end, value) || pos >= end) {
+                result = binary_corrupt;
+            } else {
+                record.epoch_ns = last_time + _unzigzag(value);
+                last_time = record.epoch_ns;
+                record.level = *pos++;
+                if (!binary_get_varint(pos, end, format_id) || !binary_get_varint(pos, end, value) ||
+                    static_cast<uint64_t>(end - pos) < value) {
+                    result = binary_corrupt;
+                } else {
+                    record.format = nullptr;
+                    if (format_id != 0) {
+                        auto format = formats.find(format_id);
+                        record.format = format == formats.end() ? nullptr : &format->second;
+                    }
+                    if (format_id != 0 && record.format == nullptr) {
+                        result = binary_corrupt;
+                    } else {
+                        record.payload = std::string_view(reinterpret_cast<const char*>(pos), value);
+                        pos += value;
+                        found = true;
+                        result = binary_ok;
+                    }
+                }
+            }
+        } else {
+            result = binary_corrupt;
+        }
+    }
+    return result;
+}
+
+void binary_record_to_text(const binary_record& record, timestamp_engine& stamp, std::string& out) {
+    out += '[';
+    out += _log_type_to_string(static_cast<log_type>(record.level));
+    out += "] ";
+    if (record.format != nullptr) {
+        fmt_args args;
+        args.append(record.payload.data(), record.payload.size());
+        fmt_render(out, record.format->c_str(), args);
+    } else {
+        out.append(record.payload.data(), record.payload.size());
+    }
+    char time[timestamp_engine::max_size];
+    out += ' ';
+    out.append(time, stamp.format_time(record.epoch_ns, time));
+    out += '\n';
+}
@@ -0,0 +1,161 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef MAP_H
+#define MAP_H
+#include <unordered_map>
+#endif
+
+#ifndef TIMESTAMP_H
+#include "timestamp.h"
+#endif
+
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+// Tags of the binary log file elements
+enum binary_tag : uint8_t {
+    // session start: magic, version, varint absolute time in ns
+    binary_session_tag = 0xB1,
+    // format string definition: varint id, varint length, bytes
+    binary_format_tag = 0xB2,
+    // record: zigzag varint time delta in ns, level byte, varint format id (0 - plain message),
+    // varint payload length, payload (message or encoded fmt_args)
+    binary_record_tag = 0xB3
+};
+
+// Magic of a binary session
+constexpr char binary_magic[4] = {'I', 'L', 'O', 'G'};
+
+// Version of the binary format
+constexpr uint8_t binary_version = 1;
+
+// Result of reading the next binary record
+enum binary_status { binary_ok, binary_end, binary_corrupt };
+
+/**
+ * @brief Append an unsigned LEB128 varint.
+ *
+ * @param[out] out result.
+ * @param[in] value value.
+ */
+void binary_put_varint(std::string& out, uint64_t value);
+
+/**
+ * @brief Read an unsigned LEB128 varint.
+ *
+ * @param[in] pos position of the varint, moved past it.
+ * @param[in] end end of the data.
+ * @param[out] value value.
+ *
+ * @return false if the data ended or the varint is too long
+ */
+bool binary_get_varint(const unsigned char*& pos, const unsigned char* end, uint64_t& value);
+
+/**
+ * @brief Writer side of the binary format.
+ *
+ * Keeps the state of the current session: the time of the previous record
+ * and the ids of the format strings already defined in the file.
+ * Format strings are interned by content, so a reused or stack buffer
+ * with a new format string gets a new definition.
+ */
+class binary_encoder {
+    // a session header has been written
+    bool session = false;
+
+    // time of the previous record
+    int64_t last_time = 0;
+
+    // ids of the defined format strings
+    std::unordered_map<std::string, uint64_t> format_ids;
+
+    // format string being looked up, keeps its capacity between records
+    std::string lookup;
+
+   public:
+    /**
+     * @brief Start a new session with the next record.
+     *
+     * Called when the file is reopened, forgets the defined format strings.
+     */
+    void reset();
+
+    /**
+     * @brief Write the header of a record.
+     *
+     * If needed writes the session header and the format string definition first.
+     * The payload must be appended right after the header.
+     *
+     * @param[out] out output buffer.
+     * @param[in] epoch_ns record time, nanoseconds since the epoch.
+     * @param[in] level record level.
+     * @param[in] fmt format string, nullptr - the payload is a plain message.
+     * @param[in] payload_size payload length.
+     */
+    void begin_record(std::string& out, const int64_t epoch_ns, const uint8_t level, const char* fmt,
+                      const size_t payload_size);
+};
+
+// Decoded binary record, valid until the next call of binary_decoder::next
+struct binary_record {
+    uint8_t level = 0;
+    int64_t epoch_ns = 0;
+    // format string, nullptr - the payload is a plain message
+    const std::string* format = nullptr;
+    std::string_view payload;
+};
+
+/**
+ * @brief Reader side of the binary format.
+ */
+class binary_decoder {
+    // a session header was read
+    bool session = false;
+
+    // time of the previous record
+    int64_t last_time = 0;
+
+    // defined format strings of the current session
+    std::unordered_map<uint64_t, std::string> formats;
+
+   public:
+    /**
+     * @brief Read the next record.
+     *
+     * Session headers and format definitions are consumed on the way. Data that
+     * does not start with a session header is corrupt.
+     *
+     * @param[in] pos current position, moved past the record.
+     * @param[in] end end of the data.
+     * @param[out] record decoded record.
+     *
+     * @return binary_ok, binary_end if there are no more records, binary_corrupt
+     */
+    binary_status next(const unsigned char*& pos, const unsigned char* end, binary_record& record);
+};
+
+/**
+ * @brief Convert a binary record to the text layout.
+ *
+ * Appends "[LEVEL] message time\n" to out, the same as the text format of the logger.
+ *
+ * @param[in] record decoded record.
+ * @param[in] stamp timestamp formatting.
+ * @param[out] out result.
+ */
+void binary_record_to_text(const binary_record& record, timestamp_engine& stamp, std::string& out);
+#endif
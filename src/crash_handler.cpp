@@ -0,0 +1,204 @@
+#include "crash_handler.h"
+
+#include <csignal>
+#include <cstring>
+
+#include "logger.h"
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// fatal signals the handler is set for
+static constexpr int crash_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+static constexpr size_t crash_signal_count = sizeof(crash_signals) / sizeof(crash_signals[0]);
+
+// Logger served by the crash handler, only one of the pointers is set
+struct crash_target {
+    std::atomic<logger*> sync{nullptr};
+    std::atomic<async_logger*> async{nullptr};
+    // async_logger drain timeout, nanoseconds
+    std::atomic<int64_t> timeout{0};
+};
+
+static crash_target crash_targets[crash_max_targets];
+
+// protects the registration, the signal handler does not take it
+static std::mutex crash_lock;
+
+// handlers that were set before install_crash_handler, restored before the signal is raised again
+static struct sigaction crash_previous[crash_signal_count];
+static bool crash_installed = false;
+
+// set by the first thread that gets a fatal signal
+static std::atomic<bool> crash_running{false};
+
+// queued records are rendered here, it is not on the stack of the crashed thread
+static char crash_scratch[crash_scratch_size];
+
+// Alternate signal stack of a thread, released when the thread ends
+struct crash_stack {
+    char* memory = nullptr;
+
+    ~crash_stack() {
+        if (memory != nullptr) {
+            stack_t disable{};
+            disable.ss_flags = SS_DISABLE;
+            sigaltstack(&disable, nullptr);
+            delete[] memory;
+        }
+    }
+};
+
+static thread_local crash_stack crash_thread_stack;
+
+/**
+ * @brief Name of a fatal signal.
+ *
+ * @param[in] signal signal number.
+ *
+ * @return name
+ */
+static const char* _signal_name(const int signal) {
+    switch (signal) {
+        case SIGSEGV:
+            return "SIGSEGV";
+        case SIGBUS:
+            return "SIGBUS";
+        case SIGILL:
+            return "SIGILL";
+        case SIGFPE:
+            return "SIGFPE";
+        case SIGABRT:
+            return "SIGABRT";
+        default:
+            return "signal";
+    }
+}
+
+/**
+ * @brief Handler of the fatal signals.
+ *
+ * Writes the records of every registered logger and raises the signal again
+ * with the previous handler.
+ *
+ * @param[in] signal signal number.
+ */
+static void _crash_signal(const int signal) {
+    if (!crash_running.exchange(true)) {
+        char note[32] = "fatal signal ";
+        const size_t prefix = std::strlen(note);
+        const char* name = _signal_name(signal);
+        std::memcpy(note + prefix, name, std::strlen(name));
+        const std::string_view text(note, prefix + std::strlen(name));
+
+        for (crash_target& target : crash_targets) {
+            async_logger* async = target.async.load(std::memory_order_acquire);
+            logger* sync = target.sync.load(std::memory_order_acquire);
+            if (async != nullptr) {
+                const std::chrono::nanoseconds timeout(target.timeout.load(std::memory_order_relaxed));
+                async->crash_drain(text, timeout, crash_scratch, sizeof(crash_scratch));
+            } else if (sync != nullptr) {
+                sync->crash_flush();
+                sync->crash_put_log(critical_log_type, text, nullptr, {}, crash_scratch,
+                                    sizeof(crash_scratch));
+            }
+        }
+    } else {
+        // another thread is writing the records, it ends the process
+        while (true) {
+            pause();
+        }
+    }
+
+    for (size_t i = 0; i < crash_signal_count; ++i) {
+        if (crash_signals[i] == signal) {
+            sigaction(signal, &crash_previous[i], nullptr);
+        }
+    }
+    // the signal is blocked in its handler, it is delivered with the previous handler on return
+    raise(signal);
+}
+
+/**
+ * @brief Set the signal handler and register a logger.
+ *
+ * @param[in] sync logger or nullptr.
+ * @param[in] async async_logger or nullptr.
+ * @param[in] timeout async_logger drain timeout.
+ *
+ * @return false if there is no free slot
+ */
+static bool _register(logger* sync, async_logger* async, const std::chrono::nanoseconds timeout) {
+    install_crash_stack();
+    std::lock_guard<std::mutex> guard(crash_lock);
+    if (!crash_installed) {
+        struct sigaction action {};
+        action.sa_handler = _crash_signal;
+        // a stack overflow leaves no room on the stack of the thread
+        action.sa_flags = SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        for (size_t i = 0; i < crash_signal_count; ++i) {
+            sigaction(crash_signals[i], &action, &crash_previous[i]);
+        }
+        crash_installed = true;
+    }
+
+    crash_target* free_slot = nullptr;
+    for (crash_target& target : crash_targets) {
+        logger* current_sync = target.sync.load(std::memory_order_relaxed);
+        async_logger* current_async = target.async.load(std::memory_order_relaxed);
+        if ((sync != nullptr && current_sync == sync) || (async != nullptr && current_async == async)) {
+            target.timeout.store(timeout.count(), std::memory_order_relaxed);
+            return true;
+        }
+        if (free_slot == nullptr && current_sync == nullptr && current_async == nullptr) {
+            free_slot = &target;
+        }
+    }
+    if (free_slot != nullptr) {
+        free_slot->timeout.store(timeout.count(), std::memory_order_relaxed);
+        free_slot->sync.store(sync, std::memory_order_release);
+        free_slot->async.store(async, std::memory_order_release);
+    }
+    return free_slot != nullptr;
+}
+
+bool install_crash_stack() {
+    stack_t current{};
+    bool result = sigaltstack(nullptr, &current) == 0;
+    if (result && (current.ss_flags & SS_DISABLE) != 0) {
+        crash_thread_stack.memory = new char[crash_stack_size];
+        stack_t stack{};
+        stack.ss_sp = crash_thread_stack.memory;
+        stack.ss_size = crash_stack_size;
+        result = sigaltstack(&stack, nullptr) == 0;
+        if (!result) {
+            delete[] crash_thread_stack.memory;
+            crash_thread_stack.memory = nullptr;
+        }
+    }
+    return result;
+}
+
+bool install_crash_handler(logger& target) {
+    return _register(&target, nullptr, std::chrono::nanoseconds(0));
+}
+
+bool install_crash_handler(async_logger& target, const std::chrono::milliseconds drain_timeout) {
+    return _register(nullptr, &target, drain_timeout);
+}
+
+void remove_crash_handler(const logger& target) {
+    std::lock_guard<std::mutex> guard(crash_lock);
+    for (crash_target& slot : crash_targets) {
+        logger* expected = const_cast<logger*>(&target);
+        slot.sync.compare_exchange_strong(expected, nullptr);
+    }
+}
+
+void remove_crash_handler(const async_logger& target) {
+    std::lock_guard<std::mutex> guard(crash_lock);
+    for (crash_target& slot : crash_targets) {
+        async_logger* expected = const_cast<async_logger*>(&target);
+        slot.async.compare_exchange_strong(expected, nullptr);
+    }
+}
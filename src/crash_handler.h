@@ -0,0 +1,85 @@
+#ifndef CHRONO_H
+#define CHRONO_H
+#include <chrono>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef CRASH_HANDLER_H
+#define CRASH_HANDLER_H
+
+class logger;
+class async_logger;
+
+// maximum number of loggers the crash handler serves at a time
+constexpr size_t crash_max_targets = 16;
+
+// size of the buffer the crash handler renders a queued record in
+constexpr size_t crash_scratch_size = 64 * 1024;
+
+// size of the alternate stack the crash handler runs on
+constexpr size_t crash_stack_size = 64 * 1024;
+
+/**
+ * @brief Give the calling thread an alternate signal stack for the crash handler.
+ *
+ * The handler runs on it (SA_ONSTACK), so a stack overflow of the thread is still
+ * logged. Set for the thread calling install_crash_handler and for the writer threads;
+ * other application threads call it themselves. A thread that already has an alternate
+ * stack keeps it, the allocated stack is released when the thread ends.
+ *
+ * @return false if the stack cannot be set
+ */
+bool install_crash_stack();
+
+/**
+ * @brief Write the buffered records of a logger when the process gets a fatal signal.
+ *
+ * On the first call the handler of SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT is set,
+ * it runs on the alternate stack of the thread (install_crash_stack).
+ * On a fatal signal the buffer of the logger is written to the file with async-signal-safe
+ * calls only, followed by a critical record "fatal signal SIGSEGV". Then the previous
+ * handler is restored and the signal is raised again, so the process ends in the same way
+ * (core dump, exit status). Register either a logger or the async_logger writing to it, not
+ * both. The logger is removed from the handler when it is destroyed.
+ *
+ * @param[in] target logger, used directly by the application threads.
+ *
+ * @return false if crash_max_targets loggers are registered already
+ */
+bool install_crash_handler(logger& target);
+
+/**
+ * @brief Write the queued records of an async_logger when the process gets a fatal signal.
+ *
+ * The same as install_crash_handler with a logger, but on a fatal signal the queue is
+ * drained first, see async_logger::crash_drain.
+ *
+ * @param[in] target async_logger.
+ * @param[in] drain_timeout how long the handler waits for the writer thread.
+ *
+ * @return false if crash_max_targets loggers are registered already
+ */
+bool install_crash_handler(async_logger& target,
+                           const std::chrono::milliseconds drain_timeout = std::chrono::milliseconds(1000));
+
+/**
+ * @brief Remove a logger from the crash handler.
+ *
+ * The signal handler stays set, with no loggers it only raises the signal again.
+ *
+ * @param[in] target logger.
+ */
+void remove_crash_handler(const logger& target);
+
+/**
+ * @brief Remove an async_logger from the crash handler.
+ *
+ * @param[in] target async_logger.
+ */
+void remove_crash_handler(const async_logger& target);
+#endif
@@ -0,0 +1,620 @@
+#include "io_backend.h"
+
+#include "log_scan.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// number of registered buffers, the maximum number of writes in flight
+static constexpr unsigned io_uring_depth = 8;
+
+// size of one registered buffer
+static constexpr size_t io_uring_buffer_size = 256 * 1024;
+
+// reserved marks that fallocate is not supported
+static constexpr uint64_t no_reserve = std::numeric_limits<uint64_t>::max();
+
+/**
+ * @brief Write all data at the given offset or at the end of the file (async-signal-safe).
+ *
+ * @param[in] fd file descriptor.
+ * @param[in] data data.
+ * @param[in] size number of bytes.
+ * @param[in] offset position in the file, -1 - write(2) at the file position.
+ *
+ * @return number of written bytes, less than size if the write has failed
+ */
+static size_t _write_all(const int fd, const char* data, const size_t size, off_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t written =
+            offset < 0 ? ::write(fd, data + done, size - done) : pwrite(fd, data + done, size - done, offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break;
+        done += static_cast<size_t>(written);
+        if (offset >= 0) offset += written;
+    }
+    return done;
+}
+
+stream_file_backend::~stream_file_backend() { stream_file_backend::close(); }
+
+bool stream_file_backend::open(const std::filesystem::path& path) {
+    // an open file is closed first, so the stream and sync_fd always refer to the same file
+    stream_file_backend::close();
+    // records are collected in the logger buffer, so the stream buffer only makes an extra copy
+    file.rdbuf()->pubsetbuf(nullptr, 0);
+    file.clear();
+    file.open(path, std::ios::app);
+    file_path = path;
+    if (file.is_open()) {
+        sync_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    return file.is_open();
+}
+
+bool stream_file_backend::is_open() const { return file.is_open(); }
+
+bool stream_file_backend::write(const char* data, const size_t size) {
+    file.write(data, size);
+    file.flush();
+    return !file.fail() && file.good();
+}
+
+bool stream_file_backend::crash_write(const char* data, const size_t size) {
+    bool result = false;
+    if (file.is_open()) {
+        // the stream does not give its descriptor, the file is opened once more for appending
+        const int fd = ::open(file_path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (fd >= 0) {
+            result = _write_all(fd, data, size, -1) == size;
+            ::close(fd);
+        }
+    }
+    return result;
+}
+
+bool stream_file_backend::sync() {
+    // fdatasync writes the data of the file, whichever descriptor it is called on
+    return file.is_open() && sync_fd >= 0 && fdatasync(sync_fd) == 0;
+}
+
+void stream_file_backend::close() {
+    file.close();
+    if (sync_fd >= 0) {
+        ::close(sync_fd);
+        sync_fd = -1;
+    }
+}
+
+pwritev_file_backend::~pwritev_file_backend() { pwritev_file_backend::close(); }
+
+bool pwritev_file_backend::open(const std::filesystem::path& path) {
+    if (fd < 0) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        struct stat info {};
+        if (fd >= 0 && fstat(fd, &info) == 0) {
+            offset = reserved = static_cast<uint64_t>(info.st_size);
+        }
+    }
+    return fd >= 0;
+}
+
+bool pwritev_file_backend::is_open() const { return fd >= 0; }
+
+void pwritev_file_backend::_reserve(const size_t size) {
+    if (reserved != no_reserve && offset + size > reserved) {
+        const uint64_t end =
+            (offset + size + backend_preallocation - 1) / backend_preallocation * backend_preallocation;
+        const off_t length = static_cast<off_t>(end - reserved);
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(reserved), length) == 0) {
+            reserved = end;
+        } else if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            reserved = no_reserve;
+        }
+    }
+}
+
+bool pwritev_file_backend::write(const char* data, const size_t size) {
+    if (fd < 0) {
+        return false;
+    }
+    _reserve(size);
+    iovec part{const_cast<char*>(data), size};
+    while (part.iov_len > 0) {
+        const ssize_t written = pwritev(fd, &part, 1, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        offset += static_cast<uint64_t>(written);
+        part.iov_base = static_cast<char*>(part.iov_base) + written;
+        part.iov_len -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool pwritev_file_backend::sync() { return fd >= 0 && fdatasync(fd) == 0; }
+
+bool pwritev_file_backend::crash_write(const char* data, const size_t size) {
+    bool result = false;
+    if (fd >= 0) {
+        // the end moves only past the written bytes, a failed write leaves no gap
+        const size_t written = _write_all(fd, data, size, static_cast<off_t>(offset));
+        offset += written;
+        result = written == size;
+    }
+    return result;
+}
+
+void pwritev_file_backend::close() {
+    if (fd >= 0) {
+        // the reserve beyond the end of the data is released
+        if (reserved != no_reserve && reserved > offset) {
+            if (ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+                reserved = offset;
+            }
+        }
+        ::close(fd);
+        fd = -1;
+        offset = reserved = 0;
+    }
+}
+
+// Write of one registered buffer
+struct uring_write {
+    size_t length = 0;
+    size_t written = 0;
+    uint64_t offset = 0;
+};
+
+// Mapped io_uring rings and registered buffers
+struct io_uring_file_backend::ring {
+    int fd = -1;
+    void* sq_map = MAP_FAILED;
+    size_t sq_size = 0;
+    void* cq_map = MAP_FAILED;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // registered buffers
+    char* memory = nullptr;
+    uring_write writes[io_uring_depth];
+    std::vector<unsigned> free_buffers;
+
+    // buffer collecting data that is not submitted yet, -1 - none
+    int open = -1;
+
+    // number of submitted writes
+    unsigned in_flight = 0;
+
+    ~ring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+        if (cq_map != MAP_FAILED && cq_map != sq_map) munmap(cq_map, cq_size);
+        if (sq_map != MAP_FAILED) munmap(sq_map, sq_size);
+        if (fd >= 0) ::close(fd);
+        std::free(memory);
+    }
+
+    /**
+     * @brief Set up the rings and register the buffers.
+     *
+     * @return false if io_uring is not available
+     */
+    bool setup() {
+        io_uring_params params{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, io_uring_depth, &params));
+        if (fd < 0) return false;
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_map) {
+            sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+        }
+        const int protection = PROT_READ | PROT_WRITE;
+        const int flags = MAP_SHARED | MAP_POPULATE;
+        sq_map = mmap(nullptr, sq_size, protection, flags, fd, IORING_OFF_SQ_RING);
+        if (sq_map == MAP_FAILED) return false;
+        cq_map = single_map ? sq_map : mmap(nullptr, cq_size, protection, flags, fd, IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED) return false;
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, protection, flags, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sq_map);
+        char* cq = static_cast<char*>(cq_map);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        memory = static_cast<char*>(std::aligned_alloc(4096, io_uring_depth * io_uring_buffer_size));
+        if (memory == nullptr) return false;
+        iovec buffers[io_uring_depth];
+        for (unsigned i = 0; i < io_uring_depth; ++i) {
+            buffers[i].iov_base = memory + i * io_uring_buffer_size;
+            buffers[i].iov_len = io_uring_buffer_size;
+            free_buffers.push_back(i);
+        }
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers, io_uring_depth) == 0;
+    }
+
+    /**
+     * @brief Submit the write of a registered buffer.
+     *
+     * @param[in] file file descriptor.
+     * @param[in] index buffer index.
+     *
+     * @return false if the submission has failed
+     */
+    bool submit(const int file, const unsigned index) {
+        const uring_write& write = writes[index];
+        const unsigned tail = *sq_tail;
+        const unsigned slot = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[slot];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE_FIXED;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<uint64_t>(memory + index * io_uring_buffer_size + write.written);
+        sqe.len = static_cast<uint32_t>(write.length - write.written);
+        sqe.off = write.offset + write.written;
+        sqe.buf_index = static_cast<uint16_t>(index);
+        sqe.user_data = index;
+        sq_array[slot] = slot;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+        long result = -1;
+        do {
+            result = syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0);
+        } while (result < 0 && errno == EINTR);
+        return result == 1;
+    }
+};
+
+io_uring_file_backend::io_uring_file_backend() : uring(new ring) {
+    if (!uring->setup()) {
+        uring.reset();
+    }
+}
+
+io_uring_file_backend::~io_uring_file_backend() { io_uring_file_backend::close(); }
+
+bool io_uring_file_backend::available() const { return uring != nullptr; }
+
+void io_uring_file_backend::_submit_open() {
+    const unsigned index = static_cast<unsigned>(uring->open);
+    uring->open = -1;
+    if (uring->submit(fd, index)) {
+        ++uring->in_flight;
+    } else {
+        uring->free_buffers.push_back(index);
+        healthy = false;
+    }
+}
+
+void io_uring_file_backend::_reap(const unsigned min_complete) {
+    if (min_complete > 0) {
+        long result = -1;
+        do {
+            result =
+                syscall(__NR_io_uring_enter, uring->fd, 0, min_complete, IORING_ENTER_GETEVENTS, nullptr, 0);
+        } while (result < 0 && errno == EINTR);
+    }
+
+    unsigned head = *uring->cq_head;
+    while (head != __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe& cqe = uring->cqes[head & *uring->cq_mask];
+        const unsigned index = static_cast<unsigned>(cqe.user_data);
+        uring_write& write = uring->writes[index];
+        bool done = true;
+        if (cqe.res > 0 && write.written + static_cast<size_t>(cqe.res) < write.length) {
+            // a short write is continued from where it stopped
+            write.written += static_cast<size_t>(cqe.res);
+            done = !uring->submit(fd, index);
+            healthy = healthy && !done;
+        } else if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+            done = !uring->submit(fd, index);
+            healthy = healthy && !done;
+        } else if (cqe.res <= 0) {
+            healthy = false;
+        }
+        if (done) {
+            --uring->in_flight;
+            uring->free_buffers.push_back(index);
+        }
+        ++head;
+    }
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+
+    // the file is idle, the collected data goes at once
+    if (uring->in_flight == 0 && uring->open >= 0) {
+        _submit_open();
+    }
+}
+
+bool io_uring_file_backend::write(const char* data, const size_t size) {
+    if (!uring) {
+        return pwritev_file_backend::write(data, size);
+    }
+    if (fd < 0) {
+        return false;
+    }
+    _reserve(size);
+    // completions that are already there are taken without a system call
+    _reap(0);
+    size_t left = size;
+    while (left > 0) {
+        if (uring->open < 0) {
+            while (uring->free_buffers.empty()) {
+                _reap(1);
+            }
+            uring->open = static_cast<int>(uring->free_buffers.back());
+            uring->free_buffers.pop_back();
+            uring->writes[uring->open] = {0, 0, offset};
+        }
+        uring_write& write = uring->writes[uring->open];
+        const size_t room = io_uring_buffer_size - write.length;
+        const size_t chunk = left < room ? left : room;
+        char* target = uring->memory + uring->open * io_uring_buffer_size + write.length;
+        std::memcpy(target, data + (size - left), chunk);
+        write.length += chunk;
+        offset += chunk;
+        left -= chunk;
+        if (write.length == io_uring_buffer_size) {
+            _submit_open();
+        }
+    }
+    if (uring->open >= 0 && uring->in_flight == 0) {
+        _submit_open();
+    }
+    return healthy;
+}
+
+bool io_uring_file_backend::flush() {
+    if (uring) {
+        if (uring->open >= 0) {
+            _submit_open();
+        }
+        while (uring->in_flight > 0) {
+            _reap(1);
+        }
+    }
+    const bool result = healthy;
+    // the error is kept for the next sync, a flush between does not confirm the lost data
+    synced_healthy = synced_healthy && healthy;
+    healthy = true;
+    return result;
+}
+
+bool io_uring_file_backend::sync() {
+    flush();
+    const bool written = synced_healthy;
+    synced_healthy = true;
+    return pwritev_file_backend::sync() && written;
+}
+
+bool io_uring_file_backend::crash_write(const char* data, const size_t size) {
+    if (uring && fd >= 0) {
+        // the collected data is written directly, the submitted writes are finished by the kernel
+        if (uring->open >= 0) {
+            const uring_write& write = uring->writes[uring->open];
+            const char* buffer = uring->memory + uring->open * io_uring_buffer_size;
+            _write_all(fd, buffer + write.written, write.length - write.written,
+                       static_cast<off_t>(write.offset + write.written));
+            uring->open = -1;
+        }
+        if (uring->in_flight > 0) {
+            long result = -1;
+            do {
+                result = syscall(__NR_io_uring_enter, uring->fd, 0, uring->in_flight, IORING_ENTER_GETEVENTS,
+                                 nullptr, 0);
+            } while (result < 0 && errno == EINTR);
+        }
+    }
+    return pwritev_file_backend::crash_write(data, size);
+}
+
+void io_uring_file_backend::close() {
+    if (fd >= 0) {
+        flush();
+    }
+    synced_healthy = true;
+    pwritev_file_backend::close();
+}
+
+mmap_ring_file_backend::mmap_ring_file_backend(const io_backend_options& options_v) : options(options_v) {}
+
+mmap_ring_file_backend::~mmap_ring_file_backend() { mmap_ring_file_backend::close(); }
+
+bool mmap_ring_file_backend::open(const std::filesystem::path& path) {
+    if (fd >= 0) {
+        return true;
+    }
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const size_t file_size = mmap_ring_header_size + options.ring_size;
+    struct stat info {};
+    const bool sized = fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == file_size;
+    // the whole file is allocated, so a full disk cannot turn a store into SIGBUS
+    if ((!sized && ftruncate(fd, static_cast<off_t>(file_size)) != 0) ||
+        posix_fallocate(fd, 0, static_cast<off_t>(file_size)) != 0) {
+        close();
+        return false;
+    }
+    void* mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    map = static_cast<char*>(mapping);
+
+    mmap_ring_header* header = _header();
+    if (!sized || std::memcmp(header->magic, mmap_ring_magic, sizeof(mmap_ring_magic)) != 0 ||
+        header->header_size != mmap_ring_header_size || header->capacity != options.ring_size ||
+        header->cursor >= options.ring_size) {
+        std::memset(header, 0, sizeof(*header));
+        std::memcpy(header->magic, mmap_ring_magic, sizeof(mmap_ring_magic));
+        header->version = 1;
+        header->header_size = mmap_ring_header_size;
+        header->capacity = options.ring_size;
+    }
+    ++header->generation;
+    last_sync = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool mmap_ring_file_backend::is_open() const { return map != nullptr; }
+
+bool mmap_ring_file_backend::write(const char* data, const size_t size) {
+    if (map == nullptr || options.ring_size == 0) {
+        return false;
+    }
+    mmap_ring_header* header = _header();
+    char* area = map + mmap_ring_header_size;
+    const size_t capacity = options.ring_size;
+    size_t cursor = header->cursor;
+    uint64_t wraps = header->wraps;
+
+    // only the newest capacity bytes of a huge write can be kept
+    const size_t skip = size > capacity ? size - capacity : 0;
+    if (skip > 0) {
+        wraps += (cursor + skip) / capacity;
+        cursor = (cursor + skip) % capacity;
+    }
+    const size_t left = size - skip;
+    const size_t first = left < capacity - cursor ? left : capacity - cursor;
+    std::memcpy(area + cursor, data + skip, first);
+    std::memcpy(area, data + skip + first, left - first);
+    if (cursor + left >= capacity) {
+        ++wraps;
+    }
+    // the cursor is stored after the data, a reader never sees it ahead of the records
+    __atomic_store_n(&header->wraps, wraps, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->cursor, (cursor + left) % capacity, __ATOMIC_RELEASE);
+
+    if (options.sync_interval.count() > 0) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_sync >= options.sync_interval) {
+            last_sync = now;
+            msync(map, mmap_ring_header_size + capacity, MS_SYNC);
+        }
+    }
+    return true;
+}
+
+bool mmap_ring_file_backend::sync() {
+    if (map == nullptr) {
+        return false;
+    }
+    last_sync = std::chrono::steady_clock::now();
+    return msync(map, mmap_ring_header_size + options.ring_size, MS_SYNC) == 0;
+}
+
+bool mmap_ring_file_backend::crash_write(const char* data, const size_t size) {
+    // a write is a memcpy into the mapping, msync and clock_gettime are async-signal-safe
+    return write(data, size);
+}
+
+void mmap_ring_file_backend::close() {
+    if (map != nullptr) {
+        if (options.sync_interval.count() > 0) {
+            msync(map, mmap_ring_header_size + options.ring_size, MS_SYNC);
+        }
+        munmap(map, mmap_ring_header_size + options.ring_size);
+        map = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool mmap_ring_is_ring(const std::string& data) {
+    return data.size() >= sizeof(mmap_ring_header) &&
+           std::memcmp(data.data(), mmap_ring_magic, sizeof(mmap_ring_magic)) == 0;
+}
+
+bool mmap_ring_text(const std::string& data, std::string& out) {
+    if (!mmap_ring_is_ring(data)) {
+        return false;
+    }
+    mmap_ring_header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.header_size < sizeof(header) || header.cursor >= header.capacity ||
+        data.size() < header.header_size + header.capacity) {
+        return false;
+    }
+    const char* area = data.data() + header.header_size;
+    if (header.wraps == 0) {
+        out.append(area, header.cursor);
+    } else {
+        // oldest bytes first: from the cursor to the end of the area, then from the start to the cursor
+        const size_t base = out.size();
+        out.append(area + header.cursor, header.capacity - header.cursor);
+        out.append(area, header.cursor);
+        // the record at the cursor may be partly overwritten, the text starts at the first record
+        // header: the cursor itself when the newest record ended on a record boundary
+        size_t start = base;
+        while (start < out.size() &&
+               log_line_level(std::string_view(out).substr(start, out.find('\n', start) - start)) ==
+                   _unknown_log_type) {
+            const size_t next = out.find('\n', start);
+            start = next == std::string::npos ? out.size() : next + 1;
+        }
+        if (start == out.size()) {
+            // lines without a level header, only the first line can be cut
+            const size_t next = out.find('\n', base);
+            start = next == std::string::npos ? out.size() : next + 1;
+        }
+        out.erase(base, start - base);
+    }
+    return true;
+}
+
+std::unique_ptr<file_backend> make_file_backend(const io_backend_type type,
+                                                const io_backend_options& options) {
+    std::unique_ptr<file_backend> result;
+    if (type == mmap_ring_backend) {
+        result.reset(new mmap_ring_file_backend(options));
+    }
+    if (type == io_uring_backend) {
+        std::unique_ptr<io_uring_file_backend> uring(new io_uring_file_backend);
+        if (uring->available()) {
+            result = std::move(uring);
+        }
+    }
+    if (!result && type != stream_backend && type != mmap_ring_backend) {
+        result.reset(new pwritev_file_backend);
+    }
+    if (!result) {
+        result.reset(new stream_file_backend);
+    }
+    return result;
+}
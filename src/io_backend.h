@@ -0,0 +1,341 @@
+#ifndef FILE_H
+#define FILE_H
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#endif
+
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <memory>
+#include <utility>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef CHRONO_H
+#define CHRONO_H
+#include <chrono>
+#endif
+
+#ifndef IO_BACKEND_H
+#define IO_BACKEND_H
+
+// File output backends of the logger
+enum io_backend_type {
+    // std::ofstream without a stream buffer, every write is a blocking write(2)
+    stream_backend,
+    // pwritev(2) at the tracked end of the file with fallocate preallocation
+    pwritev_backend,
+    // io_uring with registered buffers and several writes in flight, falls back to pwritev
+    io_uring_backend,
+    // fixed-size memory-mapped file used as a circular buffer of the newest records
+    mmap_ring_backend
+};
+
+// Settings of the backends
+struct io_backend_options {
+    // size of the data area of mmap_ring_backend
+    size_t ring_size = 16 << 20;
+    // how often mmap_ring_backend calls msync (0 - never, the page cache survives a process crash)
+    std::chrono::milliseconds sync_interval{0};
+};
+
+// Magic of the mmap_ring_backend file
+constexpr char mmap_ring_magic[8] = {'I', 'L', 'O', 'G', 'R', 'I', 'N', 'G'};
+
+// Header of the mmap_ring_backend file, the data area starts at header_size
+struct mmap_ring_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    // size of the data area
+    uint64_t capacity;
+    // next write position in the data area
+    uint64_t cursor;
+    // number of times the cursor has wrapped to the start
+    uint64_t wraps;
+    // number of times the file has been opened
+    uint64_t generation;
+};
+
+// Size of the header page of the mmap_ring_backend file
+constexpr size_t mmap_ring_header_size = 4096;
+
+// Size of the preallocated chunks of the pwritev and io_uring backends
+constexpr size_t backend_preallocation = 4 << 20;
+
+/**
+ * @brief Output of the log file.
+ *
+ * The file is opened for appending. A backend may only queue a write,
+ * flush waits until every queued write has reached the kernel page cache.
+ */
+class file_backend {
+   public:
+    virtual ~file_backend() = default;
+
+    /**
+     * @brief Open the file for appending, create it if it does not exist.
+     *
+     * @param[in] path path to the file.
+     *
+     * @return true if the file is open
+     */
+    virtual bool open(const std::filesystem::path& path) = 0;
+
+    /**
+     * @brief Check if the file is open.
+     *
+     * @return true if the file is open
+     */
+    virtual bool is_open() const = 0;
+
+    /**
+     * @brief Append data to the file.
+     *
+     * The data is copied or written before the call returns.
+     *
+     * @param[in] data data.
+     * @param[in] size number of bytes.
+     *
+     * @return false if this or an earlier queued write has failed
+     */
+    virtual bool write(const char* data, const size_t size) = 0;
+
+    /**
+     * @brief Wait for all queued writes.
+     *
+     * @return false if a write has failed
+     */
+    virtual bool flush() { return true; }
+
+    /**
+     * @brief Wait for the queued writes and make the file data durable (fdatasync).
+     *
+     * @return false if the sync or a queued write since the last sync has failed (flush reports it as well)
+     */
+    virtual bool sync() = 0;
+
+    /**
+     * @brief Append data from a signal handler (crash handler).
+     *
+     * Only async-signal-safe calls, nothing is allocated. Data collected by the
+     * backend is written first, the writes in flight are waited for.
+     *
+     * @param[in] data data.
+     * @param[in] size number of bytes.
+     *
+     * @return false if the write has failed
+     */
+    virtual bool crash_write(const char* data, const size_t size) = 0;
+
+    /**
+     * @brief Finish the queued writes and close the file.
+     */
+    virtual void close() = 0;
+};
+
+/**
+ * @brief Backend with the behaviour of the original logger: std::ofstream.
+ */
+class stream_file_backend : public file_backend {
+    std::ofstream file;
+
+    // path of the open file, crash_write opens it once more with O_APPEND
+    std::filesystem::path file_path;
+
+    // the stream does not give its descriptor, sync uses a read-only descriptor of the same file
+    int sync_fd = -1;
+
+   public:
+    ~stream_file_backend() override;
+
+    bool open(const std::filesystem::path& path) override;
+    bool is_open() const override;
+    bool write(const char* data, const size_t size) override;
+    bool sync() override;
+    bool crash_write(const char* data, const size_t size) override;
+    void close() override;
+};
+
+/**
+ * @brief Backend writing with pwritev at the tracked end of the file.
+ *
+ * The file space is reserved ahead with fallocate(FALLOC_FL_KEEP_SIZE) in
+ * backend_preallocation chunks, so the file does not fragment; the unused
+ * reserve is released on close.
+ */
+class pwritev_file_backend : public file_backend {
+   protected:
+    // file descriptor, -1 - closed
+    int fd = -1;
+
+    // end of the written data
+    uint64_t offset = 0;
+
+    // end of the reserved space
+    uint64_t reserved = 0;
+
+    /**
+     * @brief Reserve the file space for a write.
+     *
+     * @param[in] size number of bytes about to be written at offset.
+     */
+    void _reserve(const size_t size);
+
+   public:
+    ~pwritev_file_backend() override;
+
+    bool open(const std::filesystem::path& path) override;
+    bool is_open() const override;
+    bool write(const char* data, const size_t size) override;
+    bool sync() override;
+    bool crash_write(const char* data, const size_t size) override;
+    void close() override;
+};
+
+/**
+ * @brief Backend writing through io_uring (raw system calls, no liburing).
+ *
+ * Data is copied into one of the registered buffers and written with
+ * IORING_OP_WRITE_FIXED at its own offset, so up to io_uring_depth writes
+ * are in flight while the writer thread goes on. While earlier writes are
+ * in flight, new data is collected in the current buffer and submitted when
+ * the file becomes idle or the buffer is full. A write waits for a completion
+ * only when all buffers are busy.
+ */
+class io_uring_file_backend : public pwritev_file_backend {
+    struct ring;
+
+    // io_uring state, nullptr - io_uring is not available
+    std::unique_ptr<ring> uring;
+
+    // false after a failed write until flush reports it
+    bool healthy = true;
+
+    // false after a failed write until sync reports it
+    bool synced_healthy = true;
+
+    /**
+     * @brief Submit the buffer that collects data.
+     */
+    void _submit_open();
+
+    /**
+     * @brief Take the completions, wait for at least min_complete of them.
+     *
+     * @param[in] min_complete number of completions to wait for.
+     */
+    void _reap(const unsigned min_complete);
+
+   public:
+    io_uring_file_backend();
+    ~io_uring_file_backend() override;
+
+    /**
+     * @brief Check that the ring has been set up.
+     *
+     * @return false if the kernel does not provide io_uring
+     */
+    bool available() const;
+
+    bool write(const char* data, const size_t size) override;
+    bool flush() override;
+    bool sync() override;
+    bool crash_write(const char* data, const size_t size) override;
+    void close() override;
+};
+
+/**
+ * @brief Backend writing into a memory-mapped circular file.
+ *
+ * The file is a header page and a data area of ring_size bytes. A write is a
+ * memcpy into the mapping and an update of the header cursor, without a system
+ * call, and the newest ring_size bytes of records survive a crash of the process.
+ * Reopening the file continues after the saved cursor with the next generation.
+ * mmap_ring_text rebuilds the records in order.
+ */
+class mmap_ring_file_backend : public file_backend {
+    // settings
+    io_backend_options options;
+
+    // file descriptor, -1 - closed
+    int fd = -1;
+
+    // mapping of the whole file
+    char* map = nullptr;
+
+    // time of the last msync
+    std::chrono::steady_clock::time_point last_sync;
+
+    /**
+     * @brief Header of the mapped file.
+     *
+     * @return header
+     */
+    mmap_ring_header* _header() const { return reinterpret_cast<mmap_ring_header*>(map); }
+
+   public:
+    /**
+     * @brief Class mmap_ring_file_backend constructor.
+     *
+     * @param[in] options_v ring_size and sync_interval.
+     */
+    explicit mmap_ring_file_backend(const io_backend_options& options_v);
+    ~mmap_ring_file_backend() override;
+
+    mmap_ring_file_backend(const mmap_ring_file_backend&) = delete;
+    mmap_ring_file_backend& operator=(const mmap_ring_file_backend&) = delete;
+
+    bool open(const std::filesystem::path& path) override;
+    bool is_open() const override;
+    bool write(const char* data, const size_t size) override;
+    bool sync() override;
+    bool crash_write(const char* data, const size_t size) override;
+    void close() override;
+};
+
+/**
+ * @brief Check the magic of a mmap_ring_backend file.
+ *
+ * @param[in] data file contents.
+ *
+ * @return true if data starts with a ring header
+ */
+bool mmap_ring_is_ring(const std::string& data);
+
+/**
+ * @brief Rebuild the records of a mmap_ring_backend file in order.
+ *
+ * After a wrap the text starts at the first record header (log_line_level)
+ * at or after the cursor: a partly overwritten oldest record is skipped, a
+ * record that starts right at the cursor is kept.
+ *
+ * @param[in] data file contents.
+ * @param[out] out records, oldest first, are appended here.
+ *
+ * @return false if the header is corrupt
+ */
+bool mmap_ring_text(const std::string& data, std::string& out);
+
+/**
+ * @brief Create a backend.
+ *
+ * @param[in] type io_backend_type.
+ * @param[in] options settings of the backend.
+ *
+ * @return backend, pwritev_file_backend if io_uring is not available
+ */
+std::unique_ptr<file_backend> make_file_backend(const io_backend_type type,
+                                                const io_backend_options& options = io_backend_options());
+#endif
@@ -0,0 +1,206 @@
+#include "log_format.h"
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+void fmt_args::append(const void* bytes, const size_t count) {
+    if (spill.empty() && used + count <= fmt_args_capacity) {
+        std::memcpy(local + used, bytes, count);
+    } else {
+        if (spill.empty()) {
+            spill.assign(reinterpret_cast<const char*>(local), used);
+        }
+        spill.append(static_cast<const char*>(bytes), count);
+    }
+    used += static_cast<uint32_t>(count);
+}
+
+void fmt_args::append_string(std::string_view value) {
+    const uint32_t length = static_cast<uint32_t>(value.size());
+    const uint8_t tag = fmt_string_arg;
+    append(&tag, 1);
+    append(&length, sizeof(length));
+    append(value.data(), value.size());
+}
+
+// Output of fmt_render into a fixed buffer, the text that does not fit is cut off
+struct fixed_text {
+    char* data;
+    size_t capacity;
+    size_t size = 0;
+
+    void append(const char* text, const size_t count) {
+        const size_t room = capacity - size;
+        const size_t part = count < room ? count : room;
+        std::memcpy(data + size, text, part);
+        size += part;
+    }
+
+    fixed_text& operator+=(const char value) {
+        append(&value, 1);
+        return *this;
+    }
+
+    fixed_text& operator+=(const char* text) {
+        append(text, std::strlen(text));
+        return *this;
+    }
+};
+
+/**
+ * @brief Read a trivially copyable value from the encoded arguments.
+ *
+ * @param[in] pos position of the value, moved past it.
+ * @param[in] end end of the encoded arguments.
+ * @param[out] value result.
+ *
+ * @return false if the value does not fit before end
+ */
+template <typename T>
+static bool _read_value(const unsigned char*& pos, const unsigned char* end, T& value) {
+    if (static_cast<size_t>(end - pos) < sizeof(value)) return false;
+    std::memcpy(&value, pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+bool fmt_decode_arg(const unsigned char*& pos, const unsigned char* end, fmt_arg_value& arg) {
+    if (pos >= end) return false;
+    const unsigned char* next = pos;
+    arg = fmt_arg_value{};
+    arg.type = static_cast<fmt_arg_type>(*next++);
+    bool valid = false;
+    switch (arg.type) {
+        case fmt_int_arg:
+            valid = _read_value(next, end, arg.int_value);
+            break;
+        case fmt_uint_arg:
+            valid = _read_value(next, end, arg.uint_value);
+            break;
+        case fmt_double_arg:
+            valid = _read_value(next, end, arg.double_value);
+            break;
+        case fmt_bool_arg: {
+            uint8_t value = 0;
+            valid = _read_value(next, end, value);
+            arg.uint_value = value;
+            break;
+        }
+        case fmt_char_arg:
+            valid = next < end;
+            if (valid) {
+                arg.text = std::string_view(reinterpret_cast<const char*>(next), 1);
+                ++next;
+            }
+            break;
+        case fmt_string_arg: {
+            uint32_t length = 0;
+            valid = _read_value(next, end, length) && static_cast<size_t>(end - next) >= length;
+            if (valid) {
+                arg.text = std::string_view(reinterpret_cast<const char*>(next), length);
+                next += length;
+            }
+            break;
+        }
+        case fmt_pointer_arg: {
+            uintptr_t value = 0;
+            valid = _read_value(next, end, value);
+            arg.uint_value = value;
+            break;
+        }
+    }
+    // a corrupted argument ends the decoding, the rest can not be trusted
+    pos = valid ? next : end;
+    return valid;
+}
+
+/**
+ * @brief Decode one argument and append it as text.
+ *
+ * @param[out] out result.
+ * @param[in] pos position of the argument, moved past it.
+ * @param[in] end end of the encoded arguments.
+ *
+ * @return false if the argument is corrupted, {?} is appended then
+ */
+template <typename Out>
+static bool _append_arg(Out& out, const unsigned char*& pos, const unsigned char* end) {
+    fmt_arg_value arg;
+    if (!fmt_decode_arg(pos, end, arg)) {
+        out += "{?}";
+        return false;
+    }
+    switch (arg.type) {
+        case fmt_int_arg:
+            fmt_append_number(out, arg.int_value);
+            break;
+        case fmt_uint_arg:
+            fmt_append_number(out, arg.uint_value);
+            break;
+        case fmt_double_arg:
+            fmt_append_number(out, arg.double_value);
+            break;
+        case fmt_bool_arg:
+            out += arg.uint_value != 0 ? "true" : "false";
+            break;
+        case fmt_char_arg:
+        case fmt_string_arg:
+            out.append(arg.text.data(), arg.text.size());
+            break;
+        case fmt_pointer_arg:
+            out += "0x";
+            fmt_append_number(out, arg.uint_value, 16);
+            break;
+    }
+    return true;
+}
+
+/**
+ * @brief Render a format string with encoded arguments.
+ *
+ * @param[out] out result, std::string or fixed_text.
+ * @param[in] fmt format string.
+ * @param[in] pos first byte of the encoded arguments.
+ * @param[in] end end of the encoded arguments.
+ *
+ * @return false if the arguments are corrupted
+ */
+template <typename Out>
+static bool _render(Out& out, const char* fmt, const unsigned char* pos, const unsigned char* end) {
+    const char* text = fmt;
+    bool valid = true;
+    while (*text != '\0') {
+        const char* special = text;
+        while (*special != '\0' && *special != '{' && *special != '}') {
+            ++special;
+        }
+        out.append(text, special - text);
+        text = special;
+        if (*text == '\0') break;
+
+        if ((text[0] == '{' && text[1] == '{') || (text[0] == '}' && text[1] == '}')) {
+            out += text[0];
+            text += 2;
+        } else if (text[0] == '{' && text[1] == '}') {
+            if (pos < end) {
+                valid = _append_arg(out, pos, end) && valid;
+            } else {
+                out += "{}";
+            }
+            text += 2;
+        } else {
+            out += *text++;
+        }
+    }
+    return valid;
+}
+
+bool fmt_render(std::string& out, const char* fmt, const fmt_args& args) {
+    return _render(out, fmt, args.data(), args.data() + args.size());
+}
+
+size_t fmt_render(char* out, const size_t capacity, const char* fmt, std::string_view args) {
+    fixed_text text{out, capacity};
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(args.data());
+    _render(text, fmt, pos, pos + args.size());
+    return text.size;
+}
@@ -0,0 +1,299 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef TRAITS_H
+#define TRAITS_H
+#include <cstring>
+#include <type_traits>
+#endif
+
+#ifndef CHARCONV_H
+#define CHARCONV_H
+#include <charconv>
+#endif
+
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+// Type tags of the encoded format arguments
+enum fmt_arg_type : uint8_t {
+    fmt_int_arg,
+    fmt_uint_arg,
+    fmt_double_arg,
+    fmt_bool_arg,
+    fmt_char_arg,
+    fmt_string_arg,
+    fmt_pointer_arg
+};
+
+// Number of bytes of encoded arguments stored without a heap allocation
+constexpr size_t fmt_args_capacity = 128;
+
+/**
+ * @brief Binary-encoded format arguments.
+ *
+ * Every argument is stored as a fmt_arg_type tag followed by its value,
+ * strings as a 32-bit length followed by the bytes. Arguments that do not
+ * fit in the local storage are moved to a heap string.
+ */
+class fmt_args {
+    // used bytes
+    uint32_t used = 0;
+
+    // local storage
+    unsigned char local[fmt_args_capacity];
+
+    // heap storage, used when the arguments do not fit in local
+    std::string spill;
+
+   public:
+    fmt_args() : local() {}
+
+    /**
+     * @brief Append raw bytes.
+     *
+     * @param[in] bytes data.
+     * @param[in] count number of bytes.
+     */
+    void append(const void* bytes, const size_t count);
+
+    /**
+     * @brief Append a tag and a trivially copyable value.
+     *
+     * @param[in] tag fmt_arg_type.
+     * @param[in] value value.
+     */
+    template <typename T>
+    void append_value(const fmt_arg_type tag, const T value) {
+        append(&tag, 1);
+        append(&value, sizeof(value));
+    }
+
+    /**
+     * @brief Append a string argument.
+     *
+     * @param[in] value string.
+     */
+    void append_string(std::string_view value);
+
+    /**
+     * @brief Encoded bytes.
+     *
+     * @return pointer to the first encoded byte
+     */
+    const unsigned char* data() const {
+        return spill.empty() ? local : reinterpret_cast<const unsigned char*>(spill.data());
+    }
+
+    /**
+     * @brief Number of encoded bytes.
+     *
+     * @return number of bytes
+     */
+    size_t size() const { return used; }
+
+    /**
+     * @brief Remove all arguments.
+     */
+    void clear() {
+        used = 0;
+        spill.clear();
+    }
+};
+
+// Decoded format argument
+struct fmt_arg_value {
+    fmt_arg_type type = fmt_int_arg;
+    // fmt_int_arg
+    int64_t int_value = 0;
+    // fmt_uint_arg, fmt_bool_arg (0 or 1) and fmt_pointer_arg
+    uint64_t uint_value = 0;
+    // fmt_double_arg
+    double double_value = 0;
+    // fmt_string_arg and fmt_char_arg, points into the encoded arguments
+    std::string_view text;
+};
+
+/**
+ * @brief Decode one argument.
+ *
+ * Nothing is read past end. If the argument is cut off or has an unknown type
+ * pos is moved to end, so the decoding of the rest stops.
+ *
+ * @param[in] pos position of the argument, moved past it.
+ * @param[in] end end of the encoded arguments.
+ * @param[out] arg argument.
+ *
+ * @return false if the argument is corrupted
+ */
+bool fmt_decode_arg(const unsigned char*& pos, const unsigned char* end, fmt_arg_value& arg);
+
+/**
+ * @brief Append a number with std::to_chars.
+ *
+ * Used for the format arguments and the structured fields.
+ *
+ * @param[out] out result, std::string or any type with append(const char*, size_t).
+ * @param[in] value integer or floating point number.
+ * @param[in] base base of an integer.
+ */
+template <typename Out, typename T>
+void fmt_append_number(Out& out, const T value, const int base = 10) {
+    char text[32];
+    std::to_chars_result result;
+    if constexpr (std::is_floating_point_v<T>) {
+        result = std::to_chars(text, text + sizeof(text), value);
+    } else {
+        result = std::to_chars(text, text + sizeof(text), value, base);
+    }
+    out.append(text, result.ptr - text);
+}
+
+template <typename T>
+struct fmt_unsupported : std::false_type {};
+
+/**
+ * @brief Encode one format argument.
+ *
+ * Supported types: bool, char, integers, enums, floating point numbers,
+ * anything convertible to std::string_view and pointers.
+ *
+ * @param[out] args encoded arguments.
+ * @param[in] value argument.
+ */
+template <typename T>
+void fmt_encode_arg(fmt_args& args, const T& value) {
+    using type = std::decay_t<T>;
+    if constexpr (std::is_same_v<type, bool>) {
+        args.append_value(fmt_bool_arg, static_cast<uint8_t>(value));
+    } else if constexpr (std::is_same_v<type, char>) {
+        args.append_value(fmt_char_arg, value);
+    } else if constexpr (std::is_enum_v<type>) {
+        args.append_value(fmt_int_arg, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral_v<type> && std::is_signed_v<type>) {
+        args.append_value(fmt_int_arg, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral_v<type>) {
+        args.append_value(fmt_uint_arg, static_cast<uint64_t>(value));
+    } else if constexpr (std::is_floating_point_v<type>) {
+        args.append_value(fmt_double_arg, static_cast<double>(value));
+    } else if constexpr (std::is_array_v<T> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>) {
+        args.append_string(std::string_view(value));
+    } else if constexpr (std::is_same_v<type, const char*> || std::is_same_v<type, char*>) {
+        args.append_string(value == nullptr ? std::string_view("(null)") : std::string_view(value));
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        args.append_string(std::string_view(value));
+    } else if constexpr (std::is_pointer_v<type>) {
+        args.append_value(fmt_pointer_arg, reinterpret_cast<uintptr_t>(value));
+    } else {
+        static_assert(fmt_unsupported<T>::value, "unsupported type of a log format argument");
+    }
+}
+
+/**
+ * @brief Encode all format arguments.
+ *
+ * @param[out] args encoded arguments.
+ * @param[in] values arguments.
+ */
+template <typename... Args>
+void fmt_encode(fmt_args& args, const Args&... values) {
+    (fmt_encode_arg(args, values), ...);
+}
+
+/**
+ * @brief Count the {} placeholders of a format string.
+ *
+ * {{ and }} are escaped braces. Can be evaluated at compile time.
+ *
+ * @param[in] fmt format string.
+ *
+ * @return number of placeholders, -1 if the format string is malformed
+ */
+constexpr int fmt_count_placeholders(const char* fmt) {
+    int result = 0;
+    bool malformed = false;
+    for (size_t i = 0; fmt[i] != '\0' && !malformed; ++i) {
+        if (fmt[i] == '{' && fmt[i + 1] == '{') {
+            ++i;
+        } else if (fmt[i] == '}' && fmt[i + 1] == '}') {
+            ++i;
+        } else if (fmt[i] == '{' && fmt[i + 1] == '}') {
+            ++result;
+            ++i;
+        } else if (fmt[i] == '{' || fmt[i] == '}') {
+            malformed = true;
+        }
+    }
+    return malformed ? -1 : result;
+}
+
+// Used only in sizeof: the size of the result is the number of arguments + 1
+template <typename... Args>
+char (&fmt_arg_counter(const Args&...))[sizeof...(Args) + 1];
+
+/**
+ * @brief Render a format string with encoded arguments.
+ *
+ * Appends the text to out. Placeholders without an argument are kept as {},
+ * extra arguments are ignored. A corrupted argument (a record read from a
+ * damaged file) is rendered as {?} and the arguments after it are dropped.
+ *
+ * @param[out] out result.
+ * @param[in] fmt format string.
+ * @param[in] args encoded arguments.
+ *
+ * @return false if the arguments are corrupted
+ */
+bool fmt_render(std::string& out, const char* fmt, const fmt_args& args);
+
+/**
+ * @brief Render a format string with encoded arguments into a fixed buffer.
+ *
+ * The same as fmt_render with a string, but nothing is allocated and the calls
+ * are async-signal-safe (crash handler). The text that does not fit is cut off.
+ * The arguments are raw encoded bytes, so they may also be read from a copy
+ * of fmt_args::data (async_logger keeps long arguments in its payload_pool).
+ *
+ * @param[out] out buffer.
+ * @param[in] capacity size of the buffer.
+ * @param[in] fmt format string.
+ * @param[in] args encoded arguments, fmt_args::data.
+ *
+ * @return number of written bytes
+ */
+size_t fmt_render(char* out, const size_t capacity, const char* fmt, std::string_view args);
+
+/**
+ * @brief Put a formatted entry only if its level passes the filters.
+ *
+ * The same as LOGGER_LOG, but the message is a format string with {} placeholders.
+ * The number of placeholders is checked against the number of arguments at
+ * compile time, so the format string must be a literal.
+ *
+ * @param[in] target logger or async_logger.
+ * @param[in] level log_type.
+ * @param[in] fmt format string literal.
+ * @param[in] ... format arguments.
+ */
+#define LOGGER_FMT(target, level, fmt, ...)                                                    \
+    do {                                                                                       \
+        static_assert(fmt_count_placeholders(fmt) == sizeof(fmt_arg_counter(__VA_ARGS__)) - 1, \
+                      "log format string does not match the arguments");                       \
+        if (logger_level_compiled(level) && (target).should_log(level)) {                      \
+            (target).log(level, fmt, ##__VA_ARGS__);                                           \
+        }                                                                                      \
+    } while (0)
+#endif
@@ -0,0 +1,220 @@
+#include "log_index.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+static_assert(sizeof(index_header) == 24, "index header layout");
+static_assert(sizeof(index_entry) == 48, "index entry layout");
+
+uint32_t index_checksum(const index_entry& entry) {
+    index_entry copy = entry;
+    copy.checksum = 0;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&copy);
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < sizeof(copy); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619U;
+    }
+    return hash;
+}
+
+std::string index_path(const std::string& log_path) { return log_path + ".idx"; }
+
+/**
+ * @brief Inode of a file.
+ *
+ * @param[in] path file.
+ *
+ * @return inode, 0 if the file cannot be examined
+ */
+static uint64_t _inode(const std::string& path) {
+    struct stat info {};
+    return stat(path.c_str(), &info) == 0 ? static_cast<uint64_t>(info.st_ino) : 0;
+}
+
+/**
+ * @brief Read the header and the valid entries of an open index file.
+ *
+ * @param[in] fd index file.
+ * @param[in] log_inode inode of the log.
+ * @param[in] log_size size of the log.
+ * @param[out] entries valid entries.
+ *
+ * @return false if the header is wrong or belongs to another log
+ */
+static bool _read_index(const int fd, const uint64_t log_inode, const uint64_t log_size,
+                        std::vector<index_entry>& entries) {
+    entries.clear();
+    index_header header{};
+    if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 ||
+        header.entry_size != sizeof(index_entry) || log_inode == 0 || header.log_inode != log_inode) {
+        return false;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+    const size_t count = (static_cast<size_t>(info.st_size) - sizeof(header)) / sizeof(index_entry);
+    entries.resize(count);
+    const ssize_t read_size = pread(fd, entries.data(), count * sizeof(index_entry), sizeof(header));
+    size_t valid = read_size < 0 ? 0 : static_cast<size_t>(read_size) / sizeof(index_entry);
+    uint64_t end = 0;
+    for (size_t i = 0; i < valid; ++i) {
+        const index_entry& entry = entries[i];
+        if (entry.checksum != index_checksum(entry) || entry.offset < end ||
+            entry.offset + entry.size > log_size) {
+            valid = i;
+        } else {
+            end = entry.offset + entry.size;
+        }
+    }
+    entries.resize(valid);
+    return true;
+}
+
+bool load_log_index(const std::string& log_path, const uint64_t log_size, std::vector<index_entry>& entries) {
+    entries.clear();
+    const int fd = ::open(index_path(log_path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool result = _read_index(fd, _inode(log_path), log_size, entries);
+    ::close(fd);
+    return result;
+}
+
+log_index_writer::~log_index_writer() { close(); }
+
+void log_index_writer::_start(const uint64_t offset) {
+    current = index_entry{};
+    current.offset = offset;
+}
+
+void log_index_writer::_append(const index_entry* entries, const size_t count) {
+    // a short write leaves a torn entry, the readers stop at it
+    const size_t bytes = count * sizeof(index_entry);
+    if (count > 0 && write(fd, entries, bytes) != static_cast<ssize_t>(bytes)) {
+        close();
+    } else {
+        unsynced = unsynced || count > 0;
+    }
+}
+
+bool log_index_writer::open(const std::string& log_path_v, const uint64_t log_size,
+                            const size_t block_size_v) {
+    close();
+    log_path = log_path_v;
+    block_size = block_size_v == 0 ? index_block_size : block_size_v;
+    fd = ::open(index_path(log_path).c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::vector<index_entry> entries;
+    if (log_size == 0 || !_read_index(fd, _inode(log_path), log_size, entries)) {
+        reset();
+    } else {
+        // the torn tail of the last session is cut off
+        const size_t valid_size = sizeof(index_header) + entries.size() * sizeof(index_entry);
+        if (ftruncate(fd, static_cast<off_t>(valid_size)) != 0) {
+            close();
+            return false;
+        }
+    }
+    _start(log_size);
+    return fd >= 0;
+}
+
+void log_index_writer::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    unsynced = false;
+    pending.clear();
+}
+
+void log_index_writer::add_record(const uint64_t end, const int level, const int64_t time,
+                                  const long utc_offset, const bool dated, const bool other_lines) {
+    const int32_t offset = static_cast<int32_t>(utc_offset);
+    if (current.size == 0) {
+        current.earliest = current.latest = time;
+        current.least_offset = current.most_offset = offset;
+        current.dated = dated ? 1 : 0;
+    } else {
+        current.earliest = time < current.earliest ? time : current.earliest;
+        current.latest = time > current.latest ? time : current.latest;
+        current.least_offset = offset < current.least_offset ? offset : current.least_offset;
+        current.most_offset = offset > current.most_offset ? offset : current.most_offset;
+        if (current.dated != (dated ? 1 : 0)) {
+            // the layout has changed within the block, its times cannot be compared
+            current.levels |= index_other_lines;
+        }
+    }
+    if (level >= 0 && level < 7) {
+        current.levels |= static_cast<uint8_t>(1U << level);
+    }
+    if (other_lines) {
+        current.levels |= index_other_lines;
+    }
+    current.size = static_cast<uint32_t>(end - current.offset);
+    if (current.size >= block_size) {
+        current.checksum = index_checksum(current);
+        pending.push_back(current);
+        _start(end);
+    }
+}
+
+void log_index_writer::written(const uint64_t log_size) {
+    if (fd >= 0 && !pending.empty() && pending.back().offset + pending.back().size <= log_size) {
+        _append(pending.data(), pending.size());
+        pending.clear();
+    }
+}
+
+void log_index_writer::discard(const uint64_t log_size) {
+    pending.clear();
+    _start(log_size);
+}
+
+void log_index_writer::finish(const uint64_t log_size) {
+    if (current.size > 0 && current.offset + current.size == log_size) {
+        current.checksum = index_checksum(current);
+        pending.push_back(current);
+        _start(log_size);
+    }
+    written(log_size);
+    sync();
+}
+
+bool log_index_writer::sync() {
+    bool result = true;
+    if (fd >= 0 && unsynced) {
+        result = fdatasync(fd) == 0;
+        unsynced = !result;
+    }
+    return result;
+}
+
+void log_index_writer::reset() {
+    pending.clear();
+    _start(0);
+    if (fd < 0) {
+        return;
+    }
+    index_header header{};
+    std::memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.entry_size = sizeof(index_entry);
+    header.block_size = static_cast<uint32_t>(block_size);
+    header.log_inode = _inode(log_path);
+    // the header names the new log before any entry of it is appended
+    if (ftruncate(fd, 0) != 0 || write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)) ||
+        fdatasync(fd) != 0) {
+        close();
+    }
+    unsynced = false;
+}
@@ -0,0 +1,225 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef VECTOR_H
+#define VECTOR_H
+#include <vector>
+#endif
+
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+// Bytes of the log one index entry covers at least
+constexpr size_t index_block_size = 64 * 1024;
+
+// index_entry::levels bit of a block whose lines may have any text as their time: messages with newlines,
+// a change of the timestamp layout
+constexpr uint8_t index_other_lines = 0x80;
+
+// First bytes of an index file
+constexpr char index_magic[8] = {'L', 'O', 'G', 'I', 'D', 'X', '0', '2'};
+
+// Header of an index file
+struct index_header {
+    char magic[8];
+    // sizeof(index_entry)
+    uint32_t entry_size;
+    // index_block_size the file was written with
+    uint32_t block_size;
+    // inode of the log the index belongs to
+    uint64_t log_inode;
+};
+
+/**
+ * @brief One block of the log in the index file.
+ *
+ * A block is a run of whole records; the index holds the blocks in the
+ * order of the file, the bytes between the blocks are not indexed.
+ */
+struct index_entry {
+    // position of the first record of the block in the log
+    uint64_t offset;
+    // bytes of the block
+    uint32_t size;
+    // index_checksum of the entry
+    uint32_t checksum;
+    // smallest and largest time of the records of the block, nanoseconds since the epoch
+    // as the timestamps show it (cut to their precision)
+    int64_t earliest;
+    int64_t latest;
+    // smallest and largest UTC offset of the timestamps of the block, seconds
+    int32_t least_offset;
+    int32_t most_offset;
+    // bit 1 << log_type of every level in the block, index_other_lines
+    uint8_t levels;
+    // 1 if the timestamps show the date (iso8601_layout), otherwise only the time of day
+    uint8_t dated;
+    uint8_t reserved[6];
+};
+
+/**
+ * @brief Checksum of an index entry (FNV-1a of all members except checksum).
+ *
+ * @param[in] entry entry.
+ *
+ * @return checksum
+ */
+uint32_t index_checksum(const index_entry& entry);
+
+/**
+ * @brief Path of the index of a log.
+ *
+ * @param[in] log_path log file.
+ *
+ * @return <log file>.idx
+ */
+std::string index_path(const std::string& log_path);
+
+/**
+ * @brief Read the valid entries of the index of a log.
+ *
+ * Reading stops at the first entry with a wrong checksum (a torn write),
+ * an entry that overlaps the previous one or ends beyond the log. An index
+ * written for another file (the inode of the log differs) is not read.
+ *
+ * @param[in] log_path log file.
+ * @param[in] log_size size of the log.
+ * @param[out] entries valid entries.
+ *
+ * @return false if there is no index, its header is wrong or it belongs to another file
+ */
+bool load_log_index(const std::string& log_path, const uint64_t log_size, std::vector<index_entry>& entries);
+
+/**
+ * @brief Writer of the sparse index of a log (<log file>.idx).
+ *
+ * The logger passes the end of every record; once a block is at least
+ * block_size bytes it is closed, and its entry is appended to the index file
+ * after the bytes of the block are written to the log. The entries have a
+ * fixed size and a checksum, so a crash leaves at most a torn last entry
+ * that the readers ignore and the next open cuts off. The index file is
+ * synced after a new header, when the logger stops and with logger::sync.
+ */
+class log_index_writer {
+    // index file, -1 - closed
+    int fd = -1;
+
+    // log file
+    std::string log_path;
+
+    // entries were appended after the last fdatasync
+    bool unsynced = false;
+
+    // least bytes of a block
+    size_t block_size = index_block_size;
+
+    // block being filled, its offset is set and size is 0 while it has no records
+    index_entry current{};
+
+    // closed blocks whose bytes are still in the logger buffer
+    std::vector<index_entry> pending;
+
+    /**
+     * @brief Start a new block.
+     *
+     * @param[in] offset position of the block in the log.
+     */
+    void _start(const uint64_t offset);
+
+    /**
+     * @brief Append entries to the index file.
+     *
+     * @param[in] entries entries.
+     * @param[in] count number of entries.
+     */
+    void _append(const index_entry* entries, const size_t count);
+
+   public:
+    log_index_writer() = default;
+    ~log_index_writer();
+
+    log_index_writer(const log_index_writer&) = delete;
+    log_index_writer& operator=(const log_index_writer&) = delete;
+
+    /**
+     * @brief Open the index of a log.
+     *
+     * The valid entries of an existing index of the same log are kept, the
+     * rest of the file is cut off; an index of another file is started again.
+     * The first new block starts at log_size.
+     *
+     * @param[in] log_path_v log file.
+     * @param[in] log_size size of the log.
+     * @param[in] block_size_v least bytes of a block.
+     *
+     * @return false if the index file cannot be opened
+     */
+    bool open(const std::string& log_path_v, const uint64_t log_size, const size_t block_size_v);
+
+    /**
+     * @brief Close the index file, the pending and the open block are lost.
+     */
+    void close();
+
+    /**
+     * @brief Check that the index file is open.
+     *
+     * @return true if the index is written
+     */
+    bool is_open() const { return fd >= 0; }
+
+    /**
+     * @brief Count a record in the open block.
+     *
+     * @param[in] end position in the log after the record.
+     * @param[in] level log_type of the record.
+     * @param[in] time time of the timestamp of the record, nanoseconds since the epoch.
+     * @param[in] utc_offset UTC offset of the timestamp, seconds.
+     * @param[in] dated true if the timestamp shows the date.
+     * @param[in] other_lines true if the record has more than one line.
+     */
+    void add_record(const uint64_t end, const int level, const int64_t time, const long utc_offset,
+                    const bool dated, const bool other_lines);
+
+    /**
+     * @brief Append the closed blocks after the log is written up to log_size.
+     *
+     * @param[in] log_size size of the log.
+     */
+    void written(const uint64_t log_size);
+
+    /**
+     * @brief Drop the closed and the open blocks after a failed write of the log.
+     *
+     * @param[in] log_size size of the log, the next block starts there.
+     */
+    void discard(const uint64_t log_size);
+
+    /**
+     * @brief Append the open block too, when the whole log is written (logger stop).
+     *
+     * @param[in] log_size size of the log.
+     */
+    void finish(const uint64_t log_size);
+
+    /**
+     * @brief Write the appended entries to the disk (fdatasync).
+     *
+     * @return false if the sync has failed
+     */
+    bool sync();
+
+    /**
+     * @brief Start the index of an empty log again (rotation).
+     */
+    void reset();
+};
+#endif
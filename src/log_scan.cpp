@@ -0,0 +1,794 @@
+#include "log_scan.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LOG_SCAN_AVX2
+#endif
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+mapped_file::~mapped_file() { close(); }
+
+bool mapped_file::open(const std::string& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    if (ok && info.st_size > 0) {
+        void* result = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (result == MAP_FAILED) {
+            ok = false;
+        } else {
+            map = static_cast<char*>(result);
+            length = static_cast<size_t>(info.st_size);
+            madvise(map, length, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+void mapped_file::close() {
+    if (map != nullptr) {
+        munmap(map, length);
+    }
+    map = nullptr;
+    length = 0;
+}
+
+/**
+ * @brief Find a byte with memchr.
+ *
+ * @param[in] begin first byte.
+ * @param[in] end byte after the last one.
+ * @param[in] value byte to find.
+ *
+ * @return position of the first value, end if there is none
+ */
+static const char* _find_byte(const char* begin, const char* end, const char value) {
+    if (begin >= end) return end;
+    const void* found = std::memchr(begin, value, static_cast<size_t>(end - begin));
+    return found == nullptr ? end : static_cast<const char*>(found);
+}
+
+/**
+ * @brief Find a substring byte by byte.
+ *
+ * @param[in] begin first byte.
+ * @param[in] end byte after the last one.
+ * @param[in] needle substring, at least 2 bytes.
+ *
+ * @return position of the first occurrence, end if there is none
+ */
+static const char* _find_text(const char* begin, const char* end, std::string_view needle) {
+    for (; end - begin >= static_cast<ptrdiff_t>(needle.size()); ++begin) {
+        begin = _find_byte(begin, end - needle.size() + 1, needle[0]);
+        if (begin == end - needle.size() + 1) break;
+        if (std::memcmp(begin + 1, needle.data() + 1, needle.size() - 1) == 0) return begin;
+    }
+    return end;
+}
+
+// First letters of the selected level names (DEBUG, INFO, WARN, ERROR, CRITICAL)
+struct level_letters {
+    char value[5];
+    size_t count = 0;
+};
+
+// Offsets of the first letter of the level name after a newline: "[", "{"level":"", "level="
+constexpr size_t tag_offsets[3] = {2, 11, 7};
+
+/**
+ * @brief First letters of the names of some levels.
+ *
+ * @param[in] levels bit 1 << log_type of every level.
+ *
+ * @return letters
+ */
+static level_letters _level_letters(const unsigned levels) {
+    level_letters letters;
+    for (int level = debug_log_type; level <= critical_log_type; ++level) {
+        if ((levels & (1U << level)) != 0) {
+            letters.value[letters.count++] = log_type_texts[level].name[0];
+        }
+    }
+    return letters;
+}
+
+/**
+ * @brief Find a line that may start with a tag of a selected level byte by byte.
+ *
+ * @param[in] begin first byte.
+ * @param[in] end byte after the last one.
+ * @param[in] letters first letters of the selected level names.
+ *
+ * @return newline before the line, end if there is none
+ */
+static const char* _find_tag(const char* begin, const char* end, const level_letters& letters) {
+    for (; begin < end; ++begin) {
+        begin = _find_byte(begin, end, '\n');
+        if (begin == end) break;
+        for (const size_t offset : tag_offsets) {
+            if (end - begin > static_cast<ptrdiff_t>(offset) &&
+                std::memchr(letters.value, begin[offset], letters.count) != nullptr) {
+                return begin;
+            }
+        }
+    }
+    return end;
+}
+
+#ifdef LOG_SCAN_AVX2
+/**
+ * @brief Check the processor for AVX2 once.
+ *
+ * @return true if the AVX2 functions can be used
+ */
+static bool _has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+/**
+ * @brief scan_byte 32 bytes at a time.
+ */
+__attribute__((target("avx2"))) static const char* _scan_byte_avx2(const char* begin, const char* end,
+                                                                    const char value) {
+    const __m256i pattern = _mm256_set1_epi8(value);
+    for (; end - begin >= 32; begin += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, pattern)));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return _find_byte(begin, end, value);
+}
+
+/**
+ * @brief scan_text 32 candidate positions at a time.
+ *
+ * The first byte of needle is compared at 32 positions and the last byte at the
+ * same positions shifted by the needle length, the rest is compared only where
+ * both match.
+ */
+__attribute__((target("avx2"))) static const char* _scan_text_avx2(const char* begin, const char* end,
+                                                                    std::string_view needle) {
+    const size_t last = needle.size() - 1;
+    const __m256i first_byte = _mm256_set1_epi8(needle[0]);
+    const __m256i last_byte = _mm256_set1_epi8(needle[last]);
+    for (; end - begin >= static_cast<ptrdiff_t>(last + 32); begin += 32) {
+        const __m256i first_chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        const __m256i last_chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + last));
+        const __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(first_chunk, first_byte),
+                                              _mm256_cmpeq_epi8(last_chunk, last_byte));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(both));
+        while (mask != 0) {
+            const char* candidate = begin + __builtin_ctz(mask);
+            if (std::memcmp(candidate + 1, needle.data() + 1, last - 1) == 0) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return _find_text(begin, end, needle);
+}
+
+/**
+ * @brief _scan_tag 32 bytes at a time.
+ *
+ * The newlines are found in 32 bytes, the bytes at the level name offsets of
+ * the three layouts are compared with the selected letters at the same positions.
+ */
+__attribute__((target("avx2"))) static const char* _scan_tag_avx2(const char* begin, const char* end,
+                                                                   const level_letters& letters) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i patterns[5];
+    for (size_t i = 0; i < letters.count; ++i) {
+        patterns[i] = _mm256_set1_epi8(letters.value[i]);
+    }
+    for (; end - begin >= static_cast<ptrdiff_t>(tag_offsets[1] + 32); begin += 32) {
+        const __m256i lines =
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)), newline);
+        if (_mm256_movemask_epi8(lines) == 0) continue;
+        __m256i tags = _mm256_setzero_si256();
+        for (const size_t offset : tag_offsets) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + offset));
+            for (size_t i = 0; i < letters.count; ++i) {
+                tags = _mm256_or_si256(tags, _mm256_cmpeq_epi8(chunk, patterns[i]));
+            }
+        }
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(lines, tags)));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return _find_tag(begin, end, letters);
+}
+#endif
+
+#ifdef __SSE2__
+/**
+ * @brief scan_byte 16 bytes at a time.
+ */
+static const char* _scan_byte_sse2(const char* begin, const char* end, const char value) {
+    const __m128i pattern = _mm_set1_epi8(value);
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern)));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return _find_byte(begin, end, value);
+}
+
+/**
+ * @brief scan_text 16 candidate positions at a time, as _scan_text_avx2.
+ */
+static const char* _scan_text_sse2(const char* begin, const char* end, std::string_view needle) {
+    const size_t last = needle.size() - 1;
+    const __m128i first_byte = _mm_set1_epi8(needle[0]);
+    const __m128i last_byte = _mm_set1_epi8(needle[last]);
+    for (; end - begin >= static_cast<ptrdiff_t>(last + 16); begin += 16) {
+        const __m128i first_chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const __m128i last_chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + last));
+        const __m128i both =
+            _mm_and_si128(_mm_cmpeq_epi8(first_chunk, first_byte), _mm_cmpeq_epi8(last_chunk, last_byte));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(both));
+        while (mask != 0) {
+            const char* candidate = begin + __builtin_ctz(mask);
+            if (std::memcmp(candidate + 1, needle.data() + 1, last - 1) == 0) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return _find_text(begin, end, needle);
+}
+
+/**
+ * @brief _scan_tag 16 bytes at a time, as _scan_tag_avx2.
+ */
+static const char* _scan_tag_sse2(const char* begin, const char* end, const level_letters& letters) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    __m128i patterns[5];
+    for (size_t i = 0; i < letters.count; ++i) {
+        patterns[i] = _mm_set1_epi8(letters.value[i]);
+    }
+    for (; end - begin >= static_cast<ptrdiff_t>(tag_offsets[1] + 16); begin += 16) {
+        const __m128i lines =
+            _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)), newline);
+        if (_mm_movemask_epi8(lines) == 0) continue;
+        __m128i tags = _mm_setzero_si128();
+        for (const size_t offset : tag_offsets) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + offset));
+            for (size_t i = 0; i < letters.count; ++i) {
+                tags = _mm_or_si128(tags, _mm_cmpeq_epi8(chunk, patterns[i]));
+            }
+        }
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(lines, tags)));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return _find_tag(begin, end, letters);
+}
+#endif
+
+/**
+ * @brief Find a line that may start with a tag of a selected level.
+ *
+ * Only the first letter of the level name is compared, at its offset in every
+ * layout, so the line must still be checked with log_line_level.
+ *
+ * @param[in] begin first byte.
+ * @param[in] end byte after the last one.
+ * @param[in] letters first letters of the selected level names.
+ *
+ * @return newline before the line, end if there is none
+ */
+static const char* _scan_tag(const char* begin, const char* end, const level_letters& letters) {
+#ifdef LOG_SCAN_AVX2
+    if (_has_avx2()) return _scan_tag_avx2(begin, end, letters);
+#endif
+#ifdef __SSE2__
+    return _scan_tag_sse2(begin, end, letters);
+#else
+    return _find_tag(begin, end, letters);
+#endif
+}
+
+const char* scan_byte(const char* begin, const char* end, const char value) {
+#ifdef LOG_SCAN_AVX2
+    if (_has_avx2()) return _scan_byte_avx2(begin, end, value);
+#endif
+#ifdef __SSE2__
+    return _scan_byte_sse2(begin, end, value);
+#else
+    return _find_byte(begin, end, value);
+#endif
+}
+
+const char* scan_text(const char* begin, const char* end, std::string_view needle) {
+    if (needle.size() == 1) return scan_byte(begin, end, needle[0]);
+#ifdef LOG_SCAN_AVX2
+    if (_has_avx2()) return _scan_text_avx2(begin, end, needle);
+#endif
+#ifdef __SSE2__
+    return _scan_text_sse2(begin, end, needle);
+#else
+    return _find_text(begin, end, needle);
+#endif
+}
+
+/**
+ * @brief Text between a prefix and a closing byte.
+ *
+ * @param[in] line record line.
+ * @param[in] prefix text the line must start with.
+ * @param[in] close byte after the value, the end of the line also closes it.
+ *
+ * @return the value, empty if the line does not start with prefix
+ */
+static std::string_view _prefixed_value(std::string_view line, std::string_view prefix, const char close) {
+    if (line.substr(0, prefix.size()) != prefix) return {};
+    line.remove_prefix(prefix.size());
+    return line.substr(0, line.find(close));
+}
+
+log_type log_line_level(std::string_view line) {
+    std::string_view name;
+    if (!line.empty() && line[0] == '[') {
+        name = _prefixed_value(line, "[", ']');
+    } else if (!line.empty() && line[0] == '{') {
+        name = _prefixed_value(line, "{\"level\":\"", '"');
+    } else {
+        name = _prefixed_value(line, "level=", ' ');
+    }
+    return log_type_from_name(name);
+}
+
+std::string_view log_line_time(std::string_view line) {
+    if (!line.empty() && line[0] == '{') {
+        const size_t pos = line.rfind(",\"time\":\"");
+        if (pos == std::string_view::npos) return {};
+        return _prefixed_value(line.substr(pos), ",\"time\":\"", '"');
+    }
+    if (line.substr(0, 6) == "level=") {
+        const size_t pos = line.rfind(" time=");
+        if (pos == std::string_view::npos) return {};
+        std::string_view value = _prefixed_value(line.substr(pos), " time=", ' ');
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+        return value;
+    }
+    const size_t pos = line.rfind(' ');
+    return pos == std::string_view::npos ? std::string_view() : line.substr(pos + 1);
+}
+
+/**
+ * @brief Check that a timestamp or a bound starts with a date (iso8601_layout).
+ *
+ * @param[in] time timestamp text.
+ *
+ * @return true for YYYY-MM-DD...
+ */
+static bool _has_date(std::string_view time) { return time.size() >= 10 && time[4] == '-' && time[7] == '-'; }
+
+/**
+ * @brief Check that the text of a line in the place of the time is a timestamp.
+ *
+ * @param[in] time timestamp text.
+ *
+ * @return true for HH:MM... and YYYY-MM-DD...
+ */
+static bool _has_time(std::string_view time) {
+    return time.size() >= 5 && std::isdigit(static_cast<unsigned char>(time[0])) &&
+           std::isdigit(static_cast<unsigned char>(time[1])) && (time[2] == ':' || _has_date(time));
+}
+
+/**
+ * @brief Make a timestamp and a bound comparable as text.
+ *
+ * Both keep their dates if both have one, otherwise only their times of day
+ * (the text after the date) are compared.
+ *
+ * @param[in,out] time timestamp text.
+ * @param[in,out] bound from or to of a filter.
+ */
+static void _comparable(std::string_view& time, std::string_view& bound) {
+    if (_has_date(time) == _has_date(bound)) return;
+    time = _has_date(time) ? time.substr(std::min<size_t>(time.size(), 11)) : time;
+    bound = _has_date(bound) ? bound.substr(std::min<size_t>(bound.size(), 11)) : bound;
+}
+
+bool scan_filter::wraps() const {
+    return !from.empty() && !to.empty() && !_has_date(from) && !_has_date(to) &&
+           std::string_view(from).substr(0, to.size()) > to;
+}
+
+bool scan_filter::in_time(std::string_view earliest, std::string_view latest) const {
+    if (earliest.empty() || latest.empty()) return false;
+    std::string_view low = from;
+    std::string_view high = to;
+    // a range of times of day with dates is not a range if it spans days
+    const bool other_day = _has_date(earliest) && earliest.substr(0, 10) != latest.substr(0, 10);
+    if (other_day && ((!low.empty() && !_has_date(low)) || (!high.empty() && !_has_date(high)))) return true;
+    _comparable(latest, low);
+    _comparable(earliest, high);
+    const bool after = low.empty() || latest >= low;
+    const bool before = high.empty() || earliest.substr(0, high.size()) <= high;
+    return wraps() ? after || before : after && before;
+}
+
+bool scan_filter::matches(std::string_view line) const {
+    if (levels != scan_all_levels) {
+        const log_type level = log_line_level(line);
+        if (level == _unknown_log_type || (levels & (1U << level)) == 0) return false;
+    }
+    if (!from.empty() || !to.empty()) {
+        const std::string_view time = log_line_time(line);
+        if (!_has_time(time) || !in_time(time, time)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Check a line and keep it if it is selected.
+ *
+ * @param[in] begin first byte of the line.
+ * @param[in] end newline or the end of the part.
+ * @param[in] filter conditions.
+ * @param[out] out selected lines, nullptr - only count.
+ * @param[out] stats result.
+ */
+static void _select_line(const char* begin, const char* end, const scan_filter& filter, std::string* out,
+                         scan_stats& stats) {
+    if (!filter.matches(std::string_view(begin, end - begin))) return;
+    ++stats.matched;
+    if (out != nullptr) {
+        out->append(begin, end - begin);
+        *out += '\n';
+    }
+}
+
+scan_stats scan_chunk(const char* begin, const char* end, const scan_filter& filter, std::string* out) {
+    scan_stats stats;
+    stats.bytes = static_cast<uint64_t>(end - begin);
+    if (filter.substring.empty() && filter.levels != scan_all_levels) {
+        // only the lines whose tag may name a selected level are checked
+        const level_letters letters = _level_letters(filter.levels);
+        const char* line = begin;
+        while (line < end) {
+            const char* newline = scan_byte(line, end, '\n');
+            _select_line(line, newline, filter, out, stats);
+            if (newline == end) break;
+            newline = _scan_tag(newline, end, letters);
+            line = newline == end ? end : newline + 1;
+        }
+        return stats;
+    }
+    const char* pos = begin;
+    while (pos < end) {
+        const char* line = pos;
+        if (!filter.substring.empty()) {
+            // only the lines with the substring are checked, pos is always the start of a line
+            const char* found = scan_text(pos, end, filter.substring);
+            if (found == end) break;
+            const void* previous = memrchr(pos, '\n', static_cast<size_t>(found - pos));
+            line = previous == nullptr ? pos : static_cast<const char*>(previous) + 1;
+            pos = found;
+        }
+        const char* newline = scan_byte(pos, end, '\n');
+        _select_line(line, newline, filter, out, stats);
+        pos = newline == end ? end : newline + 1;
+    }
+    return stats;
+}
+
+scan_stats scan_log(const char* data, const size_t size, const scan_filter& filter, size_t threads,
+                    std::ostream* out) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    scan_stats total;
+    std::vector<std::string> outputs(threads);
+    std::vector<scan_stats> results(threads);
+    std::vector<std::thread> workers;
+    const char* pos = data;
+    const char* end = data + size;
+    while (pos < end) {
+        // up to threads parts, every part ends after a newline or at the end of the log
+        std::vector<const char*> bounds{pos};
+        while (bounds.size() <= threads && pos < end) {
+            if (static_cast<size_t>(end - pos) > scan_chunk_size) {
+                pos = scan_byte(pos + scan_chunk_size, end, '\n');
+                pos = pos == end ? end : pos + 1;
+            } else {
+                pos = end;
+            }
+            bounds.push_back(pos);
+        }
+
+        const size_t parts = bounds.size() - 1;
+        for (size_t i = 1; i < parts; ++i) {
+            workers.emplace_back([&, i] {
+                std::string* part_out = out == nullptr ? nullptr : &outputs[i];
+                results[i] = scan_chunk(bounds[i], bounds[i + 1], filter, part_out);
+            });
+        }
+        results[0] = scan_chunk(bounds[0], bounds[1], filter, out == nullptr ? nullptr : &outputs[0]);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+
+        for (size_t i = 0; i < parts; ++i) {
+            total.matched += results[i].matched;
+            total.bytes += results[i].bytes;
+            if (out != nullptr) {
+                out->write(outputs[i].data(), static_cast<std::streamsize>(outputs[i].size()));
+                outputs[i].clear();
+            }
+        }
+    }
+    return total;
+}
+
+// Nanoseconds in a day
+constexpr int64_t _day_ns = 86400LL * 1000000000LL;
+
+// Time bound of a filter in the units of the index
+struct _index_bound {
+    // the bound is given
+    bool set = false;
+    // the bound has a date: value is the local time since the epoch, otherwise the time of day
+    bool dated = false;
+    // the bound has a time of day
+    bool clock = false;
+    // nanoseconds, the first (from) or the last (to) one the bound selects
+    int64_t value = 0;
+    // time of day of value
+    int64_t day_time = 0;
+};
+
+/**
+ * @brief Days since the epoch of a date (proleptic Gregorian calendar).
+ *
+ * @param[in] year year.
+ * @param[in] month month, 1 - 12.
+ * @param[in] day day of the month.
+ *
+ * @return days since 1970-01-01
+ */
+static int64_t _days_from_civil(int64_t year, const int64_t month, const int64_t day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t year_of_era = year - era * 400;
+    const int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+/**
+ * @brief Time of day of a local time.
+ *
+ * @param[in] time local nanoseconds since the epoch.
+ *
+ * @return nanoseconds since midnight
+ */
+static int64_t _time_of_day(const int64_t time) {
+    const int64_t rest = time % _day_ns;
+    return rest < 0 ? rest + _day_ns : rest;
+}
+
+/**
+ * @brief Read a number of exactly digits digits.
+ *
+ * @param[in,out] text text, the number is removed from it.
+ * @param[in] digits number of digits.
+ * @param[out] value number.
+ *
+ * @return false if text does not start with digits digits
+ */
+static bool _take_number(std::string_view& text, const size_t digits, int64_t& value) {
+    if (text.size() < digits) return false;
+    value = 0;
+    for (size_t i = 0; i < digits; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    text.remove_prefix(digits);
+    return true;
+}
+
+/**
+ * @brief Convert a time bound of a filter for the index.
+ *
+ * The bound is "YYYY-MM-DD", "[YYYY-MM-DDT]HH[:MM[:SS[.fraction]]]", the text
+ * after it (a UTC offset) is not used. A to bound selects the whole unit of its
+ * last number, as its text selects every timestamp it is a prefix of.
+ *
+ * @param[in] text from or to of a filter.
+ * @param[in] upper true for to.
+ * @param[out] bound converted bound.
+ *
+ * @return false if the bound has another layout, then the index cannot check it
+ */
+static bool _index_bound_of(std::string_view text, const bool upper, _index_bound& bound) {
+    bound = _index_bound{};
+    if (text.empty()) return true;
+    bound.set = true;
+    int64_t unit = _day_ns;
+    if (_has_date(text)) {
+        int64_t year = 0;
+        int64_t month = 0;
+        int64_t day = 0;
+        // _has_date has checked the dashes
+        const bool read = _take_number(text, 4, year) &&
+                          (text.remove_prefix(1), _take_number(text, 2, month)) &&
+                          (text.remove_prefix(1), _take_number(text, 2, day));
+        if (!read) return false;
+        bound.dated = true;
+        bound.value = _days_from_civil(year, month, day) * _day_ns;
+        if (text.empty()) {
+            bound.value += upper ? unit - 1 : 0;
+            return true;
+        }
+        text.remove_prefix(1);
+    }
+    bound.clock = true;
+    // hours, minutes and seconds, each after a colon but the first
+    constexpr int64_t units[3] = {3600LL * 1000000000LL, 60LL * 1000000000LL, 1000000000LL};
+    for (size_t i = 0; i < 3; ++i) {
+        if (i > 0 && (text.empty() || text[0] != ':')) break;
+        int64_t number = 0;
+        if (i > 0) text.remove_prefix(1);
+        if (!_take_number(text, 2, number)) return false;
+        bound.value += number * units[i];
+        unit = units[i];
+    }
+    if (unit == units[2] && !text.empty() && text[0] == '.') {
+        text.remove_prefix(1);
+        size_t digits = 0;
+        while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) ++digits;
+        int64_t fraction = 0;
+        if (digits == 0 || digits > 9 || !_take_number(text, digits, fraction)) return false;
+        for (size_t i = digits; i < 9; ++i) fraction *= 10;
+        bound.value += fraction;
+        for (size_t i = 0; i < digits; ++i) unit /= 10;
+    }
+    bound.value += upper ? unit - 1 : 0;
+    bound.day_time = _time_of_day(bound.value);
+    return true;
+}
+
+/**
+ * @brief Local time of the earliest or the latest record of a block of the index.
+ *
+ * @param[in] entry block.
+ * @param[in] latest false - the earliest, true - the latest.
+ *
+ * @return nanoseconds since the epoch moved by the least or the most UTC offset of the block
+ */
+static int64_t _local_time(const index_entry& entry, const bool latest) {
+    return latest ? entry.latest + static_cast<int64_t>(entry.most_offset) * 1000000000LL
+                  : entry.earliest + static_cast<int64_t>(entry.least_offset) * 1000000000LL;
+}
+
+/**
+ * @brief Check the time bounds of a filter against a block of the index.
+ *
+ * The times of the block are moved by its UTC offsets to the local time the
+ * timestamps show. A block that spans midnight may hold any time of day.
+ *
+ * @param[in] entry block.
+ * @param[in] from lower bound.
+ * @param[in] to upper bound.
+ *
+ * @return false if no line of the block can be within the bounds
+ */
+static bool _block_in_time(const index_entry& entry, const _index_bound& from, const _index_bound& to) {
+    if ((entry.levels & index_other_lines) != 0) {
+        // a line of a message with newlines has any text as its time
+        return true;
+    }
+    const int64_t earliest = _local_time(entry, false);
+    const int64_t latest = _local_time(entry, true);
+    const bool other_day = earliest - _time_of_day(earliest) != latest - _time_of_day(latest);
+    // like the text, a timestamp and a bound compare their times of day unless both have dates
+    const bool after = !from.set || (from.dated && entry.dated != 0 ? latest >= from.value
+                                     : !from.clock || other_day || _time_of_day(latest) >= from.day_time);
+    const bool before = !to.set || (to.dated && entry.dated != 0 ? earliest <= to.value
+                                    : !to.clock || other_day || _time_of_day(earliest) <= to.day_time);
+    // from after to without dates: the times of day from from to midnight and from midnight to to
+    const bool wraps = from.set && to.set && !from.dated && !to.dated && from.value > to.value;
+    return wraps ? after || before : after && before;
+}
+
+std::vector<scan_range> index_ranges(const std::vector<index_entry>& entries, const uint64_t log_size,
+                                     const scan_filter& filter) {
+    const size_t count = entries.size();
+    _index_bound from;
+    _index_bound to;
+    // a bound of another layout is checked only on the lines
+    const bool timed = _index_bound_of(filter.from, false, from) && _index_bound_of(filter.to, true, to) &&
+                       (from.set || to.set);
+    // blocks [first, last) may be within the time bounds, times of day are checked block by block
+    size_t first = 0;
+    size_t last = count;
+    if (timed && from.dated && count > 0) {
+        // the running largest time does not decrease even if the clock goes back
+        std::vector<int64_t> reach(count);
+        for (size_t i = 0; i < count; ++i) {
+            const index_entry& entry = entries[i];
+            const bool any = (entry.levels & index_other_lines) != 0 || entry.dated == 0;
+            const int64_t latest = any ? INT64_MAX : _local_time(entry, true);
+            reach[i] = i > 0 && reach[i - 1] > latest ? reach[i - 1] : latest;
+        }
+        first = std::partition_point(reach.begin(), reach.end(),
+                                     [&](const int64_t time) { return time < from.value; }) -
+                reach.begin();
+    }
+    if (timed && to.dated && count > 0) {
+        // the running smallest time from the end does not decrease either
+        std::vector<int64_t> start(count);
+        for (size_t i = count; i-- > 0;) {
+            const index_entry& entry = entries[i];
+            const bool any = (entry.levels & index_other_lines) != 0 || entry.dated == 0;
+            const int64_t earliest = any ? INT64_MIN : _local_time(entry, false);
+            start[i] = i + 1 < count && start[i + 1] < earliest ? start[i + 1] : earliest;
+        }
+        last = std::partition_point(start.begin(), start.end(),
+                                    [&](const int64_t time) { return time <= to.value; }) -
+               start.begin();
+    }
+
+    std::vector<scan_range> result;
+    const auto add = [&](const uint64_t begin, const uint64_t end) {
+        if (begin >= end) return;
+        if (!result.empty() && result.back().end == begin) {
+            result.back().end = end;
+        } else {
+            result.push_back({begin, end});
+        }
+    };
+    uint64_t covered = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const index_entry& entry = entries[i];
+        add(covered, entry.offset);
+        covered = entry.offset + entry.size;
+        if (i < first || i >= last) continue;
+        if (filter.levels != scan_all_levels && (entry.levels & filter.levels) == 0) continue;
+        if (timed && !_block_in_time(entry, from, to)) continue;
+        add(entry.offset, covered);
+    }
+    add(covered, log_size);
+    return result;
+}
+
+scan_stats scan_log_ranges(const char* data, const std::vector<scan_range>& ranges, const scan_filter& filter,
+                           const size_t threads, std::ostream* out) {
+    scan_stats total;
+    for (const scan_range& range : ranges) {
+        const scan_stats part = scan_log(data + range.begin, range.end - range.begin, filter, threads, out);
+        total.matched += part.matched;
+        total.bytes += part.bytes;
+    }
+    return total;
+}
@@ -0,0 +1,270 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef IO_H
+#define IO_H
+#include <iostream>
+#endif
+
+#ifndef LOGGER_H
+#include "logger.h"
+#endif
+
+#ifndef LOG_INDEX_H
+#include "log_index.h"
+#endif
+
+#ifndef LOG_SCAN_H
+#define LOG_SCAN_H
+
+// Bits of all levels in scan_filter::levels
+constexpr unsigned scan_all_levels = 0x1F;
+
+// Size of the part of a file one thread scans at a time
+constexpr size_t scan_chunk_size = 16 * 1024 * 1024;
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The file is mapped with MAP_PRIVATE and read sequentially (MADV_SEQUENTIAL),
+ * the descriptor is closed right after mapping. An empty file has no mapping and size 0.
+ */
+class mapped_file {
+    // mapping, nullptr - closed or empty file
+    char* map = nullptr;
+
+    // size of the file
+    size_t length = 0;
+
+   public:
+    mapped_file() = default;
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    /**
+     * @brief Map a file.
+     *
+     * @param[in] path path to the file.
+     *
+     * @return false if the file cannot be opened or mapped
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Unmap and close the file.
+     */
+    void close();
+
+    /**
+     * @brief Mapped contents.
+     *
+     * @return first byte of the file, nullptr for an empty file
+     */
+    const char* data() const { return map; }
+
+    /**
+     * @brief Size of the mapped file.
+     *
+     * @return number of bytes
+     */
+    size_t size() const { return length; }
+};
+
+/**
+ * @brief Find a byte.
+ *
+ * 32 bytes are compared at once with AVX2 when the processor supports it
+ * (checked once at run time), otherwise 16 with SSE2; without SSE2 memchr is used.
+ *
+ * @param[in] begin first byte.
+ * @param[in] end byte after the last one.
+ * @param[in] value byte to find.
+ *
+ * @return position of the first value, end if there is none
+ */
+const char* scan_byte(const char* begin, const char* end, const char value);
+
+/**
+ * @brief Find a substring.
+ *
+ * The first and the last byte of needle are compared with 32 (AVX2) or 16 (SSE2)
+ * positions at once, only the candidates where both match are compared in full.
+ *
+ * @param[in] begin first byte.
+ * @param[in] end byte after the last one.
+ * @param[in] needle substring, not empty.
+ *
+ * @return position of the first occurrence, end if there is none
+ */
+const char* scan_text(const char* begin, const char* end, std::string_view needle);
+
+/**
+ * @brief Level of a record line.
+ *
+ * Recognizes the text_format "[LEVEL] ", json_format {"level":"LEVEL" and
+ * logfmt_format level=LEVEL prefixes.
+ *
+ * @param[in] line record line without the newline.
+ *
+ * @return log_type, _unknown_log_type for other lines
+ */
+log_type log_line_level(std::string_view line);
+
+/**
+ * @brief Timestamp of a record line.
+ *
+ * The text after the last space (text_format), the "time" member (json_format)
+ * or the time= value (logfmt_format).
+ *
+ * @param[in] line record line without the newline.
+ *
+ * @return timestamp text, empty if the line has none
+ */
+std::string_view log_line_time(std::string_view line);
+
+// Conditions a line must meet to be selected
+struct scan_filter {
+    // bit 1 << log_type of every selected level, lines without a level are selected only with scan_all_levels
+    unsigned levels = scan_all_levels;
+    // the timestamp is not earlier than from, empty - no bound; "12:00:00" or "2024-05-01T12:00"
+    std::string from;
+    // the timestamp does not come after to, to may be a prefix: "12:30" includes 12:30:59, empty - no bound
+    std::string to;
+    // the line contains this text (without newlines), empty - any line
+    std::string substring;
+
+    /**
+     * @brief Check that the time bounds are a range of times of day across midnight.
+     *
+     * Both bounds have no date and from comes after to ("23:00" - "01:00"),
+     * then the times from from to midnight and from midnight to to are selected.
+     *
+     * @return true if the range wraps
+     */
+    bool wraps() const;
+
+    /**
+     * @brief Check that some timestamps may be within the time bounds.
+     *
+     * Timestamps are compared as text with the bounds; if only one of a timestamp
+     * and a bound has a date, their times of day are compared. A range with
+     * dates that spans days may hold any time of day.
+     *
+     * @param[in] earliest smallest timestamp.
+     * @param[in] latest largest timestamp, earliest for one line.
+     *
+     * @return false if no timestamp from earliest to latest is selected or one of them is empty
+     */
+    bool in_time(std::string_view earliest, std::string_view latest) const;
+
+    /**
+     * @brief Check the level and the time of a line (not the substring).
+     *
+     * @param[in] line record line without the newline.
+     *
+     * @return true if the line is selected
+     */
+    bool matches(std::string_view line) const;
+};
+
+// Result of a scan
+struct scan_stats {
+    // selected lines
+    uint64_t matched = 0;
+    // scanned bytes
+    uint64_t bytes = 0;
+};
+
+/**
+ * @brief Select the lines of a part of a log.
+ *
+ * With a substring the part is searched for the substring and only the lines
+ * around the occurrences are checked. With only some levels the newlines are
+ * searched together with the first letter of a selected level name after them
+ * (AVX2/SSE2), only those lines are checked. Otherwise every line is checked.
+ *
+ * @param[in] begin first byte, the start of a line.
+ * @param[in] end byte after the last line.
+ * @param[in] filter conditions.
+ * @param[out] out selected lines with their newlines, nullptr - only count.
+ *
+ * @return selected lines and scanned bytes
+ */
+scan_stats scan_chunk(const char* begin, const char* end, const scan_filter& filter, std::string* out);
+
+/**
+ * @brief Select the lines of a log on several threads.
+ *
+ * The log is split into parts of scan_chunk_size at line boundaries, up to
+ * threads parts are scanned at once and their lines are written to out in the
+ * order of the file.
+ *
+ * @param[in] data log contents.
+ * @param[in] size size of the log.
+ * @param[in] filter conditions.
+ * @param[in] threads number of threads, 0 - one per core.
+ * @param[out] out selected lines, nullptr - only count.
+ *
+ * @return selected lines and scanned bytes
+ */
+scan_stats scan_log(const char* data, const size_t size, const scan_filter& filter, size_t threads,
+                    std::ostream* out);
+
+// Part of a log, [begin, end)
+struct scan_range {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+/**
+ * @brief Parts of a log that may hold selected lines, by its index.
+ *
+ * The bounds are converted to times; with a date, the first block that may
+ * reach filter.from and the last block that may start before filter.to are
+ * found by binary search over the running largest and smallest times of the
+ * blocks. Between them the blocks without a selected level or outside the time
+ * bounds are skipped; a bound of times of day is compared with the local times
+ * of day of a block, a block across midnight may hold any of them. A bound of
+ * another layout is checked only on the lines. The bytes not covered by the
+ * index are always scanned.
+ *
+ * @param[in] entries valid entries of the index (load_log_index).
+ * @param[in] log_size size of the log.
+ * @param[in] filter conditions.
+ *
+ * @return parts in the order of the file, adjacent parts are merged
+ */
+std::vector<scan_range> index_ranges(const std::vector<index_entry>& entries, const uint64_t log_size,
+                                     const scan_filter& filter);
+
+/**
+ * @brief Select the lines of some parts of a log.
+ *
+ * Every part is scanned with scan_log, the lines are written in the order of the file.
+ *
+ * @param[in] data log contents.
+ * @param[in] ranges parts of the log, they start and end at line boundaries.
+ * @param[in] filter conditions.
+ * @param[in] threads number of threads, 0 - one per core.
+ * @param[out] out selected lines, nullptr - only count.
+ *
+ * @return selected lines and scanned bytes
+ */
+scan_stats scan_log_ranges(const char* data, const std::vector<scan_range>& ranges, const scan_filter& filter,
+                           const size_t threads, std::ostream* out);
+#endif
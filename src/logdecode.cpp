@@ -0,0 +1,109 @@
+#include "logdecode.h"
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+bool read_whole_file(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    bool result = in.is_open();
+    if (result) {
+        out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        result = !in.bad();
+    }
+    return result;
+}
+
+long long decode_binary_log(const std::string& data, std::ostream& out) {
+    binary_decoder decoder;
+    timestamp_engine stamp;
+    binary_record record;
+    std::string text;
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* end = pos + data.size();
+    long long count = 0;
+
+    binary_status status = decoder.next(pos, end, record);
+    while (status == binary_ok) {
+        binary_record_to_text(record, stamp, text);
+        ++count;
+        if (text.size() >= 64 * 1024) {
+            out.write(text.data(), text.size());
+            text.clear();
+        }
+        status = decoder.next(pos, end, record);
+    }
+    out.write(text.data(), text.size());
+    return status == binary_corrupt ? -1 : count;
+}
+
+/**
+ * @brief Binary log decoder.
+ *
+ * Converts a file written with binary_format back to the text layout
+ * "[LEVEL] message HH:MM:SS". Compressed rotated files (<log>.<number>.lz)
+ * are decompressed first, the records of a mmap_ring_backend file are put
+ * in order, text logs are printed as they are.
+ *
+ * Try it: in build/bin directory run this command(bash):
+ * ./logdecode app.log app_text.log
+ *
+ * @param[in] argc count of console arguments.
+ * @param[in] argv argv[1] - binary, compressed or ring log file,
+ * argv[2] - text output file (optional, default - console).
+ *
+ * @return 0 on success, -1 if the file cannot be read or written or is corrupt
+ */
+int main(const int argc, const char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Too few arguments";
+        return -1;
+    }
+
+    std::string data;
+    if (!read_whole_file(argv[1], data)) {
+        std::cout << "Input file not valid" << std::endl;
+        return -1;
+    }
+    if (lz_is_compressed(data)) {
+        std::string plain;
+        if (!lz_decompress(data, plain)) {
+            std::cerr << "\033[31mCompressed log is corrupt\033[0m" << std::endl;
+            return -1;
+        }
+        data.swap(plain);
+    }
+    if (mmap_ring_is_ring(data)) {
+        std::string records;
+        if (!mmap_ring_text(data, records)) {
+            std::cerr << "\033[31mRing log header is corrupt\033[0m" << std::endl;
+            return -1;
+        }
+        data.swap(records);
+    }
+    // a binary file without the leading session header is decoded too and reported as corrupt
+    const uint8_t first = data.empty() ? 0 : static_cast<uint8_t>(data[0]);
+    const bool binary =
+        first == binary_session_tag || first == binary_format_tag || first == binary_record_tag;
+
+    std::ofstream file;
+    if (argc > 2) {
+        file.open(argv[2], std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Output file not valid" << std::endl;
+            return -1;
+        }
+    }
+    std::ostream& out = argc > 2 ? static_cast<std::ostream&>(file) : std::cout;
+
+    long long count = 0;
+    if (binary) {
+        count = decode_binary_log(data, out);
+    } else {
+        out.write(data.data(), data.size());
+    }
+
+    if (count < 0) {
+        std::cerr << "\033[31mBinary log is corrupt, decoding stopped\033[0m" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef IO_H
+#define IO_H
+#include <iostream>
+#endif
+
+#ifndef LOGGER_H
+#include "logger.h"
+#endif
+
+#ifndef LOGDECODE_H
+#define LOGDECODE_H
+
+/**
+ * @brief Read a whole file.
+ *
+ * @param[in] path path to the file.
+ * @param[out] out file contents.
+ *
+ * @return false if the file cannot be read
+ */
+bool read_whole_file(const std::string& path, std::string& out);
+
+/**
+ * @brief Convert binary log data to the text layout.
+ *
+ * @param[in] data binary log file contents.
+ * @param[out] out text stream.
+ *
+ * @return number of converted records, -1 if the data is corrupt
+ * (the records before the corrupt place are converted)
+ */
+long long decode_binary_log(const std::string& data, std::ostream& out);
+#endif
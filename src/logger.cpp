@@ -1,61 +1,52 @@
 #include "logger.h"
 
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
 // коментарии в header (.h) файле или наведитесь курсором на функцию
 
-const char* _log_type_to_string(log_type mode) {
-    switch (mode) {
-        case debug_log_type:
-            return "DEBUG";
-        case info_log_type:
-            return "INFO";
-        case warn_log_type:
-            return "WARN";
-        case error_log_type:
-            return "ERROR";
-        case critical_log_type:
-            return "CRITICAL";
-        default:
-            return "UNKNOWN";
-    }
-}
+// the buffer is reserved once, so that steady-state logging does not allocate
+static constexpr size_t min_buffer_capacity = 4096;
 
-/**
- * @brief Getting the current time structure.
- *
- * Getting the current time structure with correct formatting in strings
- *
- * @return struct time_string
- */
-const time_string _get_time() {
-    std::time_t now_time_t = std::time(nullptr);
-    const std::tm* now_tm = std::localtime(&now_time_t);
-    struct time_string time;
-    if (now_tm->tm_hour < 10) {
-        time.hour[0] = '0';
-        time.hour[1] = now_tm->tm_hour + '0';
-    } else {
-        time.hour[0] = now_tm->tm_hour / 10 + '0';
-        time.hour[1] = now_tm->tm_hour % 10 + '0';
-    }
-    if (now_tm->tm_min < 10) {
-        time.min[0] = '0';
-        time.min[1] = now_tm->tm_min + '0';
-    } else {
-        time.min[0] = now_tm->tm_min / 10 + '0';
-        time.min[1] = now_tm->tm_min % 10 + '0';
-    }
-    if (now_tm->tm_sec < 10) {
-        time.sec[0] = '0';
-        time.sec[1] = now_tm->tm_sec + '0';
-    } else {
-        time.sec[0] = now_tm->tm_sec / 10 + '0';
-        time.sec[1] = now_tm->tm_sec % 10 + '0';
+// maximum number of records the writer takes from one staging buffer at a time
+static constexpr size_t staging_batch = 256;
+
+// records the writer takes before it wakes the producers waiting for space
+static constexpr size_t space_batch = 16;
+
+// attempts a producer yields on a full queue before it sleeps
+static constexpr size_t enqueue_spins = 16;
+
+// sleeping time limit of a producer on a full queue
+static constexpr timespec enqueue_wait{0, 1000000};
+
+// source of the async_logger ids
+static std::atomic<uint64_t> async_logger_ids{1};
+
+// Staging buffer of the calling thread for one async_logger
+struct staging_slot {
+    uint64_t owner;
+    std::shared_ptr<staging_buffer> buffer;
+};
+
+// Staging buffers of the calling thread, closed when the thread exits
+struct thread_staging_slots {
+    std::vector<staging_slot> slots;
+
+    ~thread_staging_slots() {
+        for (staging_slot& slot : slots) {
+            slot.buffer->closed.store(true, std::memory_order_release);
+        }
     }
-    time.hour[2] = '\0';
-    time.min[2] = '\0';
-    time.sec[2] = '\0';
-    return time;
-}
+};
+
+static thread_local thread_staging_slots staging_slots;
+
+static_assert(log_type_from_name("CRITICAL") == critical_log_type, "names are resolved at compile time");
+static_assert(log_type_from_name("warn", true) == warn_log_type, "console names are resolved");
+static_assert(log_type_from_name("WARN", true) == _unknown_log_type, "console names are lowercase");
+static_assert(log_type_from_name("WARNING") == _unknown_log_type, "other names are not levels");
 
 /**
  * @brief Validate file path.
@@ -84,35 +75,245 @@ LoggerReturn _check_file(const std::string& path) {
     return result;
 }
 
-logger::logger(const std::string& path_v, const log_type mode_v) : mode(mode_v), path(path_v) {
-    if (mode == _unknown_log_type) {
-        mode = info_log_type;
-    }
+logger::logger(const std::string& path_v, const log_type mode_v)
+    : mode(mode_v == _unknown_log_type ? info_log_type : mode_v),
+      path(path_v),
+      file(make_file_backend(backend)) {
     logger_status = _check_file(path_v);
+    buffer.reserve(min_buffer_capacity);
+    crash_stamp.set_fixed_offset(true);
 }
 
-logger::logger(const std::string& path_v) : path(path_v) { logger_status = _check_file(path_v); }
+logger::logger(const std::string& path_v) : path(path_v), file(make_file_backend(backend)) {
+    logger_status = _check_file(path_v);
+    buffer.reserve(min_buffer_capacity);
+    crash_stamp.set_fixed_offset(true);
+}
 
 log_type logger::set_mode(const log_type mode_v) {
     log_type result = _unknown_log_type;
     if (mode_v != _unknown_log_type) {
-        mode = mode_v;
-        result = mode;
+        mode.store(mode_v, std::memory_order_relaxed);
+        result = mode_v;
     }
     return result;
 }
 
-log_type logger::get_mode() const { return mode; }
+log_type logger::get_mode() const { return mode.load(std::memory_order_relaxed); }
 
 LoggerReturn logger::get_status() const { return logger_status; }
 
+void logger::set_flush_policy(const flush_policy& policy_v) {
+    policy = policy_v;
+    buffer.reserve(policy.buffer_size + min_buffer_capacity);
+}
+
+flush_policy logger::get_flush_policy() const { return policy; }
+
+void logger::set_timestamp_format(const timestamp_format& format_v) {
+    stamp.set_format(format_v);
+    crash_stamp.set_format(format_v);
+}
+
+timestamp_format logger::get_timestamp_format() const { return stamp.get_format(); }
+
+void logger::set_record_format(const record_format format_v) {
+    output_format = format_v;
+    binary.reset();
+}
+
+record_format logger::get_record_format() const { return output_format; }
+
+void logger::set_rotation_policy(const rotation_policy& rotation_v) {
+    rotation = rotation_v;
+    rotator.reset();
+    if (rotation.max_size > 0 || rotation.interval.count() > 0) {
+        rotator.reset(new rotation_worker(path, rotation));
+        rotation_next = rotation_next_number(path);
+        rotation_retry_size = 0;
+        _schedule_rotation(std::chrono::steady_clock::now());
+    }
+}
+
+rotation_policy logger::get_rotation_policy() const { return rotation; }
+
+LoggerReturn logger::set_io_backend(const io_backend_type backend_v, const io_backend_options& options) {
+    LoggerReturn result = FILE_ALREADY_OPEN_LOGGER;
+    if (!file->is_open()) {
+        backend = backend_v;
+        file = make_file_backend(backend, options);
+        result = OK_LOGGER;
+    }
+    return result;
+}
+
+io_backend_type logger::get_io_backend() const { return backend; }
+
+LoggerReturn logger::set_index(const size_t block_size) {
+    LoggerReturn result = FILE_ALREADY_OPEN_LOGGER;
+    if (!file->is_open()) {
+        index_block = block_size;
+        result = OK_LOGGER;
+    }
+    return result;
+}
+
+logger_stats logger::get_stats() const { return metrics.snapshot(); }
+
+void logger::set_stats_dump(const std::string& path_v, const std::chrono::milliseconds interval) {
+    dumper.reset();
+    if (interval.count() > 0) {
+        const auto render = [this] { return stats_to_text(metrics.snapshot()); };
+        dumper.reset(new stats_dumper(path_v, interval, render));
+    }
+}
+
+void logger::set_rate_limit(const rate_limit_policy& policy) { limits.set_policy(policy); }
+
+void logger::add_sink(std::shared_ptr<log_sink> sink, const log_type level) {
+    if (sink) {
+        sink_level = sinks.empty() || level < sink_level ? level : sink_level;
+        sinks.push_back({std::move(sink), level});
+    }
+}
+
+void logger::clear_sinks() {
+    _flush_sinks();
+    sinks.clear();
+}
+
+void logger::_write_sinks(std::string_view record) {
+    for (const sink_entry& entry : sinks) {
+        if (record_mode >= entry.level) {
+            entry.sink->write(record);
+        }
+    }
+}
+
+void logger::_flush_sinks() {
+    for (const sink_entry& entry : sinks) {
+        entry.sink->flush();
+    }
+}
+
+void logger::_schedule_rotation(const std::chrono::steady_clock::time_point now) {
+    if (rotation.interval.count() > 0) {
+        const auto wall = std::chrono::system_clock::now().time_since_epoch();
+        const auto boundary = (wall / rotation.interval + 1) * rotation.interval;
+        next_rotation = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                  boundary - wall);
+    }
+}
+
+void logger::_rotate(const std::chrono::steady_clock::time_point now) {
+    if (file_size + buffer.size() == 0) {
+        // an empty file is not rotated, only the next interval is scheduled
+        _schedule_rotation(now);
+        return;
+    }
+    _write_buffer(now);
+    file->close();
+
+    const std::filesystem::path rotated = path.string() + '.' + std::to_string(rotation_next);
+    std::error_code error;
+    std::filesystem::rename(path, rotated, error);
+
+    const bool opened = file->open(path);
+    if (!error) {
+        ++rotation_next;
+        file_size = 0;
+        rotation_retry_size = 0;
+        binary.reset();
+        rotator->submit(rotated);
+    } else {
+        // the same file is continued with its size and index, the next try is after max_size more bytes
+        rotation_retry_size = file_size + rotation.max_size;
+    }
+    if (!opened) {
+        // the logger is closed, put_log reports FILE_CLOSED_LOGGER until run_logger
+        index.finish(file_size);
+        index.close();
+    } else if (!error) {
+        index.reset();
+    }
+    file_available = opened;
+    last_check = now;
+    _schedule_rotation(now);
+}
+
+bool logger::_check_available(const std::chrono::steady_clock::time_point now) {
+    if (now - last_check >= policy.check_interval) {
+        last_check = now;
+        file_available = std::filesystem::exists(path);
+    }
+    return file_available;
+}
+
+LoggerReturn logger::_write_buffer(const std::chrono::steady_clock::time_point now) {
+    LoggerReturn result = LOG_SAVED_LOGGER;
+    last_flush = now;
+    if (!buffer.empty()) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool written = file->write(buffer.data(), buffer.size());
+        metrics.time_io(metrics.write_latency, std::chrono::steady_clock::now() - start);
+        if (!written) {
+            result = LOG_FAILED_LOGGER;
+            write_failed = true;
+            // the lost buffer may hold the session header and format definitions
+            binary.reset();
+        } else {
+            file_size += buffer.size();
+            logger_metrics::bump(metrics.bytes, buffer.size());
+        }
+        if (index.is_open()) {
+            if (written) {
+                index.written(file_size);
+            } else {
+                index.discard(file_size);
+            }
+        }
+        for (size_t level = 0; level < stat_levels; ++level) {
+            if (pending[level] > 0) {
+                std::atomic<uint64_t>& counter = written ? metrics.written[level] : metrics.failed[level];
+                logger_metrics::bump(counter, pending[level]);
+                pending[level] = 0;
+            }
+        }
+        buffer.clear();
+    }
+    return result;
+}
+
+std::chrono::nanoseconds logger::_flush_delay() const {
+    std::chrono::nanoseconds result{0};
+    if (policy.interval.count() > 0 && !buffer.empty() && file->is_open()) {
+        const auto due = last_flush + policy.interval;
+        const auto now = std::chrono::steady_clock::now();
+        if (due > now) {
+            result = due - now;
+        }
+    }
+    return result;
+}
+
 LoggerReturn logger::run_logger() {
     LoggerReturn result = FILE_ALREADY_OPEN_LOGGER;
-    if (!file.is_open()) {
-        file.open(path, std::ios::app);
-        if (!file.is_open()) {
+    if (!file->is_open()) {
+        if (!file->open(path)) {
             result = FILE_CANNOT_OPEN_FOR_WRITING_LOGGER;
         } else {
+            last_flush = last_check = std::chrono::steady_clock::now();
+            file_available = true;
+            binary.reset();
+            std::error_code error;
+            file_size = std::filesystem::file_size(path, error);
+            if (error) {
+                file_size = 0;
+            }
+            if (index_block > 0 && backend != mmap_ring_backend) {
+                index.open(path.string(), file_size, index_block);
+            }
+            _schedule_rotation(last_check);
             result = FILE_OPENED_LOGGER;
         }
     }
@@ -121,57 +322,1062 @@ LoggerReturn logger::run_logger() {
 
 LoggerReturn logger::stop_logger() {
     LoggerReturn result = FILE_ALREADY_CLOSED_LOGGER;
-    if (file.is_open()) {
-        file.close();
+    if (file->is_open()) {
+        _report_sites();
+        _write_buffer(std::chrono::steady_clock::now());
+        index.finish(file_size);
+        index.close();
+        file->close();
+        _flush_sinks();
         result = FILE_CLOSED_LOGGER;
     }
     return result;
 }
 
-LoggerReturn logger::put_log(const std::string& message, const log_type mode_v) {
+void logger::begin_batch() { batching = true; }
+
+LoggerReturn logger::end_batch() {
+    batching = false;
+    LoggerReturn result = FILE_CLOSED_LOGGER;
+    if (file->is_open()) {
+        const auto now = std::chrono::steady_clock::now();
+        result = _check_available(now) ? _write_buffer(now) : LOG_FAILED_LOGGER;
+    }
+    return result;
+}
+
+LoggerReturn logger::flush() {
+    LoggerReturn result = FILE_CLOSED_LOGGER;
+    if (file->is_open()) {
+        const auto now = std::chrono::steady_clock::now();
+        result = _check_available(now) ? _write_buffer(now) : LOG_FAILED_LOGGER;
+        const auto start = std::chrono::steady_clock::now();
+        const bool flushed = file->flush();
+        metrics.time_io(metrics.flush_latency, std::chrono::steady_clock::now() - start);
+        if (!flushed) {
+            result = LOG_FAILED_LOGGER;
+            // the next sync reports the error too
+            write_failed = true;
+        }
+        _flush_sinks();
+    }
+    return result;
+}
+
+LoggerReturn logger::sync() {
+    LoggerReturn result = flush();
+    if (result != FILE_CLOSED_LOGGER) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool synced = file->sync();
+        const auto took = std::chrono::steady_clock::now() - start;
+        // a sync is slow by design, it is not counted as a stall
+        metrics.sync_latency.record(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(took).count()));
+        if (!synced || write_failed) {
+            result = LOG_FAILED_LOGGER;
+        }
+        write_failed = false;
+        // the index only speeds up queries, a failed sync of it does not lose records
+        index.sync();
+    }
+    return result;
+}
+
+void logger::crash_flush() {
+    if (file->is_open() && !buffer.empty()) {
+        file->crash_write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void logger::crash_put_log(const log_type mode_v, std::string_view message, const char* fmt,
+                           std::string_view args, char* scratch, const size_t capacity) {
+    // the longest start ({"level":"CRITICAL","msg":") and the end with the time always fit
+    const size_t reserve = 48 + timestamp_engine::max_size;
+    if (!file->is_open() || output_format == binary_format || capacity <= reserve) {
+        return;
+    }
+    const log_type level = mode_v == _unknown_log_type ? get_mode() : mode_v;
+    const log_type_text& texts = log_type_to_text(level);
+    const std::string_view prefix = output_format == json_format     ? texts.json_prefix
+                                    : output_format == logfmt_format ? texts.logfmt_prefix
+                                                                     : texts.text_prefix;
+    std::memcpy(scratch, prefix.data(), prefix.size());
+    size_t size = prefix.size();
+
+    const size_t room = capacity - reserve;
+    if (output_format == text_format) {
+        if (fmt != nullptr) {
+            size += fmt_render(scratch + size, room, fmt, args);
+        } else {
+            const size_t part = message.size() < room ? message.size() : room;
+            std::memcpy(scratch + size, message.data(), part);
+            size += part;
+        }
+    } else {
+        // the message is escaped as in _append_message, a formatted one is rendered at the end first
+        size_t escape_room = room;
+        if (fmt != nullptr) {
+            const size_t half = room / 2;
+            char* rendered = scratch + capacity - half;
+            message = std::string_view(rendered, fmt_render(rendered, half, fmt, args));
+            escape_room -= half;
+        }
+        size += json_escape(scratch + size, escape_room, message);
+    }
+
+    char time[timestamp_engine::max_size];
+    const size_t time_size = crash_stamp.format_now(time);
+    const std::string_view time_text(time, time_size);
+    if (output_format == json_format) {
+        std::memcpy(scratch + size, "\",\"time\":\"", 10);
+        size += 10;
+        size += json_escape(scratch + size, capacity - size, time_text);
+        std::memcpy(scratch + size, "\"}\n", 3);
+        size += 3;
+    } else if (output_format == logfmt_format) {
+        // the time is quoted like logfmt_value does when it has a space
+        const bool quoted = time_text.find_first_of(" =") != std::string_view::npos;
+        std::memcpy(scratch + size, quoted ? "\" time=\"" : "\" time=", quoted ? 8 : 7);
+        size += quoted ? 8 : 7;
+        size += json_escape(scratch + size, capacity - size, time_text);
+        if (quoted) {
+            scratch[size++] = '"';
+        }
+        scratch[size++] = '\n';
+    } else {
+        scratch[size++] = ' ';
+        std::memcpy(scratch + size, time, time_size);
+        size += time_size;
+        scratch[size++] = '\n';
+    }
+    file->crash_write(scratch, size);
+}
+
+LoggerReturn logger::put_log(std::string_view message, const log_type mode_v) {
+    const log_fragment fragment{message.data(), message.size()};
+    return put_log(&fragment, 1, mode_v);
+}
+
+LoggerReturn logger::_begin_record(const log_type mode_v) {
     LoggerReturn result = LOG_SKIPPED_LOGGER;
-    bool error = false;
-    if (!std::filesystem::exists(path)) {
-        file.flush();
-        result = LOG_FAILED_LOGGER;
-        error = true;
-    }
-    if (!error && (mode_v >= mode || mode_v == _unknown_log_type)) {
-        log_type curr_mode = mode;
+    const log_type default_mode = mode.load(std::memory_order_relaxed);
+    if (mode_v >= default_mode || mode_v == _unknown_log_type) {
+        record_mode = default_mode;
         if (mode_v != _unknown_log_type) {
-            curr_mode = mode_v;
+            record_mode = mode_v;
         }
-        if (!file.is_open()) {
-            file.flush();
+        if (_count_entries()) {
+            metrics.count_entry(record_mode, stat_accepted);
+        }
+        record_time = std::chrono::steady_clock::now();
+        if (rotator && file->is_open() &&
+            ((rotation.max_size > 0 &&
+              file_size + buffer.size() >= std::max(rotation.max_size, rotation_retry_size)) ||
+             (rotation.interval.count() > 0 && record_time >= next_rotation))) {
+            _rotate(record_time);
+        }
+        if (!file->is_open()) {
             result = FILE_CLOSED_LOGGER;
-            error = true;
+            logger_metrics::bump(metrics.failed[record_mode]);
+        } else if (!_check_available(record_time)) {
+            result = LOG_FAILED_LOGGER;
+            logger_metrics::bump(metrics.failed[record_mode]);
+        } else {
+            record_start = buffer.size();
+            record_to_sinks = !sinks.empty() && record_mode >= sink_level;
+            if (output_format == binary_format) {
+                sink_text.clear();
+            }
+            const log_type_text& level = log_type_to_text(record_mode);
+            if (output_format == json_format) {
+                buffer += level.json_prefix;
+            } else if (output_format == logfmt_format) {
+                buffer += level.logfmt_prefix;
+            } else if (output_format == text_format || record_to_sinks) {
+                std::string& text = output_format == text_format ? buffer : sink_text;
+                text += level.text_prefix;
+            }
+            result = LOG_BUFFERED_LOGGER;
+        }
+    } else {
+        // a record of an async_logger is counted here too: it passed the async_logger filter
+        // and was counted as accepted, then the level of the logger was raised
+        metrics.count_entry(mode_v, stat_filtered);
+    }
+    return result;
+}
+
+void logger::_begin_binary(const char* fmt, const size_t payload_size) {
+    binary.begin_record(buffer, stamp.now(), static_cast<uint8_t>(record_mode), fmt, payload_size);
+}
+
+void logger::_append_message(std::string_view message) {
+    if (output_format == json_format || output_format == logfmt_format) {
+        json_escape(buffer, message);
+    } else {
+        buffer.append(message.data(), message.size());
+    }
+}
+
+LoggerReturn logger::_end_record(const fmt_args* fields) {
+    LoggerReturn result = LOG_BUFFERED_LOGGER;
+    ++pending[record_mode];
+    if (output_format != binary_format || record_to_sinks) {
+        char time[timestamp_engine::max_size];
+        const int64_t now = stamp.now();
+        const size_t time_size = stamp.format_time(now, time);
+
+        if (output_format == json_format) {
+            buffer += '"';
+            if (fields != nullptr) {
+                fields_to_json(buffer, *fields);
+            }
+            buffer += ",\"time\":\"";
+            json_escape(buffer, std::string_view(time, time_size));
+            buffer += "\"}\n";
+        } else if (output_format == logfmt_format) {
+            buffer += '"';
+            if (fields != nullptr) {
+                fields_to_logfmt(buffer, *fields);
+            }
+            buffer += " time=";
+            logfmt_value(buffer, std::string_view(time, time_size));
+            buffer += '\n';
+        } else {
+            std::string& text = output_format == text_format ? buffer : sink_text;
+            if (fields != nullptr) {
+                fields_to_logfmt(text, *fields);
+            }
+            text += ' ';
+            text.append(time, time_size);
+            text += '\n';
+        }
+        if (index.is_open() && output_format != binary_format) {
+            // the json and logfmt layouts escape the newlines of the message
+            const std::string_view record = std::string_view(buffer).substr(record_start);
+            const bool other_lines = output_format == text_format && record.find('\n') + 1 < record.size();
+            const bool dated = stamp.get_format().layout == iso8601_layout;
+            index.add_record(file_size + buffer.size(), record_mode, stamp.shown_time(now),
+                             stamp.get_utc_offset(), dated, other_lines);
+        }
+    }
+    if (record_to_sinks) {
+        // the record is formatted once, every sink gets the same text
+        _write_sinks(output_format != binary_format ? std::string_view(buffer).substr(record_start)
+                                                    : std::string_view(sink_text));
+    }
+
+    if (batching) {
+        if (policy.buffer_size > 0 && buffer.size() >= policy.buffer_size) {
+            result = _write_buffer(record_time);
+        }
+    } else if (buffer.size() >= policy.buffer_size || record_mode >= policy.flush_level ||
+               (policy.interval.count() > 0 && record_time - last_flush >= policy.interval)) {
+        result = _write_buffer(record_time);
+    }
+    return result;
+}
+
+LoggerReturn logger::put_log(const log_fragment* fragments, const size_t count, const log_type mode_v) {
+    LoggerReturn result = _begin_record(mode_v);
+    if (result == LOG_BUFFERED_LOGGER) {
+        if (output_format == binary_format) {
+            size_t size = 0;
+            for (size_t i = 0; i < count; ++i) {
+                size += fragments[i].size;
+            }
+            _begin_binary(nullptr, size);
         }
-        file << "[";
-        if (file.fail() || !file.good()) {
-            if (!error) {
-                file.flush();
-                result = LOG_FAILED_LOGGER;
+        for (size_t i = 0; i < count; ++i) {
+            _append_message(std::string_view(fragments[i].data, fragments[i].size));
+            if (output_format == binary_format && record_to_sinks) {
+                sink_text.append(fragments[i].data, fragments[i].size);
+            }
+        }
+        result = _end_record();
+    }
+    return result;
+}
+
+LoggerReturn logger::put_log_format(const char* fmt, const fmt_args& args, const log_type mode_v) {
+    LoggerReturn result = _begin_record(mode_v);
+    if (result == LOG_BUFFERED_LOGGER) {
+        if (output_format == binary_format) {
+            _begin_binary(fmt, args.size());
+            buffer.append(reinterpret_cast<const char*>(args.data()), args.size());
+            if (record_to_sinks) {
+                fmt_render(sink_text, fmt, args);
             }
+        } else if (output_format == text_format) {
+            fmt_render(buffer, fmt, args);
         } else {
-            struct time_string time = _get_time();
+            // the rendered message is escaped as a whole
+            message_text.clear();
+            fmt_render(message_text, fmt, args);
+            _append_message(message_text);
+        }
+        result = _end_record();
+    }
+    return result;
+}
 
-            file << _log_type_to_string(curr_mode) << "] " << message << " " << time.hour << ":" << time.min
-                 << ":" << time.sec << std::endl;
-            if (file.fail() || !file.good()) {
-                file.flush();
-                result = LOG_FAILED_LOGGER;
-            } else {
-                result = LOG_SAVED_LOGGER;
+LoggerReturn logger::put_log(std::string_view message, const log_fields& fields, const log_type mode_v) {
+    return _put_fields(message, fields.data(), mode_v);
+}
+
+LoggerReturn logger::_put_fields(std::string_view message, const fmt_args& fields, const log_type mode_v) {
+    LoggerReturn result = _begin_record(mode_v);
+    if (result == LOG_BUFFERED_LOGGER) {
+        if (output_format == binary_format) {
+            // a binary record has no fields, they are kept as text after the message
+            message_text.assign(message.data(), message.size());
+            fields_to_logfmt(message_text, fields);
+            _begin_binary(nullptr, message_text.size());
+            buffer += message_text;
+            if (record_to_sinks) {
+                sink_text += message_text;
             }
-            file.flush();
+            result = _end_record();
+        } else {
+            _append_message(message);
+            result = _end_record(&fields);
         }
     }
+    return result;
+}
+
+LoggerReturn logger::_site_reports(const site_decision& decision, const log_type mode_v) {
+    if (decision.repeated > 0) {
+        put_log(site_repeated_text(decision.repeated), mode_v);
+    }
+    if (decision.suppressed > 0) {
+        put_log(site_suppressed_text(decision.suppressed), mode_v);
+    }
+    if (!decision.pass && _count_entries()) {
+        metrics.count_entry(mode_v, decision.reason);
+    }
+    return decision.pass ? LOG_BUFFERED_LOGGER : LOG_SUPPRESSED_LOGGER;
+}
 
+void logger::_report_sites() {
+    limits.take_pending([this](const int level, const site_decision& pending) {
+        _site_reports(pending, static_cast<log_type>(level));
+    });
+}
+
+LoggerReturn logger::put_limited(log_site& site, std::string_view message, const log_type mode_v) {
+    LoggerReturn result = LOG_SKIPPED_LOGGER;
+    if (should_log(mode_v)) {
+        const site_decision decision = limits.admit(site, mode_v, message);
+        result = _site_reports(decision, mode_v);
+        if (decision.pass) {
+            result = put_log(message, mode_v);
+        }
+    } else if (_count_entries()) {
+        metrics.count_entry(mode_v, stat_filtered);
+    }
     return result;
 }
 
 logger::~logger() {
-    if (file.is_open()) {
-        file.close();
+    remove_crash_handler(*this);
+    if (file->is_open()) {
+        _report_sites();
+        _write_buffer(std::chrono::steady_clock::now());
+        file->close();
     }
-}
\ No newline at end of file
+    _flush_sinks();
+    // the rotation_worker finishes the queued files when it is destroyed
+    rotator.reset();
+    // the last dump holds every record
+    dumper.reset();
+}
+
+async_logger::async_logger(logger& log_v, const size_t capacity, const backpressure_policy policy_v,
+                           const log_type drop_level_v, async_status_handler handler_v,
+                           const async_queue_mode queue_mode_v)
+    : target(log_v),
+      queue(queue_mode_v == shared_queue ? std::make_unique<mpsc_ring<async_record>>(capacity) : nullptr),
+      policy(policy_v),
+      drop_level(drop_level_v),
+      mode(log_v.get_mode()),
+      handler(std::move(handler_v)),
+      queue_mode(queue_mode_v),
+      staging_capacity(capacity),
+      id(async_logger_ids.fetch_add(1, std::memory_order_relaxed)) {
+    // the logger is not locked, a second writer thread would race on its buffer
+    [[maybe_unused]] const int writers_before = target.async_writers.fetch_add(1, std::memory_order_relaxed);
+    assert(writers_before == 0 && "one async_logger per logger");
+    if (queue_mode == thread_staging) {
+        writer = std::thread(&async_logger::_staging_loop, this);
+    } else {
+        writer = std::thread(&async_logger::_writer_loop, this);
+    }
+}
+
+async_logger::async_logger(logger& log_v, writer_pool& writers_v, const size_t capacity,
+                           const backpressure_policy policy_v, const log_type drop_level_v,
+                           async_status_handler handler_v)
+    : target(log_v),
+      queue(std::make_unique<mpsc_ring<async_record>>(capacity)),
+      policy(policy_v),
+      drop_level(drop_level_v),
+      mode(log_v.get_mode()),
+      handler(std::move(handler_v)),
+      queue_mode(shared_queue),
+      staging_capacity(capacity),
+      id(async_logger_ids.fetch_add(1, std::memory_order_relaxed)),
+      writers(&writers_v) {
+    // the logger is not locked, a second writer thread would race on its buffer
+    [[maybe_unused]] const int writers_before = target.async_writers.fetch_add(1, std::memory_order_relaxed);
+    assert(writers_before == 0 && "one async_logger per logger");
+    lane.drain = [this] { return _drain_batch(); };
+    writers->attach(lane);
+}
+
+async_logger::~async_logger() {
+    remove_crash_handler(*this);
+    // the end of a flood of a limited call site is queued before the writer stops
+    target.limits.take_pending([this](const int level, const site_decision& pending) {
+        _site_reports(pending, static_cast<log_type>(level));
+    });
+    shutdown = true;
+    if (writers != nullptr) {
+        writers->detach(lane);
+    }
+    if (queue) {
+        queue->notify();
+    }
+    staging_signal.notify();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    for (const auto& buffer : staging) {
+        buffer->orphaned.store(true, std::memory_order_release);
+    }
+    target.async_writers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void async_logger::_process(async_record& record) {
+    if (record.kind == set_mode_record) {
+        target.set_mode(record.type);
+        if (handler) handler(record, OK_LOGGER);
+    } else if (record.kind == bulk_record) {
+        // the block is written with one write unless it is a part of a thread_staging batch already
+        const bool own_batch = !target.batching;
+        if (own_batch) {
+            target.begin_batch();
+        }
+        // the status of the block is the first failure or the status of the last entry
+        LoggerReturn status = LOG_SKIPPED_LOGGER;
+        for (const bulk_entry& entry : record.entries) {
+            const std::string_view message(record.block.data() + entry.offset, entry.size);
+            const LoggerReturn entry_status = target.put_log(message, entry.type);
+            if (status != LOG_FAILED_LOGGER) {
+                status = entry_status;
+            }
+        }
+        if (own_batch) {
+            const LoggerReturn written = target.end_batch();
+            if (status != LOG_FAILED_LOGGER && written != FILE_CLOSED_LOGGER) {
+                status = written;
+            }
+        }
+        if (handler) handler(record, status);
+    } else if (drop_requests.load(std::memory_order_relaxed) > 0 && !record.durable) {
+        // a record with a sequence number may be waited for, the drop falls on a later record
+        drop_requests.fetch_sub(1, std::memory_order_relaxed);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        target.metrics.count_entry(_record_level(record), stat_dropped);
+    } else {
+        LoggerReturn status = LOG_SKIPPED_LOGGER;
+        if (record.format != nullptr && record.args_in_message) {
+            // the buffer keeps its capacity, long arguments are copied back without an allocation
+            message_args.clear();
+            message_args.append(record.message.data(), record.message.size());
+            status = target.put_log_format(record.format, message_args, record.type);
+        } else if (record.format != nullptr) {
+            status = target.put_log_format(record.format, record.args, record.type);
+        } else if (record.has_fields) {
+            status = target._put_fields(record.message, record.args, record.type);
+        } else {
+            status = target.put_log(record.message, record.type);
+        }
+        if (handler) handler(record, status);
+    }
+}
+
+bool async_logger::_commit() {
+    const uint64_t covered = durable.load(std::memory_order_relaxed);
+    if (sync_requested.load(std::memory_order_acquire) <= covered || taken <= covered) {
+        return false;
+    }
+    const uint64_t through = taken;
+    const bool synced = target.sync() == LOG_SAVED_LOGGER;
+    {
+        std::lock_guard<std::mutex> guard(durable_lock);
+        if (synced) {
+            durable.store(through, std::memory_order_release);
+        } else {
+            // after a failed fdatasync the records may be lost even if a later sync succeeds
+            failed_after = failed_through == 0 ? covered : failed_after;
+            failed_through = through > failed_through ? through : failed_through;
+        }
+    }
+    durable_signal.notify_all();
+    return true;
+}
+
+std::chrono::nanoseconds async_logger::_report_due() {
+    return target.limits.take_due([this](const int level, const site_decision& pending) {
+        target._site_reports(pending, static_cast<log_type>(level));
+    });
+}
+
+void async_logger::_crash_park() {
+    crash_drained.store(true, std::memory_order_release);
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::hours(1));
+    }
+}
+
+void async_logger::_writer_loop() {
+    install_crash_stack();
+    writer_tid.store(static_cast<pid_t>(syscall(SYS_gettid)), std::memory_order_release);
+    async_record record;
+    while (true) {
+        target.metrics.observe_queue(queue->size());
+        for (size_t count = 1; queue->try_pop(record); ++count) {
+            ++taken;
+            _process(record);
+            if (count % space_batch == 0) {
+                space_signal.notify();
+            }
+            if (count % staging_batch == 0) {
+                target.metrics.observe_queue(queue->size());
+                // the durability waiters do not wait for the queue to drain
+                _commit();
+            }
+        }
+
+        space_signal.notify();
+        if (shutdown && queue->empty()) break;
+
+        const std::chrono::nanoseconds report = _report_due();
+        // with a flush interval the records stay buffered until the timer, otherwise they are written now
+        const bool crashing = crash_requested.load(std::memory_order_acquire);
+        const std::chrono::nanoseconds delay = crashing ? std::chrono::nanoseconds(0) : target._flush_delay();
+        if (!_commit() && delay.count() == 0) {
+            target.flush();
+        }
+        // the freed messages go back to the producers before the writer sleeps
+        record.message.clear();
+        pool.release_cache();
+        if (crash_requested.load(std::memory_order_acquire)) {
+            // records queued during the flush are written before the writer stops
+            if (!queue->empty()) {
+                continue;
+            }
+            _crash_park();
+        }
+        // the writer also wakes when the next call site report is due
+        const std::chrono::nanoseconds wake =
+            report.count() > 0 && (delay.count() == 0 || report < delay) ? report : delay;
+        if (wake.count() > 0) {
+            queue->wait_for(wake);
+        } else {
+            queue->wait();
+        }
+    }
+    if (!_commit()) {
+        target.flush();
+    }
+}
+
+void async_logger::_staging_loop() {
+    install_crash_stack();
+    writer_tid.store(static_cast<pid_t>(syscall(SYS_gettid)), std::memory_order_release);
+    std::vector<std::shared_ptr<staging_buffer>> active;
+    async_record record;
+    const auto all_empty = [&] {
+        return !staging_changed.load(std::memory_order_relaxed) &&
+               std::all_of(active.begin(), active.end(),
+                           [](const auto& buffer) { return buffer->ring.empty(); });
+    };
+    while (true) {
+        if (staging_changed.exchange(false)) {
+            std::lock_guard<std::mutex> guard(staging_lock);
+            active = staging;
+        }
+
+        batch.clear();
+        size_t depth = 0;
+        for (const auto& buffer : active) {
+            depth += buffer->ring.size();
+        }
+        target.metrics.observe_queue(depth);
+        for (const auto& buffer : active) {
+            for (size_t i = 0; i < staging_batch && buffer->ring.try_pop(record); ++i) {
+                batch.push_back(std::move(record));
+            }
+        }
+        space_signal.notify();
+
+        if (!batch.empty()) {
+            // every buffer is in time order already, the batch is merged by the record time;
+            // ties keep the batch order, std::stable_sort would allocate a buffer for every batch
+            batch_order.resize(batch.size());
+            std::iota(batch_order.begin(), batch_order.end(), 0);
+            std::sort(batch_order.begin(), batch_order.end(), [&](const size_t left, const size_t right) {
+                return batch[left].stamp < batch[right].stamp ||
+                       (batch[left].stamp == batch[right].stamp && left < right);
+            });
+            target.begin_batch();
+            batch_next.store(0, std::memory_order_relaxed);
+            batch_end.store(batch_order.size(), std::memory_order_release);
+            for (size_t i = 0; i < batch_order.size(); ++i) {
+                batch_next.store(i + 1, std::memory_order_relaxed);
+                _process(batch[batch_order[i]]);
+            }
+            batch_end.store(0, std::memory_order_release);
+            target.end_batch();
+            continue;
+        }
+
+        // the buffers of exited threads are removed once they are drained
+        const auto split = std::stable_partition(active.begin(), active.end(), [](const auto& buffer) {
+            return !buffer->closed.load(std::memory_order_acquire) || !buffer->ring.empty();
+        });
+        if (split != active.end()) {
+            std::lock_guard<std::mutex> guard(staging_lock);
+            for (auto it = split; it != active.end(); ++it) {
+                staging.erase(std::find(staging.begin(), staging.end(), *it));
+            }
+            active.erase(split, active.end());
+        }
+
+        if (shutdown && all_empty()) break;
+
+        const std::chrono::nanoseconds report = _report_due();
+        const bool crashing = crash_requested.load(std::memory_order_acquire);
+        const std::chrono::nanoseconds delay = crashing ? std::chrono::nanoseconds(0) : target._flush_delay();
+        if (delay.count() == 0) {
+            target.flush();
+        }
+        // the freed messages go back to the producers before the writer sleeps
+        pool.release_cache();
+        if (crash_requested.load(std::memory_order_acquire)) {
+            // records staged during the flush are written before the writer stops
+            if (!all_empty()) {
+                continue;
+            }
+            _crash_park();
+        }
+        const std::chrono::nanoseconds wake =
+            report.count() > 0 && (delay.count() == 0 || report < delay) ? report : delay;
+        if (wake.count() > 0) {
+            const timespec limit{static_cast<time_t>(wake.count() / 1000000000),
+                                 static_cast<long>(wake.count() % 1000000000)};
+            staging_signal.sleep(all_empty, &limit);
+        } else {
+            staging_signal.sleep(all_empty, nullptr);
+        }
+    }
+    target.flush();
+}
+
+bool async_logger::_drain_batch() {
+    if (crash_drained.load(std::memory_order_acquire)) {
+        // the crash handler writes the file from now on, the records queued since stay in the queue
+        return false;
+    }
+    writer_tid.store(static_cast<pid_t>(syscall(SYS_gettid)), std::memory_order_release);
+    target.metrics.observe_queue(queue->size());
+    async_record record;
+    for (size_t count = 1; count <= staging_batch && queue->try_pop(record); ++count) {
+        ++taken;
+        _process(record);
+        if (count % space_batch == 0) {
+            space_signal.notify();
+        }
+    }
+    space_signal.notify();
+    if (!queue->empty()) {
+        _commit();
+        return true;
+    }
+
+    _report_due();
+    if (!_commit()) {
+        target.flush();
+    }
+    record.message.clear();
+    pool.release_cache();
+    if (crash_requested.load(std::memory_order_acquire)) {
+        // records queued during the flush are written before the lane stops;
+        // the worker is shared, it goes on with the other lanes
+        if (!queue->empty()) {
+            return true;
+        }
+        crash_drained.store(true, std::memory_order_release);
+    }
+    return false;
+}
+
+staging_buffer& async_logger::_thread_buffer() {
+    for (const staging_slot& slot : staging_slots.slots) {
+        if (slot.owner == id) {
+            return *slot.buffer;
+        }
+    }
+
+    // buffers of destroyed async_loggers are forgotten before a new one is added
+    auto& slots = staging_slots.slots;
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [](const staging_slot& slot) {
+                                   return slot.buffer->orphaned.load(std::memory_order_acquire);
+                               }),
+                slots.end());
+
+    auto buffer = std::make_shared<staging_buffer>(staging_capacity);
+    slots.push_back({id, buffer});
+    {
+        std::lock_guard<std::mutex> guard(staging_lock);
+        staging.push_back(buffer);
+    }
+    staging_changed.store(true);
+    staging_signal.notify();
+    return *buffer;
+}
+
+log_type async_logger::_record_level(const async_record& record) const {
+    return record.type == _unknown_log_type ? mode.load(std::memory_order_relaxed) : record.type;
+}
+
+fmt_args& async_logger::_args_buffer() {
+    thread_local fmt_args buffer;
+    return buffer;
+}
+
+LoggerReturn async_logger::_enqueue_format(async_record&& record, const fmt_args& args) {
+    if (args.size() <= fmt_args_capacity) {
+        record.args.append(args.data(), args.size());
+        return _enqueue(std::move(record));
+    }
+    record.args_in_message = true;
+    const std::string_view encoded(reinterpret_cast<const char*>(args.data()), args.size());
+    return _enqueue(std::move(record), encoded);
+}
+
+LoggerReturn async_logger::_enqueue(async_record&& record, std::string_view text,
+                                   const uint64_t* bulk_counts, uint64_t* sequence) {
+    LoggerReturn result = LOG_BUFFERED_LOGGER;
+    // the record is moved into the queue, its level is kept for the counters
+    const log_type level = record.kind == log_record ? _record_level(record) : _unknown_log_type;
+    bool drop_requested = false;
+    staging_buffer* buffer = nullptr;
+    if (queue_mode == thread_staging) {
+        buffer = &_thread_buffer();
+        record.stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    // the message is stored once, a record refused by the queue keeps it for the next attempt
+    bool stored = text.empty();
+    const auto push = [&] {
+        stored = stored || record.message.assign(pool, text);
+        if (!stored) {
+            return false;
+        }
+        if (buffer == nullptr) {
+            size_t position = 0;
+            const bool pushed = queue->try_push(std::move(record), &position);
+            if (pushed && sequence != nullptr) {
+                *sequence = position + 1;
+            }
+            if (pushed && writers != nullptr) {
+                writers->schedule(lane);
+            }
+            return pushed;
+        }
+        const bool pushed = buffer->ring.try_push(std::move(record));
+        if (pushed) {
+            staging_signal.notify_sleeping();
+        }
+        return pushed;
+    };
+    bool pushed = push();
+    for (size_t attempt = 1; result == LOG_BUFFERED_LOGGER && !pushed; ++attempt) {
+        if (policy == drop_newest_policy || (!stored && !pool.fits(text.size())) ||
+            (policy == drop_below_level_policy && record.kind == log_record &&
+             record.type != _unknown_log_type && record.type < drop_level)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            if (record.kind == log_record) {
+                target.metrics.count_entry(_record_level(record), stat_dropped);
+            }
+            if (bulk_counts != nullptr) {
+                // the block was counted as one record above
+                dropped.fetch_add(record.entries.size() - 1, std::memory_order_relaxed);
+                for (size_t i = 0; i < stat_levels; ++i) {
+                    target.metrics.count_entry(static_cast<int>(i), stat_dropped, bulk_counts[i]);
+                }
+            }
+            result = LOG_DROPPED_LOGGER;
+        } else {
+            if (policy == drop_oldest_policy && record.kind == log_record && !drop_requested) {
+                drop_requests.fetch_add(1, std::memory_order_relaxed);
+                drop_requested = true;
+            }
+            // a short spin, then the producer sleeps until the writer takes records
+            if (attempt < enqueue_spins) {
+                std::this_thread::yield();
+                pushed = push();
+            } else {
+                pushed = space_signal.wait(push, &enqueue_wait);
+            }
+        }
+    }
+    if (result == LOG_BUFFERED_LOGGER && level != _unknown_log_type) {
+        target.metrics.count_entry(level, stat_accepted);
+    }
+    if (result == LOG_BUFFERED_LOGGER && bulk_counts != nullptr) {
+        for (size_t i = 0; i < stat_levels; ++i) {
+            target.metrics.count_entry(static_cast<int>(i), stat_accepted, bulk_counts[i]);
+        }
+    }
+    return result;
+}
+
+LoggerReturn async_logger::put_log(std::string_view message, const log_type mode_v) {
+    return _put_message(message, mode_v, nullptr);
+}
+
+LoggerReturn async_logger::put_log(std::string_view message, const log_type mode_v, uint64_t& sequence) {
+    return _put_message(message, mode_v, &sequence);
+}
+
+LoggerReturn async_logger::_put_message(std::string_view message, const log_type mode_v, uint64_t* sequence) {
+    LoggerReturn result = LOG_SKIPPED_LOGGER;
+    if (sequence != nullptr) {
+        *sequence = 0;
+    }
+    if (should_log(mode_v)) {
+        async_record record;
+        record.type = mode_v;
+        record.durable = sequence != nullptr;
+        result = _enqueue(std::move(record), message, nullptr, sequence);
+    } else {
+        target.metrics.count_entry(mode_v, stat_filtered);
+    }
+    return result;
+}
+
+bool async_logger::wait_durable(const uint64_t sequence) {
+    if (sequence == 0) {
+        return false;
+    }
+    const auto failed = [&] { return failed_after < sequence && sequence <= failed_through; };
+    std::unique_lock<std::mutex> guard(durable_lock);
+    if (durable.load(std::memory_order_acquire) < sequence && !failed()) {
+        uint64_t requested = sync_requested.load();
+        while (requested < sequence && !sync_requested.compare_exchange_weak(requested, sequence)) {
+        }
+        // the writer checks sync_requested before it sleeps, a sleeping writer is woken for it
+        guard.unlock();
+        if (writers != nullptr) {
+            writers->schedule(lane);
+        } else {
+            queue->notify();
+        }
+        guard.lock();
+        durable_signal.wait(guard,
+                            [&] { return durable.load(std::memory_order_acquire) >= sequence || failed(); });
+    }
+    return !failed();
+}
+
+LoggerReturn async_logger::put_durable(std::string_view message, const log_type mode_v) {
+    uint64_t sequence = 0;
+    LoggerReturn result = put_log(message, mode_v, sequence);
+    if (result == LOG_BUFFERED_LOGGER) {
+        result = wait_durable(sequence) ? LOG_SAVED_LOGGER : LOG_FAILED_LOGGER;
+    }
+    return result;
+}
+
+uint64_t async_logger::get_durable() const { return durable.load(std::memory_order_acquire); }
+
+LoggerReturn async_logger::put_log(std::string_view message, const log_fields& fields,
+                                   const log_type mode_v) {
+    LoggerReturn result = LOG_SKIPPED_LOGGER;
+    if (should_log(mode_v)) {
+        async_record record;
+        record.type = mode_v;
+        record.args = fields.data();
+        record.has_fields = true;
+        result = _enqueue(std::move(record), message);
+    } else {
+        target.metrics.count_entry(mode_v, stat_filtered);
+    }
+    return result;
+}
+
+LoggerReturn async_logger::_site_reports(const site_decision& decision, const log_type mode_v) {
+    const uint64_t counts[] = {decision.repeated, decision.suppressed};
+    for (size_t i = 0; i < 2; ++i) {
+        if (counts[i] > 0) {
+            async_record record;
+            record.type = mode_v;
+            const std::string text = i == 0 ? site_repeated_text(counts[i]) : site_suppressed_text(counts[i]);
+            _enqueue(std::move(record), text);
+        }
+    }
+    if (!decision.pass) {
+        target.metrics.count_entry(mode_v, decision.reason);
+    }
+    return decision.pass ? LOG_BUFFERED_LOGGER : LOG_SUPPRESSED_LOGGER;
+}
+
+LoggerReturn async_logger::put_limited(log_site& site, std::string_view message, const log_type mode_v) {
+    LoggerReturn result = LOG_SKIPPED_LOGGER;
+    if (should_log(mode_v)) {
+        const site_decision decision = target.limits.admit(site, mode_v, message);
+        result = _site_reports(decision, mode_v);
+        if (decision.pass) {
+            async_record record;
+            record.type = mode_v;
+            result = _enqueue(std::move(record), message);
+        }
+    } else {
+        target.metrics.count_entry(mode_v, stat_filtered);
+    }
+    return result;
+}
+
+LoggerReturn async_logger::put_bulk(std::string&& block, std::vector<bulk_entry>&& entries) {
+    // entries of every level, the filtered ones are removed in place
+    uint64_t accepted[stat_levels] = {};
+    uint64_t filtered[stat_levels] = {};
+    size_t kept = 0;
+    for (const bulk_entry& entry : entries) {
+        const int level = entry.type == _unknown_log_type ? mode.load(std::memory_order_relaxed) : entry.type;
+        uint64_t* counts = should_log(entry.type) ? accepted : filtered;
+        if (level >= 0 && level < static_cast<int>(stat_levels)) {
+            ++counts[level];
+        }
+        if (counts == accepted) {
+            entries[kept++] = entry;
+        }
+    }
+    entries.resize(kept);
+    for (size_t i = 0; i < stat_levels; ++i) {
+        target.metrics.count_entry(static_cast<int>(i), stat_filtered, filtered[i]);
+    }
+
+    LoggerReturn result = LOG_SKIPPED_LOGGER;
+    if (!entries.empty()) {
+        async_record record;
+        record.kind = bulk_record;
+        record.block = std::move(block);
+        record.entries = std::move(entries);
+        result = _enqueue(std::move(record), {}, accepted);
+    }
+    return result;
+}
+
+log_type async_logger::set_mode(const log_type mode_v) {
+    log_type result = _unknown_log_type;
+    if (mode_v != _unknown_log_type) {
+        mode.store(mode_v, std::memory_order_relaxed);
+        async_record record;
+        record.kind = set_mode_record;
+        record.type = mode_v;
+        _enqueue(std::move(record));
+        result = mode_v;
+    }
+    return result;
+}
+
+uint64_t async_logger::get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+void async_logger::set_memory_cap(const size_t bytes) { pool.set_cap(bytes); }
+
+payload_stats async_logger::get_payload_stats() const { return pool.stats(); }
+
+size_t async_logger::get_queue_size() const {
+    size_t result = queue ? queue->size() : 0;
+    if (queue_mode == thread_staging) {
+        std::lock_guard<std::mutex> guard(staging_lock);
+        for (const auto& buffer : staging) {
+            result += buffer->ring.size();
+        }
+    }
+    return result;
+}
+
+bool async_logger::crash_drain(std::string_view note, const std::chrono::nanoseconds timeout, char* scratch,
+                               const size_t capacity) {
+    bool drained = false;
+    // an idle lane of a writer_pool is taken from the workers and written from this thread
+    const bool claimed = writers != nullptr && writers->claim(lane);
+    // the signal on the writer thread interrupts the writer, its queue is read from here
+    const pid_t self = static_cast<pid_t>(syscall(SYS_gettid));
+    bool own = claimed || self == writer_tid.load(std::memory_order_acquire);
+    if (!own) {
+        crash_requested.store(true, std::memory_order_release);
+        if (queue) {
+            queue->notify();
+        }
+        staging_signal.notify();
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        drained = crash_drained.load(std::memory_order_acquire);
+        while (!drained && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            drained = crash_drained.load(std::memory_order_acquire);
+            // a worker that finished the lane before the request leaves it idle, it is written from here
+            if (!drained && writers != nullptr && writers->claim(lane)) {
+                own = true;
+                break;
+            }
+        }
+    }
+
+    if (own) {
+        // nobody else writes the queue, the records are written from this thread in the queue order
+        target.crash_flush();
+        log_type level = target.get_mode();
+        const auto write = [&](const async_record& record) {
+            if (record.kind == set_mode_record) {
+                level = record.type;
+            } else if (record.kind == bulk_record) {
+                for (const bulk_entry& entry : record.entries) {
+                    const std::string_view message(record.block.data() + entry.offset, entry.size);
+                    if (entry.type >= level || entry.type == _unknown_log_type) {
+                        target.crash_put_log(entry.type, message, nullptr, {}, scratch, capacity);
+                    }
+                }
+            } else if (record.type >= level || record.type == _unknown_log_type) {
+                std::string_view args(reinterpret_cast<const char*>(record.args.data()), record.args.size());
+                if (record.args_in_message) {
+                    args = record.message;
+                }
+                target.crash_put_log(record.type, record.message, record.format, args, scratch, capacity);
+            }
+        };
+        if (queue) {
+            queue->peek(write);
+        }
+        // the rest of the batch the writer was writing when it crashed
+        const size_t end = batch_end.load(std::memory_order_acquire);
+        for (size_t i = batch_next.load(std::memory_order_relaxed); i < end; ++i) {
+            write(batch[batch_order[i]]);
+        }
+        for (const auto& buffer : staging) {
+            buffer->ring.peek(write);
+        }
+    }
+    // a writer that has not stopped in time still owns the queue, the logger buffer and the file
+    if (own || drained) {
+        target.crash_put_log(critical_log_type, note, nullptr, {}, scratch, capacity);
+    }
+    return drained;
+}
@@ -3,6 +3,11 @@
 #include <string>
 #endif
 
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
 #ifndef FILE_H
 #define FILE_H
 #include <cstdio>
@@ -20,6 +25,89 @@
 #include <stdexcept>
 #endif
 
+#ifndef CHRONO_H
+#define CHRONO_H
+#include <chrono>
+#endif
+
+#ifndef THREAD_H
+#define THREAD_H
+#include <thread>
+#endif
+
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+#include <functional>
+#endif
+
+#ifndef SYNC_H
+#define SYNC_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#endif
+
+#ifndef RING_BUFFER_H
+#include "ring_buffer.h"
+#endif
+
+#ifndef TIMESTAMP_H
+#include "timestamp.h"
+#endif
+
+#ifndef LOG_FORMAT_H
+#include "log_format.h"
+#endif
+
+#ifndef STRUCTURED_H
+#include "structured.h"
+#endif
+
+#ifndef BINARY_FORMAT_H
+#include "binary_format.h"
+#endif
+
+#ifndef ROTATION_H
+#include "rotation.h"
+#endif
+
+#ifndef SINK_H
+#include "sink.h"
+#endif
+
+#ifndef IO_BACKEND_H
+#include "io_backend.h"
+#endif
+
+#ifndef CRASH_HANDLER_H
+#include "crash_handler.h"
+#endif
+
+#ifndef STATS_H
+#include "stats.h"
+#endif
+
+#ifndef RATE_LIMIT_H
+#include "rate_limit.h"
+#endif
+
+#ifndef PAYLOAD_POOL_H
+#include "payload_pool.h"
+#endif
+
+#ifndef WRITER_POOL_H
+#include "writer_pool.h"
+#endif
+
+#ifndef LOG_INDEX_H
+#include "log_index.h"
+#endif
+
+#ifndef VECTOR_H
+#define VECTOR_H
+#include <vector>
+#endif
+
 // Listing the logging importance levels
 #ifndef LOGGER_H
 #define LOGGER_H
@@ -44,18 +132,85 @@ enum LoggerReturn {
     FILE_CANNOT_OPEN_FOR_WRITING_LOGGER,
     FILE_UNAVAILABLE_LOGGER,
     FILE_INCORRECT_LOGGER,
-    OK_LOGGER
+    OK_LOGGER,
+    // added later, kept after OK_LOGGER so the earlier values keep their numbers
+    LOG_BUFFERED_LOGGER,
+    LOG_DROPPED_LOGGER,
+    LOG_SUPPRESSED_LOGGER
+};
+
+// Layout of the records in the log file
+enum record_format {
+    // [LEVEL] message time
+    text_format,
+    // compact binary records, converted back to text with logdecode (binary_format.h)
+    binary_format,
+    // JSON Lines: {"level":"LEVEL","msg":"message",fields...,"time":"time"}
+    json_format,
+    // logfmt: level=LEVEL msg="message" fields... time=time
+    logfmt_format
+};
+
+// Part of a message for put_log, the parts are written one after another (like iovec)
+struct log_fragment {
+    const char* data;
+    size_t size;
+};
+
+// Durability settings of the buffered write mode
+struct flush_policy {
+    // flush when the buffer holds at least this many bytes (0 - flush every record)
+    size_t buffer_size = 0;
+    // flush when this much time has passed since the last flush (0 - disabled); the async_logger
+    // writer flushes on a timer, a logger used directly checks it on the next record
+    std::chrono::milliseconds interval{0};
+    // records with this level or higher are always flushed immediately
+    log_type flush_level = critical_log_type;
+    // how often the presence of the log file is checked (0 - on every record)
+    std::chrono::milliseconds check_interval{1000};
+};
+
+// Sink attached to a logger with its level threshold
+struct sink_entry {
+    std::shared_ptr<log_sink> sink;
+    log_type level;
 };
 
-// Structure of formatted time from strings
-struct time_string {
-    char hour[3];
-    char min[3];
-    char sec[3];
+// Texts of a level with their lengths, copied into a record with one memcpy
+struct log_type_text {
+    // DEBUG, INFO ...
+    std::string_view name;
+    // debug, info ... - the names of the console input
+    std::string_view lower_name;
+    // "[NAME] " - the start of a text_format record
+    std::string_view text_prefix;
+    // {"level":"NAME","msg":" - the start of a json_format record
+    std::string_view json_prefix;
+    // level=NAME msg=" - the start of a logfmt_format record
+    std::string_view logfmt_prefix;
 };
 
-// здесь использование нескольких точек выхода
-// мне показалось более читаемо
+// Texts of every log_type by its value, the last element is used for unknown values
+constexpr log_type_text log_type_texts[] = {
+    {"DEBUG", "debug", "[DEBUG] ", "{\"level\":\"DEBUG\",\"msg\":\"", "level=DEBUG msg=\""},
+    {"INFO", "info", "[INFO] ", "{\"level\":\"INFO\",\"msg\":\"", "level=INFO msg=\""},
+    {"WARN", "warn", "[WARN] ", "{\"level\":\"WARN\",\"msg\":\"", "level=WARN msg=\""},
+    {"ERROR", "error", "[ERROR] ", "{\"level\":\"ERROR\",\"msg\":\"", "level=ERROR msg=\""},
+    {"CRITICAL", "critical", "[CRITICAL] ", "{\"level\":\"CRITICAL\",\"msg\":\"", "level=CRITICAL msg=\""},
+    {"UNKNOWN", "unknown", "[UNKNOWN] ", "{\"level\":\"UNKNOWN\",\"msg\":\"", "level=UNKNOWN msg=\""}};
+
+/**
+ * @brief Texts of a level.
+ *
+ * @param[in] mode log_type.
+ *
+ * @return element of log_type_texts, UNKNOWN if mode is not a level
+ */
+constexpr const log_type_text& log_type_to_text(const log_type mode) {
+    return mode >= debug_log_type && mode <= critical_log_type ? log_type_texts[mode]
+                                                               : log_type_texts[critical_log_type + 1];
+}
+
 /**
  * @brief Convert log_type to string.
  *
@@ -65,20 +220,394 @@ struct time_string {
  *
  * @return string log type
  */
-const char* _log_type_to_string(log_type mode);
+constexpr const char* _log_type_to_string(log_type mode) { return log_type_to_text(mode).name.data(); }
+
+/**
+ * @brief Level of a level name.
+ *
+ * The length and the first letter tell the five names apart (a switch instead
+ * of comparing with every name), then the name is compared once.
+ *
+ * @param[in] name level name.
+ * @param[in] lower true - lowercase names (debug, info ...), false - DEBUG, INFO ...
+ *
+ * @return log_type, _unknown_log_type if name is not a level
+ */
+constexpr log_type log_type_from_name(std::string_view name, const bool lower = false) {
+    const unsigned first = name.empty() ? 0 : static_cast<unsigned char>(name[0]) | 0x20;
+    log_type result = _unknown_log_type;
+    switch (name.size() << 8 | first) {
+        case 5 << 8 | 'd':
+            result = debug_log_type;
+            break;
+        case 4 << 8 | 'i':
+            result = info_log_type;
+            break;
+        case 4 << 8 | 'w':
+            result = warn_log_type;
+            break;
+        case 5 << 8 | 'e':
+            result = error_log_type;
+            break;
+        case 8 << 8 | 'c':
+            result = critical_log_type;
+            break;
+        default:
+            break;
+    }
+    if (result != _unknown_log_type) {
+        const log_type_text& text = log_type_texts[result];
+        if (name != (lower ? text.lower_name : text.name)) {
+            result = _unknown_log_type;
+        }
+    }
+    return result;
+}
+
+// Compile-time minimum level: -DLOGGER_MIN_LEVEL=warn removes the debug and info call sites of the macros
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL debug
+#endif
+#define LOGGER_LEVEL_NAME(level) level##_log_type
+#define LOGGER_LEVEL_VALUE(level) LOGGER_LEVEL_NAME(level)
+
+constexpr log_type logger_min_level = LOGGER_LEVEL_VALUE(LOGGER_MIN_LEVEL);
+
+/**
+ * @brief Compile-time level check.
+ *
+ * @param[in] level log_type.
+ *
+ * @return false if records of this level are removed at compile time
+ */
+constexpr bool logger_level_compiled(const log_type level) {
+    return level == _unknown_log_type || level >= logger_min_level;
+}
+
+/**
+ * @brief Put an entry only if its level passes the filters.
+ *
+ * The level is checked at compile time (LOGGER_MIN_LEVEL) and then with should_log
+ * before the message arguments are evaluated, so a filtered call costs one comparison
+ * and does not build the message. Works with logger and async_logger.
+ *
+ * @param[in] target logger or async_logger.
+ * @param[in] level log_type.
+ * @param[in] ... arguments of put_log before the level (message or fragments and count).
+ */
+#define LOGGER_LOG(target, level, ...)                                    \
+    do {                                                                  \
+        if (logger_level_compiled(level) && (target).should_log(level)) { \
+            (target).put_log(__VA_ARGS__, level);                         \
+        }                                                                 \
+    } while (0)
+
+#define LOGGER_DEBUG(log, ...) LOGGER_LOG(log, debug_log_type, __VA_ARGS__)
+#define LOGGER_INFO(log, ...) LOGGER_LOG(log, info_log_type, __VA_ARGS__)
+#define LOGGER_WARN(log, ...) LOGGER_LOG(log, warn_log_type, __VA_ARGS__)
+#define LOGGER_ERROR(log, ...) LOGGER_LOG(log, error_log_type, __VA_ARGS__)
+#define LOGGER_CRITICAL(log, ...) LOGGER_LOG(log, critical_log_type, __VA_ARGS__)
+
+/**
+ * @brief Put an entry through the limits of its call site.
+ *
+ * The same as LOGGER_LOG with a message, but every call site has its own
+ * log_site: the record is sampled, collapsed with the previous identical message
+ * and rate limited according to set_rate_limit before it is written or queued.
+ *
+ * @param[in] target logger or async_logger.
+ * @param[in] level log_type.
+ * @param[in] message message.
+ */
+#define LOGGER_LIMITED(target, level, message)                            \
+    do {                                                                  \
+        if (logger_level_compiled(level) && (target).should_log(level)) { \
+            static log_site logger_call_site;                             \
+            (target).put_limited(logger_call_site, message, level);       \
+        }                                                                 \
+    } while (0)
+
+/**
+ * @brief Put a formatted entry through the limits of its call site.
+ *
+ * The same as LOGGER_FMT, with the limits of LOGGER_LIMITED. Repeats are
+ * compared by the format string and the encoded arguments.
+ *
+ * @param[in] target logger or async_logger.
+ * @param[in] level log_type.
+ * @param[in] fmt format string literal.
+ * @param[in] ... format arguments.
+ */
+#define LOGGER_FMT_LIMITED(target, level, fmt, ...)                                            \
+    do {                                                                                       \
+        static_assert(fmt_count_placeholders(fmt) == sizeof(fmt_arg_counter(__VA_ARGS__)) - 1, \
+                      "log format string does not match the arguments");                       \
+        if (logger_level_compiled(level) && (target).should_log(level)) {                      \
+            static log_site logger_call_site;                                                  \
+            (target).log_limited(logger_call_site, level, fmt, ##__VA_ARGS__);                 \
+        }                                                                                      \
+    } while (0)
 
 class logger {
-    // current log level/logger mode (The importance level)
-    log_type mode = info_log_type;
+    // current log level/logger mode (The importance level), can be read from any thread
+    std::atomic<log_type> mode{info_log_type};
 
     // path to output file
-    std::string path;
+    std::filesystem::path path;
 
     // logger status
     LoggerReturn logger_status = OK_LOGGER;
 
-    // file stream
-    std::ofstream file;
+    // output backend type
+    io_backend_type backend = stream_backend;
+
+    // file output
+    std::unique_ptr<file_backend> file;
+
+    // buffered write mode settings
+    flush_policy policy;
+
+    // formatted records that are not yet written to the file
+    std::string buffer;
+
+    // time of the last write to the file
+    std::chrono::steady_clock::time_point last_flush;
+
+    // time of the last file presence check
+    std::chrono::steady_clock::time_point last_check;
+
+    // result of the last file presence check
+    bool file_available = true;
+
+    // a write has failed since the last sync, the sync reports it
+    bool write_failed = false;
+
+    // timestamp formatting of the records
+    timestamp_engine stamp;
+
+    // timestamps of the records written by the crash handler, converted without localtime_r
+    timestamp_engine crash_stamp;
+
+    // layout of the records
+    record_format output_format = text_format;
+
+    // session state of the binary layout
+    binary_encoder binary;
+
+    // level of the record being written
+    log_type record_mode = info_log_type;
+
+    // time of the record being written
+    std::chrono::steady_clock::time_point record_time;
+
+    // rotation settings
+    rotation_policy rotation;
+
+    // compression and removal of the rotated files, nullptr - rotation is disabled
+    std::unique_ptr<rotation_worker> rotator;
+
+    // number of bytes in the current file
+    size_t file_size = 0;
+
+    // number of the next rotated file
+    uint64_t rotation_next = 1;
+
+    // file size of the next try after a failed rename, 0 - max_size
+    size_t rotation_retry_size = 0;
+
+    // time of the next interval rotation
+    std::chrono::steady_clock::time_point next_rotation;
+
+    // additional destinations of the records
+    std::vector<sink_entry> sinks;
+
+    // the lowest level threshold of the sinks
+    log_type sink_level = critical_log_type;
+
+    // true if the record being written goes to at least one sink
+    bool record_to_sinks = false;
+
+    // position of the record being written in the buffer
+    size_t record_start = 0;
+
+    // true between begin_batch and end_batch
+    bool batching = false;
+
+    // text of the record being written for the sinks, used with binary_format only
+    std::string sink_text;
+
+    // rendered message of a json_format or logfmt_format record before escaping,
+    // the message with the fields of a binary_format record
+    std::string message_text;
+
+    // counters of the records, writes and the async_logger queue
+    logger_metrics metrics;
+
+    // number of async_logger instances writing to the logger (at most one), they count the accepted
+    // and filtered records
+    std::atomic<int> async_writers{0};
+
+    // number of records in the buffer by level, they become written or failed with the next write
+    uint64_t pending[stat_levels] = {};
+
+    // periodic dump of the metrics, nullptr - disabled
+    std::unique_ptr<stats_dumper> dumper;
+
+    // limits of the LOGGER_LIMITED call sites, also used by an async_logger writing to the logger
+    rate_limiter limits;
+
+    // least bytes of a block of the index, 0 - no index
+    size_t index_block = 0;
+
+    // sparse index of the file
+    log_index_writer index;
+
+    // async_logger counts its records in metrics
+    friend class async_logger;
+
+    /**
+     * @brief Pass the finished record to the sinks.
+     *
+     * @param[in] record formatted record including the newline.
+     */
+    void _write_sinks(std::string_view record);
+
+    /**
+     * @brief Flush all sinks.
+     */
+    void _flush_sinks();
+
+    /**
+     * @brief Compute the time of the next interval rotation.
+     *
+     * The next multiple of rotation.interval on the wall clock (since the epoch, UTC)
+     * converted to the steady clock, so that records only compare two time points
+     *
+     * @param[in] now current time.
+     */
+    void _schedule_rotation(const std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Rotate the file.
+     *
+     * Writes the buffer, renames the file to <path>.<number> (atomic rename),
+     * opens a new file and passes the rotated one to the rotation_worker.
+     * An empty file is kept. If the rename fails, the same file is reopened with
+     * its size and index; if the open fails, the logger is closed
+     *
+     * @param[in] now current time.
+     */
+    void _rotate(const std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Check who counts the accepted and filtered records.
+     *
+     * @return true if no async_logger writes to the logger, the logger counts them itself
+     */
+    bool _count_entries() const { return async_writers.load(std::memory_order_relaxed) == 0; }
+
+    /**
+     * @brief Start a record.
+     *
+     * Checks the level and the file and writes the record prefix to the buffer
+     * (text layouts only, binary records start with _begin_binary)
+     *
+     * @param[in] mode_v log_type.
+     *
+     * @return LOG_BUFFERED_LOGGER if the message must be written next,
+     * otherwise the put entry status (LOG_SKIPPED_LOGGER, FILE_CLOSED_LOGGER, LOG_FAILED_LOGGER)
+     */
+    LoggerReturn _begin_record(const log_type mode_v);
+
+    /**
+     * @brief Write the header of a binary record.
+     *
+     * @param[in] fmt format string, nullptr - plain message.
+     * @param[in] payload_size length of the message or of the encoded arguments.
+     */
+    void _begin_binary(const char* fmt, const size_t payload_size);
+
+    /**
+     * @brief Append a part of the message of a text layout record.
+     *
+     * The part is escaped for json_format and logfmt_format, where the message
+     * is a quoted string.
+     *
+     * @param[in] message part of the message.
+     */
+    void _append_message(std::string_view message);
+
+    /**
+     * @brief Finish a record.
+     *
+     * Writes the fields and the timestamp (text layouts only) and applies the flush_policy
+     *
+     * @param[in] fields encoded fields of the record or nullptr.
+     *
+     * @return LOG_BUFFERED_LOGGER, LOG_SAVED_LOGGER or LOG_FAILED_LOGGER
+     */
+    LoggerReturn _end_record(const fmt_args* fields = nullptr);
+
+    /**
+     * @brief Put an entry with fields given by their encoding.
+     *
+     * @param[in] message message.
+     * @param[in] fields encoded fields (log_fields::data).
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status, the same as put_log with a message
+     */
+    LoggerReturn _put_fields(std::string_view message, const fmt_args& fields, const log_type mode_v);
+
+    /**
+     * @brief Write the reports of a call site decision.
+     *
+     * Writes "last message repeated N times" and "N messages suppressed by the
+     * rate limit" records and counts a record that is not written.
+     *
+     * @param[in] decision decision of rate_limiter::admit.
+     * @param[in] mode_v log_type.
+     *
+     * @return LOG_SUPPRESSED_LOGGER if the record is not written, otherwise LOG_BUFFERED_LOGGER
+     */
+    LoggerReturn _site_reports(const site_decision& decision, const log_type mode_v);
+
+    /**
+     * @brief Write the pending reports of the LOGGER_LIMITED call sites (rate_limiter::take_pending).
+     */
+    void _report_sites();
+
+    /**
+     * @brief Periodic file presence check.
+     *
+     * Checks that the log file still exists, but not more often than policy.check_interval
+     *
+     * @param[in] now current time.
+     *
+     * @return true if the file is available
+     */
+    bool _check_available(const std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Write the buffer to the file.
+     *
+     * @param[in] now current time.
+     *
+     * @return write status:
+     * LOG_FAILED_LOGGER,
+     * LOG_SAVED_LOGGER
+     */
+    LoggerReturn _write_buffer(const std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Time left until the buffered records are due by the flush_policy interval (writer thread).
+     *
+     * The async_logger writer sleeps this long on an idle queue instead of
+     * flushing at once, so an idle logger is flushed on time by the timer.
+     *
+     * @return 0 if the records are due, the interval is disabled or the buffer is empty
+     */
+    std::chrono::nanoseconds _flush_delay() const;
 
    public:
     /**
@@ -129,6 +658,17 @@ class logger {
      */
     log_type get_mode() const;
 
+    /**
+     * @brief Runtime level check.
+     *
+     * @param[in] mode_v log_type.
+     *
+     * @return true if put_log would not skip an entry of this level
+     */
+    bool should_log(const log_type mode_v) const {
+        return mode_v >= mode.load(std::memory_order_relaxed) || mode_v == _unknown_log_type;
+    }
+
     /**
      * @brief Getter for logger status.
      *
@@ -139,42 +679,1030 @@ class logger {
     LoggerReturn get_status() const;
 
     /**
-     * @brief Logger run function.
+     * @brief Setter for buffered write mode settings.
      *
-     * Opens the file for writing to the bottom
+     * Sets when the buffered records are written to the file.
+     * The default policy writes every record immediately
      *
-     * @return file opening status:
-     * FILE_ALREADY_OPEN_LOGGER,
-     * FILE_CANNOT_OPEN_FOR_WRITING_LOGGER,
-     * FILE_OPENED_LOGGER
+     * @param[in] policy_v flush_policy.
      */
-    LoggerReturn run_logger();
+    void set_flush_policy(const flush_policy& policy_v);
 
     /**
-     * @brief Logger stop function.
+     * @brief Getter for buffered write mode settings.
      *
-     * Close the file
+     * @return current flush_policy
+     */
+    flush_policy get_flush_policy() const;
+
+    /**
+     * @brief Setter for timestamp settings.
      *
-     * @return file closing status:
-     * FILE_ALREADY_CLOSED_LOGGER,
-     * FILE_CLOSED_LOGGER
+     * Sets layout, precision and clock of the record timestamps,
+     * the default is HH:MM:SS from the realtime clock
+     *
+     * @param[in] format_v timestamp_format.
      */
-    LoggerReturn stop_logger();
+    void set_timestamp_format(const timestamp_format& format_v);
 
     /**
-     * @brief Put an entry in a file.
+     * @brief Getter for timestamp settings.
      *
-     * Put an entry in a file if the log_type is not less than
-     * the default value and file exists and valid
+     * @return current timestamp_format
+     */
+    timestamp_format get_timestamp_format() const;
+
+    /**
+     * @brief Setter for the layout of the records.
      *
-     * @param[in] message message.
-     * @param[in] mode_v log_type.
+     * binary_format writes compact binary records: time delta, level,
+     * interned format string id and the message or the encoded arguments.
+     * The file is converted back to text with the logdecode tool.
+     * json_format and logfmt_format write one structured record per line,
+     * the message and the fields are escaped straight into the buffer
      *
-     * @return put entry status:
-     * LOG_FAILED_LOGGER,
-     * FILE_CLOSED_LOGGER,
-     * LOG_SAVED_LOGGER
+     * @param[in] format_v record_format.
      */
-    LoggerReturn put_log(const std::string& message, const log_type mode_v);
-};
-#endif
\ No newline at end of file
+    void set_record_format(const record_format format_v);
+
+    /**
+     * @brief Getter for the layout of the records.
+     *
+     * @return current record_format
+     */
+    record_format get_record_format() const;
+
+    /**
+     * @brief Setter for rotation settings.
+     *
+     * The file is rotated before a record when it has reached max_size bytes
+     * or the wall clock has crossed a multiple of interval. Rotated files are
+     * named <path>.<number>, the newest has the largest number; compression and
+     * removal of the files beyond keep_files happen on a low-priority thread
+     *
+     * @param[in] rotation_v rotation_policy.
+     */
+    void set_rotation_policy(const rotation_policy& rotation_v);
+
+    /**
+     * @brief Getter for rotation settings.
+     *
+     * @return current rotation_policy
+     */
+    rotation_policy get_rotation_policy() const;
+
+    /**
+     * @brief Setter for the file output backend.
+     *
+     * stream_backend (default) writes through std::ofstream. pwritev_backend and
+     * io_uring_backend write at the tracked end of the file and preallocate it
+     * with fallocate, so the logger must be the only writer of the file.
+     * io_uring_backend keeps several writes in flight, flush waits for them;
+     * without io_uring in the kernel pwritev_backend is used.
+     * mmap_ring_backend keeps only the newest records in a fixed-size mapped
+     * file for crash forensics (text_format records, logdecode reads the file)
+     *
+     * @param[in] backend_v io_backend_type.
+     * @param[in] options ring size and msync interval of mmap_ring_backend.
+     *
+     * @return OK_LOGGER, FILE_ALREADY_OPEN_LOGGER - the backend cannot be changed while the file is open
+     */
+    LoggerReturn set_io_backend(const io_backend_type backend_v,
+                                const io_backend_options& options = io_backend_options());
+
+    /**
+     * @brief Getter for the file output backend.
+     *
+     * @return current io_backend_type
+     */
+    io_backend_type get_io_backend() const;
+
+    /**
+     * @brief Setter for the sparse index of the log (<log file>.idx).
+     *
+     * For every block of at least block_size bytes of text, JSON or logfmt
+     * records the index keeps its position, the levels in it and the time of its
+     * earliest and latest timestamp; index_ranges and logscan use it to skip the
+     * blocks a query cannot match. An entry is appended after the bytes of its
+     * block are written. Not used with binary_format and mmap_ring_backend;
+     * after a rotation the index starts again for the new file.
+     *
+     * @param[in] block_size least bytes of a block, 0 - no index.
+     *
+     * @return OK_LOGGER, FILE_ALREADY_OPEN_LOGGER - the index cannot be changed while the file is open
+     */
+    LoggerReturn set_index(const size_t block_size = index_block_size);
+
+    /**
+     * @brief Add a destination of the records.
+     *
+     * Every record that passes the logger mode and the sink level is formatted
+     * once and the same text is passed to the file and to the sinks, so the file
+     * keeps its mode and each sink filters further with its own threshold.
+     * A slow sink should be wrapped in async_sink. Sinks are added before the
+     * logger is used from a writer thread (async_logger)
+     *
+     * @param[in] sink sink.
+     * @param[in] level the lowest level of the records passed to the sink.
+     */
+    void add_sink(std::shared_ptr<log_sink> sink, const log_type level);
+
+    /**
+     * @brief Remove all sinks.
+     *
+     * The sinks are flushed before removal
+     */
+    void clear_sinks();
+
+    /**
+     * @brief Start a batch of records.
+     *
+     * Until end_batch the records are only collected in the buffer (unless it
+     * exceeds flush_policy buffer_size), so the whole batch is written at once
+     */
+    void begin_batch();
+
+    /**
+     * @brief Finish a batch of records and write it to the file.
+     *
+     * @return flush status, the same as flush
+     */
+    LoggerReturn end_batch();
+
+    /**
+     * @brief Write all buffered records to the file.
+     *
+     * @return flush status:
+     * FILE_CLOSED_LOGGER,
+     * LOG_FAILED_LOGGER,
+     * LOG_SAVED_LOGGER
+     */
+    LoggerReturn flush();
+
+    /**
+     * @brief Write all buffered records and make them durable (fdatasync).
+     *
+     * flush only hands the records to the kernel page cache; sync also waits
+     * until the file data is on the disk, which takes milliseconds. New entries
+     * of the index are synced too. Concurrent callers should share syncs
+     * through async_logger::wait_durable.
+     *
+     * @return sync status:
+     * FILE_CLOSED_LOGGER,
+     * LOG_FAILED_LOGGER - a write since the last sync or the sync has failed, the records may be lost,
+     * LOG_SAVED_LOGGER
+     */
+    LoggerReturn sync();
+
+    /**
+     * @brief Snapshot of the metrics (any thread).
+     *
+     * Sums the per-thread counters and reads the writer counters without
+     * stopping the logging threads; a snapshot taken while records are being
+     * written may be a few records behind.
+     *
+     * @return records by level, bytes, write/flush latency, stalls and queue length
+     */
+    logger_stats get_stats() const;
+
+    /**
+     * @brief Dump the metrics to a sidecar file periodically.
+     *
+     * The file is replaced with stats_to_text of a new snapshot every interval
+     * by a separate thread, and once more when the logger is destroyed.
+     *
+     * @param[in] path_v sidecar file.
+     * @param[in] interval time between the dumps, 0 - stop dumping.
+     */
+    void set_stats_dump(const std::string& path_v, const std::chrono::milliseconds interval);
+
+    /**
+     * @brief Setter for the limits of the LOGGER_LIMITED call sites (any thread).
+     *
+     * An async_logger writing to the logger uses the same limits.
+     *
+     * @param[in] policy rate_limit_policy.
+     */
+    void set_rate_limit(const rate_limit_policy& policy);
+
+    /**
+     * @brief Write the buffered records from a signal handler (crash handler).
+     *
+     * Only async-signal-safe calls, nothing is allocated. The buffer is written
+     * as it is through file_backend::crash_write and emptied, rotation and
+     * sinks are skipped.
+     */
+    void crash_flush();
+
+    /**
+     * @brief Write one record from a signal handler (crash handler).
+     *
+     * The record is rendered in the record_format of the logger into scratch and
+     * written at once through file_backend::crash_write, only async-signal-safe
+     * calls are made. The level is not checked. binary_format records and the
+     * fields of a record are not written.
+     *
+     * @param[in] mode_v log_type.
+     * @param[in] message message, used if fmt is nullptr.
+     * @param[in] fmt format string or nullptr.
+     * @param[in] args encoded arguments of fmt, fmt_args::data.
+     * @param[out] scratch buffer, the message is cut off to fit.
+     * @param[in] capacity size of scratch.
+     */
+    void crash_put_log(const log_type mode_v, std::string_view message, const char* fmt,
+                       std::string_view args, char* scratch, const size_t capacity);
+
+    /**
+     * @brief Logger run function.
+     *
+     * Opens the file for writing to the bottom
+     *
+     * @return file opening status:
+     * FILE_ALREADY_OPEN_LOGGER,
+     * FILE_CANNOT_OPEN_FOR_WRITING_LOGGER,
+     * FILE_OPENED_LOGGER
+     */
+    LoggerReturn run_logger();
+
+    /**
+     * @brief Logger stop function.
+     *
+     * Write buffered records and close the file
+     *
+     * @return file closing status:
+     * FILE_ALREADY_CLOSED_LOGGER,
+     * FILE_CLOSED_LOGGER
+     */
+    LoggerReturn stop_logger();
+
+    /**
+     * @brief Put an entry in a file.
+     *
+     * Put an entry in a file if the log_type is not less than
+     * the default value and file exists and valid.
+     * The entry is written according to the flush_policy:
+     * immediately or after it has been collected in the buffer
+     *
+     * @param[in] message message.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status:
+     * LOG_FAILED_LOGGER,
+     * FILE_CLOSED_LOGGER,
+     * LOG_SKIPPED_LOGGER,
+     * LOG_BUFFERED_LOGGER - entry is in the buffer and will be written later,
+     * LOG_SAVED_LOGGER
+     */
+    LoggerReturn put_log(std::string_view message, const log_type mode_v);
+
+    /**
+     * @brief Put an entry assembled from fragments in a file.
+     *
+     * The same as put_log with a message, but the message is given by parts
+     * that are copied straight into the buffer without building a string
+     *
+     * @param[in] fragments message parts.
+     * @param[in] count number of message parts.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status, the same as put_log with a message
+     */
+    LoggerReturn put_log(const log_fragment* fragments, const size_t count, const log_type mode_v);
+
+    /**
+     * @brief Put an entry given by a format string and encoded arguments in a file.
+     *
+     * The message is rendered straight into the buffer, see fmt_render
+     *
+     * @param[in] fmt format string with {} placeholders.
+     * @param[in] args encoded arguments.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status, the same as put_log with a message
+     */
+    LoggerReturn put_log_format(const char* fmt, const fmt_args& args, const log_type mode_v);
+
+    /**
+     * @brief Put an entry with typed key/value fields in a file.
+     *
+     * The fields follow the message: " key=value" in text_format and logfmt_format,
+     * "key":value members in json_format, appended to the message text in binary_format.
+     *
+     * @param[in] message message.
+     * @param[in] fields fields.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status, the same as put_log with a message
+     */
+    LoggerReturn put_log(std::string_view message, const log_fields& fields, const log_type mode_v);
+
+    /**
+     * @brief Put a formatted entry in a file.
+     *
+     * log(warn_log_type, "request {} took {} ms", id, time)
+     *
+     * The format string is used only during the call, binary_format interns
+     * it by content, so it may live in a reused buffer.
+     *
+     * @param[in] mode_v log_type.
+     * @param[in] fmt format string with {} placeholders.
+     * @param[in] values format arguments.
+     *
+     * @return put entry status, the same as put_log with a message
+     */
+    template <typename... Args>
+    LoggerReturn log(const log_type mode_v, const char* fmt, const Args&... values) {
+        LoggerReturn result = LOG_SKIPPED_LOGGER;
+        if (should_log(mode_v)) {
+            fmt_args args;
+            fmt_encode(args, values...);
+            result = put_log_format(fmt, args, mode_v);
+        } else if (_count_entries()) {
+            metrics.count_entry(mode_v, stat_filtered);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Put an entry through the limits of a call site (LOGGER_LIMITED).
+     *
+     * @param[in] site state of the call site.
+     * @param[in] message message.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status, the same as put_log, or
+     * LOG_SUPPRESSED_LOGGER - the entry is sampled out, rate limited or a repeat
+     */
+    LoggerReturn put_limited(log_site& site, std::string_view message, const log_type mode_v);
+
+    /**
+     * @brief Put a formatted entry through the limits of a call site (LOGGER_FMT_LIMITED).
+     *
+     * @param[in] site state of the call site.
+     * @param[in] mode_v log_type.
+     * @param[in] fmt format string with {} placeholders.
+     * @param[in] values format arguments.
+     *
+     * @return put entry status, the same as put_limited
+     */
+    template <typename... Args>
+    LoggerReturn log_limited(log_site& site, const log_type mode_v, const char* fmt, const Args&... values) {
+        LoggerReturn result = LOG_SKIPPED_LOGGER;
+        if (should_log(mode_v)) {
+            fmt_args args;
+            fmt_encode(args, values...);
+            const site_decision decision = limits.admit(site, mode_v, fmt, &args);
+            result = _site_reports(decision, mode_v);
+            if (decision.pass) {
+                result = put_log_format(fmt, args, mode_v);
+            }
+        } else if (_count_entries()) {
+            metrics.count_entry(mode_v, stat_filtered);
+        }
+        return result;
+    }
+};
+
+// What async_logger does when its queue is full
+enum backpressure_policy {
+    // wait until the writer frees up space
+    block_policy,
+    // drop the record being added
+    drop_newest_policy,
+    // drop the oldest record in the queue that has no sequence number for wait_durable
+    drop_oldest_policy,
+    // drop the record being added if its level is below drop_level, otherwise wait
+    drop_below_level_policy
+};
+
+// How producers hand records to the async_logger writer
+enum async_queue_mode {
+    // one lock-free queue shared by all producers
+    shared_queue,
+    // every producer thread fills its own staging buffer, the writer drains them in batches
+    thread_staging
+};
+
+// Kind of the async_logger queue element
+enum async_record_kind { log_record, set_mode_record, bulk_record };
+
+// One entry of a bulk block (async_logger::put_bulk): its message is a part of the block text
+struct bulk_entry {
+    // position of the message in the block
+    uint32_t offset = 0;
+    // length of the message
+    uint32_t size = 0;
+    log_type type = _unknown_log_type;
+};
+
+// Element of the async_logger queue
+struct async_record {
+    async_record_kind kind = log_record;
+    log_type type = _unknown_log_type;
+    // message of a log_record, a block of the payload_pool of the async_logger
+    payload message;
+    // text of a bulk_record, the entries point into it
+    std::string block;
+    // format string of a formatted record, nullptr - the message is used
+    const char* format = nullptr;
+    // encoded arguments of a formatted record, the fields if has_fields is set
+    fmt_args args;
+    // true - a message with log_fields, args hold log_fields::data
+    bool has_fields = false;
+    // true - the arguments of a formatted record are longer than fmt_args_capacity and are kept in message
+    bool args_in_message = false;
+    // entries of a bulk_record
+    std::vector<bulk_entry> entries;
+    // steady clock time of the record (thread_staging), used to merge the staging buffers
+    int64_t stamp = 0;
+    // the producer got the sequence number for wait_durable, drop_oldest_policy does not drop the record
+    bool durable = false;
+};
+
+// Staging buffer of one producer thread (thread_staging)
+struct staging_buffer {
+    spsc_ring<async_record> ring;
+    // set when the producer thread has exited, the writer removes the buffer after draining it
+    std::atomic<bool> closed{false};
+    // set when the async_logger is destroyed, the producer thread forgets the buffer
+    std::atomic<bool> orphaned{false};
+
+    explicit staging_buffer(const size_t capacity) : ring(capacity) {}
+};
+
+// Called on the writer thread after each record is processed
+using async_status_handler = std::function<void(const async_record& record, const LoggerReturn status)>;
+
+class async_logger {
+    // logger the records are written to, only the writer thread uses it
+    logger& target;
+
+    // memory of the queued messages, destroyed after the queue
+    payload_pool pool;
+
+    // records waiting for the writer, nullptr in thread_staging mode
+    std::unique_ptr<mpsc_ring<async_record>> queue;
+
+    // behaviour on a full queue
+    backpressure_policy policy;
+
+    // level below which records are dropped with drop_below_level_policy
+    log_type drop_level;
+
+    // logger mode including the changes that are still in the queue
+    std::atomic<log_type> mode;
+
+    // optional handler of the processing results
+    async_status_handler handler;
+
+    // number of dropped records
+    std::atomic<uint64_t> dropped{0};
+
+    // number of oldest records the writer has to drop (drop_oldest_policy)
+    std::atomic<uint64_t> drop_requests{0};
+
+    // writer thread stop flag
+    std::atomic<bool> shutdown{false};
+
+    // how producers hand records to the writer
+    async_queue_mode queue_mode;
+
+    // capacity of a staging buffer
+    size_t staging_capacity;
+
+    // unique id, producer threads find their staging buffer by it
+    uint64_t id;
+
+    // staging buffers of the producer threads
+    std::vector<std::shared_ptr<staging_buffer>> staging;
+
+    // protects staging
+    mutable std::mutex staging_lock;
+
+    // set when a staging buffer is added
+    std::atomic<bool> staging_changed{false};
+
+    // writer sleeping while all staging buffers are empty
+    consumer_signal staging_signal;
+
+    // producers sleeping while the queue or their staging buffer is full
+    producer_signal space_signal;
+
+    // arguments of an args_in_message record copied back for logger::put_log_format (writer thread)
+    fmt_args message_args;
+
+    // records taken from the staging buffers and their write order (writer thread)
+    std::vector<async_record> batch;
+    std::vector<size_t> batch_order;
+
+    // part of batch_order that is not written yet, the crash handler writes it if the writer has crashed
+    std::atomic<size_t> batch_next{0};
+    std::atomic<size_t> batch_end{0};
+
+    // set by the crash handler, the writer drains the queue and stops
+    std::atomic<bool> crash_requested{false};
+
+    // set by the writer when it has stopped after crash_requested
+    std::atomic<bool> crash_drained{false};
+
+    // thread id of the writer, the crash handler does not wait for itself
+    std::atomic<pid_t> writer_tid{0};
+
+    // writer thread
+    std::thread writer;
+
+    // shared writers the records are written by instead of the own thread, nullptr - own thread
+    writer_pool* writers = nullptr;
+
+    // queue of this async_logger in writers
+    writer_lane lane;
+
+    // sequence of the last record taken from the queue (writer thread)
+    uint64_t taken = 0;
+
+    // largest sequence a wait_durable caller waits for
+    std::atomic<uint64_t> sync_requested{0};
+
+    // every record up to this sequence is on the disk
+    std::atomic<uint64_t> durable{0};
+
+    // wait_durable callers sleep on it until a sync covers their record
+    std::mutex durable_lock;
+    std::condition_variable durable_signal;
+
+    // records up to this sequence were taken before a failed sync, 0 - no sync has failed (durable_lock)
+    uint64_t failed_through = 0;
+
+    // records up to this sequence were durable before the first failed sync (durable_lock)
+    uint64_t failed_after = 0;
+
+    /**
+     * @brief Writer thread loop (shared_queue).
+     *
+     * Takes records from the queue and writes them to the logger.
+     * Before going to sleep on an empty queue writes the call site reports that
+     * are due and flushes the logger buffer; it wakes for the next report or flush.
+     * After shutdown is set drains the queue and exits.
+     */
+    void _writer_loop();
+
+    /**
+     * @brief Writer thread loop (thread_staging).
+     *
+     * Takes a batch of records from every staging buffer, orders the batch by
+     * the record time and writes it to the logger with one write. Removes the
+     * drained buffers of exited threads. Before going to sleep writes the due
+     * call site reports and flushes the logger, as _writer_loop.
+     * After shutdown is set drains all buffers and exits.
+     */
+    void _staging_loop();
+
+    /**
+     * @brief Write a batch of queued records (writer_pool worker).
+     *
+     * Writes the due call site reports and flushes the logger when the queue is
+     * drained (the pool has no timer, the reports left wait for the next batch or
+     * the stop). After a crash request the lane is marked drained (crash_drained)
+     * once its queue is drained and is not written again; the worker is not
+     * parked, it goes on with the other lanes.
+     *
+     * @return true if records are left in the queue
+     */
+    bool _drain_batch();
+
+    /**
+     * @brief Group commit: sync the logger once for all waiting records (writer thread).
+     *
+     * Called between batches of records. If a wait_durable caller waits for a
+     * record that is not durable yet, the records taken so far are synced with
+     * one logger::sync and the waiters are woken; records queued while the sync
+     * runs are covered by the next one.
+     *
+     * @return true if the logger has been synced
+     */
+    bool _commit();
+
+    /**
+     * @brief Write one record to the logger (writer thread).
+     *
+     * @param[in] record record.
+     */
+    void _process(async_record& record);
+
+    /**
+     * @brief Write the reports of the LOGGER_LIMITED call sites that are due (writer thread).
+     *
+     * @return time until the next report is due, 0 if no report is pending (rate_limiter::take_due)
+     */
+    std::chrono::nanoseconds _report_due();
+
+    /**
+     * @brief Stop the writer after a crash request (writer thread).
+     *
+     * Called when the queue is drained and the logger is flushed. The crash
+     * handler writes the file from now on, the writer sleeps until the process ends.
+     */
+    void _crash_park();
+
+    /**
+     * @brief Staging buffer of the calling thread.
+     *
+     * Registers a new buffer on the first call from a thread.
+     *
+     * @return staging buffer
+     */
+    staging_buffer& _thread_buffer();
+
+    /**
+     * @brief Level a record is counted at.
+     *
+     * @param[in] record record.
+     *
+     * @return record level, the current mode for _unknown_log_type
+     */
+    log_type _record_level(const async_record& record) const;
+
+    /**
+     * @brief Put a record in the queue according to the backpressure_policy.
+     *
+     * The message is copied into the payload_pool first; a message that does
+     * not fit under the memory cap is handled like a full queue.
+     *
+     * @param[in] record record.
+     * @param[in] text message of a log_record.
+     * @param[in] bulk_counts entries of every level of a bulk_record, counted as accepted or dropped.
+     * @param[out] sequence optional, sequence of the queued record (shared queue), otherwise 0.
+     *
+     * @return LOG_BUFFERED_LOGGER or LOG_DROPPED_LOGGER
+     */
+    LoggerReturn _enqueue(async_record&& record, std::string_view text = {},
+                          const uint64_t* bulk_counts = nullptr, uint64_t* sequence = nullptr);
+
+    /**
+     * @brief Buffer the format arguments are encoded in (calling thread).
+     *
+     * The buffer keeps its heap storage between calls, so long arguments are
+     * encoded without an allocation once the thread has logged one.
+     *
+     * @return buffer of the calling thread
+     */
+    static fmt_args& _args_buffer();
+
+    /**
+     * @brief Encode format arguments into the buffer of the calling thread.
+     *
+     * @param[in] values format arguments.
+     *
+     * @return encoded arguments, valid until the next call on this thread
+     */
+    template <typename... Args>
+    static const fmt_args& _encode_args(const Args&... values) {
+        fmt_args& encoded = _args_buffer();
+        encoded.clear();
+        fmt_encode(encoded, values...);
+        return encoded;
+    }
+
+    /**
+     * @brief Put a formatted record in the queue.
+     *
+     * Arguments that fit in fmt_args_capacity are copied into the record, longer
+     * ones into a payload_pool block like a message (args_in_message), so a long
+     * string argument costs no heap allocation per record.
+     *
+     * @param[in] record record with the type and the format string.
+     * @param[in] args encoded arguments.
+     *
+     * @return LOG_BUFFERED_LOGGER or LOG_DROPPED_LOGGER
+     */
+    LoggerReturn _enqueue_format(async_record&& record, const fmt_args& args);
+
+    /**
+     * @brief Put a message in the queue.
+     *
+     * @param[in] message message.
+     * @param[in] mode_v log_type.
+     * @param[out] sequence sequence number of the entry, nullptr - the caller does not wait for it.
+     *
+     * @return put entry status, the same as put_log
+     */
+    LoggerReturn _put_message(std::string_view message, const log_type mode_v, uint64_t* sequence);
+
+    /**
+     * @brief Queue the reports of a call site decision.
+     *
+     * The same as logger::_site_reports, the reports are queued as records.
+     *
+     * @param[in] decision decision of rate_limiter::admit.
+     * @param[in] mode_v log_type.
+     *
+     * @return LOG_SUPPRESSED_LOGGER if the record is not queued, otherwise LOG_BUFFERED_LOGGER
+     */
+    LoggerReturn _site_reports(const site_decision& decision, const log_type mode_v);
+
+   public:
+    /**
+     * @brief Class async_logger constructor.
+     *
+     * Starts the writer thread. The logger must already be running (run_logger)
+     * and must not be used directly until async_logger is destroyed. Only one
+     * async_logger may write to a logger at a time (assert): the logger has no
+     * lock, and two writer threads would share its buffer.
+     *
+     * @param[in] log_v logger the records are written to.
+     * @param[in] capacity queue capacity, rounded up to the power of two.
+     * @param[in] policy_v behaviour on a full queue.
+     * @param[in] drop_level_v level below which records are dropped with drop_below_level_policy.
+     * @param[in] handler_v optional handler of the processing results, called on the writer thread.
+     * @param[in] queue_mode_v shared queue or per-thread staging buffers of the given capacity each.
+     */
+    async_logger(logger& log_v, const size_t capacity, const backpressure_policy policy_v = block_policy,
+                 const log_type drop_level_v = warn_log_type, async_status_handler handler_v = nullptr,
+                 const async_queue_mode queue_mode_v = shared_queue);
+
+    /**
+     * @brief Class async_logger constructor with the writer threads of a writer_pool.
+     *
+     * No thread is started: the records go through one shared queue and are
+     * written by the workers of the pool, one batch at a time, in the queue order.
+     * The pool must outlive the async_logger. As with the own writer thread,
+     * only one async_logger may write to a logger at a time (assert), so the
+     * lanes of a pool write to different loggers.
+     *
+     * @param[in] log_v logger the records are written to.
+     * @param[in] writers_v shared writer threads.
+     * @param[in] capacity queue capacity, rounded up to the power of two.
+     * @param[in] policy_v behaviour on a full queue.
+     * @param[in] drop_level_v level below which records are dropped with drop_below_level_policy.
+     * @param[in] handler_v optional handler of the processing results, called on a worker thread.
+     */
+    async_logger(logger& log_v, writer_pool& writers_v, const size_t capacity,
+                 const backpressure_policy policy_v = block_policy,
+                 const log_type drop_level_v = warn_log_type, async_status_handler handler_v = nullptr);
+
+    /**
+     * @brief Class async_logger destructor.
+     *
+     * Writes all queued records, flushes the logger and stops the writer thread
+     * (or waits until the writer_pool has written the queue)
+     */
+    ~async_logger();
+
+    async_logger(const async_logger&) = delete;
+    async_logger& operator=(const async_logger&) = delete;
+
+    /**
+     * @brief Put an entry in the queue (any thread).
+     *
+     * The entry is written by the writer thread with logger::put_log
+     *
+     * @param[in] message message.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status:
+     * LOG_SKIPPED_LOGGER - the level is below the mode, the entry is not queued,
+     * LOG_BUFFERED_LOGGER - entry is in the queue,
+     * LOG_DROPPED_LOGGER - queue is full and the entry is dropped
+     */
+    LoggerReturn put_log(std::string_view message, const log_type mode_v);
+
+    /**
+     * @brief Put an entry in the queue and get its sequence number (any thread).
+     *
+     * Every element of the shared queue has a sequence number, 1 for the first
+     * one; the writer takes them in the sequence order. The number is passed
+     * to wait_durable.
+     *
+     * @param[in] message message.
+     * @param[in] mode_v log_type.
+     * @param[out] sequence sequence number of the entry, 0 if it is not queued or with thread_staging.
+     *
+     * @return put entry status, the same as put_log
+     */
+    LoggerReturn put_log(std::string_view message, const log_type mode_v, uint64_t& sequence);
+
+    /**
+     * @brief Wait until an entry is on the disk (any thread).
+     *
+     * Group commit: all callers waiting at the same time share one fdatasync
+     * (logger::sync) made by the writer, which covers every record taken from
+     * the queue before it; the records queued during a sync wait for the next
+     * one. drop_oldest_policy drops only records put without a sequence number,
+     * so a record with one is never reported durable without being written.
+     * After a failed fdatasync the records it covered may be lost even if a
+     * later sync succeeds, so every record after the durable ones at the first
+     * failure up to the last record covered by any failed sync is reported as
+     * failed.
+     *
+     * @param[in] sequence sequence number from put_log.
+     *
+     * @return false if the sequence is 0 or the sync covering the entry has failed
+     */
+    bool wait_durable(const uint64_t sequence);
+
+    /**
+     * @brief Put an entry in the queue and wait until it is on the disk (any thread).
+     *
+     * put_log with a sequence number and wait_durable.
+     *
+     * @param[in] message message.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status:
+     * LOG_SKIPPED_LOGGER - the level is below the mode, the entry is not queued,
+     * LOG_DROPPED_LOGGER - queue is full and the entry is dropped,
+     * LOG_SAVED_LOGGER - the entry is on the disk,
+     * LOG_FAILED_LOGGER - the sync has failed or the entry has no sequence number (thread_staging)
+     */
+    LoggerReturn put_durable(std::string_view message, const log_type mode_v);
+
+    /**
+     * @brief Getter for the durable sequence (any thread).
+     *
+     * @return sequence number up to which every entry is on the disk
+     */
+    uint64_t get_durable() const;
+
+    /**
+     * @brief Put an entry with typed key/value fields in the queue (any thread).
+     *
+     * The fields are copied in their encoded form and written by the writer
+     * thread with logger::put_log with fields
+     *
+     * @param[in] message message.
+     * @param[in] fields fields.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status, the same as put_log
+     */
+    LoggerReturn put_log(std::string_view message, const log_fields& fields, const log_type mode_v);
+
+    /**
+     * @brief Put a block of entries in the queue as one element (any thread).
+     *
+     * The messages are not copied: every entry is a view into block, the block
+     * is moved into the queue and the writer thread writes its entries with
+     * logger::put_log as one batch (begin_batch/end_batch), so a block is one
+     * write to the file. Entries below the mode are removed before the block is
+     * queued. The status handler is called once per block.
+     *
+     * @param[in] block text of the messages.
+     * @param[in] entries positions and levels of the messages, in the write order.
+     *
+     * @return put block status:
+     * LOG_SKIPPED_LOGGER - no entry passes the level filter, the block is not queued,
+     * LOG_BUFFERED_LOGGER - the block is in the queue,
+     * LOG_DROPPED_LOGGER - queue is full and all entries of the block are dropped
+     */
+    LoggerReturn put_bulk(std::string&& block, std::vector<bulk_entry>&& entries);
+
+    /**
+     * @brief Setter for logger mode (any thread).
+     *
+     * The mode changes after all entries already in the queue are written
+     *
+     * @param[in] mode_v log_type.
+     *
+     * @return if return _unknown_log_type - value not set, otherwise return new mode
+     */
+    log_type set_mode(const log_type mode_v);
+
+    /**
+     * @brief Put a formatted entry in the queue (any thread).
+     *
+     * Only the format string pointer and the binary-encoded arguments are queued,
+     * the text is rendered by the writer thread. The format string must stay valid
+     * until the entry is written (a string literal), string arguments are copied.
+     *
+     * @param[in] mode_v log_type.
+     * @param[in] fmt format string with {} placeholders.
+     * @param[in] values format arguments.
+     *
+     * @return put entry status, the same as put_log
+     */
+    template <typename... Args>
+    LoggerReturn log(const log_type mode_v, const char* fmt, const Args&... values) {
+        LoggerReturn result = LOG_SKIPPED_LOGGER;
+        if (should_log(mode_v)) {
+            async_record record;
+            record.type = mode_v;
+            record.format = fmt;
+            result = _enqueue_format(std::move(record), _encode_args(values...));
+        } else {
+            target.metrics.count_entry(mode_v, stat_filtered);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Put an entry through the limits of a call site in the queue (any thread).
+     *
+     * The decision is made on the calling thread with the limits of the logger
+     * (logger::set_rate_limit), a suppressed entry is not copied or queued.
+     *
+     * @param[in] site state of the call site.
+     * @param[in] message message.
+     * @param[in] mode_v log_type.
+     *
+     * @return put entry status, the same as put_log, or
+     * LOG_SUPPRESSED_LOGGER - the entry is sampled out, rate limited or a repeat
+     */
+    LoggerReturn put_limited(log_site& site, std::string_view message, const log_type mode_v);
+
+    /**
+     * @brief Put a formatted entry through the limits of a call site in the queue (any thread).
+     *
+     * @param[in] site state of the call site.
+     * @param[in] mode_v log_type.
+     * @param[in] fmt format string with {} placeholders, must stay valid (a literal).
+     * @param[in] values format arguments.
+     *
+     * @return put entry status, the same as put_limited
+     */
+    template <typename... Args>
+    LoggerReturn log_limited(log_site& site, const log_type mode_v, const char* fmt, const Args&... values) {
+        LoggerReturn result = LOG_SKIPPED_LOGGER;
+        if (should_log(mode_v)) {
+            const fmt_args& args = _encode_args(values...);
+            const site_decision decision = target.limits.admit(site, mode_v, fmt, &args);
+            result = _site_reports(decision, mode_v);
+            if (decision.pass) {
+                async_record record;
+                record.type = mode_v;
+                record.format = fmt;
+                result = _enqueue_format(std::move(record), args);
+            }
+        } else {
+            target.metrics.count_entry(mode_v, stat_filtered);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Runtime level check (any thread).
+     *
+     * @param[in] mode_v log_type.
+     *
+     * @return true if put_log would queue an entry of this level
+     */
+    bool should_log(const log_type mode_v) const {
+        return mode_v >= mode.load(std::memory_order_relaxed) || mode_v == _unknown_log_type;
+    }
+
+    /**
+     * @brief Getter for the number of dropped records.
+     *
+     * @return number of records dropped by the backpressure_policy
+     */
+    uint64_t get_dropped() const;
+
+    /**
+     * @brief Setter for the memory cap of the queued messages (any thread).
+     *
+     * The messages are kept in a payload_pool; when a new slab would take the
+     * pool above the cap, the record is handled by the backpressure_policy like
+     * a record that does not fit in the queue. Free blocks kept by idle producer
+     * threads count against the cap, so it should be several slabs per thread.
+     *
+     * @param[in] bytes cap, 0 - no cap.
+     */
+    void set_memory_cap(const size_t bytes);
+
+    /**
+     * @brief Getter for the payload_pool counters (any thread).
+     *
+     * @return memory of the queued messages and the allocator hit counters
+     */
+    payload_stats get_payload_stats() const;
+
+    /**
+     * @brief Getter for the queue length.
+     *
+     * @return approximate number of records waiting for the writer (in all staging buffers)
+     */
+    size_t get_queue_size() const;
+
+    /**
+     * @brief Write all queued records from a signal handler (crash handler).
+     *
+     * The writer thread is asked to drain the queue, flush the logger and stop;
+     * the calling thread waits for it up to timeout and only makes async-signal-safe
+     * calls. If the signal is on the writer thread, the logger buffer and the queued
+     * records are written from the calling thread with logger::crash_flush and
+     * logger::crash_put_log. With a writer_pool an idle queue is written from the
+     * calling thread at once, a queue a worker holds is drained by that worker,
+     * which then leaves the lane and goes on with the other lanes.
+     * At the end note is written as a critical record. A writer that has not
+     * stopped within timeout may still be writing, then nothing is written.
+     *
+     * @param[in] note last record.
+     * @param[in] timeout how long to wait for the writer.
+     * @param[out] scratch buffer the records are rendered in.
+     * @param[in] capacity size of scratch.
+     *
+     * @return true if the writer has drained the queue
+     */
+    bool crash_drain(std::string_view note, const std::chrono::nanoseconds timeout, char* scratch,
+                     const size_t capacity);
+};
+#endif
@@ -0,0 +1,2020 @@
+#include "logger_test.h"
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// number of operator new calls in the whole program
+std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* result = std::malloc(size == 0 ? 1 : size);
+    if (result == nullptr) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+std::string make_test_file(const std::string& name) {
+    const std::string result = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream create(result, std::ios::trunc);
+    create.close();
+    return result;
+}
+
+std::vector<std::string> read_log_lines(const std::string& path) {
+    std::vector<std::string> result;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t pos = line.find_last_of(' ');
+        result.push_back(pos == std::string::npos ? line : line.substr(0, pos));
+    }
+    return result;
+}
+
+size_t count_put_log_allocations(const flush_policy& policy, const size_t records) {
+    const std::string path = make_test_file("logger_test_alloc.log");
+    logger log(path, info_log_type);
+    log.set_flush_policy(policy);
+    log.run_logger();
+
+    const char part1[] = "request ";
+    const char part2[] = "handled";
+    const log_fragment fragments[] = {{part1, sizeof(part1) - 1}, {part2, sizeof(part2) - 1}};
+    for (size_t i = 0; i < 100; ++i) {
+        log.put_log(std::string_view("warm up record"), info_log_type);
+        log.put_log(fragments, 2, warn_log_type);
+    }
+
+    const size_t before = allocations.load();
+    for (size_t i = 0; i < records; ++i) {
+        log.put_log(std::string_view("steady state record"), info_log_type);
+        log.put_log(fragments, 2, warn_log_type);
+        log.put_log(std::string_view("filtered record"), debug_log_type);
+    }
+    const size_t result = allocations.load() - before;
+
+    log.stop_logger();
+    std::filesystem::remove(path);
+    return result;
+}
+
+// depth the recursion stops at, never reached, keeps the compiler from seeing an endless recursion
+static volatile int overflow_stop = -1;
+
+int overflow_stack(const int depth) {
+    volatile char frame[4096];
+    frame[0] = static_cast<char>(depth);
+    return depth == overflow_stop ? frame[0] : overflow_stack(depth + 1) + frame[0];
+}
+
+bool test_put_log_no_allocations() {
+    bool ok = true;
+    const size_t records = 10000;
+
+    flush_policy unbuffered;
+    const size_t unbuffered_count = count_put_log_allocations(unbuffered, records);
+    std::cout << "put_log unbuffered: " << unbuffered_count << " allocations per " << records * 3
+              << " records" << std::endl;
+    ok = ok && unbuffered_count == 0;
+
+    flush_policy buffered;
+    buffered.buffer_size = 64 * 1024;
+    buffered.flush_level = critical_log_type;
+    const size_t buffered_count = count_put_log_allocations(buffered, records);
+    std::cout << "put_log buffered: " << buffered_count << " allocations per " << records * 3 << " records"
+              << std::endl;
+    ok = ok && buffered_count == 0;
+
+    return ok;
+}
+
+bool test_level_macros_lazy() {
+    const std::string path = make_test_file("logger_test_macros.log");
+    logger log(path, warn_log_type);
+    log.run_logger();
+
+    int evaluated = 0;
+    auto message = [&](const char* text) {
+        ++evaluated;
+        return std::string(text);
+    };
+    LOGGER_DEBUG(log, message("debug"));
+    LOGGER_INFO(log, message("info"));
+    LOGGER_WARN(log, message("warn"));
+    LOGGER_ERROR(log, message("error"));
+    log.set_mode(debug_log_type);
+    LOGGER_DEBUG(log, message("debug"));
+
+    log.stop_logger();
+    std::filesystem::remove(path);
+    // the last debug call site is removed when LOGGER_MIN_LEVEL is above debug
+    const int expected = logger_level_compiled(debug_log_type) ? 3 : 2;
+    std::cout << "level macros: " << evaluated << " of 5 messages built" << std::endl;
+    return evaluated == expected;
+}
+
+bool test_format_records() {
+    const std::string path = make_test_file("logger_test_format.log");
+    logger log(path, info_log_type);
+    log.run_logger();
+    LOGGER_FMT(log, info_log_type, "sync {} {} {}", 42, -7, true);
+    {
+        async_logger async_log(log, 64);
+        const std::string user = "alice";
+        LOGGER_FMT(async_log, warn_log_type, "user {} took {} ms, ratio {}", user, 1500u, 0.25);
+        LOGGER_FMT(async_log, error_log_type, "braces {{}} char {} ptr {}", 'x', static_cast<void*>(nullptr));
+        LOGGER_FMT(async_log, info_log_type, "no arguments");
+        LOGGER_FMT(async_log, debug_log_type, "filtered {}", 1);
+        async_log.log(info_log_type, "long {}", std::string(300, 'z'));
+    }
+    log.stop_logger();
+
+    const std::vector<std::string> expected = {
+        "[INFO] sync 42 -7 true",
+        "[WARN] user alice took 1500 ms, ratio 0.25",
+        "[ERROR] braces {} char x ptr 0x0",
+        "[INFO] no arguments",
+        "[INFO] long " + std::string(300, 'z'),
+    };
+    const std::vector<std::string> actual = read_log_lines(path);
+    std::filesystem::remove(path);
+    const bool ok = actual == expected;
+    std::cout << "format records: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_binary_round_trip() {
+    const std::string path = make_test_file("logger_test_binary.log");
+    logger log(path, info_log_type);
+    log.set_record_format(binary_format);
+    for (int session = 0; session < 2; ++session) {
+        log.run_logger();
+        log.put_log("plain message", warn_log_type);
+        LOGGER_FMT(log, error_log_type, "code {} user {}", 500 + session, "bob");
+        LOGGER_FMT(log, info_log_type, "code {} user {}", -1, std::string(200, 'q'));
+        log.put_log("filtered", debug_log_type);
+        // the same buffer with another format string gets its own definition
+        char reused[32] = "left {}";
+        log.log(info_log_type, reused, 1);
+        std::snprintf(reused, sizeof(reused), "right {}");
+        log.log(info_log_type, reused, 2);
+        log.stop_logger();
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::filesystem::remove(path);
+
+    binary_decoder decoder;
+    timestamp_engine stamp;
+    binary_record record;
+    std::string text;
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* end = pos + data.size();
+    binary_status status = decoder.next(pos, end, record);
+    while (status == binary_ok) {
+        binary_record_to_text(record, stamp, text);
+        status = decoder.next(pos, end, record);
+    }
+
+    std::vector<std::string> actual;
+    size_t start = 0;
+    for (size_t next = text.find('\n'); next != std::string::npos; next = text.find('\n', start)) {
+        const std::string line = text.substr(start, next - start);
+        actual.push_back(line.substr(0, line.find_last_of(' ')));
+        start = next + 1;
+    }
+    std::vector<std::string> expected;
+    for (int session = 0; session < 2; ++session) {
+        expected.push_back("[WARN] plain message");
+        expected.push_back("[ERROR] code " + std::to_string(500 + session) + " user bob");
+        expected.push_back("[INFO] code -1 user " + std::string(200, 'q'));
+        expected.push_back("[INFO] left 1");
+        expected.push_back("[INFO] right 2");
+    }
+    const bool ok = status == binary_end && actual == expected;
+    std::cout << "binary round trip: " << data.size() << " bytes, " << actual.size() << " records, "
+              << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_binary_failed_write() {
+    const std::string path = make_test_file("logger_test_binary_failed.log");
+    std::filesystem::remove(path);
+    bool ok = true;
+    {
+        // the first write holds the session header and the format definition and is lost
+        logger log(path, info_log_type);
+        log.set_record_format(binary_format);
+        log.set_io_backend(pwritev_backend);
+        log.run_logger();
+        const auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit limit{};
+        getrlimit(RLIMIT_FSIZE, &limit);
+        rlimit no_space = limit;
+        no_space.rlim_cur = 0;
+        setrlimit(RLIMIT_FSIZE, &no_space);
+        const LoggerReturn put = log.log(error_log_type, "code {} user {}", 404, "ann");
+        const LoggerReturn flushed = log.flush();
+        setrlimit(RLIMIT_FSIZE, &limit);
+        std::signal(SIGXFSZ, old_handler);
+        ok = put == LOG_FAILED_LOGGER || flushed == LOG_FAILED_LOGGER;
+        LOGGER_FMT(log, error_log_type, "code {} user {}", 500, "bob");
+        log.put_log("plain message", warn_log_type);
+        log.stop_logger();
+    }
+    std::ifstream in(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::filesystem::remove(path);
+
+    binary_decoder decoder;
+    timestamp_engine stamp;
+    binary_record record;
+    std::string text;
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* end = pos + data.size();
+    binary_status status = decoder.next(pos, end, record);
+    size_t records = 0;
+    while (status == binary_ok) {
+        binary_record_to_text(record, stamp, text);
+        ++records;
+        status = decoder.next(pos, end, record);
+    }
+    ok = ok && status == binary_end && records == 2 && text.find("code 500 user bob") != std::string::npos;
+
+    // records without a leading session header are corrupt
+    binary_decoder headless;
+    const unsigned char* after_session = reinterpret_cast<const unsigned char*>(data.data());
+    uint64_t session_time = 0;
+    after_session += 1 + sizeof(binary_magic) + 1;
+    ok = ok && binary_get_varint(after_session, end, session_time) && *after_session == binary_format_tag;
+    ok = ok && headless.next(after_session, end, record) == binary_corrupt;
+    std::cout << "binary failed write: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_corrupted_record() {
+    const std::string format = "code {} user {}";
+    fmt_args args;
+    fmt_encode(args, 500, "bob");
+    std::string valid(reinterpret_cast<const char*>(args.data()), args.size());
+    // string length past the end, cut off integer, unknown argument type
+    std::string long_string = valid;
+    const uint32_t length = 1000;
+    std::memcpy(&long_string[1 + sizeof(int64_t) + 1], &length, sizeof(length));
+    std::string cut_off = valid.substr(0, 5);
+    std::string unknown_type = valid;
+    unknown_type[0] = static_cast<char>(200);
+
+    timestamp_engine stamp;
+    std::vector<std::string> actual;
+    for (const std::string* payload : {&valid, &long_string, &cut_off, &unknown_type}) {
+        // exact size copy, so a read past the payload is a read past the allocation
+        std::vector<char> copy(payload->begin(), payload->end());
+        binary_record record;
+        record.level = info_log_type;
+        record.format = &format;
+        record.payload = std::string_view(copy.data(), copy.size());
+        std::string text;
+        binary_record_to_text(record, stamp, text);
+        actual.push_back(text.substr(0, text.find_last_of(' ')));
+    }
+
+    log_fields fields;
+    fields.add("user", "bob").add("code", 500);
+    const unsigned char* encoded = fields.data().data();
+    std::vector<unsigned char> cut_fields(encoded, encoded + fields.data().size() - 3);
+    fmt_args truncated;
+    truncated.append(cut_fields.data(), cut_fields.size());
+    std::string json;
+    fields_to_json(json, truncated);
+    std::string rendered;
+    const bool failed = !fmt_render(rendered, "{}={} {}={}", truncated) && rendered == "user=bob code={?}";
+
+    const std::vector<std::string> expected = {
+        "[INFO] code 500 user bob",
+        "[INFO] code 500 user {?}",
+        "[INFO] code {?} user {}",
+        "[INFO] code {?} user {}",
+    };
+    const bool ok = actual == expected && json == ",\"user\":\"bob\"" && failed;
+    std::cout << "corrupted record: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_rotation() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "logger_test_rotation";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+    const std::filesystem::path path = directory / "app.log";
+    std::ofstream create(path);
+    create.close();
+
+    const int records = 500;
+    rotation_policy rotation;
+    rotation.max_size = 1024;
+    rotation.keep_files = 3;
+    rotation.compress = true;
+    {
+        logger log(path.string(), info_log_type);
+        log.set_rotation_policy(rotation);
+        log.run_logger();
+        for (int i = 0; i < records; ++i) {
+            log.log(info_log_type, "record {}", i);
+        }
+        log.stop_logger();
+    }
+
+    std::vector<std::pair<uint64_t, std::filesystem::path>> rotated;
+    bool ok = true;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        const uint64_t number = rotation_number(path, entry.path());
+        if (number != 0) {
+            rotated.emplace_back(number, entry.path());
+            ok = ok && entry.path().extension() == rotation_compressed_extension;
+        }
+    }
+    std::sort(rotated.begin(), rotated.end());
+    ok = ok && rotated.size() == rotation.keep_files;
+
+    std::string text;
+    for (const auto& file : rotated) {
+        std::ifstream in(file.second, std::ios::binary);
+        const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        ok = lz_decompress(data, text) && ok;
+    }
+    std::ifstream current(path);
+    text.append((std::istreambuf_iterator<char>(current)), std::istreambuf_iterator<char>());
+    current.close();
+    std::filesystem::remove_all(directory);
+
+    std::vector<int> numbers;
+    size_t start = 0;
+    for (size_t next = text.find('\n'); next != std::string::npos; next = text.find('\n', start)) {
+        const std::string line = text.substr(start, next - start);
+        numbers.push_back(std::atoi(line.c_str() + sizeof("[INFO] record")));
+        start = next + 1;
+    }
+    for (size_t i = 1; i < numbers.size(); ++i) {
+        ok = ok && numbers[i] == numbers[i - 1] + 1;
+    }
+    ok = ok && !numbers.empty() && numbers.back() == records - 1;
+
+    // a failed rename (a directory in the way) continues the same file with its size and index
+    std::filesystem::create_directory(directory);
+    {
+        logger log(path.string(), info_log_type);
+        rotation_policy small;
+        small.max_size = 256;
+        log.set_rotation_policy(small);
+        log.set_index(128);
+        log.run_logger();
+        std::filesystem::create_directories(directory / "app.log.1" / "taken");
+        for (int i = 0; i < 40; ++i) {
+            log.log(info_log_type, "record {}", i);
+        }
+        log.stop_logger();
+    }
+    const std::vector<std::string> lines = read_log_lines(path.string());
+    mapped_file stuck;
+    std::vector<index_entry> entries;
+    ok = ok && lines.size() == 40 && lines.back() == "[INFO] record 39";
+    ok = ok && stuck.open(path.string()) && load_log_index(path.string(), stuck.size(), entries);
+    uint64_t end = 0;
+    for (const index_entry& entry : entries) {
+        ok = ok && entry.offset == end;
+        end = entry.offset + entry.size;
+    }
+    ok = ok && entries.size() > 1 && end == stuck.size();
+    std::filesystem::remove_all(directory);
+
+    std::cout << "rotation: " << rotated.size() << " compressed files, " << numbers.size()
+              << " newest records kept, " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_sinks() {
+    const std::string path = make_test_file("logger_test_sinks.log");
+    const std::string socket_path =
+        (std::filesystem::temp_directory_path() / "logger_test_sinks.sock").string();
+    std::filesystem::remove(socket_path);
+    const int collector = socket(AF_UNIX, SOCK_DGRAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    bind(collector, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+
+    auto warn_memory = std::make_shared<memory_sink>(4096);
+    auto info_memory = std::make_shared<memory_sink>(4096);
+    auto queued = std::make_shared<async_sink>(info_memory, 16);
+    auto collector_sink = std::make_shared<socket_sink>(socket_path);
+    {
+        logger log(path, info_log_type);
+        log.add_sink(warn_memory, warn_log_type);
+        log.add_sink(queued, info_log_type);
+        log.add_sink(collector_sink, info_log_type);
+        log.run_logger();
+        log.put_log("skipped", debug_log_type);
+        log.put_log("started", info_log_type);
+        LOGGER_FMT(log, warn_log_type, "disk {}% full", 91);
+        log.put_log("failed", error_log_type);
+    }
+    queued.reset();
+
+    std::ifstream in(path);
+    const std::string file_text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::filesystem::remove(path);
+
+    std::string socket_text;
+    char datagram[512];
+    ssize_t received = recv(collector, datagram, sizeof(datagram), MSG_DONTWAIT);
+    while (received > 0) {
+        socket_text.append(datagram, static_cast<size_t>(received));
+        received = recv(collector, datagram, sizeof(datagram), MSG_DONTWAIT);
+    }
+    // a record too large for a datagram is dropped, the connection is kept for the next one
+    collector_sink->write(std::string(1 << 22, 'x'));
+    collector_sink->write("after\n");
+    received = recv(collector, datagram, sizeof(datagram), MSG_DONTWAIT);
+    const bool oversized_dropped = collector_sink->get_dropped() == 1 && received == 6 &&
+                                   std::string(datagram, static_cast<size_t>(received)) == "after\n";
+    close(collector);
+    std::filesystem::remove(socket_path);
+
+    // records ending right at the end of the buffer are whole, a record cut by the wrap is left out
+    memory_sink exact(10);
+    exact.write("abcd\n");
+    exact.write("efgh\n");
+    memory_sink cut(10);
+    cut.write("abcd\n");
+    cut.write("efghij\n");
+    const bool wrap_ok = exact.snapshot() == "abcd\nefgh\n" && cut.snapshot() == "efghij\n";
+
+    const std::string warn_text = warn_memory->snapshot();
+    const size_t warn_start = file_text.find("[WARN]");
+    const bool ok = warn_start != std::string::npos && warn_text == file_text.substr(warn_start) &&
+                    info_memory->snapshot() == file_text && socket_text == file_text &&
+                    std::count(file_text.begin(), file_text.end(), '\n') == 3 && oversized_dropped && wrap_ok;
+    std::cout << "sinks: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_thread_staging() {
+    const std::string path = make_test_file("logger_test_staging.log");
+    const int threads = 4;
+    const int records = 2000;
+    {
+        logger log(path, info_log_type);
+        log.run_logger();
+        async_logger async_log(log, 64, block_policy, warn_log_type, nullptr, thread_staging);
+        for (int round = 0; round < 2; ++round) {
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t) {
+                producers.emplace_back([&async_log, t, round] {
+                    for (int i = 0; i < records; ++i) {
+                        async_log.log(info_log_type, "thread {} record {}", t + round * threads, i);
+                    }
+                });
+            }
+            for (std::thread& producer : producers) {
+                producer.join();
+            }
+        }
+    }
+
+    std::vector<int> next(2 * threads, 0);
+    bool ok = true;
+    size_t count = 0;
+    for (const std::string& line : read_log_lines(path)) {
+        int thread = -1;
+        int record = -1;
+        std::sscanf(line.c_str(), "[INFO] thread %d record %d", &thread, &record);
+        ok = ok && thread >= 0 && thread < 2 * threads && record == next[thread];
+        if (ok) {
+            ++next[thread];
+        }
+        ++count;
+    }
+    std::filesystem::remove(path);
+    ok = ok && count == static_cast<size_t>(2 * threads * records);
+    std::cout << "thread staging: " << count << " records, " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_io_backends() {
+    bool ok = true;
+    for (const io_backend_type backend : {stream_backend, pwritev_backend, io_uring_backend}) {
+        const std::string path = make_test_file("logger_test_backend.log");
+        const int records = 5000;
+        for (int session = 0; session < 2; ++session) {
+            logger log(path, info_log_type);
+            log.set_io_backend(backend);
+            log.run_logger();
+            async_logger async_log(log, 256);
+            for (int i = 0; i < records; ++i) {
+                async_log.log(info_log_type, "record {}", session * records + i);
+            }
+        }
+
+        size_t bytes = 0;
+        int next = 0;
+        bool backend_ok = true;
+        for (const std::string& line : read_log_lines(path)) {
+            backend_ok = backend_ok && line == "[INFO] record " + std::to_string(next++);
+        }
+        std::ifstream in(path, std::ios::binary);
+        for (std::string line; std::getline(in, line);) {
+            bytes += line.size() + 1;
+        }
+        in.close();
+        backend_ok = backend_ok && next == 2 * records && bytes == std::filesystem::file_size(path);
+
+        // a failed write is reported by put_log or flush and again by the next sync, not lost in between
+        {
+            logger log(path, info_log_type);
+            log.set_io_backend(backend);
+            log.run_logger();
+            const auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+            rlimit limit{};
+            getrlimit(RLIMIT_FSIZE, &limit);
+            rlimit no_space = limit;
+            no_space.rlim_cur = 0;
+            setrlimit(RLIMIT_FSIZE, &no_space);
+            const LoggerReturn put = log.put_log("lost record", info_log_type);
+            const LoggerReturn flushed = log.flush();
+            setrlimit(RLIMIT_FSIZE, &limit);
+            std::signal(SIGXFSZ, old_handler);
+            backend_ok = backend_ok && (put == LOG_FAILED_LOGGER || flushed == LOG_FAILED_LOGGER);
+            backend_ok = backend_ok && log.sync() == LOG_FAILED_LOGGER && log.sync() == LOG_SAVED_LOGGER;
+        }
+        std::filesystem::remove(path);
+        std::cout << "io backend " << backend << ": " << (backend_ok ? "match" : "do not match") << std::endl;
+        ok = ok && backend_ok;
+    }
+    return ok;
+}
+
+bool test_mmap_ring() {
+    const std::string path = make_test_file("logger_test_ring.log");
+    const int records = 1000;
+    io_backend_options options;
+    options.ring_size = 8192;
+
+    const pid_t child = fork();
+    if (child == 0) {
+        logger log(path, info_log_type);
+        log.set_io_backend(mmap_ring_backend, options);
+        log.run_logger();
+        for (int i = 0; i < records; ++i) {
+            log.log(info_log_type, "record {}", i);
+        }
+        std::raise(SIGKILL);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    std::ifstream in(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::filesystem::remove(path);
+
+    std::string text;
+    bool ok = WIFSIGNALED(status) && mmap_ring_text(data, text);
+    int expected = -1;
+    size_t count = 0;
+    size_t start = 0;
+    for (size_t next = text.find('\n'); ok && next != std::string::npos; next = text.find('\n', start)) {
+        const int number = std::atoi(text.c_str() + start + sizeof("[INFO] record"));
+        ok = expected < 0 || number == expected;
+        expected = number + 1;
+        ++count;
+        start = next + 1;
+    }
+    ok = ok && expected == records && text.size() > options.ring_size - 64;
+
+    // records of 16 and 24 bytes in a 64 byte ring: the cursor on a record boundary and inside a record
+    for (const size_t width : {16, 24}) {
+        io_backend_options small;
+        small.ring_size = 64;
+        mmap_ring_file_backend ring(small);
+        ring.open(path);
+        std::string record;
+        for (int i = 0; i < 6; ++i) {
+            record = "[INFO] record " + std::to_string(i);
+            record.resize(width - 1, '.');
+            ring.write((record + '\n').c_str(), width);
+        }
+        ring.close();
+        std::ifstream small_in(path, std::ios::binary);
+        const std::string small_data((std::istreambuf_iterator<char>(small_in)),
+                                     std::istreambuf_iterator<char>());
+        small_in.close();
+        std::filesystem::remove(path);
+        std::string small_text;
+        ok = ok && mmap_ring_text(small_data, small_text);
+        // 16 bytes: records 2-5 fill the ring exactly, 24 bytes: record 3 is cut at the cursor
+        const int first = width == 16 ? 2 : 4;
+        ok = ok && small_text.size() == (6 - first) * width &&
+             small_text.compare(0, 15, "[INFO] record " + std::to_string(first)) == 0;
+    }
+    std::cout << "mmap ring: " << count << " newest records after a crash, "
+              << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_crash_handler() {
+    struct crash_case {
+        const char* name;
+        io_backend_type backend;
+        async_queue_mode queue_mode;
+        // true - SIGSEGV on the writer thread, false - abort on the main thread
+        bool writer_crash;
+        record_format layout;
+        // start of a record line before the message
+        const char* prefix;
+        // text between the message and the time
+        const char* suffix;
+    };
+    const crash_case cases[] = {
+        {"stream, abort", stream_backend, shared_queue, false, text_format, "[%s] ", " "},
+        {"pwritev, abort", pwritev_backend, shared_queue, false, text_format, "[%s] ", " "},
+        {"io_uring, abort", io_uring_backend, thread_staging, false, text_format, "[%s] ", " "},
+        {"stream, writer crash", stream_backend, thread_staging, true, text_format, "[%s] ", " "},
+        {"pwritev, writer crash", pwritev_backend, shared_queue, true, text_format, "[%s] ", " "},
+        {"json, writer crash", stream_backend, shared_queue, true, json_format,
+         "{\"level\":\"%s\",\"msg\":\"", "\",\"time\":\""},
+        {"logfmt, writer crash", stream_backend, thread_staging, true, logfmt_format, "level=%s msg=\"",
+         "\" time="}};
+    const int threads = 4;
+    const int records = 3000;
+    bool result = true;
+    for (const crash_case& test : cases) {
+        const std::string path = make_test_file("logger_test_crash.log");
+        const pid_t child = fork();
+        if (child == 0) {
+            const rlimit no_core{0, 0};
+            setrlimit(RLIMIT_CORE, &no_core);
+            logger log(path, info_log_type);
+            log.set_io_backend(test.backend);
+            log.set_record_format(test.layout);
+            flush_policy policy;
+            policy.buffer_size = 1 << 20;
+            policy.interval = std::chrono::hours(1);
+            log.set_flush_policy(policy);
+            log.run_logger();
+
+            std::atomic<int> processed{0};
+            const auto handler = [&](const async_record&, const LoggerReturn) {
+                if (test.writer_crash && ++processed == threads * records / 2) {
+                    std::raise(SIGSEGV);
+                }
+            };
+            async_logger async_log(log, 1 << 16, block_policy, warn_log_type, handler, test.queue_mode);
+            install_crash_handler(async_log);
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t) {
+                producers.emplace_back([&async_log, t] {
+                    for (int i = 0; i < records; ++i) {
+                        async_log.log(info_log_type, "thread {} record {}", t, i);
+                    }
+                });
+            }
+            for (std::thread& producer : producers) {
+                producer.join();
+            }
+            if (!test.writer_crash) {
+                std::abort();
+            }
+            while (true) {
+                pause();
+            }
+        }
+        int status = 0;
+        waitpid(child, &status, 0);
+
+        const int signal = test.writer_crash ? SIGSEGV : SIGABRT;
+        bool ok = WIFSIGNALED(status) && WTERMSIG(status) == signal;
+        std::vector<std::string> lines;
+        std::ifstream in(path);
+        for (std::string line; std::getline(in, line);) {
+            lines.push_back(line);
+        }
+        in.close();
+        std::filesystem::remove(path);
+        char pattern[64];
+        std::snprintf(pattern, sizeof(pattern), test.prefix, "INFO");
+        const std::string record_pattern = std::string(pattern) + "thread %d record %d" + test.suffix + "%n";
+        std::vector<int> next(threads, 0);
+        for (size_t i = 0; ok && i + 1 < lines.size(); ++i) {
+            int thread = -1;
+            int record = -1;
+            int matched = 0;
+            std::sscanf(lines[i].c_str(), record_pattern.c_str(), &thread, &record, &matched);
+            ok = matched > 0 && thread >= 0 && thread < threads && record == next[thread]++;
+        }
+        ok = ok && std::all_of(next.begin(), next.end(), [](const int count) { return count == records; });
+        std::snprintf(pattern, sizeof(pattern), test.prefix, "CRITICAL");
+        const std::string last = std::string(pattern) + "fatal signal " +
+                                 (signal == SIGSEGV ? "SIGSEGV" : "SIGABRT") + test.suffix;
+        ok = ok && !lines.empty() && lines.back().compare(0, last.size(), last) == 0;
+        std::cout << "crash handler, " << test.name << ": " << lines.size() << " lines, "
+                  << (ok ? "match" : "do not match") << std::endl;
+        result = ok && result;
+    }
+
+    {
+        // the handler runs on the alternate stack, a stack overflow still writes the buffer
+        const std::string path = make_test_file("logger_test_crash.log");
+        const pid_t child = fork();
+        if (child == 0) {
+            const rlimit no_core{0, 0};
+            setrlimit(RLIMIT_CORE, &no_core);
+            logger log(path, info_log_type);
+            flush_policy policy;
+            policy.buffer_size = 1 << 20;
+            policy.interval = std::chrono::hours(1);
+            log.set_flush_policy(policy);
+            log.run_logger();
+            install_crash_handler(log);
+            log.put_log("buffered record", info_log_type);
+            overflow_stack(0);
+            std::abort();
+        }
+        int status = 0;
+        waitpid(child, &status, 0);
+        const std::vector<std::string> expected = {"[INFO] buffered record",
+                                                   "[CRITICAL] fatal signal SIGSEGV"};
+        const bool ok =
+            WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV && read_log_lines(path) == expected;
+        std::filesystem::remove(path);
+        std::cout << "crash handler, stack overflow: " << (ok ? "match" : "do not match") << std::endl;
+        result = ok && result;
+    }
+
+    // a writer stuck in a record keeps its queue, the handler does not write next to it
+    const std::string path = make_test_file("logger_test_crash.log");
+    const pid_t child = fork();
+    if (child == 0) {
+        const rlimit no_core{0, 0};
+        setrlimit(RLIMIT_CORE, &no_core);
+        logger log(path, info_log_type);
+        log.run_logger();
+        std::atomic<bool> stuck{false};
+        const auto handler = [&](const async_record&, const LoggerReturn) {
+            stuck = true;
+            while (true) {
+                pause();
+            }
+        };
+        async_logger async_log(log, 64, block_policy, warn_log_type, handler);
+        install_crash_handler(async_log, std::chrono::milliseconds(50));
+        for (int i = 0; i < 10; ++i) {
+            async_log.put_log("queued record", info_log_type);
+        }
+        while (!stuck) {
+            std::this_thread::yield();
+        }
+        std::abort();
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    const bool ok = WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT && read_log_lines(path).size() <= 1;
+    std::filesystem::remove(path);
+    std::cout << "crash handler, stuck writer: " << (ok ? "match" : "do not match") << std::endl;
+    return ok && result;
+}
+
+bool test_stats() {
+    const std::string path = make_test_file("logger_test_stats.log");
+    const std::string sidecar = path + ".stats";
+    const int threads = 2;
+    const uint64_t records = 1000;
+    logger_stats stats;
+    {
+        logger log(path, info_log_type);
+        log.set_stats_dump(sidecar, std::chrono::milliseconds(10));
+        log.run_logger();
+        log.put_log("direct record", warn_log_type);
+        log.put_log("direct debug record", debug_log_type);
+        {
+            async_logger async_log(log, 1 << 12, block_policy, warn_log_type, nullptr, thread_staging);
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t) {
+                producers.emplace_back([&async_log, t] {
+                    for (uint64_t i = 0; i < records; ++i) {
+                        async_log.log(debug_log_type, "thread {} debug {}", t, i);
+                        async_log.log(info_log_type, "thread {} info {}", t, i);
+                        async_log.log(warn_log_type, "thread {} warn {}", t, i);
+                    }
+                });
+            }
+            for (std::thread& producer : producers) {
+                producer.join();
+            }
+        }
+        {
+            async_logger lossy(log, 4, drop_newest_policy);
+            for (uint64_t i = 0; i < records; ++i) {
+                lossy.put_log("lossy record", info_log_type);
+            }
+        }
+        log.flush();
+        stats = log.get_stats();
+    }
+
+    const level_stats& debug = stats.levels[debug_log_type];
+    const level_stats& info = stats.levels[info_log_type];
+    const level_stats& warn = stats.levels[warn_log_type];
+    bool ok = debug.accepted == 0 && debug.filtered == threads * records + 1;
+    ok = ok && info.accepted + info.dropped == (threads + 1) * records && info.filtered == 0;
+    ok = ok && warn.accepted == threads * records + 1 && warn.dropped == 0;
+    for (const level_stats& level : stats.levels) {
+        ok = ok && level.written == level.accepted && level.failed == 0;
+    }
+    ok = ok && stats.bytes == std::filesystem::file_size(path);
+    ok = ok && stats.write_latency.count > 0 && stats.flush_latency.count > 0 && stats.queue_high_water > 0;
+
+    std::ifstream in(sidecar);
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    ok = ok && text.find("written.info " + std::to_string(info.written) + "\n") != std::string::npos;
+    std::filesystem::remove(path);
+    std::filesystem::remove(sidecar);
+
+    // async_loggers one after another on one logger: the records are counted once,
+    // a record the logger level rejects after the async_logger filter is filtered
+    logger_stats shared;
+    {
+        logger log(path, info_log_type);
+        log.run_logger();
+        {
+            async_logger earlier(log, 64);
+            earlier.put_log("earlier record", info_log_type);
+        }
+        std::atomic<int> processed{0};
+        const auto count = [&](const async_record&, const LoggerReturn) { ++processed; };
+        {
+            async_logger later(log, 64, block_policy, warn_log_type, count);
+            later.put_log("later record", error_log_type);
+            while (processed < 1) {
+                std::this_thread::yield();
+            }
+            log.set_mode(error_log_type);
+            later.put_log("rejected record", warn_log_type);
+            later.put_log("last record", error_log_type);
+        }
+        shared = log.get_stats();
+    }
+    std::filesystem::remove(path);
+    const level_stats& shared_info = shared.levels[info_log_type];
+    const level_stats& shared_warn = shared.levels[warn_log_type];
+    const level_stats& shared_error = shared.levels[error_log_type];
+    ok = ok && shared_info.accepted == 1 && shared_info.written == 1;
+    ok = ok && shared_warn.accepted == 1 && shared_warn.filtered == 1 && shared_warn.written == 0;
+    ok = ok && shared_error.accepted == 2 && shared_error.written == 2;
+    std::cout << "stats: " << info.accepted + warn.accepted << " records written, " << info.dropped
+              << " dropped, " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_structured_records() {
+    log_fields fields;
+    fields.add("user", "alice b").add("status", 200).add("ratio", 0.5).add("ok", true).add("delta", -7);
+    fields.add("note", "a \"long\" text\nwith a tab\t, \x01 and a backslash \\ at the end");
+    fields.add("nan", std::numeric_limits<double>::quiet_NaN());
+    const std::string escaped =
+        "a \\\"long\\\" text\\nwith a tab\\t, \\u0001 and a backslash \\\\ at the end";
+    const std::string logfmt_fields =
+        " user=\"alice b\" status=200 ratio=0.5 ok=true delta=-7 note=\"" + escaped + "\" nan=nan";
+
+    struct layout_case {
+        record_format format;
+        // text before the time
+        std::vector<std::string> expected;
+        // start of the time in a line
+        std::string time_prefix;
+    };
+    const std::string json_fields =
+        ",\"user\":\"alice b\",\"status\":200,\"ratio\":0.5,\"ok\":true,\"delta\":-7,\"note\":\"" + escaped +
+        "\",\"nan\":null";
+    const layout_case cases[] = {
+        {text_format,
+         {"[INFO] plain \"quoted\" message", "[WARN] fields message" + logfmt_fields,
+          "[ERROR] request 42 failed"},
+         " "},
+        {json_format,
+         {"{\"level\":\"INFO\",\"msg\":\"plain \\\"quoted\\\" message\"",
+          "{\"level\":\"WARN\",\"msg\":\"fields message\"" + json_fields,
+          "{\"level\":\"ERROR\",\"msg\":\"request 42 failed\""},
+         ",\"time\":\""},
+        {logfmt_format,
+         {"level=INFO msg=\"plain \\\"quoted\\\" message\"",
+          "level=WARN msg=\"fields message\"" + logfmt_fields,
+          "level=ERROR msg=\"request 42 failed\""},
+         " time="}};
+
+    bool ok = true;
+    for (const layout_case& test : cases) {
+        const std::string path = make_test_file("logger_test_structured.log");
+        {
+            logger log(path, info_log_type);
+            log.set_record_format(test.format);
+            log.run_logger();
+            log.put_log("plain \"quoted\" message", info_log_type);
+            log.put_log("fields message", fields, warn_log_type);
+            log.log(error_log_type, "request {} failed", 42);
+            log.put_log("skipped", fields, debug_log_type);
+            async_logger async_log(log, 16);
+            async_log.put_log("plain \"quoted\" message", info_log_type);
+            async_log.put_log("fields message", fields, warn_log_type);
+            async_log.log(error_log_type, "request {} failed", 42);
+        }
+        std::ifstream in(path);
+        std::string line;
+        size_t count = 0;
+        while (std::getline(in, line)) {
+            const size_t time = line.rfind(test.time_prefix);
+            const std::string& expected = test.expected[count % test.expected.size()];
+            ok = ok && time != std::string::npos && line.substr(0, time) == expected;
+            ++count;
+        }
+        in.close();
+        std::filesystem::remove(path);
+        ok = ok && count == 2 * test.expected.size();
+    }
+
+    // the special byte at every position around the 16-byte blocks
+    const char specials[] = {'"', '\\', '\n', '\x1f', '\x7f', ' '};
+    for (size_t size = 1; size <= 40 && ok; ++size) {
+        for (size_t pos = 0; pos < size && ok; ++pos) {
+            for (const char special : specials) {
+                std::string text(size, 'x');
+                text[pos] = special;
+                std::string expected = text.substr(0, pos);
+                if (special == '"' || special == '\\') {
+                    expected += '\\';
+                    expected += special;
+                } else if (special == '\n') {
+                    expected += "\\n";
+                } else if (special == '\x1f') {
+                    expected += "\\u001f";
+                } else {
+                    expected += special;
+                }
+                expected += text.substr(pos + 1);
+                std::string out;
+                json_escape(out, text);
+                std::string value;
+                logfmt_value(value, text);
+                const bool quoted = special != '\x7f';
+                ok = ok && out == expected && (value[0] == '"') == quoted;
+            }
+        }
+    }
+
+    // logfmt keys cannot be quoted
+    log_fields keys;
+    keys.add("a key", 1).add("k=v", 2).add("", 3).add("q\"\\\n", 4);
+    std::string key_out;
+    fields_to_logfmt(key_out, keys.data());
+    ok = ok && key_out == " a_key=1 k_v=2 _=3 q___=4";
+    std::cout << "structured records: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_log_scan() {
+    struct scan_case {
+        scan_filter filter;
+        std::string expected;
+    };
+    std::vector<scan_case> cases(6);
+    cases[0].filter.levels = (1U << warn_log_type) | (1U << error_log_type) | (1U << critical_log_type);
+    cases[1].filter.from = "01:00:00";
+    cases[1].filter.to = "02:30";
+    cases[2].filter.substring = "timeout";
+    cases[3].filter.levels = 1U << error_log_type;
+    cases[3].filter.from = "00:30:00";
+    cases[3].filter.substring = "timeout";
+    cases[4].filter.levels = 1U << critical_log_type;
+    // across midnight
+    cases[5].filter.from = "02:00:00";
+    cases[5].filter.to = "00:30";
+
+    // every fifth line has no level, the layout and the message length change from line to line
+    std::string data;
+    for (size_t i = 0; data.size() <= scan_chunk_size + scan_chunk_size / 4; ++i) {
+        const int level = static_cast<int>(i % 6);
+        const size_t second = (i / 40) % (4 * 3600);
+        char time[16];
+        std::snprintf(time, sizeof(time), "%02zu:%02zu:%02zu", second / 3600, second / 60 % 60, second % 60);
+        std::string message = "request " + std::to_string(i) + std::string(i % 47, 'x');
+        if (i % 7 == 0) {
+            message += " timeout";
+        }
+
+        std::string line;
+        if (level == 5) {
+            line = "plain line " + message;
+        } else {
+            const std::string name = _log_type_to_string(static_cast<log_type>(level));
+            switch (i % 3) {
+                case 0:
+                    line = "[" + name + "] " + message + " " + time;
+                    break;
+                case 1:
+                    line = "{\"level\":\"" + name + "\",\"msg\":\"" + message + "\",\"time\":\"" + time;
+                    line += "\"}";
+                    break;
+                default:
+                    line = "level=" + name + " msg=\"" + message + "\" time=" + time;
+                    break;
+            }
+        }
+        data += line + "\n";
+
+        const bool selected[] = {level >= warn_log_type && level < 5,
+                                 level < 5 && std::string(time) >= "01:00:00" && std::string(time) < "02:31",
+                                 i % 7 == 0,
+                                 level == error_log_type && std::string(time) >= "00:30:00" && i % 7 == 0,
+                                 level == critical_log_type,
+                                 level < 5 && (std::string(time) >= "02:00" || std::string(time) < "00:31")};
+        for (size_t test = 0; test < cases.size(); ++test) {
+            if (selected[test]) {
+                cases[test].expected += line + "\n";
+            }
+        }
+    }
+
+    const std::string path = make_test_file("logger_test_scan.log");
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    mapped_file file;
+    bool ok = file.open(path) && file.size() == data.size();
+    for (const scan_case& test : cases) {
+        for (const size_t threads : {1, 4}) {
+            std::ostringstream out;
+            const scan_stats stats =
+                ok ? scan_log(file.data(), file.size(), test.filter, threads, &out) : scan_stats();
+            const size_t lines = std::count(test.expected.begin(), test.expected.end(), '\n');
+            ok = ok && out.str() == test.expected && stats.matched == lines && stats.bytes == data.size();
+        }
+    }
+    file.close();
+    std::filesystem::remove(path);
+
+    // a time of day against a date, dates against a range of times of day
+    scan_filter day;
+    day.from = "12:00";
+    day.to = "2024-05-01T13";
+    ok = ok && day.matches("[INFO] m 2024-05-01T12:30:00+00:00") && !day.matches("[INFO] m 11:59:59");
+    ok = ok && day.matches("[INFO] m 13:59:59") && !day.matches("[INFO] m 2024-05-01T14:00:00+00:00");
+    day.from = "23:00";
+    day.to = "01:00";
+    ok = ok && day.wraps() && day.matches("[INFO] m 2024-05-01T23:30:00+00:00");
+    ok = ok && !day.matches("[INFO] m 22:00");
+    ok = ok && day.in_time("2024-05-01T12:00:00", "2024-05-02T12:00:00") && !day.in_time("12:00", "22:00");
+
+    // the match at every position around the 16 and 32-byte blocks
+    for (size_t size = 1; size <= 80 && ok; ++size) {
+        for (size_t pos = 0; pos < size && ok; ++pos) {
+            std::string text(size, 'a');
+            text[pos] = '\n';
+            ok = scan_byte(text.data(), text.data() + size, '\n') == text.data() + pos;
+            text[pos] = 't';
+            ok = ok && scan_byte(text.data(), text.data() + size, '\n') == text.data() + size;
+            // a false candidate with the same first and last byte before the match
+            const std::string needle = "tao";
+            text.replace(0, std::min<size_t>(size, 3), "tbo", 0, std::min<size_t>(size, 3));
+            if (pos + needle.size() <= size && pos >= 3) {
+                text.replace(pos, needle.size(), needle);
+                ok = ok && scan_text(text.data(), text.data() + size, needle) == text.data() + pos;
+            } else {
+                ok = ok && scan_text(text.data(), text.data() + size, needle) == text.data() + size;
+            }
+        }
+    }
+    std::cout << "log scan: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_bulk_records() {
+    bool ok = true;
+    size_t written = 0;
+    for (const async_queue_mode queue_mode : {shared_queue, thread_staging}) {
+        const std::string path = make_test_file("logger_test_bulk.log");
+        std::vector<std::string> expected;
+        logger_stats stats;
+        {
+            logger log(path, info_log_type);
+            log.run_logger();
+            {
+                async_logger async_log(log, 4, block_policy, warn_log_type, nullptr, queue_mode);
+                for (int round = 0; round < 2; ++round) {
+                    // the messages follow each other without separators, the entries point into the block
+                    std::string block;
+                    std::vector<bulk_entry> entries;
+                    for (uint32_t i = 0; i < 500; ++i) {
+                        bulk_entry entry;
+                        entry.type = i % 5 == 4 ? _unknown_log_type : static_cast<log_type>(i % 5);
+                        const std::string message = "bulk " + std::to_string(round) + ' ' + std::to_string(i);
+                        entry.offset = static_cast<uint32_t>(block.size());
+                        entry.size = static_cast<uint32_t>(message.size());
+                        block += message;
+                        entries.push_back(entry);
+
+                        const log_type mode = round == 0 ? info_log_type : error_log_type;
+                        const log_type level = entry.type == _unknown_log_type ? mode : entry.type;
+                        if (level >= mode) {
+                            const std::string name = _log_type_to_string(level);
+                            expected.push_back("[" + name + "] " + message);
+                        }
+                    }
+                    const LoggerReturn status = async_log.put_bulk(std::move(block), std::move(entries));
+                    ok = ok && status == LOG_BUFFERED_LOGGER;
+                    async_log.set_mode(error_log_type);
+                }
+                std::vector<bulk_entry> filtered(3);
+                filtered[0].type = filtered[1].type = filtered[2].type = warn_log_type;
+                ok = ok && async_log.put_bulk("skipped", std::move(filtered)) == LOG_SKIPPED_LOGGER;
+            }
+            stats = log.get_stats();
+        }
+        ok = ok && read_log_lines(path) == expected;
+        std::filesystem::remove(path);
+
+        // round 0: 100 debug entries filtered, round 1: 100 debug, info and warn each, unknown at error
+        const level_stats& debug = stats.levels[debug_log_type];
+        const level_stats& info = stats.levels[info_log_type];
+        const level_stats& warn = stats.levels[warn_log_type];
+        const level_stats& error = stats.levels[error_log_type];
+        ok = ok && debug.filtered == 200 && info.filtered == 100 && warn.filtered == 103;
+        ok = ok && info.written == 200 && warn.written == 100;
+        ok = ok && error.written == 300 && error.accepted == 300;
+        written += error.written;
+    }
+    std::cout << "bulk records: " << written << " error records written, " << (ok ? "match" : "do not match")
+              << std::endl;
+    return ok;
+}
+
+bool test_rate_limits() {
+    const std::string path = make_test_file("logger_test_limits.log");
+    std::vector<std::string> expected;
+    logger_stats stats;
+    bool ok = true;
+    {
+        logger log(path, debug_log_type);
+        log.run_logger();
+        {
+            async_logger async_log(log, 1024);
+
+            // identical messages of one call site
+            rate_limit_policy policy;
+            policy.collapse = true;
+            policy.collapse_window = std::chrono::hours(1);
+            log.set_rate_limit(policy);
+            for (int i = 0; i < 11; ++i) {
+                LOGGER_LIMITED(async_log, error_log_type, i < 10 ? "dependency down" : "dependency up");
+            }
+            for (int i = 0; i < 5; ++i) {
+                LOGGER_FMT_LIMITED(async_log, warn_log_type, "retry {} of {}", i < 4 ? 1 : 2, 3);
+            }
+            expected = {"[ERROR] dependency down", "[ERROR] last message repeated 9 times",
+                        "[ERROR] dependency up", "[WARN] retry 1 of 3",
+                        "[WARN] last message repeated 3 times", "[WARN] retry 2 of 3"};
+
+            // distinct messages of one call site: the burst is written, the rest waits for the next token
+            policy = rate_limit_policy();
+            policy.rate = 10;
+            policy.burst = 3;
+            log.set_rate_limit(policy);
+            for (int i = 0; i < 101; ++i) {
+                if (i == 100) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+                }
+                LOGGER_LIMITED(async_log, info_log_type, "request " + std::to_string(i));
+            }
+            expected.insert(expected.end(), {"[INFO] request 0", "[INFO] request 1", "[INFO] request 2",
+                                             "[INFO] 97 messages suppressed by the rate limit",
+                                             "[INFO] request 100"});
+
+            // debug records are not written, about half of the info records are
+            policy = rate_limit_policy();
+            policy.sample[debug_log_type] = 0;
+            policy.sample[info_log_type] = 0.5;
+            log.set_rate_limit(policy);
+            static log_site site;
+            for (int i = 0; i < 10000; ++i) {
+                LOGGER_LIMITED(async_log, debug_log_type, "sampled debug");
+                if (async_log.put_limited(site, "sampled info", info_log_type) == LOG_BUFFERED_LOGGER) {
+                    expected.push_back("[INFO] sampled info");
+                }
+            }
+
+            // the repeats of a flood that stops are written by the writer when collapse_window has passed
+            policy = rate_limit_policy();
+            policy.collapse = true;
+            policy.collapse_window = std::chrono::milliseconds(50);
+            log.set_rate_limit(policy);
+            for (int i = 0; i < 5; ++i) {
+                LOGGER_LIMITED(async_log, error_log_type, "disk full");
+            }
+            expected.push_back("[ERROR] disk full");
+            expected.push_back("[ERROR] last message repeated 4 times");
+            bool reported = false;
+            for (int wait = 0; wait < 200 && !reported; ++wait) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                const std::vector<std::string> lines = read_log_lines(path);
+                reported = !lines.empty() && lines.back() == expected.back();
+            }
+            ok = ok && reported;
+
+            // the repeats at the end of a flood are written when the async_logger stops
+            policy = rate_limit_policy();
+            policy.collapse = true;
+            log.set_rate_limit(policy);
+            for (int i = 0; i < 4; ++i) {
+                LOGGER_LIMITED(async_log, critical_log_type, "shutting down");
+            }
+            expected.push_back("[CRITICAL] shutting down");
+            expected.push_back("[CRITICAL] last message repeated 3 times");
+        }
+        stats = log.get_stats();
+    }
+    ok = ok && read_log_lines(path) == expected;
+    std::filesystem::remove(path);
+
+    const level_stats& debug = stats.levels[debug_log_type];
+    const level_stats& info = stats.levels[info_log_type];
+    ok = ok && stats.levels[error_log_type].collapsed == 13 && stats.levels[warn_log_type].collapsed == 3;
+    ok = ok && stats.levels[critical_log_type].collapsed == 3;
+    ok = ok && info.rate_limited == 97 && debug.sampled == 10000 && debug.written == 0;
+    ok = ok && info.sampled > 4500 && info.sampled < 5500 && info.sampled + info.written == 10000 + 5;
+
+    // the reports of a call site do not go to new limits at the address of destroyed ones
+    static log_site site;
+    rate_limit_policy collapse;
+    collapse.collapse = true;
+    std::optional<rate_limiter> limits;
+    limits.emplace();
+    limits->set_policy(collapse);
+    for (int i = 0; i < 3; ++i) {
+        limits->admit(site, info_log_type, "same message");
+    }
+    limits.reset();
+    limits.emplace();
+    uint64_t foreign = 0;
+    limits->take_pending([&](const int, const site_decision& pending) { foreign += pending.repeated; });
+    ok = ok && foreign == 0;
+    std::cout << "rate limits: " << info.rate_limited << " records rate limited, "
+              << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_payload_pool() {
+    bool ok = true;
+    {
+        // one slab of 64-byte blocks fits under the cap, a slab of another class does not
+        payload_pool pool;
+        pool.set_cap(payload_slab_size);
+        std::vector<payload> messages(payload_slab_size / payload_min_block);
+        for (payload& message : messages) {
+            ok = ok && message.assign(pool, "short message");
+        }
+        payload extra;
+        ok = ok && !extra.assign(pool, "short message") && !extra.assign(pool, std::string(100, 'x'));
+        ok = ok && pool.fits(payload_max_block) && !pool.fits(payload_slab_size + 1);
+        messages.pop_back();
+        ok = ok && extra.assign(pool, "short message") && std::string_view(extra) == "short message";
+        const payload_stats stats = pool.stats();
+        ok = ok && stats.slabs == 1 && stats.cap_failures == 2 && stats.reserved_bytes == payload_slab_size;
+        ok = ok && stats.used_bytes == payload_slab_size && stats.cache_hits > 0;
+
+        // once its blocks are free the slab is cut for the class that needs memory
+        messages.clear();
+        extra.clear();
+        ok = ok && extra.assign(pool, std::string(100, 'x')) && pool.fits(100);
+        ok = ok && pool.stats().slabs == 1 && pool.stats().recycled_slabs == 1;
+    }
+
+    const std::string path = make_test_file("logger_test_payload.log");
+    std::vector<std::string> expected;
+    payload_stats blocked;
+    uint64_t dropped = 0;
+    uint64_t recycled = 0;
+    {
+        logger log(path, debug_log_type);
+        log.run_logger();
+        {
+            async_logger async_log(log, 4096, block_policy);
+            async_log.set_memory_cap(4 * payload_slab_size);
+            for (int i = 0; i < 20000; ++i) {
+                const std::string message = "payload " + std::to_string(i) + std::string(i % 300, '.');
+                ok = ok && async_log.put_log(message, info_log_type) == LOG_BUFFERED_LOGGER;
+                expected.push_back("[INFO] " + message);
+            }
+            // the writer frees the last block when it goes to sleep
+            for (int wait = 0; wait < 500 && async_log.get_payload_stats().used_bytes > 0; ++wait) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            blocked = async_log.get_payload_stats();
+        }
+        {
+            // a class that has filled the cap does not starve another class
+            async_logger async_log(log, 4096, block_policy);
+            async_log.set_memory_cap(payload_slab_size);
+            for (int i = 0; i < 2000; ++i) {
+                const std::string message = "short payload " + std::string(26, 's');
+                ok = ok && async_log.put_log(message, info_log_type) == LOG_BUFFERED_LOGGER;
+                expected.push_back("[INFO] " + message);
+            }
+            for (int wait = 0; wait < 500 && async_log.get_payload_stats().used_bytes > 0; ++wait) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            const std::string longer = "long payload " + std::string(87, 'l');
+            ok = ok && async_log.put_log(longer, info_log_type) == LOG_BUFFERED_LOGGER;
+            expected.push_back("[INFO] " + longer);
+            recycled = async_log.get_payload_stats().recycled_slabs;
+        }
+        {
+            // a message longer than the cap never fits and is dropped even under block_policy
+            async_logger async_log(log, 4096, block_policy);
+            async_log.set_memory_cap(payload_slab_size);
+            const std::string huge(payload_slab_size + 1, 'x');
+            ok = ok && async_log.put_log(huge, info_log_type) == LOG_DROPPED_LOGGER;
+            async_log.set_memory_cap(0);
+            dropped = async_log.get_dropped();
+        }
+    }
+    ok = ok && read_log_lines(path) == expected && dropped == 1 && recycled == 1;
+    std::filesystem::remove(path);
+
+    // 20000 messages of up to 317 bytes went through at most 4 slabs
+    ok = ok && blocked.allocations == 20000 && blocked.used_bytes == 0 && blocked.slabs <= 4;
+    ok = ok && blocked.reserved_bytes <= blocked.cap_bytes && blocked.cache_hits > 0;
+    std::cout << "payload pool: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_writer_pool() {
+    const size_t files = 6;
+    const size_t producers = 3;
+    const size_t per_file = 2000;
+    bool ok = true;
+    std::vector<std::string> paths;
+    std::vector<writer_worker_stats> stats;
+    size_t stolen_lines = 0;
+    {
+        writer_pool writers(2);
+        std::vector<std::unique_ptr<logger>> logs;
+        for (size_t i = 0; i < files; ++i) {
+            paths.push_back(make_test_file("logger_test_pool_" + std::to_string(i) + ".log"));
+            logs.push_back(std::make_unique<logger>(paths.back(), debug_log_type));
+            logs.back()->run_logger();
+        }
+        {
+            // the lanes are homed in turn: files 0, 2, 4 on the first worker, 1, 3, 5 on the second
+            std::atomic<bool> held{false};
+            std::vector<std::unique_ptr<async_logger>> async_logs;
+            const auto hold = [&](const async_record&, const LoggerReturn) {
+                if (!held.exchange(true)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+            };
+            async_logs.push_back(
+                std::make_unique<async_logger>(*logs[0], writers, 64, block_policy, warn_log_type, hold));
+            for (size_t i = 1; i < files; ++i) {
+                async_logs.push_back(std::make_unique<async_logger>(*logs[i], writers, 64));
+            }
+            stats = writers.stats();
+            ok = ok && stats.size() == 2 && stats[0].lanes == 3 && stats[1].lanes == 3;
+
+            // file 2 waits behind the held file 0 on its home worker, the idle worker takes it
+            async_logs[0]->put_log("held", info_log_type);
+            while (!held.load()) {
+                std::this_thread::yield();
+            }
+            for (; stolen_lines < 10; ++stolen_lines) {
+                async_logs[2]->put_log("stolen " + std::to_string(stolen_lines), info_log_type);
+            }
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < producers; ++t) {
+                threads.emplace_back([&, t] {
+                    for (size_t i = 0; i < per_file; ++i) {
+                        for (const auto& async_log : async_logs) {
+                            async_log->put_log(std::to_string(t) + ' ' + std::to_string(i), info_log_type);
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+        stats = writers.stats();
+    }
+
+    for (size_t file = 0; file < files; ++file) {
+        const std::vector<std::string> lines = read_log_lines(paths[file]);
+        std::filesystem::remove(paths[file]);
+        size_t next[producers] = {};
+        size_t extra = 0;
+        for (const std::string& line : lines) {
+            // "[INFO] <producer> <index>", the held and stolen records are counted apart
+            const std::string text = line.substr(sizeof("[INFO]"));
+            const size_t space = text.find(' ');
+            if (space == std::string::npos || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+                ++extra;
+                continue;
+            }
+            const size_t thread = std::stoul(text);
+            const size_t index = std::stoul(text.substr(space + 1));
+            ok = ok && thread < producers && index == next[thread];
+            next[thread] = index + 1;
+        }
+        ok = ok && lines.size() == producers * per_file + extra;
+        ok = ok && extra == (file == 0 ? 1 : file == 2 ? stolen_lines : 0);
+    }
+    ok = ok && stats[0].lanes == 0 && stats[1].lanes == 0 && stats[1].stolen > 0;
+
+    // a crash drain of one lane does not stop the worker shared with another lane
+    const std::string crashed_path = make_test_file("logger_test_pool_crashed.log");
+    const std::string other_path = make_test_file("logger_test_pool_other.log");
+    size_t other_lines = 0;
+    {
+        writer_pool writers(1);
+        logger crashed_log(crashed_path, debug_log_type);
+        logger other_log(other_path, debug_log_type);
+        crashed_log.run_logger();
+        other_log.run_logger();
+        std::atomic<bool> held{false};
+        const auto hold = [&](const async_record&, const LoggerReturn) {
+            if (!held.exchange(true)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        };
+        async_logger crashed(crashed_log, writers, 64, block_policy, warn_log_type, hold);
+        async_logger other(other_log, writers, 64);
+        crashed.put_log("before the crash", info_log_type);
+        while (!held.load()) {
+            std::this_thread::yield();
+        }
+        // the worker holds the lane, it drains it and leaves it
+        char scratch[1024];
+        ok = ok && crashed.crash_drain("crash drained", std::chrono::seconds(5), scratch, sizeof(scratch));
+        for (int i = 0; i < 10; ++i) {
+            other.put_log("after the crash " + std::to_string(i), info_log_type);
+        }
+        for (int wait = 0; wait < 500 && other_lines < 10; ++wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            other_lines = read_log_lines(other_path).size();
+        }
+    }
+    const std::vector<std::string> crashed_lines = read_log_lines(crashed_path);
+    ok = ok && other_lines == 10 && crashed_lines.size() == 2;
+    ok = ok && crashed_lines[0] == "[INFO] before the crash";
+    ok = ok && crashed_lines[1] == "[CRITICAL] crash drained";
+    std::filesystem::remove(crashed_path);
+    std::filesystem::remove(other_path);
+    std::cout << "writer pool: " << files << " files on " << stats.size() << " workers, "
+              << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_log_index() {
+    const std::string path = make_test_file("logger_test_index.log");
+    std::filesystem::remove(index_path(path));
+    timestamp_format format;
+    format.precision = micros_precision;
+    bool ok = true;
+    for (int session = 0; session < 2; ++session) {
+        logger log(path, debug_log_type);
+        log.set_timestamp_format(format);
+        ok = ok && log.set_index(4096) == OK_LOGGER && log.run_logger() == FILE_OPENED_LOGGER;
+        ok = ok && log.set_index(0) == FILE_ALREADY_OPEN_LOGGER;
+        for (int i = 0; i < 3000; ++i) {
+            // critical records only at the start of each session, one multi-line record in the middle
+            const log_type level = i < 100 ? critical_log_type : static_cast<log_type>(i % 3);
+            const std::string message = "session " + std::to_string(session) + " record " + std::to_string(i);
+            log.put_log(i == 1500 ? message + "\nsecond line" : message, level);
+        }
+        log.stop_logger();
+        if (session == 0) {
+            // half of an entry, as after a crash during the append
+            std::ofstream torn(index_path(path), std::ios::binary | std::ios::app);
+            torn << std::string(sizeof(index_entry) / 2, 'x');
+        }
+    }
+
+    mapped_file file;
+    std::vector<index_entry> entries;
+    ok = ok && file.open(path) && load_log_index(path, file.size(), entries) && entries.size() > 10;
+    ok = ok && std::filesystem::file_size(index_path(path)) ==
+                   sizeof(index_header) + entries.size() * sizeof(index_entry);
+    uint64_t end = 0;
+    for (const index_entry& entry : entries) {
+        // blocks of whole records in the order of the file, the last block of a session may be short
+        ok = ok && entry.offset >= end && entry.size > 0;
+        ok = ok && file.data()[entry.offset + entry.size - 1] == '\n';
+        ok = ok && (entry.offset == 0 || file.data()[entry.offset - 1] == '\n');
+        end = entry.offset + entry.size;
+    }
+    ok = ok && end == file.size();
+
+    timestamp_engine engine(format);
+    const auto text = [&](const int64_t time) {
+        char out[timestamp_engine::max_size];
+        return std::string(out, engine.format_time(time, out));
+    };
+    std::vector<scan_filter> filters(5);
+    filters[0].levels = 1U << critical_log_type;
+    const index_entry& middle = entries[entries.size() / 2];
+    filters[1].from = text(middle.latest);
+    filters[1].to = text(middle.latest).substr(0, 8);
+    filters[2].levels = 1U << info_log_type;
+    filters[2].from = filters[1].from;
+    filters[3].from = text(entries[1].earliest);
+    filters[3].to = text(entries[2].latest);
+    // from comes after to: a range across midnight
+    filters[4].from = filters[1].from;
+    filters[4].to = text(entries[1].earliest);
+    uint64_t critical_bytes = 0;
+    for (const scan_filter& filter : filters) {
+        std::ostringstream full;
+        std::ostringstream indexed;
+        const scan_stats all = scan_log(file.data(), file.size(), filter, 1, &full);
+        const std::vector<scan_range> ranges = index_ranges(entries, file.size(), filter);
+        const scan_stats part = scan_log_ranges(file.data(), ranges, filter, 1, &indexed);
+        ok = ok && full.str() == indexed.str() && all.matched == part.matched && part.bytes <= all.bytes;
+        critical_bytes = critical_bytes == 0 ? part.bytes : critical_bytes;
+    }
+    ok = ok && critical_bytes < file.size() / 4;
+    file.close();
+
+    // a copy of the log is another file, the copy of the index does not belong to it
+    const std::string copy = make_test_file("logger_test_index_copy.log");
+    std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::copy_file(index_path(path), index_path(copy),
+                               std::filesystem::copy_options::overwrite_existing);
+    std::vector<index_entry> copied;
+    ok = ok && !load_log_index(copy, std::filesystem::file_size(copy), copied) && copied.empty();
+    std::filesystem::remove(copy);
+    std::filesystem::remove(index_path(copy));
+    std::filesystem::remove(path);
+    std::filesystem::remove(index_path(path));
+    std::cout << "log index: " << entries.size() << " blocks, " << (ok ? "match" : "do not match")
+              << std::endl;
+    return ok;
+}
+
+bool test_index_midnight() {
+    const std::string path = make_test_file("logger_test_midnight.log");
+    const int64_t second = 1000000000LL;
+    bool ok = true;
+    for (int dated = 0; dated < 2; ++dated) {
+        timestamp_format format;
+        format.layout = dated == 1 ? iso8601_layout : time_layout;
+        timestamp_engine engine(format);
+        engine.set_fixed_offset(true);
+        const auto text = [&](const int64_t time) {
+            char out[timestamp_engine::max_size];
+            return std::string(out, engine.format_time(time, out));
+        };
+        // blocks before, across and after the local midnight of 2024-05-01
+        const int64_t midnight = (1714521600LL - engine.get_utc_offset()) * second;
+        const int64_t times[3][2] = {{midnight - 20 * second, midnight - 10 * second},
+                                     {midnight - 5 * second, midnight + 5 * second},
+                                     {midnight + 10 * second, midnight + 20 * second}};
+        std::string log;
+        std::vector<index_entry> entries(3);
+        for (size_t i = 0; i < 3; ++i) {
+            entries[i].offset = log.size();
+            for (const int64_t time : times[i]) {
+                log += "[INFO] block " + std::to_string(i) + ' ' + text(time) + '\n';
+            }
+            entries[i].size = static_cast<uint32_t>(log.size() - entries[i].offset);
+            entries[i].earliest = times[i][0];
+            entries[i].latest = times[i][1];
+            entries[i].least_offset = entries[i].most_offset = static_cast<int32_t>(engine.get_utc_offset());
+            entries[i].levels = 1U << info_log_type;
+            entries[i].dated = static_cast<uint8_t>(dated);
+        }
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << log;
+        }
+        // times of day just after midnight, a range across midnight and a bound with the date if there is one
+        std::vector<scan_filter> filters(3);
+        filters[0].from = "00:00:00";
+        filters[0].to = "00:00:07";
+        filters[1].from = "23:59:55";
+        filters[1].to = "00:00:07";
+        filters[2].from = text(midnight + 10 * second);
+        const uint64_t scanned_blocks[3] = {1, 1, dated == 1 ? 1U : 3U};
+        mapped_file file;
+        ok = ok && file.open(path);
+        for (size_t i = 0; ok && i < filters.size(); ++i) {
+            std::ostringstream full;
+            std::ostringstream indexed;
+            const scan_stats all = scan_log(file.data(), file.size(), filters[i], 1, &full);
+            const std::vector<scan_range> ranges = index_ranges(entries, file.size(), filters[i]);
+            const scan_stats part = scan_log_ranges(file.data(), ranges, filters[i], 1, &indexed);
+            uint64_t blocks = 0;
+            for (const index_entry& entry : entries) {
+                for (const scan_range& range : ranges) {
+                    blocks += range.begin <= entry.offset && entry.offset < range.end ? 1 : 0;
+                }
+            }
+            ok = ok && full.str() == indexed.str() && all.matched == part.matched && all.matched > 0 &&
+                 blocks == scanned_blocks[i];
+        }
+        file.close();
+    }
+    std::filesystem::remove(path);
+    std::cout << "index midnight: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_durable_commit() {
+    const std::string path = make_test_file("logger_test_durable.log");
+    const size_t threads = 4;
+    const size_t records = 100;
+    bool ok = true;
+    uint64_t syncs = 0;
+    size_t lines = 0;
+    {
+        logger log(path, info_log_type);
+        log.run_logger();
+        async_logger async_log(log, 1024);
+        std::atomic<size_t> saved{0};
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < threads; ++t) {
+            producers.emplace_back([&] {
+                for (size_t i = 0; i < records; ++i) {
+                    saved += async_log.put_durable("durable record", info_log_type) == LOG_SAVED_LOGGER;
+                }
+            });
+        }
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+        uint64_t sequence = 0;
+        ok = ok && async_log.put_log("last record", error_log_type, sequence) == LOG_BUFFERED_LOGGER;
+        ok = ok && sequence == threads * records + 1 && async_log.wait_durable(sequence);
+        ok = ok && async_log.get_durable() >= sequence && !async_log.wait_durable(0);
+        ok = ok && async_log.put_log("skipped", debug_log_type, sequence) == LOG_SKIPPED_LOGGER;
+        ok = ok && sequence == 0;
+        ok = ok && saved == threads * records;
+        syncs = log.get_stats().sync_latency.count;
+        // the durable records are in the file while the writer is still running
+        lines = read_log_lines(path).size();
+    }
+    ok = ok && syncs >= 1 && syncs <= threads * records + 1 && lines == threads * records + 1;
+
+    {
+        logger log(path, info_log_type);
+        log.run_logger();
+        writer_pool writers(1);
+        async_logger async_log(log, writers, 64);
+        ok = ok && async_log.put_durable("pooled record", error_log_type) == LOG_SAVED_LOGGER;
+        ok = ok && read_log_lines(path).back() == "[ERROR] pooled record";
+    }
+    {
+        logger log(path, info_log_type);
+        log.run_logger();
+        async_logger async_log(log, 64, block_policy, warn_log_type, nullptr, thread_staging);
+        uint64_t sequence = 1;
+        ok = ok && async_log.put_log("staged record", info_log_type, sequence) == LOG_BUFFERED_LOGGER;
+        ok = ok && sequence == 0;
+        ok = ok && async_log.put_durable("staged record", info_log_type) == LOG_FAILED_LOGGER;
+    }
+    {
+        // records with a sequence number are not dropped by drop_oldest_policy while a flood is dropped
+        std::filesystem::remove(path);
+        logger log(path, info_log_type);
+        log.run_logger();
+        async_logger async_log(log, 4, drop_oldest_policy);
+        std::atomic<bool> flooding{true};
+        std::vector<std::thread> floods;
+        for (size_t t = 0; t < threads; ++t) {
+            floods.emplace_back([&] {
+                while (flooding) {
+                    async_log.put_log("flood", info_log_type);
+                }
+            });
+        }
+        std::vector<std::string> saved;
+        for (size_t i = 0; i < 30 * records; ++i) {
+            const std::string message = "durable " + std::to_string(i);
+            if (async_log.put_durable(message, error_log_type) == LOG_SAVED_LOGGER) {
+                saved.push_back("[ERROR] " + message);
+            }
+        }
+        flooding = false;
+        for (std::thread& flood : floods) {
+            flood.join();
+        }
+        std::vector<std::string> written;
+        for (const std::string& line : read_log_lines(path)) {
+            if (line.rfind("[ERROR] ", 0) == 0) {
+                written.push_back(line);
+            }
+        }
+        ok = ok && saved.size() == 30 * records && written == saved;
+    }
+    {
+        // a file size limit of 0 makes every write fail (EFBIG) until it is lifted
+        std::filesystem::remove(path);
+        logger log(path, info_log_type);
+        log.set_io_backend(pwritev_backend);
+        log.run_logger();
+        async_logger async_log(log, 64);
+        const auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit limit{};
+        getrlimit(RLIMIT_FSIZE, &limit);
+        rlimit no_space = limit;
+        no_space.rlim_cur = 0;
+        uint64_t first = 0;
+        uint64_t last = 0;
+        setrlimit(RLIMIT_FSIZE, &no_space);
+        ok = ok && async_log.put_log("lost record", info_log_type, first) == LOG_BUFFERED_LOGGER;
+        ok = ok && !async_log.wait_durable(first);
+        setrlimit(RLIMIT_FSIZE, &limit);
+        ok = ok && async_log.put_durable("saved record", info_log_type) == LOG_SAVED_LOGGER;
+        setrlimit(RLIMIT_FSIZE, &no_space);
+        ok = ok && async_log.put_log("lost record", info_log_type, last) == LOG_BUFFERED_LOGGER;
+        ok = ok && !async_log.wait_durable(last);
+        setrlimit(RLIMIT_FSIZE, &limit);
+        std::signal(SIGXFSZ, old_handler);
+        // a later sync succeeds, the records of both failed syncs are still reported as failed
+        ok = ok && async_log.put_durable("final record", info_log_type) == LOG_SAVED_LOGGER;
+        ok = ok && !async_log.wait_durable(first) && !async_log.wait_durable(last);
+        const std::vector<std::string> expected = {"[INFO] saved record", "[INFO] final record"};
+        ok = ok && read_log_lines(path) == expected;
+    }
+    {
+        // open without close moves both the stream and the descriptor used for the sync
+        const std::string other = make_test_file("logger_test_durable_other.log");
+        std::filesystem::remove(other);
+        stream_file_backend file;
+        ok = ok && file.open(path) && file.open(other);
+        ok = ok && file.write("[INFO] moved record 00:00:00\n", 29) && file.sync();
+        file.close();
+        ok = ok && read_log_lines(other) == std::vector<std::string>{"[INFO] moved record"};
+        std::filesystem::remove(other);
+    }
+    std::filesystem::remove(path);
+    std::cout << "durable commit: " << threads * records << " records in " << syncs << " syncs, "
+              << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_flush_timer() {
+    const std::string path = make_test_file("logger_test_flush_timer.log");
+    bool ok = true;
+    {
+        logger log(path, info_log_type);
+        flush_policy policy;
+        policy.buffer_size = 1 << 20;
+        policy.interval = std::chrono::milliseconds(200);
+        log.set_flush_policy(policy);
+        log.run_logger();
+        async_logger async_log(log, 64);
+        async_log.put_log("buffered record", info_log_type);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ok = ok && read_log_lines(path).empty();
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        const std::vector<std::string> lines = read_log_lines(path);
+        ok = ok && lines.size() == 1 && lines[0] == "[INFO] buffered record";
+    }
+    std::filesystem::remove(path);
+    std::cout << "flush timer: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_full_queue_wait() {
+    const std::string path = make_test_file("logger_test_full_queue.log");
+    const int records = 100;
+    bool ok = true;
+    double busy = 0;
+    for (const backpressure_policy policy : {block_policy, drop_oldest_policy}) {
+        logger log(path, info_log_type);
+        log.run_logger();
+        async_logger async_log(log, 2, policy, warn_log_type, [](const async_record&, const LoggerReturn) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        double cpu = 0;
+        const auto start = std::chrono::steady_clock::now();
+        std::thread producer([&] {
+            for (int i = 0; i < records; ++i) {
+                async_log.put_log("waiting record", info_log_type);
+            }
+            timespec used{};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &used);
+            cpu = used.tv_sec + used.tv_nsec / 1e9;
+        });
+        producer.join();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        busy = std::max(busy, cpu / elapsed.count());
+        ok = ok && cpu < elapsed.count() / 4;
+    }
+    ok = ok && read_log_lines(path).size() >= static_cast<size_t>(records);
+    std::filesystem::remove(path);
+    std::cout << "full queue wait: producer busy " << static_cast<int>(busy * 100) << "% of the time, "
+              << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_timestamp_engine() {
+    const char* old_zone = std::getenv("TZ");
+    const std::string saved = old_zone == nullptr ? "" : old_zone;
+    // 2023-11-14 22:13:20 UTC and some nanoseconds
+    const int64_t second = 1700000000LL * 1000000000LL;
+    const int64_t time = second + 123456789;
+    const auto text = [](timestamp_engine& engine, const int64_t epoch_ns) {
+        char out[timestamp_engine::max_size];
+        return std::string(out, engine.format_time(epoch_ns, out));
+    };
+    bool ok = true;
+
+    setenv("TZ", "UTC-3", 1);
+    tzset();
+    timestamp_engine nanos({iso8601_layout, nanos_precision, realtime_clock});
+    timestamp_engine micros({iso8601_layout, micros_precision, realtime_clock});
+    timestamp_engine millis({time_layout, millis_precision, realtime_clock});
+    timestamp_engine plain({time_layout, seconds_precision, realtime_clock});
+    ok = ok && text(nanos, time) == "2023-11-15T01:13:20.123456789+03:00";
+    ok = ok && text(micros, time) == "2023-11-15T01:13:20.123456+03:00";
+    ok = ok && text(millis, time) == "01:13:20.123";
+    ok = ok && text(plain, time) == "01:13:20";
+    // the cached second is replaced when the next one starts and when the time goes back
+    ok = ok && text(nanos, second + 999999999) == "2023-11-15T01:13:20.999999999+03:00";
+    ok = ok && text(nanos, second + 1000000000) == "2023-11-15T01:13:21.000000000+03:00";
+    ok = ok && text(nanos, second + 86400000000000LL) == "2023-11-16T01:13:20.000000000+03:00";
+    ok = ok && text(nanos, second - 1) == "2023-11-15T01:13:19.999999999+03:00";
+    ok = ok && nanos.get_utc_offset() == 3 * 3600 && millis.shown_time(time) == second + 123000000;
+
+    // a negative offset with minutes, kept by set_fixed_offset after the zone changes
+    setenv("TZ", "XST+03:30", 1);
+    tzset();
+    timestamp_engine negative({iso8601_layout, seconds_precision, realtime_clock});
+    ok = ok && text(negative, time) == "2023-11-14T18:43:20-03:30";
+    negative.set_fixed_offset(true);
+    setenv("TZ", "UTC", 1);
+    tzset();
+    ok = ok && text(negative, time + 1000000000) == "2023-11-14T18:43:21-03:30";
+
+    if (old_zone == nullptr) {
+        unsetenv("TZ");
+    } else {
+        setenv("TZ", saved.c_str(), 1);
+    }
+    tzset();
+    std::cout << "timestamp engine: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_log_type_from_name() {
+    static_assert(log_type_from_name("WARN") == warn_log_type, "level names are resolved at compile time");
+    const char* upper[] = {"DEBUG", "INFO", "WARN", "ERROR", "CRITICAL"};
+    const char* lower[] = {"debug", "info", "warn", "error", "critical"};
+    const log_type levels[] = {debug_log_type, info_log_type, warn_log_type, error_log_type,
+                               critical_log_type};
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        ok = ok && log_type_from_name(upper[i]) == levels[i] &&
+             log_type_from_name(lower[i], true) == levels[i];
+        // the other case, a cut name and a longer name are not levels
+        ok = ok && log_type_from_name(lower[i]) == _unknown_log_type &&
+             log_type_from_name(upper[i], true) == _unknown_log_type;
+        const std::string name = upper[i];
+        ok = ok && log_type_from_name(name.substr(0, name.size() - 1)) == _unknown_log_type &&
+             log_type_from_name(name + "S") == _unknown_log_type;
+    }
+    for (const char* other : {"", "WARNING", "FATAL", "DEBUF", "Info", "ERRORS", "CRITICAl"}) {
+        ok = ok && log_type_from_name(other) == _unknown_log_type;
+    }
+    std::cout << "log type from name: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+bool test_backpressure_policies() {
+    const std::string path = make_test_file("logger_test_backpressure.log");
+    const size_t capacity = 4;
+    bool ok = true;
+    size_t queued = 0;
+    for (const backpressure_policy policy : {drop_below_level_policy, drop_oldest_policy}) {
+        std::filesystem::remove(path);
+        logger log(path, debug_log_type);
+        log.run_logger();
+        {
+            // the writer is held in the first record until the queue is full
+            std::atomic<bool> entered{false};
+            std::atomic<bool> release{false};
+            const auto handler = [&](const async_record&, const LoggerReturn) {
+                if (!entered.exchange(true)) {
+                    while (!release) {
+                        std::this_thread::yield();
+                    }
+                }
+            };
+            async_logger async_log(log, capacity, policy, warn_log_type, handler);
+            async_log.put_log("first", info_log_type);
+            while (!entered) {
+                std::this_thread::yield();
+            }
+            if (policy == drop_below_level_policy) {
+                // a full queue drops records below warn at once, an error record waits for space
+                LoggerReturn put = LOG_BUFFERED_LOGGER;
+                while (put == LOG_BUFFERED_LOGGER) {
+                    put = async_log.put_log("queued " + std::to_string(queued), info_log_type);
+                    queued += put == LOG_BUFFERED_LOGGER ? 1 : 0;
+                }
+                ok = ok && put == LOG_DROPPED_LOGGER && queued >= capacity &&
+                     async_log.put_log("debug", debug_log_type) == LOG_DROPPED_LOGGER;
+                std::thread waiting([&] { async_log.put_log("error", error_log_type); });
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                release = true;
+                waiting.join();
+            } else {
+                // a full queue makes the writer drop its oldest record for the new one
+                for (size_t i = 0; i < queued; ++i) {
+                    const LoggerReturn put = async_log.put_log("queued " + std::to_string(i), info_log_type);
+                    ok = ok && put == LOG_BUFFERED_LOGGER;
+                }
+                std::thread waiting([&] { async_log.put_log("newest", info_log_type); });
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                release = true;
+                waiting.join();
+            }
+        }
+        const logger_stats stats = log.get_stats();
+        const uint64_t dropped = stats.levels[debug_log_type].dropped + stats.levels[info_log_type].dropped;
+        log.stop_logger();
+        std::vector<std::string> expected = {"[INFO] first"};
+        for (size_t i = policy == drop_oldest_policy ? 1 : 0; i < queued; ++i) {
+            expected.push_back("[INFO] queued " + std::to_string(i));
+        }
+        expected.push_back(policy == drop_oldest_policy ? "[INFO] newest" : "[ERROR] error");
+        ok = ok && read_log_lines(path) == expected && dropped == (policy == drop_oldest_policy ? 1U : 2U);
+    }
+    std::filesystem::remove(path);
+    std::cout << "backpressure policies: " << (ok ? "match" : "do not match") << std::endl;
+    return ok;
+}
+
+/**
+ * @brief Tests of the logger library.
+ *
+ * Runs every test and prints the result in the same way as main_test.
+ *
+ * @return 0 if all tests passed, otherwise 1
+ */
+int main() {
+    bool ok = true;
+    ok = test_put_log_no_allocations() && ok;
+    ok = test_level_macros_lazy() && ok;
+    ok = test_format_records() && ok;
+    ok = test_binary_round_trip() && ok;
+    ok = test_binary_failed_write() && ok;
+    ok = test_corrupted_record() && ok;
+    ok = test_rotation() && ok;
+    ok = test_sinks() && ok;
+    ok = test_thread_staging() && ok;
+    ok = test_io_backends() && ok;
+    ok = test_mmap_ring() && ok;
+    ok = test_crash_handler() && ok;
+    ok = test_stats() && ok;
+    ok = test_structured_records() && ok;
+    ok = test_log_scan() && ok;
+    ok = test_bulk_records() && ok;
+    ok = test_rate_limits() && ok;
+    ok = test_payload_pool() && ok;
+    ok = test_writer_pool() && ok;
+    ok = test_log_index() && ok;
+    ok = test_index_midnight() && ok;
+    ok = test_durable_commit() && ok;
+    ok = test_flush_timer() && ok;
+    ok = test_full_queue_wait() && ok;
+    ok = test_timestamp_engine() && ok;
+    ok = test_log_type_from_name() && ok;
+    ok = test_backpressure_policies() && ok;
+
+    if (ok) {
+        std::cout << "\033[32mTEST PASSED!\033[0m" << std::endl;
+    } else {
+        std::cout << "\033[31mTEST FAILED!\033[0m" << std::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,408 @@
+#ifndef IO_H
+#define IO_H
+#include <iostream>
+#endif
+
+#ifndef TEST_STD_H
+#define TEST_STD_H
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <vector>
+#endif
+
+#ifndef SOCKET_H
+#define SOCKET_H
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#ifndef PROCESS_H
+#define PROCESS_H
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <csignal>
+#endif
+
+#ifndef LOGGER_H
+#include "logger.h"
+#endif
+
+#ifndef LOG_SCAN_H
+#include "log_scan.h"
+#endif
+
+#ifndef LOGGER_TEST_H
+#define LOGGER_TEST_H
+
+/**
+ * @brief Create an empty log file for a test.
+ *
+ * @param[in] name file name in the temporary directory.
+ *
+ * @return path to the created file
+ */
+std::string make_test_file(const std::string& name);
+
+/**
+ * @brief Read a log file without timestamps.
+ *
+ * @param[in] path path to the log file.
+ *
+ * @return lines of the file, each without the part after the last space
+ */
+std::vector<std::string> read_log_lines(const std::string& path);
+
+/**
+ * @brief Count heap allocations of steady-state logging.
+ *
+ * Opens a logger with the given policy, writes warm-up records and then
+ * counts the operator new calls made while writing records through
+ * put_log with a string_view and with fragments.
+ *
+ * @param[in] policy flush_policy of the logger.
+ * @param[in] records number of counted records.
+ *
+ * @return number of allocations during the counted records
+ */
+size_t count_put_log_allocations(const flush_policy& policy, const size_t records);
+
+/**
+ * @brief Recurse until the stack overflows (SIGSEGV).
+ *
+ * @param[in] depth depth of the call.
+ *
+ * @return never returns while the stop depth is not reached
+ */
+int overflow_stack(const int depth);
+
+/**
+ * @brief Test: steady-state logging does not allocate.
+ *
+ * Checks the unbuffered and the buffered write modes.
+ *
+ * @return true if there were no allocations
+ */
+bool test_put_log_no_allocations();
+
+/**
+ * @brief Test: level macros do not evaluate filtered messages.
+ *
+ * The message argument of LOGGER_* has a side effect, which must
+ * happen only for the levels the logger accepts.
+ *
+ * @return true if only accepted records evaluated the message
+ */
+bool test_level_macros_lazy();
+
+/**
+ * @brief Test: formatted records of logger and async_logger.
+ *
+ * async_logger queues the format string and encoded arguments,
+ * the text is rendered by the writer thread.
+ *
+ * @return true if the file contains the expected text
+ */
+bool test_format_records();
+
+/**
+ * @brief Test: binary records decode to the text layout.
+ *
+ * Writes plain and formatted records in binary_format over two sessions
+ * (one format buffer is reused with new contents) and compares the decoded
+ * text with the expected lines.
+ *
+ * @return true if the decoded text matches
+ */
+bool test_binary_round_trip();
+
+/**
+ * @brief Test: binary log after a failed write.
+ *
+ * Loses the first binary_format write (the session header and the format
+ * definition) under a file size limit of 0, writes more records and checks
+ * that they decode. Records without a leading session header must be corrupt.
+ *
+ * @return true if the records after the failed write decode
+ */
+bool test_binary_failed_write();
+
+/**
+ * @brief Test: corrupted format arguments are not read past their end.
+ *
+ * Renders records with a too long string, a cut off integer and an unknown
+ * argument type, and JSON fields cut off in the middle of a value.
+ *
+ * @return true if the damaged arguments are rendered as {?} or dropped
+ */
+bool test_corrupted_record();
+
+/**
+ * @brief Test: size rotation with compression and retention.
+ *
+ * Writes numbered records with a small max_size, then checks that only
+ * keep_files compressed files are left and that they and the current file
+ * hold the newest records without gaps. A failed rename must continue the
+ * same file with an index covering all of it.
+ *
+ * @return true if the rotated files are as expected
+ */
+bool test_rotation();
+
+/**
+ * @brief Test: records are passed to the sinks by their thresholds.
+ *
+ * A memory_sink at warn, an async_sink in front of a memory_sink and
+ * a socket_sink at info must get the same text as the file. An oversized
+ * datagram must not close the socket, a memory_sink wrap must cut only
+ * a record that is really cut.
+ *
+ * @return true if every sink got the expected records
+ */
+bool test_sinks();
+
+/**
+ * @brief Test: thread staging buffers keep every record of exited threads.
+ *
+ * Producer threads write numbered records through thread_staging and exit
+ * before the async_logger is destroyed. Every record must be in the file
+ * and the records of each thread must keep their order.
+ *
+ * @return true if no record is lost or reordered within a thread
+ */
+bool test_thread_staging();
+
+/**
+ * @brief Test: every I/O backend writes the same file.
+ *
+ * Each backend appends numbered records in two sessions through async_logger.
+ * The file must hold all records in order and its size must not include
+ * the preallocated space. A write that fails under a file size limit of 0
+ * must be reported by put_log or flush and by the next sync, then cleared.
+ *
+ * @return true if every backend wrote the expected file
+ */
+bool test_io_backends();
+
+/**
+ * @brief Test: the mmap ring file keeps the newest records after a crash.
+ *
+ * A child process writes numbered records to a small ring file and is killed
+ * without closing the logger. The records rebuilt from the file must be
+ * the newest ones without gaps. A record starting right at the cursor of a
+ * wrapped ring is kept, a partly overwritten one is skipped.
+ *
+ * @return true if the newest records survived
+ */
+bool test_mmap_ring();
+
+/**
+ * @brief Test: the crash handler writes the queued records on a fatal signal.
+ *
+ * A child process logs numbered records from several threads through async_logger
+ * with a large logger buffer and crashes while the records are still queued:
+ * with abort on the main thread (the writer drains the queue) and with SIGSEGV
+ * on the writer thread (the records are written from the signal handler), in
+ * the text, JSON and logfmt layouts. The file must hold every record in order
+ * and the fatal signal record last, the child must end with the same signal.
+ * A writer stuck past the drain timeout keeps its queue: nothing is written
+ * from the handler next to it. A stack overflow of the thread that set the
+ * handler must still write the buffered records (alternate signal stack).
+ *
+ * @return true if no record was lost in every case
+ */
+bool test_crash_handler();
+
+/**
+ * @brief Test: the metrics count every record once.
+ *
+ * Records at filtered and accepted levels are logged directly and from several
+ * threads through async_logger, then through a small dropping queue. The entry
+ * counters must match the calls, every accepted record must be counted as
+ * written, the byte counter must match the file size and the sidecar file must
+ * hold the last snapshot. Two async_loggers one after another on one logger
+ * must not double count, and a record the logger level rejects after the
+ * async_logger filter must be counted as filtered.
+ *
+ * @return true if the counters match
+ */
+bool test_stats();
+
+/**
+ * @brief Test: structured records in every text layout.
+ *
+ * The same plain, formatted and field records are written directly and through
+ * async_logger with text_format, json_format and logfmt_format and compared
+ * with the expected lines without the time. json_escape is checked with the
+ * special byte at every position of strings longer than one SIMD block.
+ *
+ * @return true if all records and escapes match
+ */
+bool test_structured_records();
+
+/**
+ * @brief Test: log scanning and filtering.
+ *
+ * A mapped log of text, JSON and logfmt lines larger than scan_chunk_size is
+ * filtered by level, time range and substring with one and four threads and
+ * compared with the lines selected while the log was generated. scan_byte and
+ * scan_text are checked with the match at every position around the SIMD blocks.
+ *
+ * @return true if all selections and searches match
+ */
+bool test_log_scan();
+
+/**
+ * @brief Test: blocks of entries queued with async_logger::put_bulk.
+ *
+ * Blocks of mixed levels are queued with a level change between them through
+ * the shared queue and the staging buffers; the file must hold the entries
+ * above the level in order, and the counters must count every entry.
+ *
+ * @return true if the records and the counters match
+ */
+bool test_bulk_records();
+
+/**
+ * @brief Test: sampling, rate limiting and repeat collapsing of call sites.
+ *
+ * A flood of identical messages is collapsed into one record and a repeat
+ * report, a flood of distinct messages is cut to the burst of its call site
+ * and reported with the next written record, the sampled levels keep their
+ * share of the records; the file and the counters are checked for each.
+ * The repeats of a flood that stops are written by the writer once collapse_window
+ * has passed, the repeats at the end of a flood when the async_logger stops;
+ * new limits at the address of destroyed ones get none of their reports.
+ *
+ * @return true if the records and the counters match
+ */
+bool test_rate_limits();
+
+/**
+ * @brief Test: payload_pool blocks and the memory cap of async_logger.
+ *
+ * The pool refuses a slab above its cap, reuses the freed blocks and cuts a
+ * free slab for another class; an async_logger with a cap writes every record
+ * under block_policy with the blocks reused, a record of another class after
+ * one class has filled the cap, and drops a record larger than the cap.
+ *
+ * @return true if the records and the counters match
+ */
+bool test_payload_pool();
+
+/**
+ * @brief Test: several async_logger instances written by the workers of one writer_pool.
+ *
+ * While a worker is held in a slow status handler, the lane queued behind it
+ * must be stolen by the other worker. Then producer threads write to every
+ * file at once through small queues; every file must hold the records of
+ * each producer in order. A crash drain of a lane a worker holds must not stop
+ * that worker from writing another lane.
+ *
+ * @return true if the records and the counters match
+ */
+bool test_writer_pool();
+
+/**
+ * @brief Test: sparse index of a log and the queries that use it.
+ *
+ * A log with an index is written in two sessions, with a torn entry appended
+ * to the index between them. The entries must cover whole records in order,
+ * and the level, time and combined queries over the index ranges must select
+ * the same lines as a scan of the whole file while scanning less of it.
+ * The index copied along with the log does not belong to the copy.
+ *
+ * @return true if the entries and the selected lines match
+ */
+bool test_log_index();
+
+/**
+ * @brief Test: index queries around midnight.
+ *
+ * An index of three blocks before, across and after midnight is built by hand
+ * for the time and the ISO-8601 layouts. Bounds after or before midnight and a
+ * range of times of day across it must skip the blocks outside them and select
+ * the same lines as a scan of the whole file.
+ *
+ * @return true if the selected lines and the scanned blocks match
+ */
+bool test_index_midnight();
+
+/**
+ * @brief Test: group commit of durable records.
+ *
+ * Producer threads put records with put_durable at once; every record must
+ * be reported durable and be in the file before the async_logger is
+ * destroyed, with at most one sync per record. The sequence numbers, a
+ * writer_pool and thread_staging (no sequence numbers) are checked too.
+ * Every record acknowledged by put_durable must be in the file while flood
+ * threads fill a queue of 4 records with drop_oldest_policy.
+ * With a file size limit of 0 two syncs fail with a successful one between
+ * them; after a later sync succeeds the records of both failed syncs must
+ * still be reported as failed. A stream backend
+ * opened again without close must sync the new file.
+ *
+ * @return true if the records and the counters match
+ */
+bool test_durable_commit();
+
+/**
+ * @brief Test: the flush interval of an idle async_logger.
+ *
+ * A record below the flush level must stay in the logger buffer right after
+ * it is written and reach the file by the timer of the writer, without
+ * another record or a flush call.
+ *
+ * @return true if the record is written on time
+ */
+bool test_flush_timer();
+
+/**
+ * @brief Test: producers waiting on a full async_logger queue.
+ *
+ * The writer is slowed down by its status handler; producers with
+ * block_policy and drop_oldest_policy must sleep while the queue is full
+ * instead of spinning, so their CPU time stays far below the run time.
+ *
+ * @return true if all records are written and the producers slept
+ */
+bool test_full_queue_wait();
+
+/**
+ * @brief Test: timestamp_engine output.
+ *
+ * Formats fixed points in time in fixed time zones: the ISO-8601 date with
+ * a positive and a negative UTC offset, milli, micro and nanosecond digits,
+ * the cached second replaced at the next second, the next day and a step back,
+ * and the saved offset of set_fixed_offset.
+ *
+ * @return true if every timestamp matches
+ */
+bool test_timestamp_engine();
+
+/**
+ * @brief Test: log_type_from_name.
+ *
+ * Every level name in upper and lower case must give its level, names in
+ * the other case, cut or longer names and other words must not.
+ *
+ * @return true if every name is resolved as expected
+ */
+bool test_log_type_from_name();
+
+/**
+ * @brief Test: drop_below_level_policy and drop_oldest_policy.
+ *
+ * The writer is held in the first record while the queue is filled.
+ * drop_below_level_policy must drop info and debug records at once and let
+ * an error record wait; drop_oldest_policy must drop the oldest queued
+ * record for the new one. The file and the dropped counters are checked.
+ *
+ * @return true if the expected records are written and dropped
+ */
+bool test_backpressure_policies();
+#endif
@@ -0,0 +1,120 @@
+#include "logscan.h"
+
+#include <cctype>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+bool parse_scan_levels(const std::string& list, const bool minimum, unsigned& levels) {
+    levels = 0;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        std::string name = list.substr(start, comma - start);
+        for (char& symbol : name) {
+            symbol = static_cast<char>(std::toupper(static_cast<unsigned char>(symbol)));
+        }
+
+        const int found = log_type_from_name(name);
+        if (found < 0 || (minimum && comma != list.size())) return false;
+        levels |= minimum ? scan_all_levels & ~((1U << found) - 1) : 1U << found;
+        start = comma + 1;
+    }
+    return true;
+}
+
+bool parse_scan_options(const int argc, const char* argv[], scan_filter& filter, size_t& threads,
+                        bool& count_only, bool& use_index) {
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t equals = arg.find('=');
+        const std::string name = arg.substr(0, equals);
+        const std::string value = equals == std::string::npos ? std::string() : arg.substr(equals + 1);
+        bool ok = true;
+        if (name == "--level" || name == "--levels") {
+            ok = parse_scan_levels(value, name == "--level", filter.levels);
+        } else if (name == "--from") {
+            filter.from = value;
+        } else if (name == "--to") {
+            filter.to = value;
+        } else if (name == "--grep") {
+            ok = value.find('\n') == std::string::npos;
+            filter.substring = value;
+        } else if (name == "--threads") {
+            ok = !value.empty() && value.find_first_not_of("0123456789") == std::string::npos;
+            threads = ok ? std::stoul(value) : 0;
+        } else if (arg == "--count") {
+            count_only = true;
+        } else if (arg == "--no-index") {
+            use_index = false;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "\033[31mWrong option: " << arg << "\033[0m" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Log scanner.
+ *
+ * Maps a text, JSON or logfmt log file into memory and prints the lines that
+ * match all the given conditions, in the order of the file. Line ends, level
+ * tags and the --grep text are searched with AVX2/SSE2, the file is split into
+ * parts at line boundaries that are scanned on several threads.
+ * Times are compared as text: "12:30:00" or "2024-05-01T12:30", --to may be a
+ * prefix; a time without a date is compared with the time of day of the lines,
+ * --from=23:00 --to=01:00 selects the hours across midnight.
+ * If the log has an index (<log file>.idx, logger::set_index), only the blocks
+ * that may hold selected lines and the bytes after the index are scanned,
+ * --no-index scans the whole file.
+ *
+ * Try it: in build/bin directory run this command(bash):
+ * ./logscan app.log --level=warn --from=12:00 --to=12:30 --grep=timeout
+ *
+ * @param[in] argc count of console arguments.
+ * @param[in] argv argv[1] - log file, then the options (see parse_scan_options).
+ *
+ * @return 0 on success, -1 if the options are wrong or the file cannot be read
+ */
+int main(const int argc, const char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Too few arguments";
+        return -1;
+    }
+
+    scan_filter filter;
+    size_t threads = 0;
+    bool count_only = false;
+    bool use_index = true;
+    if (!parse_scan_options(argc, argv, filter, threads, count_only, use_index)) {
+        return -1;
+    }
+
+    mapped_file file;
+    if (!file.open(argv[1])) {
+        std::cout << "Input file not valid" << std::endl;
+        return -1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    std::ostream* out = count_only ? nullptr : &std::cout;
+    std::vector<index_entry> entries;
+    scan_stats stats;
+    if (use_index && load_log_index(argv[1], file.size(), entries)) {
+        const std::vector<scan_range> ranges = index_ranges(entries, file.size(), filter);
+        stats = scan_log_ranges(file.data(), ranges, filter, threads, out);
+    } else {
+        stats = scan_log(file.data(), file.size(), filter, threads, out);
+    }
+    if (count_only) {
+        std::cout << stats.matched << std::endl;
+    }
+    std::cout.flush();
+    return std::cout.good() ? 0 : -1;
+}
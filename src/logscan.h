@@ -0,0 +1,47 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef IO_H
+#define IO_H
+#include <iostream>
+#endif
+
+#ifndef LOG_SCAN_H
+#include "log_scan.h"
+#endif
+
+#ifndef LOGSCAN_H
+#define LOGSCAN_H
+
+/**
+ * @brief Level bits of a list of levels.
+ *
+ * @param[in] list level names separated by commas: debug,info,warn,error,critical
+ * (any case).
+ * @param[in] minimum true - the list is one level, it and all higher levels are selected.
+ * @param[out] levels bits for scan_filter::levels.
+ *
+ * @return false if a name is not a level
+ */
+bool parse_scan_levels(const std::string& list, const bool minimum, unsigned& levels);
+
+/**
+ * @brief Read the options of logscan.
+ *
+ * --level=<minimum level>, --levels=<list>, --from=<time>, --to=<time>,
+ * --grep=<text>, --threads=<count>, --count, --no-index.
+ *
+ * @param[in] argc count of console arguments.
+ * @param[in] argv console arguments, argv[1] is the file.
+ * @param[out] filter conditions.
+ * @param[out] threads number of threads, 0 - one per core.
+ * @param[out] count_only true - print only the number of selected lines.
+ * @param[out] use_index false - the index of the log is not used.
+ *
+ * @return false and an error message on std::cerr if an option is wrong
+ */
+bool parse_scan_options(const int argc, const char* argv[], scan_filter& filter, size_t& threads,
+                        bool& count_only, bool& use_index);
+#endif
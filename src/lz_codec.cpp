@@ -0,0 +1,196 @@
+#include "lz_codec.h"
+
+#include <cstring>
+#include <vector>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// number of bits of the match finder hash
+static constexpr int hash_bits = 14;
+
+// shortest match
+static constexpr size_t min_match = 4;
+
+/**
+ * @brief Read 4 bytes.
+ *
+ * @param[in] pos position.
+ *
+ * @return 4 bytes as a number
+ */
+static uint32_t _read32(const char* pos) {
+    uint32_t result;
+    std::memcpy(&result, pos, sizeof(result));
+    return result;
+}
+
+/**
+ * @brief Write a length that did not fit in the token nibble.
+ *
+ * @param[out] out compressed data.
+ * @param[in] length length minus 15.
+ */
+static void _put_length(std::string& out, size_t length) {
+    while (length >= 255) {
+        out += static_cast<char>(255);
+        length -= 255;
+    }
+    out += static_cast<char>(length);
+}
+
+/**
+ * @brief Read a continued length.
+ *
+ * @param[in] pos position, moved past the length.
+ * @param[in] end end of the data.
+ * @param[out] length length is added here.
+ *
+ * @return false if the data ended
+ */
+static bool _get_length(const unsigned char*& pos, const unsigned char* end, size_t& length) {
+    bool more = true;
+    while (more && pos < end) {
+        length += *pos;
+        more = *pos++ == 255;
+    }
+    return !more;
+}
+
+/**
+ * @brief Write one sequence.
+ *
+ * @param[out] out compressed data.
+ * @param[in] literals literals.
+ * @param[in] literal_size number of literals.
+ * @param[in] offset match offset, 0 - last sequence without a match.
+ * @param[in] match_size match length.
+ */
+static void _put_sequence(std::string& out, const char* literals, const size_t literal_size,
+                          const size_t offset, const size_t match_size) {
+    const size_t match_code = offset == 0 ? 0 : match_size - min_match;
+    const size_t literal_code = literal_size < 15 ? literal_size : 15;
+    out += static_cast<char>((literal_code << 4) | (match_code < 15 ? match_code : 15));
+    if (literal_size >= 15) {
+        _put_length(out, literal_size - 15);
+    }
+    out.append(literals, literal_size);
+    if (offset != 0) {
+        out += static_cast<char>(offset & 0xFF);
+        out += static_cast<char>(offset >> 8);
+        if (match_code >= 15) {
+            _put_length(out, match_code - 15);
+        }
+    }
+}
+
+void lz_compress_block(const char* in, const size_t size, std::string& out) {
+    std::vector<int32_t> table(size_t(1) << hash_bits, -1);
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + min_match <= size) {
+        const uint32_t value = _read32(in + pos);
+        const uint32_t hash = (value * 2654435761u) >> (32 - hash_bits);
+        const int32_t candidate = table[hash];
+        table[hash] = static_cast<int32_t>(pos);
+        if (candidate >= 0 && pos - candidate <= 0xFFFF && _read32(in + candidate) == value) {
+            size_t length = min_match;
+            while (pos + length < size && in[candidate + length] == in[pos + length]) {
+                ++length;
+            }
+            _put_sequence(out, in + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+        } else {
+            ++pos;
+        }
+    }
+    _put_sequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+bool lz_decompress_block(const char* in, const size_t size, char* out, const size_t raw_size) {
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(in);
+    const unsigned char* end = pos + size;
+    size_t written = 0;
+    bool ok = true;
+    bool done = false;
+    while (ok && !done && pos < end) {
+        const unsigned char token = *pos++;
+        size_t literal_size = token >> 4;
+        if (literal_size == 15) {
+            ok = _get_length(pos, end, literal_size);
+        }
+        if (ok && (static_cast<size_t>(end - pos) < literal_size || raw_size - written < literal_size)) {
+            ok = false;
+        }
+        if (ok) {
+            std::memcpy(out + written, pos, literal_size);
+            pos += literal_size;
+            written += literal_size;
+            done = written == raw_size;
+        }
+        if (ok && !done) {
+            size_t match_size = token & 0x0F;
+            size_t offset = 0;
+            if (end - pos < 2) {
+                ok = false;
+            } else {
+                offset = pos[0] | (static_cast<size_t>(pos[1]) << 8);
+                pos += 2;
+            }
+            if (ok && match_size == 15) {
+                ok = _get_length(pos, end, match_size);
+            }
+            match_size += min_match;
+            if (ok && (offset == 0 || offset > written || raw_size - written < match_size)) {
+                ok = false;
+            }
+            for (size_t i = 0; ok && i < match_size; ++i) {
+                out[written] = out[written - offset];
+                ++written;
+            }
+        }
+    }
+    return ok && written == raw_size;
+}
+
+void lz_compress(const std::string& data, std::string& out) {
+    out.append(lz_magic, sizeof(lz_magic));
+    for (size_t start = 0; start < data.size(); start += lz_block_size) {
+        const size_t raw_size = data.size() - start < lz_block_size ? data.size() - start : lz_block_size;
+        const size_t header = out.size();
+        out.append(2 * sizeof(uint32_t), '\0');
+        lz_compress_block(data.data() + start, raw_size, out);
+        const uint32_t sizes[2] = {static_cast<uint32_t>(raw_size),
+                                   static_cast<uint32_t>(out.size() - header - 2 * sizeof(uint32_t))};
+        std::memcpy(&out[header], sizes, sizeof(sizes));
+    }
+}
+
+bool lz_is_compressed(const std::string& data) {
+    return data.size() >= sizeof(lz_magic) &&
+           data.compare(0, sizeof(lz_magic), lz_magic, sizeof(lz_magic)) == 0;
+}
+
+bool lz_decompress(const std::string& data, std::string& out) {
+    bool ok = lz_is_compressed(data);
+    size_t pos = sizeof(lz_magic);
+    while (ok && pos < data.size()) {
+        uint32_t sizes[2] = {0, 0};
+        if (data.size() - pos < sizeof(sizes)) {
+            ok = false;
+        } else {
+            std::memcpy(sizes, data.data() + pos, sizeof(sizes));
+            pos += sizeof(sizes);
+        }
+        if (ok && (sizes[0] > lz_block_size || data.size() - pos < sizes[1])) {
+            ok = false;
+        }
+        if (ok) {
+            const size_t start = out.size();
+            out.resize(start + sizes[0]);
+            ok = lz_decompress_block(data.data() + pos, sizes[1], &out[start], sizes[0]);
+            pos += sizes[1];
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,74 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+// Magic of a compressed file
+constexpr char lz_magic[4] = {'I', 'L', 'Z', '1'};
+
+// Maximum amount of input compressed as one block
+constexpr size_t lz_block_size = 1 << 20;
+
+/**
+ * @brief Compress one block (LZ4-style).
+ *
+ * The block is a sequence of tokens: literal length and match length nibbles
+ * (15 - continued in the next bytes), literals, 16-bit match offset.
+ * The last sequence has only literals.
+ *
+ * @param[in] in input data.
+ * @param[in] size input size, not more than lz_block_size.
+ * @param[out] out compressed data is appended here.
+ */
+void lz_compress_block(const char* in, const size_t size, std::string& out);
+
+/**
+ * @brief Decompress one block.
+ *
+ * @param[in] in compressed data.
+ * @param[in] size compressed size.
+ * @param[out] out buffer of raw_size bytes.
+ * @param[in] raw_size size of the decompressed block.
+ *
+ * @return false if the data is corrupt
+ */
+bool lz_decompress_block(const char* in, const size_t size, char* out, const size_t raw_size);
+
+/**
+ * @brief Compress data into the framed format.
+ *
+ * Frame: lz_magic, then blocks of uint32 raw size, uint32 compressed size and data.
+ *
+ * @param[in] data input data.
+ * @param[out] out compressed frame is appended here.
+ */
+void lz_compress(const std::string& data, std::string& out);
+
+/**
+ * @brief Check the magic of the framed format.
+ *
+ * @param[in] data data.
+ *
+ * @return true if data starts with lz_magic
+ */
+bool lz_is_compressed(const std::string& data);
+
+/**
+ * @brief Decompress a frame.
+ *
+ * @param[in] data compressed frame.
+ * @param[out] out decompressed data is appended here.
+ *
+ * @return false if the frame is corrupt
+ */
+bool lz_decompress(const std::string& data, std::string& out);
+#endif
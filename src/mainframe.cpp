@@ -8,25 +8,8 @@ void handle_sigint(int) { interrupted = true; }
 
 // коментарии в header (.h) файле или наведитесь курсором на функцию
 
-log_type str_to_log_type(const std::string& level) {
-    log_type result = _unknown_log_type;
-    if (level == "debug") {
-        result = debug_log_type;
-    }
-    if (level == "info") {
-        result = info_log_type;
-    }
-    if (level == "warn") {
-        result = warn_log_type;
-    }
-    if (level == "error") {
-        result = error_log_type;
-    }
-    if (level == "critical") {
-        result = critical_log_type;
-    }
-
-    return result;
+log_type str_to_log_type(std::string_view level) {
+    return log_type_from_name(level, true);
 }
 
 bool s21_getline(std::istream& in, std::string& out) {
@@ -69,6 +52,15 @@ void print_logger_status(const LoggerReturn status, const std::string& command)
         case LOG_SKIPPED_LOGGER:
             std::cout << command << "\033[33mLOG_SKIPPED\033[0m";
             break;
+        case LOG_BUFFERED_LOGGER:
+            std::cout << command << "\033[32m!!LOG_BUFFERED!!\033[0m";
+            break;
+        case LOG_DROPPED_LOGGER:
+            std::cout << command << "\033[31mLOG_DROPPED\033[0m";
+            break;
+        case LOG_SUPPRESSED_LOGGER:
+            std::cout << command << "\033[33mLOG_SUPPRESSED\033[0m";
+            break;
         case FILE_CANNOT_OPEN_FOR_WRITING_LOGGER:
             std::cout << command << "\033[31mFILE_CANNOT_OPEN_FOR_WRITING\033[0m";
             break;
@@ -82,32 +74,56 @@ void print_logger_status(const LoggerReturn status, const std::string& command)
     std::cout << std::endl;
 }
 
-bool compare_lines_ignore_time(const std::string& expected, const std::string& actual) {
+bool compare_lines_ignore_time(std::string_view expected, std::string_view actual) {
     size_t pos_act = actual.find_last_of(' ');
 
-    std::string trimmed_act = (pos_act == std::string::npos) ? actual : actual.substr(0, pos_act);
+    std::string_view trimmed_act = (pos_act == std::string_view::npos) ? actual : actual.substr(0, pos_act);
 
     return expected == trimmed_act;
 }
 
+/**
+ * @brief Take the next line of a mapped file.
+ *
+ * @param[in] pos start of the line, moved past its newline.
+ * @param[in] end end of the file.
+ * @param[out] line the line without the newline.
+ *
+ * @return false if the file has no more lines
+ */
+static bool _next_line(const char*& pos, const char* end, std::string_view& line) {
+    if (pos >= end) {
+        line = std::string_view();
+        return false;
+    }
+    const char* newline = scan_byte(pos, end, '\n');
+    line = std::string_view(pos, newline - pos);
+    pos = newline == end ? end : newline + 1;
+    return true;
+}
+
 void compare_files(const std::string& expected_file, const std::string& actual_file) {
-    std::ifstream exp_fs(expected_file);
-    std::ifstream act_fs(actual_file);
+    mapped_file exp_file;
+    mapped_file act_file;
     bool ok = true;
 
-    if (!exp_fs.is_open() || !exp_fs.good() || exp_fs.fail()) {
+    if (!exp_file.open(expected_file)) {
         std::cout << "Expected file not valid" << std::endl;
         ok = false;
     }
-    if (!act_fs.is_open() || !act_fs.good() || act_fs.fail()) {
+    if (!act_file.open(actual_file)) {
         std::cout << "Output file not valid" << std::endl;
         ok = false;
     }
 
-    std::string exp_line, act_line;
+    const char* exp_pos = exp_file.data();
+    const char* exp_end = exp_pos + exp_file.size();
+    const char* act_pos = act_file.data();
+    const char* act_end = act_pos + act_file.size();
+    std::string_view exp_line, act_line;
     int line_num = 0;
-    bool exp_ok = s21_getline(exp_fs, exp_line);
-    bool act_ok = s21_getline(act_fs, act_line);
+    bool exp_ok = _next_line(exp_pos, exp_end, exp_line);
+    bool act_ok = _next_line(act_pos, act_end, act_line);
 
     while (ok && (exp_ok || act_ok)) {
         line_num++;
@@ -123,16 +139,8 @@ void compare_files(const std::string& expected_file, const std::string& actual_f
             ok = false;
         }
 
-        exp_ok = s21_getline(exp_fs, exp_line);
-        act_ok = s21_getline(act_fs, act_line);
-    }
-
-    if (act_fs.is_open()) {
-        act_fs.close();
-    }
-
-    if (exp_fs.is_open()) {
-        exp_fs.close();
+        exp_ok = _next_line(exp_pos, exp_end, exp_line);
+        act_ok = _next_line(act_pos, act_end, act_line);
     }
 
     if (ok) {
@@ -156,46 +164,26 @@ void split_info(std::string& first_part, std::string& second_part, std::string d
     }
 }
 
-void mode_setter_interface(logger& log, const std::string& log_str) {
-    if (log.set_mode(str_to_log_type(std::ref(log_str))) == _unknown_log_type) {
+void mode_setter_interface(async_logger& log, const std::string& log_str) {
+    if (log.set_mode(str_to_log_type(log_str)) == _unknown_log_type) {
         std::cout << "Log level is not recognized, the changes are not applied" << std::endl;
-    } else {
-        std::cout << "Now default: " << _log_type_to_string(log.get_mode()) << std::endl;
     }
 }
 
-void logger_thread(logger& log, std::queue<LogEntry>& queue, std::mutex& mtx, std::condition_variable& cv,
-                   const bool& shutdown) {
-    while (true) {
-        std::unique_lock<std::mutex> lock(mtx);
-        cv.wait(lock, [&] { return !queue.empty() || shutdown; });
-
-        if (shutdown && queue.empty()) break;
-
-        while (!queue.empty()) {
-            auto entry = queue.front();
-            queue.pop();
-            lock.unlock();
-
-            log_type format_type = str_to_log_type(entry.type);
-
-            if (entry.type == "$set_default") {
-                mode_setter_interface(std::ref(log), std::ref(entry.message));
-            }
-            if (entry.type != "$set_default" && format_type == _unknown_log_type) {
-                std::cout << "\033[33mUnknown log type, default value is used\033[0m\n";
-            }
-            if (entry.type != "$set_default") {
-                print_logger_status(log.put_log(entry.message, format_type), "put_log: ");
-            }
-
-            lock.lock();
+void print_async_status(const async_record& record, const LoggerReturn status) {
+    if (record.kind == set_mode_record) {
+        std::cout << "Now default: " << _log_type_to_string(record.type) << std::endl;
+    } else if (record.kind == bulk_record) {
+        print_logger_status(status, "put_bulk: " + std::to_string(record.entries.size()) + " records ");
+    } else {
+        if (record.type == _unknown_log_type) {
+            std::cout << "\033[33mUnknown log type, default value is used\033[0m\n";
         }
+        print_logger_status(status, "put_log: ");
     }
 }
 
-void input_loop(std::queue<LogEntry>& queue, std::mutex& mtx, std::condition_variable& cv,
-                std::atomic<bool>& interrupted) {
+void input_loop(async_logger& log, std::atomic<bool>& interrupted) {
     while (!interrupted) {
         std::string input;
         if (s21_getline(std::cin, input) == false || input == "exit") break;
@@ -204,13 +192,108 @@ void input_loop(std::queue<LogEntry>& queue, std::mutex& mtx, std::condition_var
         std::string message_part;
         split_info(std::ref(type_part), std::ref(message_part), ":", input);
 
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            queue.push(LogEntry{type_part, message_part});
+        if (type_part == "$set_default") {
+            mode_setter_interface(std::ref(log), std::ref(message_part));
+        } else {
+            const LoggerReturn status = log.put_log(message_part, str_to_log_type(type_part));
+            if (status != LOG_BUFFERED_LOGGER) {
+                print_logger_status(status, "put_log: ");
+            }
         }
+    }
+}
 
-        cv.notify_one();
+bulk_parse_result parse_bulk_lines(const std::string& block, const size_t end, size_t& pos,
+                                   std::vector<bulk_entry>& entries, std::string_view& value) {
+    const char* data = block.data();
+    bulk_parse_result result = bulk_parsed;
+    while (result == bulk_parsed && pos < end) {
+        const char* line = data + pos;
+        const char* newline = scan_byte(line, data + end, '\n');
+        const std::string_view text(line, newline - line);
+        pos = newline - data + (newline < data + end ? 1 : 0);
+        if (text.empty()) continue;
+
+        const size_t colon = text.find(':');
+        const bool has_type = colon != std::string_view::npos;
+        const std::string_view type_part = has_type ? text.substr(0, colon) : std::string_view();
+        const size_t message_pos = has_type ? colon + 1 : 0;
+        if (text == "exit") {
+            result = bulk_exit;
+        } else if (type_part == "$set_default") {
+            value = text.substr(message_pos);
+            result = bulk_set_default;
+        } else {
+            bulk_entry entry;
+            entry.offset = static_cast<uint32_t>(line - data + message_pos);
+            entry.size = static_cast<uint32_t>(text.size() - message_pos);
+            entry.type = str_to_log_type(type_part);
+            entries.push_back(entry);
+        }
     }
+    return result;
+}
+
+long long bulk_input_loop(async_logger& log, const int fd, std::atomic<bool>& interrupted) {
+    long long count = 0;
+    std::string block;
+    std::vector<bulk_entry> entries;
+    bool input_end = false;
+    bool stop = false;
+    while (!stop && !input_end && !interrupted) {
+        // the unfinished last line of the previous block stays at the start
+        const size_t carry = block.size();
+        block.resize(carry + bulk_block_size);
+        const ssize_t got = read(fd, block.data() + carry, bulk_block_size);
+        if (got < 0) {
+            block.resize(carry);
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        block.resize(carry + got);
+        input_end = got == 0;
+
+        // the complete lines end after the last newline, at the end of the input the last line is complete
+        size_t end = block.size();
+        if (!input_end) {
+            const void* last = memrchr(block.data() + carry, '\n', got);
+            if (last == nullptr) continue;
+            end = static_cast<const char*>(last) - block.data() + 1;
+        }
+
+        size_t pos = 0;
+        std::string_view value;
+        bulk_parse_result parsed = parse_bulk_lines(block, end, pos, entries, value);
+        while (parsed == bulk_set_default) {
+            // the entries before the level change are queued before it, in a copy of their part of the block
+            if (!entries.empty()) {
+                const uint32_t base = entries.front().offset;
+                for (bulk_entry& entry : entries) {
+                    entry.offset -= base;
+                }
+                count += entries.size();
+                log.put_bulk(block.substr(base, pos - base), std::move(entries));
+                entries.clear();
+            }
+            mode_setter_interface(log, std::string(value));
+            parsed = parse_bulk_lines(block, end, pos, entries, value);
+        }
+        stop = parsed == bulk_exit;
+
+        std::string next = block.substr(end);
+        if (!entries.empty()) {
+            count += entries.size();
+            const size_t reserve = entries.size();
+            const LoggerReturn status = log.put_bulk(std::move(block), std::move(entries));
+            if (status == LOG_DROPPED_LOGGER) {
+                print_logger_status(status, "put_bulk: ");
+            }
+            entries.clear();
+            entries.reserve(reserve);
+        }
+        block = std::move(next);
+    }
+    return count;
 }
 
 /**
@@ -222,7 +305,8 @@ void input_loop(std::queue<LogEntry>& queue, std::mutex& mtx, std::condition_var
  *
  * - incorrect path to the file or logging file itself.
  *
- * Initializing the logger, queue, and auxiliary objects.
+ * Initializing the logger, async_logger with per-thread staging buffers and writer thread,
+ * the crash handler and auxiliary objects.
  *
  * All paths must be specified relative to the program launch directory.
  * @note When defining TEST_H, testing of the expected (3 console argument)
@@ -236,26 +320,42 @@ void input_loop(std::queue<LogEntry>& queue, std::mutex& mtx, std::condition_var
  * ../../materials/test_expected.txt < ../../materials/test_input.txt
  * make sure materials/test_output.txt is empty
  *
+ * The last argument --bulk switches to the bulk input (bulk_input_loop) of the
+ * console input, --bulk=<file> of a file, for replaying large inputs:
+ * ./main app.log info --bulk=replay.txt
  *
  * @param[in] argc count of console arguments.
  * @param[in] argv array of string console arguments.
  * argv[1] - path to log file, argv[2] - log level/type,
- * if defined TEST_H - argv[3] - expected file path
+ * if defined TEST_H - argv[3] - expected file path,
+ * optional last argument --bulk or --bulk=<input file>
  *
  * @return the result of the entire program
  */
 int main(const int argc, const char* argv[]) {
+    // the arguments without --bulk
+    const bool bulk = argc > 3 && std::string_view(argv[argc - 1]).substr(0, 6) == "--bulk";
+    const int required = bulk ? argc - 1 : argc;
 #ifdef TEST_H
-    if (argc < 4) {
+    if (required < 4) {
         std::cout << "Too few arguments";
         return -1;
     }
 #else
-    if (argc < 3) {
+    if (required < 3) {
         std::cout << "Too few arguments";
         return -1;
     }
 #endif
+    int bulk_fd = STDIN_FILENO;
+    if (bulk && argv[argc - 1][6] == '=') {
+        bulk_fd = open(argv[argc - 1] + 7, O_RDONLY | O_CLOEXEC);
+        if (bulk_fd < 0) {
+            std::cout << "Input file not valid" << std::endl;
+            return -1;
+        }
+    }
+
     log_type user_log_type = str_to_log_type(argv[2]);
     if (user_log_type == _unknown_log_type) {
         std::cout << "\033[33mUnknown log type, default - info is used\033[0m\n";
@@ -275,23 +375,26 @@ int main(const int argc, const char* argv[]) {
     }
 
     std::signal(SIGINT, handle_sigint);
-    std::queue<LogEntry> queue;
-    std::mutex mtx;
-    std::condition_variable cv;
-    bool shutdown = false;
-
-    std::thread log_thread(logger_thread, std::ref(log), std::ref(queue), std::ref(mtx), std::ref(cv),
-                           std::ref(shutdown));
-    std::cout << "format: log_level:message\n\n";
-    input_loop(queue, mtx, cv, interrupted);
-
-    {
-        std::lock_guard<std::mutex> lock(mtx);
-        shutdown = true;
+    if (bulk) {
+        // a few blocks of bulk_block_size in the queue, the writer takes a whole block at a time
+        async_logger async_log(log, 16, block_policy, warn_log_type, print_async_status);
+        install_crash_handler(async_log);
+        const long long count = bulk_input_loop(async_log, bulk_fd, interrupted);
+        if (count < 0) {
+            std::cout << "\033[31mInput read error\033[0m" << std::endl;
+        } else {
+            std::cout << "bulk: " << count << " records read" << std::endl;
+        }
+        if (bulk_fd != STDIN_FILENO) {
+            close(bulk_fd);
+        }
+    } else {
+        async_logger async_log(log, 1024, block_policy, warn_log_type, print_async_status, thread_staging);
+        // records still in the staging buffers are written if the program crashes
+        install_crash_handler(async_log);
+        std::cout << "format: log_level:message\n\n";
+        input_loop(async_log, interrupted);
     }
-
-    cv.notify_one();
-    log_thread.join();
     print_logger_status(log.stop_logger(), "stop_logger: ");
 
 #ifdef TEST_H
@@ -3,13 +3,6 @@
 #include <thread>
 #endif
 
-#ifndef QUEUE_H
-#define QUEUE_H
-#include <condition_variable>
-#include <mutex>
-#include <queue>
-#endif
-
 #ifndef IO_H
 #define IO_H
 #include <iostream>
@@ -25,13 +18,16 @@
 #include "logger.h"
 #endif
 
-// Queue element
-#ifndef LOG_ENTRY_H
-#define LOG_ENTRY_H
-struct LogEntry {
-    std::string type;
-    std::string message;
-};
+#ifndef BULK_H
+#define BULK_H
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#ifndef LOG_SCAN_H
+#include "log_scan.h"
 #endif
 
 #ifndef MAINFRAME_H
@@ -47,7 +43,7 @@ void handle_sigint(int);
  * @return log_type,
  * @return _unknown_log_type  If no matches are found.
  */
-log_type str_to_log_type(const std::string& level);
+log_type str_to_log_type(std::string_view level);
 
 /**
  * @brief custom std::getline.
@@ -82,11 +78,13 @@ void print_logger_status(const LoggerReturn status, const std::string& command);
  *
  * @return true if the strings are equal, otherwise false.
  */
-bool compare_lines_ignore_time(const std::string& expected, const std::string& actual);
+bool compare_lines_ignore_time(std::string_view expected, std::string_view actual);
 
 /**
  * @brief compare files line by line.
  *
+ * Both files are mapped into memory (mapped_file) and the line ends are found
+ * with scan_byte, so large logs are not read character by character.
  * Compare files line by line and print reading errors or
  * the first occurrence of unequal lines of a file in the format
  * "Line <line_num> not mach:\n
@@ -116,45 +114,87 @@ void split_info(std::string& first_part, std::string& second_part, std::string d
  * @brief log level setter interface.
  *
  * if the string containing the logging level is
- * recognized, then a new default value is set in the log class
- * and print status.
+ * recognized, then a new default value is queued for the logger,
+ * otherwise print that the level is not recognized.
  *
- * @param[in] log logger.
+ * @param[in] log async_logger.
  * @param[in] log_str level log string.
  *
  */
-void mode_setter_interface(logger& log, const std::string& log_str);
+void mode_setter_interface(async_logger& log, const std::string& log_str);
 
 /**
- * @brief Separate thread for the operations of the logger.
+ * @brief async_logger status handler.
  *
- * The loop takes a new pair of values from
- * the queue and performs operations (put_log or mode_setter_interface).
- * The loop runs until shutdown is set to true.
+ * Called on the writer thread of async_logger after each record:
+ * print the new default level or the put_log status.
  *
- * @param[in] log logger.
- * @param[in] queue queue<LogEntry>.
- * @param[in] mtx provides thread safety.
- * @param[in] cv provides waiting during an empty queue.
- * @param[in] shutdown flag that ensures that the queue is stopped after processing.
+ * @param[in] record processed record.
+ * @param[in] status processing status.
  */
-void logger_thread(logger& log, std::queue<LogEntry>& queue, std::mutex& mtx, std::condition_variable& cv,
-                   const bool& shutdown);
+void print_async_status(const async_record& record, const LoggerReturn status);
 
 /**
- * @brief Separate thread for the input from console.
+ * @brief Loop for the input from console.
  *
  * The loop runs until interrupted true is set.
  * Divides the input into the first two parts,
  * where the first is the logging level or command,
- * and the second is the message. After which it gets into the queue for the logger
+ * and the second is the message. After which it gets into the queue of async_logger,
+ * the writing itself happens on the async_logger writer thread
  * (Аfter pressing Ctrl + C is necessary to complete the cycle, that is, press Enter).
  *
- * @param[in] queue queue<LogEntry>.
- * @param[in] mtx provides thread safety.
- * @param[in] cv provides wake-up logger_thread after sending data to the queue.
+ * @param[in] log async_logger.
+ * @param[in] interrupted Stop flag when pressing Ctrl + C
+ */
+void input_loop(async_logger& log, std::atomic<bool>& interrupted);
+
+// Size of a block read by bulk_input_loop
+constexpr size_t bulk_block_size = 1024 * 1024;
+
+// Result of parsing the lines of a bulk block
+enum bulk_parse_result {
+    // all lines are parsed
+    bulk_parsed,
+    // a "$set_default" line: the entries before it are parsed, value holds the new level
+    bulk_set_default,
+    // an "exit" line: the entries before it are parsed, the input ends
+    bulk_exit
+};
+
+/**
+ * @brief Parse "level:message" lines of a block in place.
+ *
+ * Every line becomes a bulk_entry pointing at its message inside the block,
+ * nothing is copied. Lines are split at the first ':' like split_info, a line
+ * without ':' is a message of the default level, empty lines are skipped.
+ * Parsing stops after a "$set_default:<level>" or an "exit" line.
+ *
+ * @param[in] block block text.
+ * @param[in] end end of the complete lines in the block.
+ * @param[in,out] pos offset of the first line to parse, moved past the parsed lines.
+ * @param[out] entries parsed entries are appended here.
+ * @param[out] value level text of a "$set_default" line.
+ *
+ * @return why parsing has stopped
+ */
+bulk_parse_result parse_bulk_lines(const std::string& block, const size_t end, size_t& pos,
+                                   std::vector<bulk_entry>& entries, std::string_view& value);
+
+/**
+ * @brief Bulk input of "level:message" lines.
+ *
+ * Reads the input in blocks of bulk_block_size with read(2), parses the complete
+ * lines of a block in place (parse_bulk_lines) and hands the whole block with
+ * its entries to the writer with one async_logger::put_bulk. Only the unfinished
+ * last line is copied to the next block. "$set_default" and "exit" work as in
+ * input_loop. Stops at the end of the input or when interrupted is set.
+ *
+ * @param[in] log async_logger.
+ * @param[in] fd input: STDIN_FILENO or an opened file.
  * @param[in] interrupted Stop flag when pressing Ctrl + C
+ *
+ * @return number of parsed records, -1 on a read error
  */
-void input_loop(std::queue<LogEntry>& queue, std::mutex& mtx, std::condition_variable& cv,
-                std::atomic<bool>& interrupted);
+long long bulk_input_loop(async_logger& log, const int fd, std::atomic<bool>& interrupted);
 #endif
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include "payload_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// source of the payload_pool ids
+static std::atomic<uint64_t> payload_pool_ids{1};
+
+// Cache of the calling thread for one payload_pool
+struct payload_slot {
+    uint64_t owner;
+    std::shared_ptr<payload_depot> depot;
+    std::shared_ptr<payload_cache> cache;
+};
+
+void payload_slab_deleter::operator()(char* memory) const {
+    ::operator delete[](memory, static_cast<std::align_val_t>(payload_slab_size));
+}
+
+/**
+ * @brief Slab of a block.
+ *
+ * @param[in] block block of a slab.
+ *
+ * @return address of the slab (the key of payload_depot::slabs)
+ */
+static const char* _slab_base(const char* block) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(block);
+    return reinterpret_cast<const char*>(address & ~uintptr_t{payload_slab_size - 1});
+}
+
+/**
+ * @brief Number of blocks of a class in a slab.
+ *
+ * @param[in] size_class class index.
+ *
+ * @return blocks
+ */
+static size_t _slab_blocks(const size_t size_class) {
+    return payload_slab_size / (payload_min_block << size_class);
+}
+
+/**
+ * @brief Cut a slab into blocks of a class.
+ *
+ * @param[in] memory slab.
+ * @param[in] size_class class index.
+ * @param[out] blocks free blocks of the class, the new ones are appended.
+ */
+static void _cut(char* memory, const size_t size_class, std::vector<char*>& blocks) {
+    const size_t block = payload_min_block << size_class;
+    for (size_t offset = 0; offset + block <= payload_slab_size; offset += block) {
+        blocks.push_back(memory + offset);
+    }
+}
+
+/**
+ * @brief Move free blocks of a class to the depot (depot lock held).
+ *
+ * A slab whose blocks are all in the depot now is added to payload_depot::idle.
+ *
+ * @param[in] depot depot.
+ * @param[in] size_class class index.
+ * @param[in,out] blocks free blocks of a cache, the last count of them are moved.
+ * @param[in] count number of blocks.
+ */
+static void _give(payload_depot& depot, const size_t size_class, std::vector<char*>& blocks,
+                  const size_t count) {
+    for (size_t i = blocks.size() - count; i < blocks.size(); ++i) {
+        const char* base = _slab_base(blocks[i]);
+        payload_slab& slab = depot.slabs.find(base)->second;
+        if (++slab.free_blocks == _slab_blocks(size_class) && !slab.idle) {
+            slab.idle = true;
+            depot.idle.push_back(base);
+        }
+    }
+    std::vector<char*>& shared = depot.blocks[size_class];
+    shared.insert(shared.end(), blocks.end() - count, blocks.end());
+    blocks.resize(blocks.size() - count);
+}
+
+/**
+ * @brief Move free blocks of a class from the depot to a cache (depot lock held).
+ *
+ * @param[in] depot depot.
+ * @param[in] size_class class index.
+ * @param[out] blocks free blocks of a cache.
+ * @param[in] count number of blocks, at most the blocks of the class in the depot.
+ */
+static void _take(payload_depot& depot, const size_t size_class, std::vector<char*>& blocks,
+                  const size_t count) {
+    std::vector<char*>& shared = depot.blocks[size_class];
+    for (size_t i = shared.size() - count; i < shared.size(); ++i) {
+        --depot.slabs.find(_slab_base(shared[i]))->second.free_blocks;
+    }
+    blocks.insert(blocks.end(), shared.end() - count, shared.end());
+    shared.resize(shared.size() - count);
+}
+
+/**
+ * @brief Return the blocks of a cache to the depot, fold its counters and forget it.
+ *
+ * @param[in] slot cache slot.
+ */
+static void _retire(const payload_slot& slot) {
+    payload_depot& depot = *slot.depot;
+    payload_cache& cache = *slot.cache;
+    std::lock_guard<std::mutex> guard(depot.lock);
+    for (size_t i = 0; i < payload_classes; ++i) {
+        _give(depot, i, cache.blocks[i], cache.blocks[i].size());
+    }
+    const payload_counters& counters = cache.counters;
+    depot.retired.allocations += counters.allocations.load(std::memory_order_relaxed);
+    depot.retired.cache_hits += counters.cache_hits.load(std::memory_order_relaxed);
+    depot.retired.depot_refills += counters.depot_refills.load(std::memory_order_relaxed);
+    depot.retired.used_bytes += counters.allocated_bytes.load(std::memory_order_relaxed);
+    depot.retired_freed += counters.freed_bytes.load(std::memory_order_relaxed);
+    auto& caches = depot.caches;
+    caches.erase(std::find(caches.begin(), caches.end(), slot.cache));
+}
+
+// Caches of the calling thread, retired when the thread exits
+struct thread_payload_slots {
+    std::vector<payload_slot> slots;
+
+    ~thread_payload_slots() {
+        for (const payload_slot& slot : slots) {
+            _retire(slot);
+        }
+    }
+};
+
+static thread_local thread_payload_slots payload_slots;
+
+/**
+ * @brief Size class of a payload.
+ *
+ * @param[in] size payload length, from 1 to payload_max_block.
+ *
+ * @return class index, the block size is payload_min_block << index
+ */
+static size_t _size_class(const size_t size) {
+    return size <= payload_min_block ? 0 : 64 - __builtin_clzll(size - 1) - 6;
+}
+
+/**
+ * @brief Count memory taken from the heap against the cap.
+ *
+ * @param[in] depot depot.
+ * @param[in] bytes size of the new memory.
+ *
+ * @return false if the reserved memory would exceed the cap
+ */
+static bool _reserve(payload_depot& depot, const uint64_t bytes) {
+    const uint64_t cap = depot.cap.load(std::memory_order_relaxed);
+    uint64_t reserved = depot.reserved.load(std::memory_order_relaxed);
+    do {
+        if (cap != 0 && reserved + bytes > cap) {
+            return false;
+        }
+    } while (!depot.reserved.compare_exchange_weak(reserved, reserved + bytes, std::memory_order_relaxed));
+    return true;
+}
+
+/**
+ * @brief Add to a counter of the calling thread.
+ *
+ * @param[in] counter counter of the thread's own cache.
+ * @param[in] count value to add.
+ */
+static void _bump(std::atomic<uint64_t>& counter, const uint64_t count = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+
+payload_pool::payload_pool()
+    : depot(std::make_shared<payload_depot>()),
+      id(payload_pool_ids.fetch_add(1, std::memory_order_relaxed)) {}
+
+payload_pool::~payload_pool() { depot->closed.store(true, std::memory_order_release); }
+
+payload_cache& payload_pool::_local() {
+    for (const payload_slot& slot : payload_slots.slots) {
+        if (slot.owner == id) {
+            return *slot.cache;
+        }
+    }
+
+    // caches of destroyed pools are forgotten before a new one is added
+    auto& slots = payload_slots.slots;
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [](const payload_slot& slot) {
+                                   if (!slot.depot->closed.load(std::memory_order_acquire)) {
+                                       return false;
+                                   }
+                                   _retire(slot);
+                                   return true;
+                               }),
+                slots.end());
+
+    auto cache = std::make_shared<payload_cache>();
+    {
+        std::lock_guard<std::mutex> guard(depot->lock);
+        depot->caches.push_back(cache);
+    }
+    slots.push_back({id, depot, cache});
+    return *cache;
+}
+
+void payload_pool::set_cap(const size_t bytes) { depot->cap.store(bytes, std::memory_order_relaxed); }
+
+bool payload_pool::fits(const size_t size) const {
+    const uint64_t cap = depot->cap.load(std::memory_order_relaxed);
+    if (cap == 0 || size > payload_max_block) {
+        return cap == 0 || size <= cap;
+    }
+    return depot->class_slabs[_size_class(size)].load(std::memory_order_relaxed) > 0 ||
+           payload_slab_size <= cap;
+}
+
+bool payload_pool::_refill(payload_cache& cache, const size_t size_class) {
+    std::vector<char*>& free_blocks = cache.blocks[size_class];
+    std::lock_guard<std::mutex> guard(depot->lock);
+    const size_t shared = depot->blocks[size_class].size();
+    if (shared > 0) {
+        _take(*depot, size_class, free_blocks, std::min(shared, payload_cache_blocks / 2));
+        _bump(cache.counters.depot_refills);
+        return true;
+    }
+    if (!_reserve(*depot, payload_slab_size)) {
+        if (_recycle(cache, size_class)) {
+            return true;
+        }
+        depot->cap_failures.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const auto alignment = static_cast<std::align_val_t>(payload_slab_size);
+    char* memory = static_cast<char*>(::operator new[](payload_slab_size, alignment));
+    payload_slab& slab = depot->slabs[memory];
+    slab.memory.reset(memory);
+    slab.size_class = size_class;
+    depot->slab_count.fetch_add(1, std::memory_order_relaxed);
+    depot->class_slabs[size_class].fetch_add(1, std::memory_order_relaxed);
+    _cut(memory, size_class, free_blocks);
+    return true;
+}
+
+bool payload_pool::_recycle(payload_cache& cache, const size_t size_class) {
+    for (size_t i = 0; i < payload_classes; ++i) {
+        if (i != size_class) {
+            _give(*depot, i, cache.blocks[i], cache.blocks[i].size());
+        }
+    }
+    while (!depot->idle.empty()) {
+        const char* base = depot->idle.back();
+        depot->idle.pop_back();
+        payload_slab& slab = depot->slabs.find(base)->second;
+        slab.idle = false;
+        if (slab.free_blocks != _slab_blocks(slab.size_class)) {
+            // blocks of the slab were taken again since it became idle
+            continue;
+        }
+        std::vector<char*>& shared = depot->blocks[slab.size_class];
+        shared.erase(std::remove_if(shared.begin(), shared.end(),
+                                    [&](const char* block) { return _slab_base(block) == base; }),
+                     shared.end());
+        depot->class_slabs[slab.size_class].fetch_sub(1, std::memory_order_relaxed);
+        depot->class_slabs[size_class].fetch_add(1, std::memory_order_relaxed);
+        depot->recycled.fetch_add(1, std::memory_order_relaxed);
+        slab.size_class = size_class;
+        slab.free_blocks = 0;
+        _cut(slab.memory.get(), size_class, cache.blocks[size_class]);
+        return true;
+    }
+    return false;
+}
+
+char* payload_pool::allocate(const size_t size, uint32_t& capacity) {
+    payload_cache& cache = _local();
+    char* result = nullptr;
+    if (size > payload_max_block) {
+        if (_reserve(*depot, size)) {
+            result = new char[size];
+            capacity = static_cast<uint32_t>(size);
+            depot->large_count.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            depot->cap_failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        const size_t size_class = _size_class(size);
+        std::vector<char*>& free_blocks = cache.blocks[size_class];
+        if (!free_blocks.empty()) {
+            _bump(cache.counters.cache_hits);
+        } else if (!_refill(cache, size_class)) {
+            return nullptr;
+        }
+        result = free_blocks.back();
+        free_blocks.pop_back();
+        capacity = static_cast<uint32_t>(payload_min_block << size_class);
+    }
+    if (result != nullptr) {
+        _bump(cache.counters.allocations);
+        _bump(cache.counters.allocated_bytes, capacity);
+    }
+    return result;
+}
+
+void payload_pool::free(char* block, const uint32_t capacity) {
+    payload_cache& cache = _local();
+    _bump(cache.counters.freed_bytes, capacity);
+    if (capacity > payload_max_block) {
+        delete[] block;
+        depot->reserved.fetch_sub(capacity, std::memory_order_relaxed);
+        return;
+    }
+    const size_t size_class = _size_class(capacity);
+    std::vector<char*>& free_blocks = cache.blocks[size_class];
+    free_blocks.push_back(block);
+    if (free_blocks.size() > payload_cache_blocks) {
+        // half of the blocks go back to the producers through the depot
+        std::lock_guard<std::mutex> guard(depot->lock);
+        _give(*depot, size_class, free_blocks, free_blocks.size() / 2);
+    }
+}
+
+void payload_pool::release_cache() {
+    payload_cache& cache = _local();
+    std::lock_guard<std::mutex> guard(depot->lock);
+    for (size_t i = 0; i < payload_classes; ++i) {
+        _give(*depot, i, cache.blocks[i], cache.blocks[i].size());
+    }
+}
+
+payload_stats payload_pool::stats() const {
+    payload_stats result;
+    uint64_t freed = 0;
+    {
+        std::lock_guard<std::mutex> guard(depot->lock);
+        result = depot->retired;
+        freed = depot->retired_freed;
+        for (const auto& cache : depot->caches) {
+            const payload_counters& counters = cache->counters;
+            result.allocations += counters.allocations.load(std::memory_order_relaxed);
+            result.cache_hits += counters.cache_hits.load(std::memory_order_relaxed);
+            result.depot_refills += counters.depot_refills.load(std::memory_order_relaxed);
+            result.used_bytes += counters.allocated_bytes.load(std::memory_order_relaxed);
+            freed += counters.freed_bytes.load(std::memory_order_relaxed);
+        }
+    }
+    // a block freed on another thread may be counted before its allocation
+    result.used_bytes = result.used_bytes > freed ? result.used_bytes - freed : 0;
+    result.cap_bytes = depot->cap.load(std::memory_order_relaxed);
+    result.reserved_bytes = depot->reserved.load(std::memory_order_relaxed);
+    result.slabs = depot->slab_count.load(std::memory_order_relaxed);
+    result.recycled_slabs = depot->recycled.load(std::memory_order_relaxed);
+    result.large_allocations = depot->large_count.load(std::memory_order_relaxed);
+    result.cap_failures = depot->cap_failures.load(std::memory_order_relaxed);
+    return result;
+}
+
+bool payload::assign(payload_pool& pool_v, std::string_view text) {
+    clear();
+    if (text.empty()) {
+        return true;
+    }
+    char* block = pool_v.allocate(text.size(), capacity);
+    if (block == nullptr) {
+        return false;
+    }
+    std::memcpy(block, text.data(), text.size());
+    pool = &pool_v;
+    bytes = block;
+    length = static_cast<uint32_t>(text.size());
+    return true;
+}
+
+void payload::clear() {
+    if (bytes != nullptr) {
+        pool->free(bytes, capacity);
+        bytes = nullptr;
+        length = 0;
+    }
+}
@@ -0,0 +1,320 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef SYNC_H
+#define SYNC_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#endif
+
+#ifndef VECTOR_H
+#define VECTOR_H
+#include <vector>
+#endif
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+#include <atomic>
+#endif
+
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <memory>
+#endif
+
+#ifndef MAP_H
+#define MAP_H
+#include <unordered_map>
+#endif
+
+#ifndef PAYLOAD_POOL_H
+#define PAYLOAD_POOL_H
+
+// Smallest block, the size classes are 64, 128 ... 4096 bytes
+constexpr size_t payload_min_block = 64;
+
+// Number of size classes
+constexpr size_t payload_classes = 7;
+
+// Largest block, longer payloads are allocated one by one
+constexpr size_t payload_max_block = payload_min_block << (payload_classes - 1);
+
+// Memory the blocks of one class are cut from at a time
+constexpr size_t payload_slab_size = 64 * 1024;
+
+// Free blocks of one class a thread keeps, half of them go back to the shared depot above it
+constexpr size_t payload_cache_blocks = 64;
+
+// Counters of a payload_pool
+struct payload_stats {
+    // memory cap, 0 - no cap
+    uint64_t cap_bytes = 0;
+    // slabs and large payloads taken from the heap
+    uint64_t reserved_bytes = 0;
+    // blocks and large payloads held by payloads
+    uint64_t used_bytes = 0;
+    // payloads allocated
+    uint64_t allocations = 0;
+    // allocations served from the free blocks of the calling thread
+    uint64_t cache_hits = 0;
+    // batches of free blocks taken from the shared depot
+    uint64_t depot_refills = 0;
+    // slabs cut into blocks
+    uint64_t slabs = 0;
+    // free slabs cut again into blocks of another class
+    uint64_t recycled_slabs = 0;
+    // payloads longer than payload_max_block
+    uint64_t large_allocations = 0;
+    // allocations refused because of the memory cap
+    uint64_t cap_failures = 0;
+};
+
+// Counters of one thread of a payload_pool, written only by that thread
+struct payload_counters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> cache_hits{0};
+    std::atomic<uint64_t> depot_refills{0};
+    // bytes of the blocks allocated and freed by the thread, used_bytes is the difference of the sums
+    std::atomic<uint64_t> allocated_bytes{0};
+    std::atomic<uint64_t> freed_bytes{0};
+};
+
+// Free blocks and counters of one thread
+struct payload_cache {
+    std::vector<char*> blocks[payload_classes];
+    payload_counters counters;
+};
+
+// Frees a slab allocated aligned to payload_slab_size
+struct payload_slab_deleter {
+    void operator()(char* memory) const;
+};
+
+// Memory of the blocks of one class
+struct payload_slab {
+    // payload_slab_size bytes aligned to payload_slab_size, a block finds its slab by its address
+    std::unique_ptr<char[], payload_slab_deleter> memory;
+    // class the slab is cut for
+    size_t size_class = 0;
+    // blocks of the slab in payload_depot::blocks, all of them - the slab may be cut for another class
+    size_t free_blocks = 0;
+    // the slab is in payload_depot::idle
+    bool idle = false;
+};
+
+// Memory of a payload_pool shared by its threads
+struct payload_depot {
+    // protects everything except the atomics
+    std::mutex lock;
+    // free blocks returned by the threads
+    std::vector<char*> blocks[payload_classes];
+    // slabs by their address
+    std::unordered_map<const char*, payload_slab> slabs;
+    // slabs that had all their blocks in the depot, checked again when they are taken
+    std::vector<const char*> idle;
+    // caches of the threads, read for the counters
+    std::vector<std::shared_ptr<payload_cache>> caches;
+    // counters of the exited threads
+    payload_stats retired;
+    uint64_t retired_freed = 0;
+    std::atomic<uint64_t> cap{0};
+    std::atomic<uint64_t> reserved{0};
+    std::atomic<uint64_t> slab_count{0};
+    std::atomic<uint64_t> recycled{0};
+    // slabs cut for every class, fits() of a class with slabs does not need a new one
+    std::atomic<uint64_t> class_slabs[payload_classes] = {};
+    std::atomic<uint64_t> large_count{0};
+    std::atomic<uint64_t> cap_failures{0};
+    // set when the payload_pool is destroyed, the threads forget their caches
+    std::atomic<bool> closed{false};
+};
+
+/**
+ * @brief Size-class allocator of the record payloads.
+ *
+ * Blocks of 64 ... 4096 bytes are cut from 64 KB slabs. Every thread keeps
+ * its own free blocks of each class: a producer allocates from its cache without
+ * a lock, the writer frees into its cache, and full caches hand half of their
+ * blocks to the shared depot, where the producers refill from (one lock per batch).
+ * Slabs and large payloads are counted against an optional memory cap; an
+ * allocation above the cap fails instead of growing the heap. At the cap a slab
+ * whose blocks are all free in the depot is cut again for the class that needs
+ * memory, so a class that filled the cap does not starve the others. The memory
+ * is returned to the heap only when the pool is destroyed.
+ */
+class payload_pool {
+    std::shared_ptr<payload_depot> depot;
+
+    // unique id, threads find their cache by it
+    uint64_t id;
+
+    /**
+     * @brief Cache of the calling thread, registered on the first call.
+     *
+     * @return cache
+     */
+    payload_cache& _local();
+
+    /**
+     * @brief Take free blocks of a class from the depot or a new slab.
+     *
+     * @param[in] cache cache of the calling thread.
+     * @param[in] size_class class index.
+     *
+     * @return false if the depot is empty, a new slab would exceed the cap and no slab is free
+     */
+    bool _refill(payload_cache& cache, const size_t size_class);
+
+    /**
+     * @brief Cut a free slab of another class for a class (depot lock held).
+     *
+     * The free blocks of the other classes in the cache of the calling thread
+     * go to the depot first, they may complete a slab.
+     *
+     * @param[in] cache cache of the calling thread.
+     * @param[in] size_class class index.
+     *
+     * @return false if no slab has all its blocks in the depot
+     */
+    bool _recycle(payload_cache& cache, const size_t size_class);
+
+   public:
+    payload_pool();
+    ~payload_pool();
+
+    payload_pool(const payload_pool&) = delete;
+    payload_pool& operator=(const payload_pool&) = delete;
+
+    /**
+     * @brief Setter for the memory cap (any thread).
+     *
+     * The memory already taken is kept, new slabs and large payloads are refused
+     * while the reserved memory would exceed the cap.
+     *
+     * @param[in] bytes cap, 0 - no cap.
+     */
+    void set_cap(const size_t bytes);
+
+    /**
+     * @brief Check that a payload can ever be allocated under the cap (any thread).
+     *
+     * A block fits if its class has slabs already or a slab fits under the cap
+     * (a free slab of another class may be cut for it), a large payload if it
+     * alone is not larger than the cap.
+     *
+     * @param[in] size payload length.
+     *
+     * @return false if the payload can never be allocated
+     */
+    bool fits(const size_t size) const;
+
+    /**
+     * @brief Allocate a block (any thread).
+     *
+     * @param[in] size payload length, not 0.
+     * @param[out] capacity size of the block.
+     *
+     * @return the block, nullptr if the memory cap is reached
+     */
+    char* allocate(const size_t size, uint32_t& capacity);
+
+    /**
+     * @brief Free a block (any thread).
+     *
+     * @param[in] block block returned by allocate.
+     * @param[in] capacity its size.
+     */
+    void free(char* block, const uint32_t capacity);
+
+    /**
+     * @brief Return the free blocks of the calling thread to the depot.
+     *
+     * Called by the writer before it goes to sleep, so the producers can
+     * reuse the blocks it has freed.
+     */
+    void release_cache();
+
+    /**
+     * @brief Counters of all threads (any thread).
+     *
+     * @return snapshot
+     */
+    payload_stats stats() const;
+};
+
+/**
+ * @brief Text in a payload_pool block.
+ *
+ * Move-only owner of a block: the block goes back to the pool when the payload
+ * is destroyed or reassigned, on whatever thread that happens.
+ */
+class payload {
+    payload_pool* pool = nullptr;
+    char* bytes = nullptr;
+    uint32_t length = 0;
+    uint32_t capacity = 0;
+
+   public:
+    payload() = default;
+    ~payload() { clear(); }
+
+    payload(payload&& other) noexcept
+        : pool(other.pool), bytes(other.bytes), length(other.length), capacity(other.capacity) {
+        other.bytes = nullptr;
+        other.length = 0;
+    }
+
+    payload& operator=(payload&& other) noexcept {
+        if (this != &other) {
+            clear();
+            pool = other.pool;
+            bytes = other.bytes;
+            length = other.length;
+            capacity = other.capacity;
+            other.bytes = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    payload(const payload&) = delete;
+    payload& operator=(const payload&) = delete;
+
+    /**
+     * @brief Copy a text into a block of a pool.
+     *
+     * @param[in] pool_v pool.
+     * @param[in] text text.
+     *
+     * @return false if the memory cap of the pool is reached, the payload is empty then
+     */
+    bool assign(payload_pool& pool_v, std::string_view text);
+
+    /**
+     * @brief Return the block to the pool.
+     */
+    void clear();
+
+    const char* data() const { return bytes; }
+
+    size_t size() const { return length; }
+
+    bool empty() const { return length == 0; }
+
+    operator std::string_view() const { return std::string_view(bytes, length); }
+};
+#endif
@@ -0,0 +1,208 @@
+#include "rate_limit.h"
+
+#include <algorithm>
+#include <functional>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// sample_threshold of a level that keeps every record (above any 32-bit number)
+static constexpr uint64_t sample_all = uint64_t{1} << 32;
+
+// call sites that have had a limited record, in the reverse order of their first record
+static std::atomic<log_site*> site_list{nullptr};
+
+// rate_limiter::id of the next limits
+static std::atomic<uint64_t> rate_limiter_ids{1};
+
+/**
+ * @brief Random number of the calling thread (xorshift64*).
+ *
+ * @return 64-bit random number
+ */
+static uint64_t _site_random() {
+    static thread_local uint64_t state = 0;
+    if (state == 0) {
+        const auto now = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        state = (reinterpret_cast<uintptr_t>(&state) ^ now) | 1;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+rate_limiter::rate_limiter() : id(rate_limiter_ids.fetch_add(1, std::memory_order_relaxed)) {
+    for (auto& threshold : sample_threshold) {
+        threshold.store(sample_all, std::memory_order_relaxed);
+    }
+}
+
+void rate_limiter::set_policy(const rate_limit_policy& policy) {
+    const int64_t step = policy.rate > 0 ? static_cast<int64_t>(1e9 / policy.rate) : 0;
+    tolerance.store(static_cast<int64_t>(std::max(policy.burst, 1.0) * step), std::memory_order_relaxed);
+    interval.store(step, std::memory_order_relaxed);
+    for (size_t level = 0; level < stat_levels; ++level) {
+        const double share = std::clamp(policy.sample[level], 0.0, 1.0);
+        sample_threshold[level].store(static_cast<uint64_t>(share * sample_all), std::memory_order_relaxed);
+    }
+    window.store(std::chrono::nanoseconds(policy.collapse_window).count(), std::memory_order_relaxed);
+    collapse.store(policy.collapse, std::memory_order_relaxed);
+}
+
+bool rate_limiter::_take(log_site& site, const int64_t now) const {
+    const int64_t step = interval.load(std::memory_order_relaxed);
+    const int64_t limit = tolerance.load(std::memory_order_relaxed);
+    int64_t ready = site.ready.load(std::memory_order_relaxed);
+    int64_t next = 0;
+    do {
+        // every record moves the time the bucket is full again by one interval
+        next = std::max(ready, now) + step;
+        if (next - now > limit) {
+            return false;
+        }
+    } while (!site.ready.compare_exchange_weak(ready, next, std::memory_order_relaxed));
+    return true;
+}
+
+void rate_limiter::_attach(log_site& site, const int level) const {
+    if (site.owner.load(std::memory_order_relaxed) != id) {
+        site.owner.store(id, std::memory_order_relaxed);
+    }
+    if (site.level.load(std::memory_order_relaxed) != level) {
+        site.level.store(level, std::memory_order_relaxed);
+    }
+    if (!site.listed.load(std::memory_order_relaxed) &&
+        !site.listed.exchange(true, std::memory_order_relaxed)) {
+        site.next = site_list.load(std::memory_order_relaxed);
+        while (!site_list.compare_exchange_weak(site.next, &site, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+        }
+    }
+}
+
+site_decision rate_limiter::admit(log_site& site, const int level, std::string_view message,
+                                  const fmt_args* args) const {
+    site_decision decision;
+    if (level >= 0 && level < static_cast<int>(stat_levels)) {
+        const uint64_t threshold = sample_threshold[level].load(std::memory_order_relaxed);
+        if (threshold < sample_all && (_site_random() >> 32) >= threshold) {
+            decision.pass = false;
+            decision.reason = stat_sampled;
+            return decision;
+        }
+    }
+    const bool collapsing = collapse.load(std::memory_order_relaxed);
+    const bool limiting = interval.load(std::memory_order_relaxed) > 0;
+    if (!collapsing && !limiting) {
+        return decision;
+    }
+
+    _attach(site, level);
+    const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    uint64_t repeated = 0;
+    if (collapsing) {
+        uint64_t hash = std::hash<std::string_view>()(message);
+        if (args != nullptr) {
+            const std::string_view bytes(reinterpret_cast<const char*>(args->data()), args->size());
+            hash ^= std::hash<std::string_view>()(bytes) * 0x9E3779B97F4A7C15ULL;
+        }
+        if (site.last_hash.exchange(hash, std::memory_order_relaxed) == hash) {
+            if (site.repeats.fetch_add(1, std::memory_order_relaxed) == 0) {
+                site.repeat_start.store(now, std::memory_order_relaxed);
+            }
+            pending.store(true, std::memory_order_release);
+            decision.pass = false;
+            decision.reason = stat_collapsed;
+            const int64_t since = site.repeat_start.load(std::memory_order_relaxed);
+            if (now - since < window.load(std::memory_order_relaxed)) {
+                return decision;
+            }
+            // collapse_window has passed: the count of the repeats is written instead of the record
+        }
+        repeated = site.repeats.exchange(0, std::memory_order_relaxed);
+        if (!decision.pass && repeated == 0) {
+            // another thread has reported the repeats
+            return decision;
+        }
+    }
+
+    if (limiting && !_take(site, now)) {
+        // the repeats and the record are reported with the next written record of the call site
+        site.suppressed.fetch_add(repeated + (decision.pass ? 1 : 0), std::memory_order_relaxed);
+        pending.store(true, std::memory_order_release);
+        if (decision.pass) {
+            decision.pass = false;
+            decision.reason = stat_rate_limited;
+        }
+        return decision;
+    }
+    decision.repeated = repeated;
+    decision.suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    return decision;
+}
+
+void rate_limiter::take_pending(const site_report_handler& report) const {
+    for (log_site* site = site_list.load(std::memory_order_acquire); site != nullptr; site = site->next) {
+        if (site->owner.load(std::memory_order_relaxed) != id) {
+            continue;
+        }
+        site_decision held;
+        held.repeated = site->repeats.exchange(0, std::memory_order_relaxed);
+        held.suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+        if (held.repeated > 0 || held.suppressed > 0) {
+            report(site->level.load(std::memory_order_relaxed), held);
+        }
+    }
+}
+
+std::chrono::nanoseconds rate_limiter::take_due(const site_report_handler& report) const {
+    if (!pending.exchange(false, std::memory_order_acquire)) {
+        return std::chrono::nanoseconds(0);
+    }
+    const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    const int64_t step = interval.load(std::memory_order_relaxed);
+    const int64_t limit = tolerance.load(std::memory_order_relaxed);
+    const int64_t span = window.load(std::memory_order_relaxed);
+    // the earliest time a report that is left is due, 0 - none is left
+    int64_t next = 0;
+    const auto later = [&](const int64_t due) { next = next == 0 ? due : std::min(next, due); };
+    for (log_site* site = site_list.load(std::memory_order_acquire); site != nullptr; site = site->next) {
+        if (site->owner.load(std::memory_order_relaxed) != id) {
+            continue;
+        }
+        site_decision due;
+        if (site->repeats.load(std::memory_order_relaxed) > 0) {
+            const int64_t at = site->repeat_start.load(std::memory_order_relaxed) + span;
+            if (at <= now) {
+                due.repeated = site->repeats.exchange(0, std::memory_order_relaxed);
+            } else {
+                later(at);
+            }
+        }
+        if (site->suppressed.load(std::memory_order_relaxed) > 0) {
+            // _take lets a record through again once now + step - ready is within the tolerance
+            const int64_t at = site->ready.load(std::memory_order_relaxed) + step - limit;
+            if (at <= now) {
+                due.suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+            } else {
+                later(at);
+            }
+        }
+        if (due.repeated > 0 || due.suppressed > 0) {
+            report(site->level.load(std::memory_order_relaxed), due);
+        }
+    }
+    if (next == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    pending.store(true, std::memory_order_relaxed);
+    return std::chrono::nanoseconds(next - now);
+}
+
+std::string site_repeated_text(const uint64_t count) {
+    return "last message repeated " + std::to_string(count) + " times";
+}
+
+std::string site_suppressed_text(const uint64_t count) {
+    return std::to_string(count) + " messages suppressed by the rate limit";
+}
@@ -0,0 +1,228 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
+#ifndef CHRONO_H
+#define CHRONO_H
+#include <chrono>
+#endif
+
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+#include <functional>
+#endif
+
+#ifndef LOG_FORMAT_H
+#include "log_format.h"
+#endif
+
+#ifndef STATS_H
+#include "stats.h"
+#endif
+
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+// Limits of the call sites of the LOGGER_LIMITED and LOGGER_FMT_LIMITED macros
+struct rate_limit_policy {
+    // records per second one call site may write, 0 - no limit
+    double rate = 0;
+    // records a call site may write at once after a pause (token bucket size), at least 1
+    double burst = 1;
+    // share of the records written at each level (debug ... critical), from 0 to 1
+    double sample[stat_levels] = {1, 1, 1, 1, 1};
+    // identical consecutive messages of a call site are written once, then "last message repeated N times"
+    bool collapse = false;
+    // the longest time the repeats of a message are held back before their count is written
+    std::chrono::milliseconds collapse_window{1000};
+};
+
+// Decision about one record of a call site
+struct site_decision {
+    // the record is written
+    bool pass = true;
+    // why the record is not written: stat_sampled, stat_rate_limited or stat_collapsed
+    stat_entry_kind reason = stat_accepted;
+    // repeats of the previous message, "last message repeated N times" is written before the record
+    uint64_t repeated = 0;
+    // records of the call site held back since its last written record, reported before the record
+    uint64_t suppressed = 0;
+};
+
+class rate_limiter;
+
+// Receives the pending reports of a call site: its level and site_decision::repeated and suppressed
+using site_report_handler = std::function<void(const int level, const site_decision& pending)>;
+
+/**
+ * @brief State of one call site.
+ *
+ * A static object of every LOGGER_LIMITED call site. All members are atomics,
+ * so threads check the same call site without a lock. A call site is added to
+ * a global list on its first limited record and is never removed, so the object
+ * must have static storage duration.
+ */
+class log_site {
+    friend class rate_limiter;
+
+    // rate_limiter::id of the limits the call site was last checked with, its reports go to their logger
+    std::atomic<uint64_t> owner{0};
+
+    // level of the last record, the level of the pending reports
+    std::atomic<int> level{0};
+
+    // set when the call site is in the global list
+    std::atomic<bool> listed{false};
+
+    // next call site of the global list
+    log_site* next = nullptr;
+
+    // steady clock time (ns) when the token bucket is full again (GCRA theoretical arrival time)
+    std::atomic<int64_t> ready{0};
+
+    // records held back by the rate limit that are not reported yet
+    std::atomic<uint64_t> suppressed{0};
+
+    // hash of the last message
+    std::atomic<uint64_t> last_hash{0};
+
+    // repeats of the last message that are not reported yet
+    std::atomic<uint64_t> repeats{0};
+
+    // steady clock time (ns) of the first unreported repeat
+    std::atomic<int64_t> repeat_start{0};
+
+   public:
+    constexpr log_site() = default;
+
+    log_site(const log_site&) = delete;
+    log_site& operator=(const log_site&) = delete;
+};
+
+/**
+ * @brief Rate limit, sampling and repeat collapsing of the call sites.
+ *
+ * The settings are atomics read with relaxed loads, so set_policy may be called
+ * while other threads log. The checks are done on the logging thread before
+ * the record is formatted or queued.
+ */
+class rate_limiter {
+    // number of these limits, never reused: the limits of a new logger at the same address have another one
+    const uint64_t id;
+
+    // set when a call site may hold back records or repeats that are not reported yet
+    mutable std::atomic<bool> pending{false};
+
+    // time between the records of a call site, ns, 0 - no limit
+    std::atomic<int64_t> interval{0};
+
+    // burst * interval, ns
+    std::atomic<int64_t> tolerance{0};
+
+    // a record is written if a 32-bit random number is below the threshold of its level
+    std::atomic<uint64_t> sample_threshold[stat_levels];
+
+    // collapse identical consecutive messages
+    std::atomic<bool> collapse{false};
+
+    // rate_limit_policy::collapse_window, ns
+    std::atomic<int64_t> window{0};
+
+    /**
+     * @brief Take a token of the call site.
+     *
+     * @param[in] site call site.
+     * @param[in] now steady clock time, ns.
+     *
+     * @return false if the rate limit is exceeded
+     */
+    bool _take(log_site& site, const int64_t now) const;
+
+    /**
+     * @brief Remember the limits and the level of a call site, add it to the global list.
+     *
+     * @param[in] site call site.
+     * @param[in] level log_type.
+     */
+    void _attach(log_site& site, const int level) const;
+
+   public:
+    rate_limiter();
+
+    /**
+     * @brief Setter for the limits (any thread).
+     *
+     * @param[in] policy rate_limit_policy.
+     */
+    void set_policy(const rate_limit_policy& policy);
+
+    /**
+     * @brief Check a record of a call site (any thread).
+     *
+     * The record is sampled first, then compared with the previous message of
+     * the call site (if collapse is on) and then takes a token of the call site.
+     * A record held back by the rate limit is counted in site_decision::suppressed
+     * of the next written record; pending repeats are reported when the message
+     * changes or when collapse_window has passed since the first repeat.
+     *
+     * @param[in] site call site.
+     * @param[in] level log_type.
+     * @param[in] message message or format string.
+     * @param[in] args encoded format arguments, nullptr - none.
+     *
+     * @return decision
+     */
+    site_decision admit(log_site& site, const int level, std::string_view message,
+                        const fmt_args* args = nullptr) const;
+
+    /**
+     * @brief Take the pending reports of the call sites checked with these limits (any thread).
+     *
+     * The repeats that are held back and the records suppressed since the last
+     * written record of every call site are handed to report and reset; called
+     * when the logger stops so that the end of a flood is not lost.
+     *
+     * @param[in] report called for every call site with pending reports.
+     */
+    void take_pending(const site_report_handler& report) const;
+
+    /**
+     * @brief Take the reports that are due of the call sites checked with these limits (writer thread).
+     *
+     * Repeats are due when collapse_window has passed since the first one, held
+     * back records when the rate limit would let a record of the call site through
+     * again. The async_logger writer calls it when it has written the queue and
+     * sleeps until the next report is due, so the end of a flood is reported
+     * on time even if the call site does not log again.
+     *
+     * @param[in] report called for every call site with reports that are due.
+     *
+     * @return time until the next report is due, 0 if no report is pending
+     */
+    std::chrono::nanoseconds take_due(const site_report_handler& report) const;
+};
+
+/**
+ * @brief Text of a repeat report.
+ *
+ * @param[in] count number of repeats.
+ *
+ * @return "last message repeated N times"
+ */
+std::string site_repeated_text(const uint64_t count);
+
+/**
+ * @brief Text of a rate limit report.
+ *
+ * @param[in] count number of records held back.
+ *
+ * @return "N messages suppressed by the rate limit"
+ */
+std::string site_suppressed_text(const uint64_t count);
+#endif
@@ -0,0 +1,469 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <memory>
+#include <utility>
+#endif
+
+#ifndef CHRONO_H
+#define CHRONO_H
+#include <chrono>
+#endif
+
+#ifndef FUTEX_H
+#define FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <climits>
+#include <ctime>
+#endif
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+// size of the cache line, used to keep producer and consumer data apart
+constexpr size_t cache_line_size = 64;
+
+/**
+ * @brief Block on the futex word.
+ *
+ * Sleep while *word == expected, until futex_wake or the timeout.
+ *
+ * @param[in] word futex word.
+ * @param[in] expected value at which the thread goes to sleep.
+ * @param[in] timeout sleeping time limit, nullptr - no limit.
+ */
+inline void futex_wait(std::atomic<uint32_t>* word, const uint32_t expected, const timespec* timeout) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+}
+
+/**
+ * @brief Wake the threads sleeping on the futex word.
+ *
+ * @param[in] word futex word.
+ */
+inline void futex_wake(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief Round up the ring capacity to the power of two.
+ *
+ * @param[in] value value.
+ *
+ * @return the smallest power of two not less than value and 2
+ */
+inline size_t ring_capacity(const size_t value) {
+    size_t result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * @brief Sleeping of a single consumer until producers have new data.
+ *
+ * The consumer goes to sleep on a futex only after it has found its queues
+ * empty, producers pay for a system call only when the consumer is sleeping.
+ */
+class consumer_signal {
+    // consumer states for the futex word
+    enum consumer_state : uint32_t { awake_state = 0, sleeping_state = 1, notified_state = 2 };
+
+    // futex word, consumer_state
+    alignas(cache_line_size) std::atomic<uint32_t> state{awake_state};
+
+   public:
+    /**
+     * @brief Consumer sleeping with an optional time limit (consumer thread).
+     *
+     * Returns at once if notify was called since the last sleep.
+     *
+     * @param[in] empty returns true if there is nothing to consume.
+     * @param[in] timeout sleeping time limit, nullptr - no limit.
+     */
+    template <typename Empty>
+    void sleep(const Empty& empty, const timespec* timeout) {
+        uint32_t expected = awake_state;
+        if (state.compare_exchange_strong(expected, sleeping_state)) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (empty()) {
+                futex_wait(&state, sleeping_state, timeout);
+            }
+        }
+        state.store(awake_state, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wake the consumer if it is sleeping (producer, after publishing data).
+     */
+    void notify_sleeping() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (state.load(std::memory_order_relaxed) == sleeping_state) {
+            notify();
+        }
+    }
+
+    /**
+     * @brief Wake the consumer (any thread).
+     *
+     * If the consumer is not sleeping yet, its next sleep returns immediately.
+     */
+    void notify() {
+        if (state.exchange(notified_state) == sleeping_state) {
+            futex_wake(&state);
+        }
+    }
+};
+
+/**
+ * @brief Sleeping of producers until the consumer frees space.
+ *
+ * A producer that has found its queue full sleeps on a futex; the consumer
+ * pays for a system call only when a producer is sleeping.
+ */
+class producer_signal {
+    // futex word, changed by every wake-up
+    alignas(cache_line_size) std::atomic<uint32_t> epoch{0};
+
+    // number of producers about to sleep or sleeping
+    std::atomic<uint32_t> waiters{0};
+
+   public:
+    /**
+     * @brief Retry once more, then sleep with a time limit (producer).
+     *
+     * @param[in] retry attempt to put the element, returns true on success.
+     * @param[in] timeout sleeping time limit, nullptr - no limit.
+     *
+     * @return result of retry
+     */
+    template <typename Retry>
+    bool wait(const Retry& retry, const timespec* timeout) {
+        const uint32_t seen = epoch.load(std::memory_order_relaxed);
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool done = retry();
+        if (!done) {
+            futex_wait(&epoch, seen, timeout);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return done;
+    }
+
+    /**
+     * @brief Wake the sleeping producers (consumer, after freeing space).
+     */
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            epoch.fetch_add(1);
+            futex_wake(&epoch);
+        }
+    }
+};
+
+/**
+ * @brief Bounded multi-producer/single-consumer ring buffer.
+ *
+ * Any number of threads may call try_push at the same time, try_pop and wait
+ * must be called from one consumer thread only. Every cell carries its own
+ * sequence number, so producers only contend on one atomic increment and never
+ * take a lock. The consumer sleeps on a futex only after it has found the ring
+ * empty, so producers pay for a system call only when the consumer is idle.
+ *
+ * @tparam T element type, must be default constructible and move assignable.
+ */
+template <typename T>
+class mpsc_ring {
+    // ring cell, every cell occupies its own cache line(s)
+    struct alignas(cache_line_size) cell {
+        std::atomic<size_t> sequence{0};
+        T data{};
+    };
+
+    std::unique_ptr<cell[]> cells;
+    size_t mask;
+
+    // next position for producers
+    alignas(cache_line_size) std::atomic<size_t> tail{0};
+
+    // next position for the consumer, atomic only so that size() can be read by other threads
+    alignas(cache_line_size) std::atomic<size_t> head{0};
+
+    // consumer sleeping
+    consumer_signal signal;
+
+    /**
+     * @brief Consumer sleeping with an optional time limit.
+     *
+     * @param[in] timeout sleeping time limit, nullptr - no limit.
+     */
+    void _sleep(const timespec* timeout) {
+        signal.sleep([this] { return empty(); }, timeout);
+    }
+
+   public:
+    /**
+     * @brief Class mpsc_ring constructor.
+     *
+     * @param[in] capacity minimum number of elements, rounded up to the power of two.
+     */
+    explicit mpsc_ring(const size_t capacity)
+        : cells(new cell[ring_capacity(capacity)]), mask(ring_capacity(capacity) - 1) {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_ring(const mpsc_ring&) = delete;
+    mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+    /**
+     * @brief Put an element in the ring (any thread).
+     *
+     * @param[in] value element, moved into the ring on success.
+     * @param[out] position optional, the number of elements pushed before this one,
+     * the consumer takes the elements in the order of their positions.
+     *
+     * @return false if the ring is full, otherwise true
+     */
+    bool try_push(T&& value, size_t* position = nullptr) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        cell* target = nullptr;
+        while (target == nullptr) {
+            cell& current = cells[pos & mask];
+            const size_t seq = current.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    target = &current;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        target->data = std::move(value);
+        target->sequence.store(pos + 1, std::memory_order_release);
+        if (position != nullptr) {
+            *position = pos;
+        }
+
+        signal.notify_sleeping();
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest element from the ring (consumer thread).
+     *
+     * @param[out] out taken element.
+     *
+     * @return false if the ring is empty, otherwise true
+     */
+    bool try_pop(T& out) {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        cell& current = cells[pos & mask];
+        if (current.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        out = std::move(current.data);
+        current.sequence.store(pos + mask + 1, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Check the ring for emptiness (consumer thread).
+     *
+     * @return true if there is no element ready to be taken
+     */
+    bool empty() const {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        return cells[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    /**
+     * @brief Approximate number of elements (any thread).
+     *
+     * @return number of elements reserved by producers and not yet taken
+     */
+    size_t size() const {
+        const size_t pos = tail.load(std::memory_order_relaxed);
+        const size_t cur = head.load(std::memory_order_relaxed);
+        return pos > cur ? pos - cur : 0;
+    }
+
+    /**
+     * @brief Ring capacity.
+     *
+     * @return maximum number of elements
+     */
+    size_t capacity() const { return mask + 1; }
+
+    /**
+     * @brief Visit the elements ready to be taken without taking them.
+     *
+     * Nothing is moved or freed, so it can be called from a signal handler
+     * (crash handler). The result is exact only while the consumer is not running.
+     *
+     * @param[in] visit called with every element, oldest first.
+     */
+    template <typename Visit>
+    void peek(const Visit& visit) const {
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (cells[pos & mask].sequence.load(std::memory_order_acquire) == pos + 1) {
+            visit(cells[pos & mask].data);
+            ++pos;
+        }
+    }
+
+    /**
+     * @brief Wait for new elements (consumer thread).
+     *
+     * Returns when the ring is not empty or notify was called.
+     */
+    void wait() { _sleep(nullptr); }
+
+    /**
+     * @brief Wait for new elements with a time limit (consumer thread).
+     *
+     * Returns when the ring is not empty, notify was called or the time has passed.
+     *
+     * @param[in] timeout sleeping time limit.
+     */
+    void wait_for(const std::chrono::nanoseconds timeout) {
+        const timespec limit{static_cast<time_t>(timeout.count() / 1000000000),
+                             static_cast<long>(timeout.count() % 1000000000)};
+        _sleep(&limit);
+    }
+
+    /**
+     * @brief Wake the consumer (any thread).
+     *
+     * If the consumer is not sleeping yet, its next wait returns immediately.
+     */
+    void notify() { signal.notify(); }
+};
+
+/**
+ * @brief Bounded single-producer/single-consumer ring buffer.
+ *
+ * One thread calls try_push, one other thread calls try_pop. Each side keeps
+ * a cached copy of the other side's index, so the shared indices are read
+ * only when the ring looks full or empty. The ring does not wake the consumer,
+ * the owner pairs it with a consumer_signal.
+ *
+ * @tparam T element type, must be default constructible and move assignable.
+ */
+template <typename T>
+class spsc_ring {
+    std::unique_ptr<T[]> cells;
+    size_t mask;
+
+    // next position for the producer and its copy of head
+    alignas(cache_line_size) std::atomic<size_t> tail{0};
+    size_t head_cache = 0;
+
+    // next position for the consumer and its copy of tail
+    alignas(cache_line_size) std::atomic<size_t> head{0};
+    size_t tail_cache = 0;
+
+   public:
+    /**
+     * @brief Class spsc_ring constructor.
+     *
+     * @param[in] capacity minimum number of elements, rounded up to the power of two.
+     */
+    explicit spsc_ring(const size_t capacity)
+        : cells(new T[ring_capacity(capacity)]), mask(ring_capacity(capacity) - 1) {}
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    /**
+     * @brief Put an element in the ring (producer thread).
+     *
+     * @param[in] value element, moved into the ring on success.
+     *
+     * @return false if the ring is full, otherwise true
+     */
+    bool try_push(T&& value) {
+        const size_t pos = tail.load(std::memory_order_relaxed);
+        if (pos - head_cache > mask) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (pos - head_cache > mask) {
+                return false;
+            }
+        }
+        cells[pos & mask] = std::move(value);
+        tail.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest element from the ring (consumer thread).
+     *
+     * @param[out] out taken element.
+     *
+     * @return false if the ring is empty, otherwise true
+     */
+    bool try_pop(T& out) {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        if (pos == tail_cache) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (pos == tail_cache) {
+                return false;
+            }
+        }
+        out = std::move(cells[pos & mask]);
+        head.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Check the ring for emptiness (consumer thread).
+     *
+     * @return true if there is no element ready to be taken
+     */
+    bool empty() const {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Approximate number of elements (any thread).
+     *
+     * @return number of elements put and not yet taken
+     */
+    size_t size() const {
+        const size_t pos = tail.load(std::memory_order_relaxed);
+        const size_t cur = head.load(std::memory_order_relaxed);
+        return pos > cur ? pos - cur : 0;
+    }
+
+    /**
+     * @brief Visit the elements ready to be taken without taking them.
+     *
+     * The same as mpsc_ring::peek.
+     *
+     * @param[in] visit called with every element, oldest first.
+     */
+    template <typename Visit>
+    void peek(const Visit& visit) const {
+        const size_t end = tail.load(std::memory_order_acquire);
+        for (size_t pos = head.load(std::memory_order_relaxed); pos != end; ++pos) {
+            visit(cells[pos & mask]);
+        }
+    }
+};
+#endif
@@ -0,0 +1,152 @@
+#include "rotation.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// nice value of the worker thread
+static constexpr int worker_priority = 19;
+
+uint64_t rotation_number(const std::filesystem::path& path, const std::filesystem::path& rotated) {
+    const std::string prefix = path.filename().string() + '.';
+    std::string name = rotated.filename().string();
+    const std::string extension = rotation_compressed_extension;
+    if (name.size() > extension.size() &&
+        name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+        name.resize(name.size() - extension.size());
+    }
+    uint64_t result = 0;
+    if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0) {
+        for (size_t i = prefix.size(); i < name.size(); ++i) {
+            if (name[i] < '0' || name[i] > '9') {
+                return 0;
+            }
+            result = result * 10 + (name[i] - '0');
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief List the rotated files of a log.
+ *
+ * @param[in] path log file.
+ *
+ * @return numbers and paths of the rotated files
+ */
+static std::vector<std::pair<uint64_t, std::filesystem::path>> _list_rotated(
+    const std::filesystem::path& path) {
+    std::vector<std::pair<uint64_t, std::filesystem::path>> result;
+    std::filesystem::path directory = path.parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    std::error_code error;
+    std::filesystem::directory_iterator it(directory, error);
+    for (const std::filesystem::directory_iterator end; !error && it != end; it.increment(error)) {
+        const uint64_t number = rotation_number(path, it->path());
+        if (number != 0) {
+            result.emplace_back(number, it->path());
+        }
+    }
+    return result;
+}
+
+uint64_t rotation_next_number(const std::filesystem::path& path) {
+    uint64_t result = 0;
+    for (const auto& rotated : _list_rotated(path)) {
+        result = std::max(result, rotated.first);
+    }
+    return result + 1;
+}
+
+bool rotation_compress_file(const std::filesystem::path& rotated) {
+    std::ifstream input(rotated, std::ios::binary);
+    if (!input.is_open()) {
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+
+    std::string compressed;
+    lz_compress(data, compressed);
+
+    const std::filesystem::path target = rotated.string() + rotation_compressed_extension;
+    const std::filesystem::path temporary = target.string() + ".tmp";
+    std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+    output.write(compressed.data(), compressed.size());
+    output.close();
+
+    std::error_code error;
+    if (output.fail()) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (!error) {
+        std::filesystem::remove(rotated, error);
+    }
+    return !error;
+}
+
+rotation_worker::rotation_worker(const std::filesystem::path& path_v, const rotation_policy& policy_v)
+    : path(path_v), policy(policy_v) {}
+
+rotation_worker::~rotation_worker() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void rotation_worker::submit(const std::filesystem::path& rotated) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(rotated);
+        if (!worker.joinable()) {
+            worker = std::thread(&rotation_worker::_worker_loop, this);
+        }
+    }
+    wake.notify_one();
+}
+
+void rotation_worker::_remove_old() {
+    auto rotated = _list_rotated(path);
+    if (rotated.size() > policy.keep_files) {
+        std::sort(rotated.begin(), rotated.end(),
+                  [](const auto& left, const auto& right) { return left.first > right.first; });
+        std::error_code error;
+        for (size_t i = policy.keep_files; i < rotated.size(); ++i) {
+            std::filesystem::remove(rotated[i].second, error);
+        }
+    }
+}
+
+void rotation_worker::_worker_loop() {
+    // only this thread: on Linux the nice value is per thread
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), worker_priority);
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stop || !jobs.empty(); });
+        if (jobs.empty()) break;
+
+        const std::filesystem::path rotated = jobs.front();
+        jobs.pop_front();
+        guard.unlock();
+        if (policy.compress) {
+            rotation_compress_file(rotated);
+        }
+        _remove_old();
+        guard.lock();
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef FILE_H
+#define FILE_H
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#endif
+
+#ifndef CHRONO_H
+#define CHRONO_H
+#include <chrono>
+#endif
+
+#ifndef THREAD_H
+#define THREAD_H
+#include <thread>
+#endif
+
+#ifndef SYNC_H
+#define SYNC_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#endif
+
+#ifndef LZ_CODEC_H
+#include "lz_codec.h"
+#endif
+
+#ifndef ROTATION_H
+#define ROTATION_H
+
+// Extension of the compressed rotated files
+constexpr const char* rotation_compressed_extension = ".lz";
+
+// Log file rotation settings
+struct rotation_policy {
+    // rotate before the file grows beyond this many bytes (0 - disabled)
+    size_t max_size = 0;
+    // rotate when the wall clock crosses a multiple of this interval (0 - disabled)
+    std::chrono::seconds interval{0};
+    // number of rotated files that are kept, older ones are removed
+    size_t keep_files = 5;
+    // compress the rotated files (lz_codec.h) on the background thread
+    bool compress = false;
+};
+
+/**
+ * @brief Number of the rotated file.
+ *
+ * Rotated files are named <log file>.<number>[.lz], the newest has the largest number.
+ *
+ * @param[in] path log file.
+ * @param[in] rotated rotated file.
+ *
+ * @return number of the rotated file, 0 if it is not a rotated file of this log
+ */
+uint64_t rotation_number(const std::filesystem::path& path, const std::filesystem::path& rotated);
+
+/**
+ * @brief Next free number of a rotated file.
+ *
+ * @param[in] path log file.
+ *
+ * @return the largest number of the existing rotated files + 1
+ */
+uint64_t rotation_next_number(const std::filesystem::path& path);
+
+/**
+ * @brief Compress a file.
+ *
+ * Writes <file>.lz through a temporary file and an atomic rename, then removes the file.
+ *
+ * @param[in] rotated file.
+ *
+ * @return true if the file was compressed
+ */
+bool rotation_compress_file(const std::filesystem::path& rotated);
+
+/**
+ * @brief Background work of the rotation.
+ *
+ * Compresses the rotated files and removes the ones beyond keep_files
+ * on its own low-priority thread, so the logger only renames the file.
+ * The thread is started with the first rotated file and
+ * finishes the queued files before destruction.
+ */
+class rotation_worker {
+    // log file
+    std::filesystem::path path;
+
+    // rotation settings
+    rotation_policy policy;
+
+    // rotated files waiting for the thread
+    std::deque<std::filesystem::path> jobs;
+
+    // protects jobs and stop
+    std::mutex lock;
+
+    // signals new jobs and stop
+    std::condition_variable wake;
+
+    // thread stop flag
+    bool stop = false;
+
+    // worker thread
+    std::thread worker;
+
+    /**
+     * @brief Worker thread loop.
+     *
+     * Lowers the thread priority, then handles the rotated files until stop.
+     */
+    void _worker_loop();
+
+    /**
+     * @brief Remove the oldest rotated files beyond keep_files.
+     */
+    void _remove_old();
+
+   public:
+    /**
+     * @brief Class rotation_worker constructor.
+     *
+     * @param[in] path_v log file.
+     * @param[in] policy_v rotation settings.
+     */
+    rotation_worker(const std::filesystem::path& path_v, const rotation_policy& policy_v);
+
+    /**
+     * @brief Class rotation_worker destructor.
+     *
+     * Handles all queued files and stops the thread
+     */
+    ~rotation_worker();
+
+    rotation_worker(const rotation_worker&) = delete;
+    rotation_worker& operator=(const rotation_worker&) = delete;
+
+    /**
+     * @brief Queue a rotated file.
+     *
+     * @param[in] rotated rotated file.
+     */
+    void submit(const std::filesystem::path& rotated);
+};
+#endif
@@ -0,0 +1,148 @@
+#include "sink.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+fd_sink::fd_sink(const int fd_v) : fd(fd_v) {}
+
+void fd_sink::write(std::string_view record) {
+    size_t written = 0;
+    while (written < record.size()) {
+        const ssize_t result = ::write(fd, record.data() + written, record.size() - written);
+        if (result > 0) {
+            written += static_cast<size_t>(result);
+        } else if (result == 0 || errno != EINTR) {
+            // 0 leaves errno untouched, it is not an interrupt and would repeat forever
+            break;
+        }
+    }
+}
+
+socket_sink::socket_sink(const std::string& path_v) : path(path_v) { _connect(); }
+
+socket_sink::~socket_sink() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool socket_sink::_connect() {
+    last_connect = std::chrono::steady_clock::now();
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd >= 0;
+}
+
+void socket_sink::write(std::string_view record) {
+    const bool retry = std::chrono::steady_clock::now() - last_connect >= std::chrono::seconds(1);
+    if (fd < 0 && (!retry || !_connect())) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (send(fd, record.data(), record.size(), MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        // a full queue, a too large record or no kernel buffers - only this record is lost
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EMSGSIZE && errno != ENOBUFS) {
+            // the collector is gone, connect again later
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+uint64_t socket_sink::get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+memory_sink::memory_sink(const size_t capacity) : ring(capacity, '\0') {}
+
+void memory_sink::write(std::string_view record) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (ring.empty()) return;
+    const bool trimmed = record.size() > ring.size();
+    if (trimmed) {
+        record.remove_prefix(record.size() - ring.size());
+    }
+    const size_t end = (pos + record.size()) % ring.size();
+    // the byte before the oldest kept one after this write, not written yet or ending a record
+    const size_t before = (end + ring.size() - 1) % ring.size();
+    const bool boundary = (!wrapped && before >= pos) || ring[before] == '\n';
+    const size_t first = std::min(record.size(), ring.size() - pos);
+    std::memcpy(&ring[pos], record.data(), first);
+    std::memcpy(&ring[0], record.data() + first, record.size() - first);
+    if (pos + record.size() >= ring.size()) {
+        wrapped = true;
+    }
+    if (wrapped) {
+        whole = record.size() == ring.size() ? !trimmed : boundary;
+    }
+    pos = end;
+}
+
+std::string memory_sink::snapshot() const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::string result;
+    if (wrapped) {
+        result.assign(ring, pos, std::string::npos);
+        result.append(ring, 0, pos);
+        if (!whole) {
+            // the oldest record is cut by the wrap
+            const size_t first_end = result.find('\n');
+            result.erase(0, first_end == std::string::npos ? result.size() : first_end + 1);
+        }
+    } else {
+        result.assign(ring, 0, pos);
+    }
+    return result;
+}
+
+async_sink::async_sink(std::shared_ptr<log_sink> target_v, const size_t capacity)
+    : target(std::move(target_v)), queue(capacity) {
+    worker = std::thread(&async_sink::_worker_loop, this);
+}
+
+async_sink::~async_sink() {
+    shutdown = true;
+    queue.notify();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void async_sink::write(std::string_view record) {
+    std::string copy(record);
+    if (!queue.try_push(std::move(copy))) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void async_sink::_worker_loop() {
+    std::string record;
+    while (true) {
+        while (queue.try_pop(record)) {
+            target->write(record);
+        }
+
+        if (shutdown && queue.empty()) break;
+
+        target->flush();
+        queue.wait();
+    }
+    target->flush();
+}
+
+uint64_t async_sink::get_dropped() const { return dropped.load(std::memory_order_relaxed); }
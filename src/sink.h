@@ -0,0 +1,229 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
+#ifndef THREAD_H
+#define THREAD_H
+#include <thread>
+#endif
+
+#ifndef SYNC_H
+#define SYNC_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#endif
+
+#ifndef RING_BUFFER_H
+#include "ring_buffer.h"
+#endif
+
+#ifndef SINK_H
+#define SINK_H
+
+/**
+ * @brief Additional destination of the log records.
+ *
+ * The logger formats a record once and passes the same text to every sink
+ * whose level threshold the record passes. write and flush are called from
+ * the thread that writes to the logger.
+ */
+class log_sink {
+   public:
+    virtual ~log_sink() = default;
+
+    /**
+     * @brief Write one record.
+     *
+     * @param[in] record formatted record including the newline, valid only during the call.
+     */
+    virtual void write(std::string_view record) = 0;
+
+    /**
+     * @brief Write the records buffered by the sink.
+     */
+    virtual void flush() {}
+};
+
+/**
+ * @brief Sink writing to a file descriptor (stderr by default).
+ *
+ * Every record is written with one write call.
+ */
+class fd_sink : public log_sink {
+    // file descriptor, not closed by the sink
+    int fd;
+
+   public:
+    /**
+     * @brief Class fd_sink constructor.
+     *
+     * @param[in] fd_v file descriptor.
+     */
+    explicit fd_sink(const int fd_v = STDERR_FILENO);
+
+    void write(std::string_view record) override;
+};
+
+/**
+ * @brief Sink sending records to a UNIX domain datagram socket.
+ *
+ * Every record is one datagram. The sink never blocks: when the collector
+ * is missing or its queue is full the record is dropped and counted,
+ * reconnection is tried not more often than once a second. A record too
+ * large for a datagram or a lack of kernel buffers drops only that record.
+ */
+class socket_sink : public log_sink {
+    // path of the collector socket
+    std::string path;
+
+    // socket, -1 - not connected
+    int fd = -1;
+
+    // time of the last connection attempt
+    std::chrono::steady_clock::time_point last_connect;
+
+    // number of dropped records
+    std::atomic<uint64_t> dropped{0};
+
+    /**
+     * @brief Connect to the collector.
+     *
+     * @return true if the socket is connected
+     */
+    bool _connect();
+
+   public:
+    /**
+     * @brief Class socket_sink constructor.
+     *
+     * @param[in] path_v path of the collector socket.
+     */
+    explicit socket_sink(const std::string& path_v);
+
+    /**
+     * @brief Class socket_sink destructor.
+     *
+     * Closes the socket
+     */
+    ~socket_sink() override;
+
+    socket_sink(const socket_sink&) = delete;
+    socket_sink& operator=(const socket_sink&) = delete;
+
+    void write(std::string_view record) override;
+
+    /**
+     * @brief Getter for the number of dropped records.
+     *
+     * @return number of records that could not be sent
+     */
+    uint64_t get_dropped() const;
+};
+
+/**
+ * @brief Sink keeping the newest records in memory.
+ *
+ * A circular buffer of a fixed size, for example to dump
+ * the last records after a crash.
+ */
+class memory_sink : public log_sink {
+    // circular buffer
+    std::string ring;
+
+    // next write position
+    size_t pos = 0;
+
+    // true after the buffer has been filled once
+    bool wrapped = false;
+
+    // the oldest kept byte starts a record, checked after the buffer wraps
+    bool whole = true;
+
+    // protects the buffer from snapshot on another thread
+    mutable std::mutex lock;
+
+   public:
+    /**
+     * @brief Class memory_sink constructor.
+     *
+     * @param[in] capacity size of the buffer in bytes.
+     */
+    explicit memory_sink(const size_t capacity);
+
+    void write(std::string_view record) override;
+
+    /**
+     * @brief Copy of the kept records (any thread).
+     *
+     * @return the newest whole records, oldest first
+     */
+    std::string snapshot() const;
+};
+
+/**
+ * @brief Sink with its own queue and thread in front of a slow sink.
+ *
+ * write only copies the record into the queue, the wrapped sink is written
+ * by the sink thread, so a slow destination does not hold back the logger
+ * and the other sinks. When the queue is full the record is dropped and counted.
+ */
+class async_sink : public log_sink {
+    // wrapped sink, only the sink thread uses it
+    std::shared_ptr<log_sink> target;
+
+    // records waiting for the sink thread
+    mpsc_ring<std::string> queue;
+
+    // number of dropped records
+    std::atomic<uint64_t> dropped{0};
+
+    // thread stop flag
+    std::atomic<bool> shutdown{false};
+
+    // sink thread
+    std::thread worker;
+
+    /**
+     * @brief Sink thread loop.
+     *
+     * Writes queued records to the wrapped sink, flushes it before going to sleep
+     * on an empty queue. After shutdown is set drains the queue and exits.
+     */
+    void _worker_loop();
+
+   public:
+    /**
+     * @brief Class async_sink constructor.
+     *
+     * @param[in] target_v wrapped sink.
+     * @param[in] capacity queue capacity, rounded up to the power of two.
+     */
+    async_sink(std::shared_ptr<log_sink> target_v, const size_t capacity);
+
+    /**
+     * @brief Class async_sink destructor.
+     *
+     * Writes all queued records and stops the thread
+     */
+    ~async_sink() override;
+
+    async_sink(const async_sink&) = delete;
+    async_sink& operator=(const async_sink&) = delete;
+
+    void write(std::string_view record) override;
+
+    /**
+     * @brief Getter for the number of dropped records.
+     *
+     * @return number of records dropped on a full queue
+     */
+    uint64_t get_dropped() const;
+};
+#endif
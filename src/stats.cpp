@@ -0,0 +1,227 @@
+#include "stats.h"
+
+#include <algorithm>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// names of the levels in the text form, the same order as log_type
+static const char* const stat_level_names[stat_levels] = {"debug", "info", "warn", "error", "critical"};
+
+// source of the thread_counters ids
+static std::atomic<uint64_t> thread_counters_ids{1};
+
+// Counter block of the calling thread for one thread_counters
+struct counter_slot {
+    uint64_t owner;
+    std::shared_ptr<counter_registry> registry;
+    std::shared_ptr<counter_block> block;
+};
+
+/**
+ * @brief Fold a block into the retired sums and remove it from the registry.
+ *
+ * @param[in] slot counter slot.
+ */
+static void _retire(const counter_slot& slot) {
+    std::lock_guard<std::mutex> guard(slot.registry->lock);
+    for (size_t i = 0; i < counter_block_size; ++i) {
+        slot.registry->retired[i].fetch_add(slot.block->values[i].load(std::memory_order_relaxed),
+                                            std::memory_order_relaxed);
+    }
+    auto& blocks = slot.registry->blocks;
+    blocks.erase(std::find(blocks.begin(), blocks.end(), slot.block));
+}
+
+// Counter blocks of the calling thread, retired when the thread exits
+struct thread_counter_slots {
+    std::vector<counter_slot> slots;
+
+    ~thread_counter_slots() {
+        for (const counter_slot& slot : slots) {
+            _retire(slot);
+        }
+    }
+};
+
+static thread_local thread_counter_slots counter_slots;
+
+thread_counters::thread_counters()
+    : registry(std::make_shared<counter_registry>()),
+      id(thread_counters_ids.fetch_add(1, std::memory_order_relaxed)) {}
+
+thread_counters::~thread_counters() { registry->closed.store(true, std::memory_order_release); }
+
+counter_block& thread_counters::_local() {
+    for (const counter_slot& slot : counter_slots.slots) {
+        if (slot.owner == id) {
+            return *slot.block;
+        }
+    }
+
+    // blocks of destroyed counters are forgotten before a new one is added
+    auto& slots = counter_slots.slots;
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [](const counter_slot& slot) {
+                                   return slot.registry->closed.load(std::memory_order_acquire);
+                               }),
+                slots.end());
+
+    auto block = std::make_shared<counter_block>();
+    {
+        std::lock_guard<std::mutex> guard(registry->lock);
+        registry->blocks.push_back(block);
+    }
+    slots.push_back({id, registry, block});
+    return *block;
+}
+
+void thread_counters::sum(uint64_t* out) const {
+    std::lock_guard<std::mutex> guard(registry->lock);
+    for (size_t i = 0; i < counter_block_size; ++i) {
+        out[i] = registry->retired[i].load(std::memory_order_relaxed);
+        for (const auto& block : registry->blocks) {
+            out[i] += block->values[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+latency_summary latency_stat::summary() const {
+    latency_summary result;
+    uint64_t counts[65];
+    for (size_t i = 0; i < 65; ++i) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        result.count += counts[i];
+    }
+    result.max_ns = max_value.load(std::memory_order_relaxed);
+
+    const auto percentile = [&](const uint64_t rank) {
+        uint64_t seen = 0;
+        for (size_t i = 0; i < 65; ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                const uint64_t upper = i == 64 ? UINT64_MAX : (uint64_t(1) << i) - 1;
+                return std::min(upper, result.max_ns);
+            }
+        }
+        return result.max_ns;
+    };
+    if (result.count > 0) {
+        result.p50_ns = percentile(result.count / 2);
+        result.p99_ns = percentile(result.count * 99 / 100);
+    }
+    return result;
+}
+
+void logger_metrics::time_io(latency_stat& stat, const std::chrono::steady_clock::duration took) {
+    stat.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(took).count()));
+    if (took >= stat_stall_threshold) {
+        bump(stalls);
+    }
+}
+
+void logger_metrics::observe_queue(const uint64_t depth) {
+    queue_depth.store(depth, std::memory_order_relaxed);
+    if (depth > queue_high_water.load(std::memory_order_relaxed)) {
+        queue_high_water.store(depth, std::memory_order_relaxed);
+    }
+}
+
+logger_stats logger_metrics::snapshot() const {
+    logger_stats result;
+    uint64_t entries[counter_block_size];
+    entry.sum(entries);
+    for (size_t level = 0; level < stat_levels; ++level) {
+        level_stats& stats = result.levels[level];
+        stats.accepted = entries[level * stat_entry_kinds + stat_accepted];
+        stats.filtered = entries[level * stat_entry_kinds + stat_filtered];
+        stats.dropped = entries[level * stat_entry_kinds + stat_dropped];
+        stats.sampled = entries[level * stat_entry_kinds + stat_sampled];
+        stats.rate_limited = entries[level * stat_entry_kinds + stat_rate_limited];
+        stats.collapsed = entries[level * stat_entry_kinds + stat_collapsed];
+        stats.written = written[level].load(std::memory_order_relaxed);
+        stats.failed = failed[level].load(std::memory_order_relaxed);
+    }
+    result.bytes = bytes.load(std::memory_order_relaxed);
+    result.write_latency = write_latency.summary();
+    result.flush_latency = flush_latency.summary();
+    result.sync_latency = sync_latency.summary();
+    result.stalls = stalls.load(std::memory_order_relaxed);
+    result.queue_depth = queue_depth.load(std::memory_order_relaxed);
+    result.queue_high_water = queue_high_water.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::string stats_to_text(const logger_stats& stats) {
+    std::string result;
+    const auto line = [&result](const std::string& name, const uint64_t value) {
+        result += name;
+        result += ' ';
+        result += std::to_string(value);
+        result += '\n';
+    };
+    for (size_t level = 0; level < stat_levels; ++level) {
+        const std::string name = stat_level_names[level];
+        line("accepted." + name, stats.levels[level].accepted);
+        line("filtered." + name, stats.levels[level].filtered);
+        line("dropped." + name, stats.levels[level].dropped);
+        line("sampled." + name, stats.levels[level].sampled);
+        line("rate_limited." + name, stats.levels[level].rate_limited);
+        line("collapsed." + name, stats.levels[level].collapsed);
+        line("written." + name, stats.levels[level].written);
+        line("failed." + name, stats.levels[level].failed);
+    }
+    line("bytes", stats.bytes);
+    const std::pair<const char*, const latency_summary*> latencies[] = {
+        {"write_latency", &stats.write_latency},
+        {"flush_latency", &stats.flush_latency},
+        {"sync_latency", &stats.sync_latency}};
+    for (const auto& latency : latencies) {
+        const std::string name = latency.first;
+        line(name + ".count", latency.second->count);
+        line(name + ".p50_ns", latency.second->p50_ns);
+        line(name + ".p99_ns", latency.second->p99_ns);
+        line(name + ".max_ns", latency.second->max_ns);
+    }
+    line("stalls", stats.stalls);
+    line("queue_depth", stats.queue_depth);
+    line("queue_high_water", stats.queue_high_water);
+    return result;
+}
+
+stats_dumper::stats_dumper(const std::filesystem::path& path_v, const std::chrono::milliseconds interval_v,
+                           std::function<std::string()> render_v)
+    : path(path_v), interval(interval_v), render(std::move(render_v)) {
+    worker = std::thread(&stats_dumper::_worker_loop, this);
+}
+
+stats_dumper::~stats_dumper() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    _dump();
+}
+
+void stats_dumper::_dump() {
+    const std::filesystem::path temporary = path.string() + ".tmp";
+    std::ofstream out(temporary, std::ios::trunc);
+    out << render();
+    out.close();
+    if (!out.fail()) {
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+    }
+}
+
+void stats_dumper::_worker_loop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (!wake.wait_for(guard, interval, [this] { return stop; })) {
+        guard.unlock();
+        _dump();
+        guard.lock();
+    }
+}
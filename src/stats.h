@@ -0,0 +1,360 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef FILE_H
+#define FILE_H
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#endif
+
+#ifndef CHRONO_H
+#define CHRONO_H
+#include <chrono>
+#endif
+
+#ifndef THREAD_H
+#define THREAD_H
+#include <thread>
+#endif
+
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+#include <functional>
+#endif
+
+#ifndef SYNC_H
+#define SYNC_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#endif
+
+#ifndef VECTOR_H
+#define VECTOR_H
+#include <vector>
+#endif
+
+#ifndef RING_BUFFER_H
+#include "ring_buffer.h"
+#endif
+
+#ifndef STATS_H
+#define STATS_H
+
+// Number of log levels with their own counters (debug ... critical)
+constexpr size_t stat_levels = 5;
+
+// Counters of the records at one level
+enum stat_entry_kind {
+    // passed the level filter and was taken by the logger or the async_logger queue
+    stat_accepted,
+    // rejected by the level filter of put_log/log (the LOGGER_* macros skip the call and are not counted)
+    stat_filtered,
+    // dropped by the async_logger backpressure_policy
+    stat_dropped,
+    // not selected by the sampling of a limited call site (rate_limiter)
+    stat_sampled,
+    // held back by the rate limit of a limited call site
+    stat_rate_limited,
+    // a repeat of the previous message of a limited call site
+    stat_collapsed,
+    stat_entry_kinds
+};
+
+// Number of counters of one thread
+constexpr size_t counter_block_size = stat_levels * stat_entry_kinds;
+
+// A write or flush of the file that takes longer is counted as a writer stall
+constexpr std::chrono::milliseconds stat_stall_threshold{10};
+
+// Counters of one thread
+struct counter_block {
+    std::atomic<uint64_t> values[counter_block_size] = {};
+};
+
+// Counter blocks of all threads of one thread_counters
+struct counter_registry {
+    // protects blocks
+    std::mutex lock;
+    std::vector<std::shared_ptr<counter_block>> blocks;
+    // sums of the blocks of exited threads
+    std::atomic<uint64_t> retired[counter_block_size] = {};
+    // set when the thread_counters is destroyed, the threads forget their blocks
+    std::atomic<bool> closed{false};
+};
+
+/**
+ * @brief Counters incremented from many threads without shared writes.
+ *
+ * Every thread gets its own counter_block on the first add, so add is a plain
+ * load and store of the thread's own cache line, without a lock prefix. A reader
+ * sums the blocks of all threads; the block of an exited thread is folded into
+ * the retired sums.
+ */
+class thread_counters {
+    std::shared_ptr<counter_registry> registry;
+
+    // unique id, threads find their block by it
+    uint64_t id;
+
+    /**
+     * @brief Counter block of the calling thread, registered on the first call.
+     *
+     * @return counter block
+     */
+    counter_block& _local();
+
+   public:
+    thread_counters();
+    ~thread_counters();
+
+    thread_counters(const thread_counters&) = delete;
+    thread_counters& operator=(const thread_counters&) = delete;
+
+    /**
+     * @brief Add to a counter of the calling thread (any thread).
+     *
+     * @param[in] index counter index, less than counter_block_size.
+     * @param[in] count value to add.
+     */
+    void add(const size_t index, const uint64_t count = 1) {
+        std::atomic<uint64_t>& value = _local().values[index];
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Sum the counters of all threads (any thread).
+     *
+     * @param[out] out counter_block_size sums.
+     */
+    void sum(uint64_t* out) const;
+};
+
+// Percentiles of a latency_stat
+struct latency_summary {
+    uint64_t count = 0;
+    // upper bounds of the power-of-two buckets holding the percentiles, nanoseconds
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+/**
+ * @brief Latency histogram with power-of-two buckets.
+ *
+ * record is called by one thread at a time (the thread writing the file),
+ * summary by any thread.
+ */
+class latency_stat {
+    // bucket i holds the values below 2^i and not below 2^(i-1)
+    std::atomic<uint64_t> buckets[65] = {};
+    std::atomic<uint64_t> max_value{0};
+
+   public:
+    /**
+     * @brief Add a value (one thread at a time).
+     *
+     * @param[in] value nanoseconds.
+     */
+    void record(const uint64_t value) {
+        std::atomic<uint64_t>& bucket = buckets[value == 0 ? 0 : 64 - __builtin_clzll(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > max_value.load(std::memory_order_relaxed)) {
+            max_value.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Percentiles (any thread).
+     *
+     * @return count, p50, p99 and max
+     */
+    latency_summary summary() const;
+};
+
+// Counters of the records at one level
+struct level_stats {
+    uint64_t accepted = 0;
+    uint64_t filtered = 0;
+    uint64_t dropped = 0;
+    // removed at a LOGGER_LIMITED call site by the sampling, the rate limit and the repeat collapsing
+    uint64_t sampled = 0;
+    uint64_t rate_limited = 0;
+    uint64_t collapsed = 0;
+    // reached the file
+    uint64_t written = 0;
+    // the write has failed or the file was closed or unavailable
+    uint64_t failed = 0;
+};
+
+// Snapshot of the logger metrics
+struct logger_stats {
+    // by log_type, debug ... critical
+    level_stats levels[stat_levels];
+    // bytes written to the file
+    uint64_t bytes = 0;
+    // writes, flushes and syncs (fdatasync) of the file and how long they took
+    latency_summary write_latency;
+    latency_summary flush_latency;
+    latency_summary sync_latency;
+    // writes and flushes longer than stat_stall_threshold
+    uint64_t stalls = 0;
+    // async_logger queue length seen by the writer, the last one and the largest one
+    uint64_t queue_depth = 0;
+    uint64_t queue_high_water = 0;
+};
+
+/**
+ * @brief Counters of a logger.
+ *
+ * Entry counters are updated by the logging threads through thread_counters,
+ * the other counters by the thread writing the file. Reading never blocks
+ * the logging threads.
+ */
+class logger_metrics {
+   public:
+    // accepted, filtered, dropped and limited records: index level * stat_entry_kinds + stat_entry_kind
+    thread_counters entry;
+
+    // written and failed records by level (writer thread)
+    std::atomic<uint64_t> written[stat_levels] = {};
+    std::atomic<uint64_t> failed[stat_levels] = {};
+
+    // bytes written to the file (writer thread)
+    std::atomic<uint64_t> bytes{0};
+
+    // writes and flushes longer than stat_stall_threshold (writer thread)
+    std::atomic<uint64_t> stalls{0};
+
+    // async_logger queue length (async_logger writer thread)
+    std::atomic<uint64_t> queue_depth{0};
+    std::atomic<uint64_t> queue_high_water{0};
+
+    latency_stat write_latency;
+    latency_stat flush_latency;
+    latency_stat sync_latency;
+
+    /**
+     * @brief Add to a counter of the writer thread.
+     *
+     * @param[in] counter counter.
+     * @param[in] count value to add.
+     */
+    static void bump(std::atomic<uint64_t>& counter, const uint64_t count = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Count an entry at a level (any thread).
+     *
+     * @param[in] level log level from 0 to stat_levels - 1, other values are ignored.
+     * @param[in] kind stat_entry_kind.
+     * @param[in] count number of entries.
+     */
+    void count_entry(const int level, const stat_entry_kind kind, const uint64_t count = 1) {
+        if (level >= 0 && level < static_cast<int>(stat_levels)) {
+            entry.add(level * stat_entry_kinds + kind, count);
+        }
+    }
+
+    /**
+     * @brief Record the duration of a write, flush or sync (writer thread).
+     *
+     * @param[in] stat write_latency, flush_latency or sync_latency.
+     * @param[in] took duration.
+     */
+    void time_io(latency_stat& stat, const std::chrono::steady_clock::duration took);
+
+    /**
+     * @brief Record the async_logger queue length (async_logger writer thread).
+     *
+     * @param[in] depth number of queued records.
+     */
+    void observe_queue(const uint64_t depth);
+
+    /**
+     * @brief Read all counters (any thread).
+     *
+     * @return snapshot
+     */
+    logger_stats snapshot() const;
+};
+
+/**
+ * @brief Text form of the metrics.
+ *
+ * One "metric value" line per counter, for example "written.warn 42" or
+ * "write_latency.p99_ns 4095", the same layout as the bench output.
+ *
+ * @param[in] stats snapshot.
+ *
+ * @return text
+ */
+std::string stats_to_text(const logger_stats& stats);
+
+/**
+ * @brief Periodic dump of the metrics to a sidecar file.
+ *
+ * A thread writes the text given by render every interval to a temporary file
+ * and renames it over the sidecar file, so readers always see a whole snapshot.
+ * The last snapshot is written when the object is destroyed.
+ */
+class stats_dumper {
+    // sidecar file
+    std::filesystem::path path;
+
+    // time between the dumps
+    std::chrono::milliseconds interval;
+
+    // text of the current metrics
+    std::function<std::string()> render;
+
+    // protects stop
+    std::mutex lock;
+
+    // signals stop
+    std::condition_variable wake;
+
+    // thread stop flag
+    bool stop = false;
+
+    // dumping thread
+    std::thread worker;
+
+    /**
+     * @brief Write the current metrics to the sidecar file.
+     */
+    void _dump();
+
+    /**
+     * @brief Dumping thread loop.
+     */
+    void _worker_loop();
+
+   public:
+    /**
+     * @brief Class stats_dumper constructor.
+     *
+     * Starts the dumping thread.
+     *
+     * @param[in] path_v sidecar file.
+     * @param[in] interval_v time between the dumps.
+     * @param[in] render_v text of the current metrics, called on the dumping thread.
+     */
+    stats_dumper(const std::filesystem::path& path_v, const std::chrono::milliseconds interval_v,
+                 std::function<std::string()> render_v);
+
+    /**
+     * @brief Class stats_dumper destructor.
+     *
+     * Stops the thread and writes the last snapshot.
+     */
+    ~stats_dumper();
+
+    stats_dumper(const stats_dumper&) = delete;
+    stats_dumper& operator=(const stats_dumper&) = delete;
+};
+#endif
@@ -0,0 +1,239 @@
+#include "structured.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+/**
+ * @brief Check a byte for escaping.
+ *
+ * @param[in] value byte.
+ * @param[in] logfmt true - spaces and = also need quoting (a logfmt value).
+ *
+ * @return true if the byte must be escaped or the value quoted
+ */
+static bool _special(const char value, const bool logfmt) {
+    const unsigned char byte = static_cast<unsigned char>(value);
+    return byte <= 0x1F || value == '"' || value == '\\' || (logfmt && (value == ' ' || value == '='));
+}
+
+/**
+ * @brief Find the first byte that needs escaping.
+ *
+ * 16 bytes are checked at once with SSE2, the tail byte by byte.
+ *
+ * @param[in] data text.
+ * @param[in] size length of the text.
+ * @param[in] logfmt true - spaces and = are also searched for.
+ *
+ * @return position of the byte, size if there is none
+ */
+static size_t _scan(const char* data, const size_t size, const bool logfmt) {
+    size_t pos = 0;
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    const __m128i space = _mm_set1_epi8(logfmt ? ' ' : '"');
+    const __m128i equals = _mm_set1_epi8(logfmt ? '=' : '"');
+    for (; pos + 16 <= size; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        // unsigned byte <= 0x1F exactly when min(byte, 0x1F) == byte
+        __m128i found = _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk);
+        found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, quote));
+        found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, backslash));
+        found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, space));
+        found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, equals));
+        const int mask = _mm_movemask_epi8(found);
+        if (mask != 0) {
+            return pos + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    while (pos < size && !_special(data[pos], logfmt)) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Output of json_escape into a fixed buffer: plain text is cut off, an escape is written whole or not at all
+struct fixed_escape {
+    char* data;
+    size_t capacity;
+    size_t size = 0;
+
+    void append(const char* text, const size_t count) {
+        const size_t part = count < capacity - size ? count : capacity - size;
+        std::memcpy(data + size, text, part);
+        size += part;
+    }
+
+    fixed_escape& operator+=(const char* text) {
+        const size_t count = std::strlen(text);
+        if (count <= capacity - size) {
+            append(text, count);
+        } else {
+            size = capacity;
+        }
+        return *this;
+    }
+};
+
+/**
+ * @brief Escape a string for a JSON string literal.
+ *
+ * @param[out] out result, std::string or fixed_escape.
+ * @param[in] text string.
+ */
+template <typename Out>
+static void _json_escape(Out& out, std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    size_t start = 0;
+    while (start < text.size()) {
+        const size_t pos = start + _scan(text.data() + start, text.size() - start, false);
+        out.append(text.data() + start, pos - start);
+        if (pos == text.size()) break;
+
+        const unsigned char byte = static_cast<unsigned char>(text[pos]);
+        switch (byte) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            case '\b':
+                out += "\\b";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            default: {
+                const char code[] = {'\\', 'u', '0', '0', hex[byte >> 4], hex[byte & 0xF], '\0'};
+                out += code;
+                break;
+            }
+        }
+        start = pos + 1;
+    }
+}
+
+void json_escape(std::string& out, std::string_view text) { _json_escape(out, text); }
+
+size_t json_escape(char* out, const size_t capacity, std::string_view text) {
+    fixed_escape escaped{out, capacity};
+    _json_escape(escaped, text);
+    return escaped.size;
+}
+
+void logfmt_value(std::string& out, std::string_view text) {
+    if (!text.empty() && _scan(text.data(), text.size(), true) == text.size()) {
+        out.append(text.data(), text.size());
+    } else {
+        out += '"';
+        json_escape(out, text);
+        out += '"';
+    }
+}
+
+void logfmt_key(std::string& out, std::string_view key) {
+    if (key.empty()) {
+        out += '_';
+        return;
+    }
+    size_t pos = 0;
+    while (pos < key.size()) {
+        const size_t plain = pos + _scan(key.data() + pos, key.size() - pos, true);
+        out.append(key.data() + pos, plain - pos);
+        if (plain == key.size()) break;
+        out += '_';
+        pos = plain + 1;
+    }
+}
+
+/**
+ * @brief Append a field value.
+ *
+ * @param[out] out result.
+ * @param[in] value decoded value.
+ * @param[in] json true - JSON value, false - logfmt value.
+ */
+static void _append_value(std::string& out, const fmt_arg_value& value, const bool json) {
+    switch (value.type) {
+        case fmt_int_arg:
+            fmt_append_number(out, value.int_value);
+            break;
+        case fmt_uint_arg:
+            fmt_append_number(out, value.uint_value);
+            break;
+        case fmt_double_arg:
+            if (json && !std::isfinite(value.double_value)) {
+                out += "null";
+            } else {
+                fmt_append_number(out, value.double_value);
+            }
+            break;
+        case fmt_bool_arg:
+            out += value.uint_value != 0 ? "true" : "false";
+            break;
+        case fmt_char_arg:
+        case fmt_string_arg:
+            if (json) {
+                out += '"';
+                json_escape(out, value.text);
+                out += '"';
+            } else {
+                logfmt_value(out, value.text);
+            }
+            break;
+        case fmt_pointer_arg:
+            out += json ? "\"0x" : "0x";
+            fmt_append_number(out, value.uint_value, 16);
+            if (json) {
+                out += '"';
+            }
+            break;
+    }
+}
+
+void fields_to_logfmt(std::string& out, const fmt_args& fields) {
+    const unsigned char* pos = fields.data();
+    const unsigned char* end = pos + fields.size();
+    while (pos < end) {
+        fmt_arg_value key;
+        fmt_arg_value value;
+        if (!fmt_decode_arg(pos, end, key) || !fmt_decode_arg(pos, end, value)) break;
+        out += ' ';
+        logfmt_key(out, key.text);
+        out += '=';
+        _append_value(out, value, false);
+    }
+}
+
+void fields_to_json(std::string& out, const fmt_args& fields) {
+    const unsigned char* pos = fields.data();
+    const unsigned char* end = pos + fields.size();
+    while (pos < end) {
+        fmt_arg_value key;
+        fmt_arg_value value;
+        if (!fmt_decode_arg(pos, end, key) || !fmt_decode_arg(pos, end, value)) break;
+        out += ",\"";
+        json_escape(out, key.text);
+        out += "\":";
+        _append_value(out, value, true);
+    }
+}
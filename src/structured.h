@@ -0,0 +1,140 @@
+#ifndef STR_H
+#define STR_H
+#include <string>
+#endif
+
+#ifndef VIEW_H
+#define VIEW_H
+#include <string_view>
+#endif
+
+#ifndef LOG_FORMAT_H
+#include "log_format.h"
+#endif
+
+#ifndef STRUCTURED_H
+#define STRUCTURED_H
+
+/**
+ * @brief Typed key/value fields of a record.
+ *
+ * Every field is encoded as its key (a string argument) followed by the value
+ * with the fmt_args encoding, so the fields are queued and copied like format
+ * arguments. Keys are escaped in JSON; in logfmt spaces, =, ", \ and control
+ * characters of a key are replaced with _ (see logfmt_key).
+ *
+ * log_fields fields;
+ * fields.add("user", name).add("status", 200).add("ms", 3.5);
+ */
+class log_fields {
+    // key, value, key, value ...
+    fmt_args encoded;
+
+   public:
+    /**
+     * @brief Add a field.
+     *
+     * @param[in] key field name.
+     * @param[in] value any type supported by fmt_encode_arg.
+     *
+     * @return *this
+     */
+    template <typename T>
+    log_fields& add(std::string_view key, const T& value) {
+        encoded.append_string(key);
+        fmt_encode_arg(encoded, value);
+        return *this;
+    }
+
+    /**
+     * @brief Encoded fields.
+     *
+     * @return key and value arguments
+     */
+    const fmt_args& data() const { return encoded; }
+
+    /**
+     * @brief Check for fields.
+     *
+     * @return true if no field has been added
+     */
+    bool empty() const { return encoded.size() == 0; }
+
+    /**
+     * @brief Remove all fields.
+     */
+    void clear() { encoded.clear(); }
+};
+
+/**
+ * @brief Append a string escaped for a JSON string literal.
+ *
+ * ", \ and control characters are escaped, other bytes (UTF-8 included) are
+ * copied as they are. The bytes that need escaping are found 16 at a time with
+ * SSE2 where it is available, so plain text is copied in large runs.
+ *
+ * @param[out] out result, the quotes are not added.
+ * @param[in] text string.
+ */
+void json_escape(std::string& out, std::string_view text);
+
+/**
+ * @brief Escape a string for a JSON string literal into a fixed buffer.
+ *
+ * The same as json_escape with a string, but nothing is allocated and the call
+ * is async-signal-safe (crash handler). The text that does not fit is cut off,
+ * an escape sequence is never cut in the middle.
+ *
+ * @param[out] out buffer.
+ * @param[in] capacity size of the buffer.
+ * @param[in] text string.
+ *
+ * @return number of written bytes
+ */
+size_t json_escape(char* out, const size_t capacity, std::string_view text);
+
+/**
+ * @brief Append a logfmt value.
+ *
+ * A value without spaces, =, ", \ and control characters is written as it is,
+ * otherwise it is quoted and escaped as in JSON. An empty value is written as "".
+ *
+ * @param[out] out result.
+ * @param[in] text value.
+ */
+void logfmt_value(std::string& out, std::string_view text);
+
+/**
+ * @brief Append a logfmt key.
+ *
+ * logfmt has no quoted keys, so spaces, =, ", \ and control characters are
+ * replaced with _ and an empty key is written as _.
+ *
+ * @param[out] out result.
+ * @param[in] key field name.
+ */
+void logfmt_key(std::string& out, std::string_view key);
+
+/**
+ * @brief Append the fields in logfmt.
+ *
+ * " key=value" for every field, numbers are written with std::to_chars.
+ * Used by text_format and logfmt_format. Corrupted fields end the output.
+ *
+ * @param[out] out result.
+ * @param[in] fields encoded fields (log_fields::data).
+ */
+void fields_to_logfmt(std::string& out, const fmt_args& fields);
+
+/**
+ * @brief Append the fields as JSON object members.
+ *
+ * ,"key":value for every field. Numbers are written with std::to_chars,
+ * infinite and NaN doubles as null, strings, chars and pointers as strings.
+ * Corrupted fields end the output.
+ *
+ * @param[out] out result.
+ * @param[in] fields encoded fields (log_fields::data).
+ */
+void fields_to_json(std::string& out, const fmt_args& fields);
+#endif
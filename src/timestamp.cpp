@@ -0,0 +1,179 @@
+#include "timestamp.h"
+
+#include <cstring>
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+// "00" "01" ... "99"
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+ * @brief Write a number from 0 to 99 as two digits.
+ *
+ * @param[out] out buffer of at least 2 bytes.
+ * @param[in] value number.
+ */
+static void _put_two_digits(char* out, const int value) { std::memcpy(out, &digit_pairs[value * 2], 2); }
+
+/**
+ * @brief Clock reading in nanoseconds.
+ *
+ * @param[in] clock_id CLOCK_REALTIME or CLOCK_MONOTONIC.
+ *
+ * @return nanoseconds
+ */
+static int64_t _read_clock(const clockid_t clock_id) {
+    timespec ts;
+    clock_gettime(clock_id, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+timestamp_engine::timestamp_engine(const timestamp_format& format_v) : prefix(), suffix() {
+    set_format(format_v);
+}
+
+/**
+ * @brief Convert days since the epoch to a date of the proleptic Gregorian calendar.
+ *
+ * @param[in] days days since 1970-01-01.
+ * @param[out] local tm_year, tm_mon and tm_mday are set.
+ */
+static void _civil_from_days(int64_t days, std::tm& local) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t day_of_era = days - era * 146097;
+    const int64_t year_of_era =
+        (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const int64_t month = (5 * day_of_year + 2) / 153;
+    local.tm_mday = static_cast<int>(day_of_year - (153 * month + 2) / 5 + 1);
+    local.tm_mon = static_cast<int>(month < 10 ? month + 2 : month - 10);
+    local.tm_year = static_cast<int>(year_of_era + era * 400 + (local.tm_mon <= 1) - 1900);
+}
+
+void timestamp_engine::set_format(const timestamp_format& format_v) {
+    format = format_v;
+    monotonic_offset = _read_clock(CLOCK_REALTIME) - _read_clock(CLOCK_MONOTONIC);
+    cached_second = INT64_MIN;
+
+    const std::time_t time = std::time(nullptr);
+    std::tm local;
+    localtime_r(&time, &local);
+    utc_offset = local.tm_gmtoff;
+}
+
+void timestamp_engine::set_fixed_offset(const bool fixed) { fixed_offset = fixed; }
+
+timestamp_format timestamp_engine::get_format() const { return format; }
+
+int64_t timestamp_engine::now() const {
+    int64_t result = 0;
+    if (format.clock == monotonic_clock) {
+        result = _read_clock(CLOCK_MONOTONIC) + monotonic_offset;
+    } else {
+        result = _read_clock(CLOCK_REALTIME);
+    }
+    return result;
+}
+
+void timestamp_engine::_update_cache(const int64_t second) {
+    std::tm local{};
+    if (fixed_offset) {
+        const int64_t shifted = second + utc_offset;
+        int64_t days = shifted / 86400;
+        int64_t rest = shifted % 86400;
+        if (rest < 0) {
+            rest += 86400;
+            --days;
+        }
+        _civil_from_days(days, local);
+        local.tm_hour = static_cast<int>(rest / 3600);
+        local.tm_min = static_cast<int>(rest / 60 % 60);
+        local.tm_sec = static_cast<int>(rest % 60);
+        local.tm_gmtoff = utc_offset;
+    } else {
+        const std::time_t time = static_cast<std::time_t>(second);
+        localtime_r(&time, &local);
+        utc_offset = local.tm_gmtoff;
+    }
+
+    char* out = prefix;
+    if (format.layout == iso8601_layout) {
+        const int year = local.tm_year + 1900;
+        _put_two_digits(out, year / 100 % 100);
+        _put_two_digits(out + 2, year % 100);
+        out[4] = '-';
+        _put_two_digits(out + 5, local.tm_mon + 1);
+        out[7] = '-';
+        _put_two_digits(out + 8, local.tm_mday);
+        out[10] = 'T';
+        out += 11;
+    }
+    _put_two_digits(out, local.tm_hour);
+    out[2] = ':';
+    _put_two_digits(out + 3, local.tm_min);
+    out[5] = ':';
+    _put_two_digits(out + 6, local.tm_sec);
+    prefix_size = out + 8 - prefix;
+
+    suffix_size = 0;
+    if (format.layout == iso8601_layout) {
+        long offset_min = local.tm_gmtoff / 60;
+        suffix[0] = offset_min < 0 ? '-' : '+';
+        if (offset_min < 0) {
+            offset_min = -offset_min;
+        }
+        _put_two_digits(suffix + 1, static_cast<int>(offset_min / 60 % 100));
+        suffix[3] = ':';
+        _put_two_digits(suffix + 4, static_cast<int>(offset_min % 60));
+        suffix_size = 6;
+    }
+    cached_second = second;
+}
+
+size_t timestamp_engine::format_time(const int64_t epoch_ns, char* out) {
+    int64_t second = epoch_ns / 1000000000;
+    int64_t nanos = epoch_ns % 1000000000;
+    if (nanos < 0) {
+        nanos += 1000000000;
+        --second;
+    }
+    if (second != cached_second) {
+        _update_cache(second);
+    }
+
+    std::memcpy(out, prefix, prefix_size);
+    size_t size = prefix_size;
+    if (format.precision != seconds_precision) {
+        out[size++] = '.';
+        for (int i = nanos_precision; i > format.precision; --i) {
+            nanos /= 10;
+        }
+        for (int i = format.precision - 1; i >= 0; --i) {
+            out[size + i] = static_cast<char>('0' + nanos % 10);
+            nanos /= 10;
+        }
+        size += format.precision;
+    }
+    std::memcpy(out + size, suffix, suffix_size);
+    return size + suffix_size;
+}
+
+int64_t timestamp_engine::shown_time(const int64_t epoch_ns) const {
+    int64_t unit = 1;
+    for (int i = nanos_precision; i > format.precision; --i) {
+        unit *= 10;
+    }
+    int64_t rest = epoch_ns % unit;
+    if (rest < 0) {
+        rest += unit;
+    }
+    return epoch_ns - rest;
+}
+
+long timestamp_engine::get_utc_offset() const { return utc_offset; }
+
+size_t timestamp_engine::format_now(char* out) { return format_time(now(), out); }
@@ -0,0 +1,163 @@
+#ifndef TIME_H
+#define TIME_H
+#include <ctime>
+#endif
+
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+// Number of fractional second digits in a timestamp
+enum timestamp_precision {
+    seconds_precision = 0,
+    millis_precision = 3,
+    micros_precision = 6,
+    nanos_precision = 9
+};
+
+// Layout of a timestamp
+enum timestamp_layout {
+    // HH:MM:SS[.fraction]
+    time_layout,
+    // YYYY-MM-DDTHH:MM:SS[.fraction]+hh:mm (ISO-8601 with the UTC offset)
+    iso8601_layout
+};
+
+// Clock the timestamps are taken from
+enum timestamp_clock {
+    // CLOCK_REALTIME, follows changes of the system time
+    realtime_clock,
+    // CLOCK_MONOTONIC anchored to the realtime at start, never goes backwards
+    monotonic_clock
+};
+
+// Timestamp settings
+struct timestamp_format {
+    timestamp_layout layout = time_layout;
+    timestamp_precision precision = seconds_precision;
+    timestamp_clock clock = realtime_clock;
+};
+
+/**
+ * @brief Cached timestamp formatting.
+ *
+ * The date and time part is converted with localtime_r only when the second
+ * changes, for all other stamps the cached prefix is copied and only the
+ * fractional digits are written. Formatting does not allocate memory.
+ * One object must be used by one thread at a time.
+ */
+class timestamp_engine {
+    // settings
+    timestamp_format format;
+
+    // realtime minus monotonic time at start, in nanoseconds (monotonic_clock)
+    int64_t monotonic_offset = 0;
+
+    // second the cached parts belong to
+    int64_t cached_second = INT64_MIN;
+
+    // formatted date/time of cached_second
+    char prefix[24];
+    size_t prefix_size = 0;
+
+    // formatted UTC offset of cached_second (iso8601_layout)
+    char suffix[8];
+    size_t suffix_size = 0;
+
+    // UTC offset in seconds of the last conversion
+    long utc_offset = 0;
+
+    // convert with utc_offset instead of localtime_r
+    bool fixed_offset = false;
+
+    /**
+     * @brief Update the cached parts for a new second.
+     *
+     * @param[in] second seconds since the epoch.
+     */
+    void _update_cache(const int64_t second);
+
+   public:
+    // maximum length of a formatted timestamp
+    static constexpr size_t max_size = 48;
+
+    /**
+     * @brief Class timestamp_engine constructor.
+     *
+     * @param[in] format_v timestamp settings.
+     */
+    explicit timestamp_engine(const timestamp_format& format_v = timestamp_format());
+
+    /**
+     * @brief Setter for timestamp settings.
+     *
+     * @param[in] format_v timestamp settings.
+     */
+    void set_format(const timestamp_format& format_v);
+
+    /**
+     * @brief Getter for timestamp settings.
+     *
+     * @return current timestamp settings
+     */
+    timestamp_format get_format() const;
+
+    /**
+     * @brief Convert the time without localtime_r.
+     *
+     * The UTC offset of the last conversion (or of set_format) is used, so
+     * format_time only makes async-signal-safe calls (crash handler), but does
+     * not follow a daylight saving time change.
+     *
+     * @param[in] fixed true - use the saved UTC offset, false - localtime_r.
+     */
+    void set_fixed_offset(const bool fixed);
+
+    /**
+     * @brief Current time from the selected clock.
+     *
+     * @return nanoseconds since the epoch
+     */
+    int64_t now() const;
+
+    /**
+     * @brief Format a point in time.
+     *
+     * @param[in] epoch_ns nanoseconds since the epoch.
+     * @param[out] out buffer of at least max_size bytes, not null-terminated.
+     *
+     * @return number of written bytes
+     */
+    size_t format_time(const int64_t epoch_ns, char* out);
+
+    /**
+     * @brief Cut a point in time to the precision of the timestamps.
+     *
+     * @param[in] epoch_ns nanoseconds since the epoch.
+     *
+     * @return the time the formatted timestamp shows
+     */
+    int64_t shown_time(const int64_t epoch_ns) const;
+
+    /**
+     * @brief Getter for the UTC offset of the last formatted timestamp.
+     *
+     * @return offset in seconds
+     */
+    long get_utc_offset() const;
+
+    /**
+     * @brief Format the current time.
+     *
+     * @param[out] out buffer of at least max_size bytes, not null-terminated.
+     *
+     * @return number of written bytes
+     */
+    size_t format_now(char* out);
+};
+#endif
@@ -0,0 +1,184 @@
+#include "writer_pool.h"
+
+#include "crash_handler.h"
+
+// коментарии в header (.h) файле или наведитесь курсором на функцию
+
+writer_pool::writer_pool(const size_t threads) {
+    const size_t count = threads == 0 ? 1 : threads;
+    for (size_t i = 0; i < count; ++i) {
+        workers.push_back(std::make_unique<writer_worker>());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        workers[i]->thread = std::thread(&writer_pool::_worker_loop, this, i);
+    }
+}
+
+writer_pool::~writer_pool() {
+    shutdown.store(true);
+    for (const auto& worker : workers) {
+        {
+            std::lock_guard<std::mutex> guard(worker->lock);
+        }
+        worker->wake.notify_one();
+    }
+    for (const auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void writer_pool::_worker_loop(const size_t index) {
+    install_crash_stack();
+    writer_worker& self = *workers[index];
+    while (true) {
+        bool stolen = false;
+        writer_lane* lane = _take(index, stolen);
+        if (lane != nullptr) {
+            if (stolen) {
+                self.stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            self.batches.fetch_add(1, std::memory_order_relaxed);
+            _run(*lane);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(self.lock);
+        // the run queues are checked again after sleeping is set, a lane queued later wakes the worker
+        self.sleeping.store(true);
+        bool backlog = !self.lanes.empty();
+        for (size_t i = 0; i < workers.size() && !backlog; ++i) {
+            backlog = workers[i]->queued.load() > 0;
+        }
+        if (!backlog && !shutdown.load()) {
+            self.wake.wait(guard);
+        }
+        self.sleeping.store(false);
+        if (!backlog && shutdown.load()) {
+            break;
+        }
+    }
+}
+
+writer_lane* writer_pool::_take(const size_t index, bool& stolen) {
+    writer_lane* result = nullptr;
+    {
+        writer_worker& self = *workers[index];
+        std::lock_guard<std::mutex> guard(self.lock);
+        if (!self.lanes.empty()) {
+            result = self.lanes.front();
+            self.lanes.pop_front();
+            self.queued.store(self.lanes.size());
+        }
+    }
+    for (size_t step = 1; result == nullptr && step < workers.size(); ++step) {
+        writer_worker& victim = *workers[(index + step) % workers.size()];
+        if (victim.queued.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.lanes.empty()) {
+            result = victim.lanes.back();
+            victim.lanes.pop_back();
+            victim.queued.store(victim.lanes.size());
+            stolen = true;
+        }
+    }
+    return result;
+}
+
+void writer_pool::_run(writer_lane& lane) {
+    lane.state.store(lane_running);
+    // pairs with the fence of schedule: a record added before the state was read is written by this batch
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool more = lane.drain();
+    uint32_t expected = lane_running;
+    if (more || !lane.state.compare_exchange_strong(expected, lane_idle)) {
+        // records are left or were added during the batch
+        lane.state.store(lane_queued);
+        _submit(lane);
+    } else if (idle_waiters.load() > 0) {
+        // the lane is not touched after it is idle, detach may destroy it now
+        {
+            std::lock_guard<std::mutex> guard(idle_lock);
+        }
+        idle_signal.notify_all();
+    }
+}
+
+void writer_pool::_submit(writer_lane& lane) {
+    writer_worker& home = *workers[lane.home];
+    bool home_sleeping = false;
+    {
+        std::lock_guard<std::mutex> guard(home.lock);
+        home.lanes.push_back(&lane);
+        home.queued.store(home.lanes.size());
+        home_sleeping = home.sleeping.load();
+    }
+    if (home_sleeping) {
+        home.wake.notify_one();
+        return;
+    }
+    // the home worker is busy, a sleeping worker steals the lane
+    for (const auto& worker : workers) {
+        if (worker.get() != &home && worker->sleeping.load()) {
+            {
+                std::lock_guard<std::mutex> guard(worker->lock);
+            }
+            worker->wake.notify_one();
+            return;
+        }
+    }
+}
+
+void writer_pool::attach(writer_lane& lane) {
+    lane.home = next_home.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    lane.state.store(lane_idle);
+    workers[lane.home]->homed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void writer_pool::detach(writer_lane& lane) {
+    idle_waiters.fetch_add(1);
+    schedule(lane);
+    {
+        std::unique_lock<std::mutex> guard(idle_lock);
+        idle_signal.wait(guard, [&] { return lane.state.load() == lane_idle; });
+    }
+    idle_waiters.fetch_sub(1);
+    workers[lane.home]->homed.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void writer_pool::schedule(writer_lane& lane) {
+    // the record is published before the state is read, the worker reads the queue after setting the state
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t state = lane.state.load(std::memory_order_relaxed);
+    while (state == lane_idle || state == lane_running) {
+        const uint32_t next = state == lane_idle ? lane_queued : lane_dirty;
+        if (lane.state.compare_exchange_weak(state, next)) {
+            if (next == lane_queued) {
+                _submit(lane);
+            }
+            break;
+        }
+    }
+}
+
+bool writer_pool::claim(writer_lane& lane) {
+    uint32_t expected = lane_idle;
+    return lane.state.compare_exchange_strong(expected, lane_running);
+}
+
+size_t writer_pool::size() const { return workers.size(); }
+
+std::vector<writer_worker_stats> writer_pool::stats() const {
+    std::vector<writer_worker_stats> result;
+    for (const auto& worker : workers) {
+        writer_worker_stats item;
+        item.lanes = worker->homed.load(std::memory_order_relaxed);
+        item.batches = worker->batches.load(std::memory_order_relaxed);
+        item.stolen = worker->stolen.load(std::memory_order_relaxed);
+        result.push_back(item);
+    }
+    return result;
+}
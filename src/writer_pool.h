@@ -0,0 +1,229 @@
+#ifndef INT_H
+#define INT_H
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#ifndef SYNC_H
+#define SYNC_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#endif
+
+#ifndef THREAD_H
+#define THREAD_H
+#include <thread>
+#endif
+
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+#include <functional>
+#endif
+
+#ifndef VECTOR_H
+#define VECTOR_H
+#include <vector>
+#endif
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+#include <atomic>
+#endif
+
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <memory>
+#endif
+
+#ifndef WRITER_POOL_H
+#define WRITER_POOL_H
+
+// States of a writer_lane
+enum writer_lane_state : uint32_t {
+    // no records, not in a run queue
+    lane_idle,
+    // in the run queue of a worker
+    lane_queued,
+    // a worker is writing its records
+    lane_running,
+    // records were added while a worker was writing, the worker queues the lane again
+    lane_dirty
+};
+
+// Writes up to one batch of records of a lane, returns true if records are left
+using writer_lane_drain = std::function<bool()>;
+
+/**
+ * @brief Records of one file served by a writer_pool.
+ *
+ * A lane is in at most one run queue and is written by at most one worker at
+ * a time, so the records of a file keep their order whichever worker writes them.
+ */
+struct writer_lane {
+    // writes a batch of records, called on a worker thread
+    writer_lane_drain drain;
+
+    // writer_lane_state
+    std::atomic<uint32_t> state{lane_idle};
+
+    // worker the lane is queued on
+    size_t home = 0;
+};
+
+// Counters of one worker of a writer_pool
+struct writer_worker_stats {
+    // lanes the worker is home of
+    size_t lanes = 0;
+    // batches written
+    uint64_t batches = 0;
+    // batches of lanes taken from the run queues of other workers
+    uint64_t stolen = 0;
+};
+
+// Thread of a writer_pool and its run queue
+struct writer_worker {
+    // protects lanes
+    std::mutex lock;
+    // lanes waiting for this worker, stolen from the back
+    std::deque<writer_lane*> lanes;
+    // length of lanes, read by the other workers without the lock
+    std::atomic<size_t> queued{0};
+    // the worker waits on it while no run queue has lanes
+    std::condition_variable wake;
+    std::atomic<bool> sleeping{false};
+    std::atomic<size_t> homed{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> stolen{0};
+    std::thread thread;
+};
+
+/**
+ * @brief Fixed number of writer threads serving any number of async_logger instances.
+ *
+ * Every lane (the queue of one async_logger, one file) is homed on a worker in
+ * turn. A producer queues an idle lane on its home worker; the worker writes a
+ * batch of its records and queues it again at the back while records are left,
+ * so busy files share the worker. A worker with an empty run queue takes a lane
+ * from the back of the run queue of a busy worker, and is woken for it when a
+ * lane is queued on a worker that is not sleeping.
+ */
+class writer_pool {
+    std::vector<std::unique_ptr<writer_worker>> workers;
+
+    // home of the next lane
+    std::atomic<size_t> next_home{0};
+
+    // worker stop flag
+    std::atomic<bool> shutdown{false};
+
+    // detach waits on it for a lane to become idle
+    std::mutex idle_lock;
+    std::condition_variable idle_signal;
+    std::atomic<size_t> idle_waiters{0};
+
+    /**
+     * @brief Worker thread loop.
+     *
+     * Writes the lanes of its run queue, steals when it is empty and sleeps
+     * while all run queues are empty.
+     *
+     * @param[in] index worker index.
+     */
+    void _worker_loop(const size_t index);
+
+    /**
+     * @brief Take a lane from the own run queue or from the back of another one.
+     *
+     * @param[in] index worker index.
+     * @param[out] stolen true if the lane is taken from another worker.
+     *
+     * @return lane, nullptr if all run queues are empty
+     */
+    writer_lane* _take(const size_t index, bool& stolen);
+
+    /**
+     * @brief Write a batch of a lane and queue it again if records are left (worker thread).
+     *
+     * @param[in] lane lane in lane_queued state.
+     */
+    void _run(writer_lane& lane);
+
+    /**
+     * @brief Put a lane in the run queue of its home and wake a worker for it.
+     *
+     * @param[in] lane lane in lane_queued state.
+     */
+    void _submit(writer_lane& lane);
+
+   public:
+    /**
+     * @brief Class writer_pool constructor.
+     *
+     * @param[in] threads number of workers, at least 1.
+     */
+    explicit writer_pool(const size_t threads);
+
+    /**
+     * @brief Class writer_pool destructor.
+     *
+     * Stops the workers; the async_logger instances using the pool must be destroyed first.
+     */
+    ~writer_pool();
+
+    writer_pool(const writer_pool&) = delete;
+    writer_pool& operator=(const writer_pool&) = delete;
+
+    /**
+     * @brief Home a lane on the next worker (any thread).
+     *
+     * @param[in] lane idle lane.
+     */
+    void attach(writer_lane& lane);
+
+    /**
+     * @brief Write the rest of a lane and forget it (any thread).
+     *
+     * Queues the lane once more and waits until it is idle; no worker touches
+     * the lane afterwards. New records must not be added to the lane.
+     *
+     * @param[in] lane lane.
+     */
+    void detach(writer_lane& lane);
+
+    /**
+     * @brief Queue a lane after a record is added to it (producer thread).
+     *
+     * An idle lane is queued on its home worker, a running lane is marked so
+     * that its worker writes it again; otherwise nothing is done.
+     *
+     * @param[in] lane lane.
+     */
+    void schedule(writer_lane& lane);
+
+    /**
+     * @brief Take an idle lane away from the workers (crash handler).
+     *
+     * Async-signal-safe. After success no worker writes the lane again.
+     *
+     * @param[in] lane lane.
+     *
+     * @return false if the lane is queued or a worker is writing it
+     */
+    bool claim(writer_lane& lane);
+
+    /**
+     * @brief Getter for the number of workers.
+     *
+     * @return number of workers
+     */
+    size_t size() const;
+
+    /**
+     * @brief Counters of the workers (any thread).
+     *
+     * @return snapshot, one element per worker
+     */
+    std::vector<writer_worker_stats> stats() const;
+};
+#endif